@@ -40,6 +40,7 @@ extern DaedalusConfig	g_DaedalusConfig;
 extern bool gDynarecEnabled;			// Use dynamic recompilation
 extern bool gDynarecLoopOptimisation;	// Enable the dynarec loop optmisation
 extern bool gDynarecDoublesOptimisation;	// Enable the dynarec loop optmisation
+extern bool gCachedInterpreterEnabled;	// Use the pre-decoded interpreter when the dynarec is off
 extern bool gOSHooksEnabled;			// Apply os-hooks
 extern u32	gSpeedSyncEnabled;
 extern bool gDoubleDisplayEnabled;
@@ -51,6 +52,7 @@ extern bool gCheatsEnabled;
 //ToDo: Needs moving to Graphics plugin config
 extern bool	gCleanSceneEnabled;
 extern bool	gClearDepthFrameBuffer;
+extern bool	gThreadedDisplayLists;
 extern u32	gCheckTextureHashFrequency;
 //ToDo: Needs moving to Input plugin config
 extern u32	gControllerIndex;
@@ -65,4 +67,36 @@ enum EAudioPluginMode
 
 extern EAudioPluginMode gAudioPluginEnabled;
 
+// How CAudioBuffer converts from the N64 DAC rate to the output rate
+enum EAudioResampleQuality
+{
+	ARQ_LINEAR,			// Cheapest. Dull when upsampling and aliases when downsampling
+	ARQ_CUBIC,			// 4 tap Catmull-Rom
+	ARQ_SINC,			// 16 tap windowed sinc, band limited when downsampling
+};
+
+#ifdef DAEDALUS_LINUX
+// Where the Linux audio plugin sends its output
+enum EAudioOutput
+{
+	AO_DEVICE,			// The default SDL device (PulseAudio/ALSA)
+	AO_NULL,			// Nowhere, but still consumed in real time
+	AO_WAVE_FILE,		// gAudioOutputFilename
+};
+
+extern EAudioOutput	gAudioOutput;
+extern IO::Filename	gAudioOutputFilename;
+extern EAudioResampleQuality	gAudioResampleQuality;
+
+// Where the Linux front end renders to
+enum EVideoOutput
+{
+	VO_WINDOW,			// An SDL window
+	VO_HEADLESS,		// An offscreen framebuffer, on a surfaceless EGL context. No window or display needed
+	VO_NULL,			// As VO_HEADLESS, but display lists are processed without drawing anything
+};
+
+extern EVideoOutput	gVideoOutput;
+#endif
+
 #endif // CONFIG_CONFIGOPTIONS_H_
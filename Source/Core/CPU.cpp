@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Config/ConfigOptions.h"
 #include "Core/Cheats.h"
+#include "Core/DMA.h"
 #include "Core/Dynamo.h"
 #include "Core/Interpret.h"
 #include "Core/Interrupt.h"
@@ -41,6 +42,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/SaveState.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
+#include "HLEAudio/audiohle.h"
 #include "OSHLE/ultra_R4300.h"
 #include "System/System.h"
 #include "Utility/AtomicPrimitives.h"
@@ -84,9 +86,13 @@ enum ESaveStateOperation
 	SSO_NONE,
 	SSO_SAVE,
 	SSO_LOAD,
+	SSO_RESTORE_SNAPSHOT,
 };
 
 static ESaveStateOperation		gSaveStateOperation(SSO_NONE);
+static u32						gRestoreSnapshotAge = 0;
+static u32						gSnapshotInterval = 0;		// In VBLs, 0 if we're not taking snapshots
+static u32						gVblsSinceSnapshot = 0;
 
 const  u32			kInitialVIInterruptCycles = 62500;
 static u32			gVerticalInterrupts = 0;
@@ -129,6 +135,154 @@ void CPU_UnregisterVblCallback(VblCallbackFn fn, void * arg)
 	}
 }
 
+//*****************************************************************************
+// Event scheduler
+//*****************************************************************************
+// Pending events are kept in a binary min-heap ordered by deadline. Each type
+// of event can only be pending once, and we track where it lives in the heap so
+// that it can be rescheduled or cancelled without a search. Deadlines are
+// absolute times on gEventClock and are compared with wrapping arithmetic, so
+// the clock is free to overflow.
+//
+// The interpreter and dynarec only ever touch gCPUState.NextEvent.mCount, which
+// counts down to the top of the heap. It's reloaded whenever the top changes.
+struct CPUEventEntry
+{
+	u32				mDeadline;
+	u32				mSequence;		// Breaks ties - the most recently added event fires first
+	ECPUEventType	mEventType;
+};
+
+static const u32		kEventNotPending = ~0u;
+
+static CPUEventEntry	gEventHeap[ MAX_CPU_EVENTS ];
+static u32				gEventHeapIndex[ NUM_CPU_EVENT_TYPES ];	// Heap index of each pending event type
+static u32				gEventClock    = 0;		// Time at which NextEvent.mCount was last reloaded
+static s32				gEventReload   = 0;		// The value NextEvent.mCount was last reloaded with
+static u32				gEventSequence = 0;
+
+static inline bool CPU_EventDueBefore( const CPUEventEntry & a, const CPUEventEntry & b )
+{
+	s32 delta = s32( a.mDeadline - b.mDeadline );
+	return delta < 0 || ( delta == 0 && s32( a.mSequence - b.mSequence ) > 0 );
+}
+
+static inline void CPU_SetEventHeapEntry( u32 idx, const CPUEventEntry & entry )
+{
+	gEventHeap[ idx ] = entry;
+	gEventHeapIndex[ entry.mEventType ] = idx;
+}
+
+static void CPU_SiftEventUp( u32 idx )
+{
+	CPUEventEntry entry = gEventHeap[ idx ];
+	while( idx > 0 )
+	{
+		u32 parent = ( idx - 1 ) / 2;
+		if( !CPU_EventDueBefore( entry, gEventHeap[ parent ] ) )
+			break;
+
+		CPU_SetEventHeapEntry( idx, gEventHeap[ parent ] );
+		idx = parent;
+	}
+	CPU_SetEventHeapEntry( idx, entry );
+}
+
+static void CPU_SiftEventDown( u32 idx )
+{
+	const u32 num_events = gCPUState.NumEvents;
+
+	CPUEventEntry entry = gEventHeap[ idx ];
+	while( true )
+	{
+		u32 child = idx * 2 + 1;
+		if( child >= num_events )
+			break;
+
+		if( child + 1 < num_events && CPU_EventDueBefore( gEventHeap[ child + 1 ], gEventHeap[ child ] ) )
+			child++;
+
+		if( !CPU_EventDueBefore( gEventHeap[ child ], entry ) )
+			break;
+
+		CPU_SetEventHeapEntry( idx, gEventHeap[ child ] );
+		idx = child;
+	}
+	CPU_SetEventHeapEntry( idx, entry );
+}
+
+static void CPU_SiftEvent( u32 idx )
+{
+	if( idx > 0 && CPU_EventDueBefore( gEventHeap[ idx ], gEventHeap[ ( idx - 1 ) / 2 ] ) )
+	{
+		CPU_SiftEventUp( idx );
+	}
+	else
+	{
+		CPU_SiftEventDown( idx );
+	}
+}
+
+// Account for the cycles that have elapsed since NextEvent was last reloaded.
+static inline void CPU_SyncEventClock()
+{
+	gEventClock += u32( gEventReload - gCPUState.NextEvent.mCount );
+	gEventReload = gCPUState.NextEvent.mCount;
+}
+
+static void CPU_ReloadNextEvent()
+{
+	if( gCPUState.NumEvents > 0 )
+	{
+		gCPUState.NextEvent.mCount     = s32( gEventHeap[ 0 ].mDeadline - gEventClock );
+		gCPUState.NextEvent.mEventType = gEventHeap[ 0 ].mEventType;
+	}
+	else
+	{
+		// Only happens briefly while a VBL is being handled.
+		gCPUState.NextEvent.mCount     = 0x7fffffff;
+		gCPUState.NextEvent.mEventType = CPU_EVENT_VBL;
+	}
+	gEventReload = gCPUState.NextEvent.mCount;
+}
+
+static void CPU_RemoveEventAt( u32 idx )
+{
+	gEventHeapIndex[ gEventHeap[ idx ].mEventType ] = kEventNotPending;
+
+	u32 last = --gCPUState.NumEvents;
+	if( idx != last )
+	{
+		CPU_SetEventHeapEntry( idx, gEventHeap[ last ] );
+		CPU_SiftEvent( idx );
+	}
+}
+
+// NB: the caller should hold the event queue lock.
+static void CPU_ScheduleEvent( s32 count, ECPUEventType event_type )
+{
+	CPU_SyncEventClock();
+
+	// A 'negative' count (e.g. COMPARE set to just behind COUNT) fires straight away.
+	if( count < 0 )
+		count = 0;
+
+	CPUEventEntry entry;
+	entry.mDeadline  = gEventClock + count;
+	entry.mSequence  = gEventSequence++;
+	entry.mEventType = event_type;
+
+	u32 idx = gEventHeapIndex[ event_type ];
+	if( idx == kEventNotPending )
+	{
+		idx = gCPUState.NumEvents++;
+	}
+	CPU_SetEventHeapEntry( idx, entry );
+	CPU_SiftEvent( idx );
+
+	CPU_ReloadNextEvent();
+}
+
 void CPU_SkipToNextEvent()
 {
 	LOCK_EVENT_QUEUE();
@@ -136,91 +290,60 @@ void CPU_SkipToNextEvent()
 #ifdef DAEDALUS_ENABLE_ASSERTS
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "There are no events" );
 	#endif
-	gCPUState.CPUControl[C0_COUNT]._u32 += (gCPUState.Events[ 0 ].mCount - 1);
-	gCPUState.Events[ 0 ].mCount = 1;
+	gCPUState.CPUControl[C0_COUNT]._u32 += (gCPUState.NextEvent.mCount - 1);
+	gCPUState.NextEvent.mCount = 1;
 }
 
 static void CPU_ResetEventList()
 {
-	gCPUState.Events[ 0 ].mCount     = kInitialVIInterruptCycles;
-	gCPUState.Events[ 0 ].mEventType = CPU_EVENT_VBL;
-	gCPUState.NumEvents = 1;
-
 	RESET_EVENT_QUEUE_LOCK();
+
+	for( u32 i = 0; i < NUM_CPU_EVENT_TYPES; ++i )
+	{
+		gEventHeapIndex[ i ] = kEventNotPending;
+	}
+	gCPUState.NumEvents = 0;
+	gCPUState.NextEvent.mCount = 0;
+	gEventClock = 0;
+	gEventReload = 0;
+	gEventSequence = 0;
+
+	CPU_ScheduleEvent( kInitialVIInterruptCycles, CPU_EVENT_VBL );
 }
 
+// If an event of this type is already pending, it's rescheduled.
 void CPU_AddEvent( s32 count, ECPUEventType event_type )
 {
 	LOCK_EVENT_QUEUE();
 #ifdef DAEDALUS_ENABLE_ASSERTS
 	DAEDALUS_ASSERT( count > 0, "Count is invalid" );
-	DAEDALUS_ASSERT( gCPUState.NumEvents < MAX_CPU_EVENTS, "Too many events" );
+	DAEDALUS_ASSERT( event_type > 0 && event_type < NUM_CPU_EVENT_TYPES, "Invalid event type" );
 #endif
-	u32 event_idx = 0;
-	for( event_idx = 0; event_idx < gCPUState.NumEvents; ++event_idx )
-	{
-		CPUEvent & event = gCPUState.Events[ event_idx ];
+	CPU_ScheduleEvent( count, event_type );
+}
 
-		if( count <= event.mCount )
-		{
-			//
-			//	This event belongs before the subsequent one so insert a space for it here and break out
-			//	Don't forget to decrement the counter for the subsequent event
-			//
-			event.mCount -= count;
-
-			u32 num_to_copy  = gCPUState.NumEvents - event_idx;
-			if( num_to_copy > 0 )
-			{
-				memmove( &gCPUState.Events[ event_idx+1 ], &gCPUState.Events[ event_idx ], num_to_copy * sizeof( CPUEvent ) );
-			}
-			break;
-		}
+void CPU_RemoveEvent( ECPUEventType event_type )
+{
+	LOCK_EVENT_QUEUE();
 
-		//
-		//	Decrease counter by that for this event
-		//
-		count -= event.mCount;
-	}
-#ifdef DAEDALUS_ENABLE_ASSERTS
-	DAEDALUS_ASSERT( event_idx <= gCPUState.NumEvents, "Invalid idx" );
-	#endif
-	gCPUState.Events[ event_idx ].mCount = count;
-	gCPUState.Events[ event_idx ].mEventType = event_type;
-	gCPUState.NumEvents++;
+	u32 idx = gEventHeapIndex[ event_type ];
+	if( idx == kEventNotPending )
+		return;
+
+	CPU_SyncEventClock();
+	CPU_RemoveEventAt( idx );
+	CPU_ReloadNextEvent();
 }
 
 static void CPU_SetCompareEvent( s32 count )
 {
-	{
-		LOCK_EVENT_QUEUE();
+	LOCK_EVENT_QUEUE();
 
 #ifdef DAEDALUS_ENABLE_ASSERTS
-		DAEDALUS_ASSERT( count > 0, "Count is invalid" );
+	DAEDALUS_ASSERT( count > 0, "Count is invalid" );
 #endif
-		//
-		//	Remove any existing compare events. Need to adjust any subsequent timer's count.
-		//
-		for( u32 i = 0; i < gCPUState.NumEvents; ++i )
-		{
-			if( gCPUState.Events[ i ].mEventType == CPU_EVENT_COMPARE )
-			{
-				//
-				//	Check for a following event, and remove
-				//
-				if( i+1 < gCPUState.NumEvents )
-				{
-					gCPUState.Events[ i+1 ].mCount += gCPUState.Events[ i ].mCount;
-					u32 num_to_copy = gCPUState.NumEvents - (i+1);
-					memmove( &gCPUState.Events[ i ], &gCPUState.Events[ i+1 ], num_to_copy * sizeof( CPUEvent ) );
-				}
-				gCPUState.NumEvents--;
-				break;
-			}
-		}
-	}
-
-	CPU_AddEvent( count, CPU_EVENT_COMPARE );
+	// Replaces any existing compare event.
+	CPU_ScheduleEvent( count, CPU_EVENT_COMPARE );
 }
 
 static ECPUEventType CPU_PopEvent()
@@ -229,18 +352,14 @@ static ECPUEventType CPU_PopEvent()
 
 #ifdef DAEDALUS_ENABLE_ASSERTS
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "Event queue empty" );
-	DAEDALUS_ASSERT( gCPUState.Events[ 0 ].mCount <= 0, "Popping event when cycles remain" );
-	//DAEDALUS_ASSERT( gCPUState.Events[ 0 ].mCount == 0, "Popping event with a bit of underflow" );
+	DAEDALUS_ASSERT( gCPUState.NextEvent.mCount <= 0, "Popping event when cycles remain" );
 #endif
 
-	ECPUEventType event_type = gCPUState.Events[ 0 ].mEventType;
+	ECPUEventType event_type = gEventHeap[ 0 ].mEventType;
 
-	u32	num_to_copy = gCPUState.NumEvents - 1;
-	if( num_to_copy > 0 )
-	{
-		memmove( &gCPUState.Events[ 0 ], &gCPUState.Events[ 1 ], num_to_copy * sizeof( CPUEvent ) );
-	}
-	gCPUState.NumEvents--;
+	CPU_SyncEventClock();
+	CPU_RemoveEventAt( 0 );
+	CPU_ReloadNextEvent();
 
 	return event_type;
 }
@@ -248,28 +367,20 @@ static ECPUEventType CPU_PopEvent()
 // XXXX This is for savestate. Looks very suspicious to me
 u32 CPU_GetVideoInterruptEventCount()
 {
-	for( u32 i = 0; i < gCPUState.NumEvents; ++i )
-	{
-		if(gCPUState.Events[ i ].mEventType == CPU_EVENT_VBL)
-		{
-			return gCPUState.Events[ i ].mCount;
-		}
-	}
+	u32 idx = gEventHeapIndex[ CPU_EVENT_VBL ];
+	if( idx == kEventNotPending )
+		return 0;
 
-	return 0;
+	u32 now = gEventClock + u32( gEventReload - gCPUState.NextEvent.mCount );
+	return gEventHeap[ idx ].mDeadline - now;
 }
 
 // XXXX This is for savestate. Looks very suspicious to me
 void CPU_SetVideoInterruptEventCount( u32 count )
 {
-	for( u32 i = 0; i < gCPUState.NumEvents; ++i )
-	{
-		if(gCPUState.Events[ i ].mEventType == CPU_EVENT_VBL)
-		{
-			gCPUState.Events[ i ].mCount = count;
-			return;
-		}
-	}
+	LOCK_EVENT_QUEUE();
+
+	CPU_ScheduleEvent( count, CPU_EVENT_VBL );
 }
 
 void SCPUState::ClearStuffToDo()
@@ -338,6 +449,10 @@ bool CPU_RomOpen()
 	gCPUStopOnSimpleState = false;
 	RESET_EVENT_QUEUE_LOCK();
 
+	// Snapshots from the last rom are no use to this one
+	SaveState_ClearSnapshots();
+	gVblsSinceSnapshot = 0;
+
 	memset(&gCPUState, 0, sizeof(gCPUState));
 
 	CPU_SetPC( 0xbfc00000 );
@@ -386,6 +501,7 @@ bool CPU_RomOpen()
 #endif
 
 	Dynamo_Reset();
+	Inter_Reset();
 
 	CPU_SelectCore();
 	return true;
@@ -460,14 +576,49 @@ bool CPU_RequestLoadState( const char * filename )
 	return true;	// XXXX could fail
 }
 
+bool CPU_RequestRestoreSnapshot( u32 age )
+{
+	MutexLock lock( &gSaveStateMutex );
+
+	// Abort if already in the process of loading/saving
+	if( gSaveStateOperation != SSO_NONE )
+	{
+		return false;
+	}
+
+	gSaveStateOperation = SSO_RESTORE_SNAPSHOT;
+	gRestoreSnapshotAge = age;
+	gCPUState.AddJob(CPU_CHANGE_CORE);
+
+	return true;
+}
+
+void CPU_SetSnapshotInterval( u32 vbls )
+{
+	gSnapshotInterval = vbls;
+	gVblsSinceSnapshot = 0;
+}
+
 static void HandleSaveStateOperationOnVerticalBlank()
 {
 	#ifdef DAEDALUS_ENABLE_ASSERTS
 		DAEDALUS_ASSERT(gCPURunning, "Expecting the CPU to be running at this point");
 	#endif
-	if( gSaveStateOperation == SSO_NONE )
+	bool take_snapshot = false;
+	if( gSnapshotInterval > 0 && ++gVblsSinceSnapshot >= gSnapshotInterval )
+	{
+		take_snapshot = true;
+		gVblsSinceSnapshot = 0;
+	}
+
+	if( gSaveStateOperation == SSO_NONE && !take_snapshot )
 		return;
 
+	// Don't snapshot the rsp/rdp halfway through a threaded display list,
+	// or RDRAM while an async audio list is still writing to it
+	RSP_HLE_SyncGraphicsTask();
+	Audio_WaitForUcode();
+
 	MutexLock lock( &gSaveStateMutex );
 
 	//
@@ -476,9 +627,6 @@ static void HandleSaveStateOperationOnVerticalBlank()
 	switch( gSaveStateOperation )
 	{
 	case SSO_NONE:
-	#ifdef DAEDALUS_DEBUG_CONSOLE
-		DAEDALUS_ERROR( "Unreachable" );
-		#endif
 		break;
 	case SSO_SAVE:
 		#ifdef DAEDALUS_DEBUG_CONSOLE
@@ -506,8 +654,23 @@ static void HandleSaveStateOperationOnVerticalBlank()
 			// Halt the CPU so that we can swap the rom safely and load the savesate.
 			CPU_Halt("Load SaveSate");
 			// NB: return without clearing gSaveStateOperation
+			return;
 		}
 		break;
+	case SSO_RESTORE_SNAPSHOT:
+		if (SaveState_RestoreSnapshot( gRestoreSnapshotAge ))
+		{
+			CPU_ResetFragmentCache();
+		}
+		gSaveStateOperation = SSO_NONE;
+		gVblsSinceSnapshot = 0;
+		take_snapshot = false;	// We'd just be storing the state we restored
+		break;
+	}
+
+	if( take_snapshot )
+	{
+		SaveState_TakeSnapshot();
 	}
 }
 
@@ -711,6 +874,9 @@ void CPU_HANDLE_COUNT_INTERRUPT()
 		break;
 	case CPU_EVENT_AUDIO:
 		{
+			// An async list may still be running on another thread
+			Audio_WaitForUcode();
+
 			u32 status = Memory_SP_SetRegisterBits(SP_STATUS_REG, SP_STATUS_TASKDONE|SP_STATUS_YIELDED|SP_STATUS_BROKE|SP_STATUS_HALT);
 			if( status & SP_STATUS_INTR_BREAK )
 				CPU_AddEvent(4000, CPU_EVENT_SPINT);
@@ -720,6 +886,12 @@ void CPU_HANDLE_COUNT_INTERRUPT()
 		Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SP);
 		R4300_Interrupt_UpdateCause3();
 		break;
+	case CPU_EVENT_SI_DMA:
+		DMA_SI_Complete();
+		break;
+	case CPU_EVENT_PI_DMA:
+		DMA_PI_Complete();
+		break;
 	default:
 		NODEFAULT;
 	}
@@ -883,6 +1055,11 @@ bool CPU_CheckStuffToDo()
 			R4300_Handle_Exception();
 			gCPUState.ClearJob( CPU_CHECK_EXCEPTIONS );
 		}
+		else if( gCPUState.GetStuffToDo() & CPU_GRAPHICS_TASK_DONE )
+		{
+			gCPUState.ClearJob( CPU_GRAPHICS_TASK_DONE );
+			RSP_HLE_FinishGraphicsTask();
+		}
 		else if( gCPUState.GetStuffToDo() & CPU_CHANGE_CORE )
 		{
 			gCPUState.ClearJob( CPU_CHANGE_CORE );
@@ -57,6 +57,7 @@ struct DBG_BreakPoint
 #define CPU_CHECK_INTERRUPTS				0x00000002
 #define CPU_STOP_RUNNING					0x00000008
 #define CPU_CHANGE_CORE						0x00000010
+#define CPU_GRAPHICS_TASK_DONE				0x00000020
 
 //*****************************************************************************
 // External declarations
@@ -73,10 +74,14 @@ enum	ECPUEventType
 	CPU_EVENT_COMPARE,
 	CPU_EVENT_AUDIO,
 	CPU_EVENT_SPINT,
+	CPU_EVENT_SI_DMA,
+	CPU_EVENT_PI_DMA,
+
+	NUM_CPU_EVENT_TYPES
 };
 
-// In practice there should only ever be 2
-#define MAX_CPU_EVENTS 4
+// Each type of event can only be pending once, so this is also the size of the event heap
+#define MAX_CPU_EVENTS (NUM_CPU_EVENT_TYPES - 1)
 
 struct CPUEvent
 {
@@ -130,8 +135,8 @@ ALIGNED_TYPE(struct, SCPUState, CACHE_ALIGN)
 	REG32			Temp3;				// 0x2A8	Temp storage Dynarec
 	REG32			Temp4;				// 0x2AC	Temp storage Dynarec
 
-	CPUEvent		Events[ MAX_CPU_EVENTS ];	// 0x2B0 //In practice there should only ever be 2 CPU_EVENTS
-	u32				NumEvents;
+	CPUEvent		NextEvent;			// 0x2B0 The earliest pending event. mCount is decremented as ops are executed and it's due when <= 0
+	u32				NumEvents;			// 0x2B8 Number of pending events (the rest of the scheduler lives in CPU.cpp)
 
 	void			AddJob( u32 job );
 	void			ClearJob( u32 job );
@@ -161,6 +166,8 @@ void	CPU_Skip();
 bool	CPU_Run();
 bool	CPU_RequestSaveState( const char * filename );
 bool	CPU_RequestLoadState( const char * filename );
+bool	CPU_RequestRestoreSnapshot( u32 age );			// See SaveState_RestoreSnapshot
+void	CPU_SetSnapshotInterval( u32 vbls );				// Take an in-memory snapshot every vbls VBLs, 0 to stop
 void	CPU_Halt( const char * reason );
 void	CPU_SelectCore();
 u32		CPU_GetVideoInterruptEventCount();
@@ -175,6 +182,7 @@ void	CPU_EnableBreakPoint( u32 address, bool enable );		// Enable/Disable the br
 #endif
 bool	CPU_IsRunning();
 void	CPU_AddEvent( s32 count, ECPUEventType event_type );
+void	CPU_RemoveEvent( ECPUEventType event_type );
 void	CPU_SkipToNextEvent();
 bool	CPU_CheckStuffToDo();
 
@@ -254,8 +262,8 @@ inline bool CPU_ProcessEventCycles( u32 cycles )
 #ifdef DAEDALUS_ENABLE_ASSERTS
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "There are no events" );
 	#endif
-	gCPUState.Events[ 0 ].mCount -= cycles;
-	return gCPUState.Events[ 0 ].mCount <= 0;
+	gCPUState.NextEvent.mCount -= cycles;
+	return gCPUState.NextEvent.mCount <= 0;
 }
 
 #ifdef DAEDALUS_PROFILE_EXECUTION
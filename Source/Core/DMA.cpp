@@ -103,6 +103,8 @@ void DMA_SP_CopyToRDRAM()
 	u32 spmem_address = (spmem_address_reg&0x0FFF)		& ~7;	// Align to 8 byte boundary
 	u32 length = ((wrlen_reg    &0x0FFF) | 7)+1;				// Round up to 8 bytes
 
+	RSP_HLE_SyncAudioTask();
+
 #ifdef FAST_DMA_SP
 	if((spmem_address_reg & 0x1000) == 0)
 	{
@@ -135,6 +137,57 @@ void DMA_SP_CopyToRDRAM()
 	Memory_SP_ClrRegisterBits(SP_STATUS_REG, SP_STATUS_DMA_BUSY);
 }
 
+// The data is copied as soon as the DMA is started, but the interrupt is raised
+// (and the busy flag cleared) after roughly the time the transfer would take on
+// hardware. Counts are in COUNT register units (see VI_INTR_CYCLES).
+static const s32 kSIDMACycles = 100;
+
+static inline s32 PI_DMACycles( u32 length )
+{
+	// The cart bus manages about 8 bytes per count
+	return s32( length / 8 ) + 1;
+}
+
+static void DMA_SI_Start()
+{
+	Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_DMA_BUSY);
+	CPU_AddEvent(kSIDMACycles, CPU_EVENT_SI_DMA);
+}
+
+void DMA_SI_Complete()
+{
+	Memory_SI_ClrRegisterBits(SI_STATUS_REG, SI_STATUS_DMA_BUSY);
+	Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_INTERRUPT);
+	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SI);
+	R4300_Interrupt_UpdateCause3();
+}
+
+static void DMA_PI_Start( u32 length )
+{
+	Memory_PI_SetRegisterBits(PI_STATUS_REG, PI_STATUS_DMA_BUSY);
+	CPU_AddEvent(PI_DMACycles( length ), CPU_EVENT_PI_DMA);
+}
+
+void DMA_PI_Complete()
+{
+	Memory_PI_ClrRegisterBits(PI_STATUS_REG, PI_STATUS_DMA_BUSY);
+	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_PI);
+	R4300_Interrupt_UpdateCause3();
+}
+
+// Finish any transfers that are in flight straight away (e.g. after loading a savestate,
+// where the event list isn't restored).
+void DMA_CompletePending()
+{
+	CPU_RemoveEvent(CPU_EVENT_SI_DMA);
+	CPU_RemoveEvent(CPU_EVENT_PI_DMA);
+
+	if (Memory_SI_GetRegister(SI_STATUS_REG) & SI_STATUS_DMA_BUSY)
+		DMA_SI_Complete();
+	if (Memory_PI_GetRegister(PI_STATUS_REG) & PI_STATUS_DMA_BUSY)
+		DMA_PI_Complete();
+}
+
 //*****************************************************************************
 // Copy 64bytes from DRAM to PIF_RAM
 //*****************************************************************************
@@ -151,9 +204,7 @@ void DMA_SI_CopyFromDRAM( )
 		dst[i] = BSWAP32(src[i]);
 	}
 
-	Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_INTERRUPT);
-	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SI);
-	R4300_Interrupt_UpdateCause3();
+	DMA_SI_Start();
 }
 
 //*****************************************************************************
@@ -170,18 +221,23 @@ void DMA_SI_CopyToDRAM( )
 
 	DPF( DEBUG_MEMORY_PIF, "PIF -> DRAM (0x%08x) Transfer ", mem );
 
+	RSP_HLE_SyncAudioTask();
+
 	for(u32 i = 0; i < 16; i++)
 	{
 		dst[i] = BSWAP32(src[i]);
 	}
 
-	Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_INTERRUPT);
-	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SI);
-
 	//Skipping this IRQ fixes allows Body Harvest, Nightmare Creatures and Cruisn' USA to boot
-	//ToDo: Implement Delay SI, PJ64 uses that option to make these games boot..
-	if (g_ROM.GameHacks != BODY_HARVEST)
-		R4300_Interrupt_UpdateCause3();
+	//ToDo: Check whether the SI delay is enough for these now
+	if (g_ROM.GameHacks == BODY_HARVEST)
+	{
+		Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_INTERRUPT);
+		Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SI);
+		return;
+	}
+
+	DMA_SI_Start();
 }
 
 /*
@@ -256,6 +312,8 @@ void DMA_PI_CopyToRDRAM()
 
 	DPF( DEBUG_MEMORY_PI, "PI: Copying %d bytes of data from 0x%08x to 0x%08x", pi_length_reg, cart_address, mem_address );
 
+	RSP_HLE_SyncAudioTask();
+
 	if ( IsDom2Addr1( cart_address ))
 	{
 		//DBGConsole_Msg(0, "[YReading from Cart domain 2/addr1]");
@@ -319,9 +377,7 @@ void DMA_PI_CopyToRDRAM()
 		DBGConsole_Msg(0, "PIXFer: Not copying, but issuing interrupt");
 	}
 #endif
-	Memory_PI_ClrRegisterBits(PI_STATUS_REG, PI_STATUS_DMA_BUSY);
-	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_PI);
-	R4300_Interrupt_UpdateCause3();
+	DMA_PI_Start( pi_length_reg );
 }
 //*****************************************************************************
 //
@@ -350,7 +406,7 @@ void DMA_PI_CopyFromRDRAM()
 		cart_address -= PI_DOM2_ADDR1;
 
 		copy_succeeded = DMA_HandleTransfer( p_dst, cart_address, dst_size, g_pu8RamBase, mem_address, gRamSize, pi_length_reg );
-		Save_MarkSaveDirty();
+		Save_MarkSaveDirty( cart_address, pi_length_reg );
 	}
 	else if ( IsDom1Addr1( cart_address ) )
 	{
@@ -370,7 +426,7 @@ void DMA_PI_CopyFromRDRAM()
 		else
 			copy_succeeded = DMA_FLASH_CopyFromDRAM(mem_address, pi_length_reg);
 
-		Save_MarkSaveDirty();
+		Save_MarkSaveDirty( cart_address, pi_length_reg );
 	}
 	else if ( IsDom1Addr2( cart_address ) )
 	{
@@ -398,7 +454,5 @@ void DMA_PI_CopyFromRDRAM()
 		DBGConsole_Msg(0, "PIXFer: Not copying, but issuing interrupt");
 	}
 #endif
-	Memory_PI_ClrRegisterBits(PI_STATUS_REG, PI_STATUS_DMA_BUSY);
-	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_PI);
-	R4300_Interrupt_UpdateCause3();
+	DMA_PI_Start( pi_length_reg );
 }
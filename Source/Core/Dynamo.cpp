@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/CPU.h"
 			// For REG_?? defines
 #include "Core/Memory.h"
+#include "Core/Interpret.h"
 #include "Core/Interrupt.h"
 #include "Core/R4300.h"
 #include "Core/Registers.h"		
@@ -111,6 +112,8 @@ void CPU_DynarecEnable()
 //*****************************************************************************
 void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length )
 {
+	Inter_InvalidateICacheRange( address, length );
+
 	if( gFragmentCache.ShouldInvalidateOnWrite( address, length ) )
 	{
 #ifndef DAEDALUS_SILENT
@@ -594,6 +597,9 @@ void Dynamo_SelectCore()
 
 void CPU_ResetFragmentCache() {}
 void Dynamo_Reset() {}
-void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length ) {}
+void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length )
+{
+	Inter_InvalidateICacheRange( address, length );
+}
 
 #endif //DAEDALUS_ENABLE_DYNAREC
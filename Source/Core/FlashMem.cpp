@@ -96,11 +96,11 @@ void Flash_DoCommand(u32 FlashRAM_Command)
 				break;
 			case FLASHRAM_MODE_ERASE:
 				memset((u8*)g_pMemoryBuffers[MEM_SAVE] + FlashRAM_Offset, 0xFF, 128);
-				Save_MarkSaveDirty();
+				Save_MarkSaveDirty(FlashRAM_Offset, 128);
 				break;
 			case FLASHRAM_MODE_WRITE:
 				memcpy((u8*)g_pMemoryBuffers[MEM_SAVE] + FlashRAM_Offset, FlashBlock, 128);
-				Save_MarkSaveDirty();
+				Save_MarkSaveDirty(FlashRAM_Offset, 128);
 				break;
 			default:
 				DBGConsole_Msg(0, "Warning: Unknown FlashRam mode: %d", FlashFlag);
@@ -156,9 +156,230 @@ void CPU_Go()
 }
 
 
+//*****************************************************************************
+//	Cached interpreter
+//
+//	Ops executed from RDRAM (through KSEG0/KSEG1) are decoded once into a
+//	per-page array of handler/opcode records, so the common path skips the
+//	memory lookup table and the second level of handler dispatch. The opcode
+//	is kept alongside the handler and checked against RAM before each use,
+//	so code patched by cheats, os hooks or the debugger without a CACHE op
+//	is simply redecoded. CPU_InvalidateICacheRange() clears the affected
+//	records. Everything else (TLB mapped code, ROM, PIF) goes through
+//	CPU_EXECUTE_OP.
+//*****************************************************************************
+namespace
+{
+struct SDecodedOp
+{
+	CPU_Instruction		Handler;
+	u32					OpBits;
+};
+
+const u32				kDecodedPageBits = 12;
+const u32				kDecodedPageSize = 1 << kDecodedPageBits;
+const u32				kDecodedPageMask = kDecodedPageSize - 1;
+const u32				kOpsPerDecodedPage = kDecodedPageSize / 4;
+const u32				kMaxDecodedPages = MAX_RAM_ADDRESS >> kDecodedPageBits;
+
+SDecodedOp *			gDecodedPages[ kMaxDecodedPages ] {};
+}
+
+//*****************************************************************************
+//	These handlers are switched by R4300_SetSR when COP1 becomes unusable,
+//	so they have to be looked up at execution time rather than decode time.
+//*****************************************************************************
+static void R4300_CALL_TYPE Inter_ExecuteTopLevelOp( R4300_CALL_SIGNATURE )
+{
+	OpCode op_code;
+	op_code._u32 = op_code_bits;
+
+	R4300_ExecuteInstruction( op_code );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static CPU_Instruction Inter_DecodeOp( OpCode op_code )
+{
+	switch( op_code.op )
+	{
+	case OP_COPRO1:
+	case OP_LWC1:
+	case OP_LDC1:
+	case OP_SWC1:
+	case OP_SDC1:
+		return Inter_ExecuteTopLevelOp;
+
+	default:
+		return R4300_GetInstructionHandler( op_code );
+	}
+}
+
+//*****************************************************************************
+//	Execute decoded ops from the page containing the current PC, until we
+//	leave the page or there is something else to do.
+//*****************************************************************************
+static void CPU_ExecuteDecodedPage( u32 physical_address )
+{
+	u32				page( physical_address >> kDecodedPageBits );
+	SDecodedOp *	p_ops( gDecodedPages[ page ] );
+	if( p_ops == nullptr )
+	{
+		p_ops = new SDecodedOp[ kOpsPerDecodedPage ]();
+		gDecodedPages[ page ] = p_ops;
+	}
+
+	const u32 *		p_ram_ops( (const u32 *)(g_pu8RamBase + (physical_address & ~kDecodedPageMask)) );
+	const u32		page_base( gCPUState.CurrentPC & ~kDecodedPageMask );
+	u32				offset( gCPUState.CurrentPC - page_base );
+
+	do
+	{
+		u32				index( offset >> 2 );
+		SDecodedOp &	decoded( p_ops[ index ] );
+		u32				op_bits( p_ram_ops[ index ] );
+
+		if( DAEDALUS_EXPECT_UNLIKELY( decoded.Handler == nullptr || decoded.OpBits != op_bits ) )
+		{
+			OpCode op_code;
+			op_code._u32 = op_bits;
+
+			decoded.Handler = Inter_DecodeOp( op_code );
+			decoded.OpBits = op_bits;
+		}
+
+		// Cache instruction base pointer (used for SpeedHack() @ R4300.0)
+		gLastAddress = (u8 *)&p_ram_ops[ index ];
+
+		decoded.Handler( op_bits );
+		gGPR[0]._u64 = 0;	//Ensure r0 is zero
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+		gTotalInstructionsEmulated++;
+#endif
+
+		// Increment count register
+		gCPUState.CPUControl[C0_COUNT]._u32 = gCPUState.CPUControl[C0_COUNT]._u32 + COUNTER_INCREMENT_PER_OP;
+
+		if (CPU_ProcessEventCycles( COUNTER_INCREMENT_PER_OP ) )
+		{
+			CPU_HANDLE_COUNT_INTERRUPT();
+		}
+
+		switch (gCPUState.Delay)
+		{
+		case DO_DELAY:
+			INCREMENT_PC();
+			gCPUState.Delay = EXEC_DELAY;
+			break;
+		case EXEC_DELAY:
+			CPU_SetPC(gCPUState.TargetPC);
+			gCPUState.Delay = NO_DELAY;
+			break;
+		case NO_DELAY:
+			INCREMENT_PC();
+			break;
+		default:
+			NODEFAULT;
+		}
+
+		// Branches, ERET etc. can move the PC anywhere, so always rederive
+		// the slot from the PC rather than stepping through the page.
+		offset = gCPUState.CurrentPC - page_base;
+	}
+	while( offset < kDecodedPageSize && gCPUState.GetStuffToDo() == 0 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CPU_GoCached()
+{
+	DAEDALUS_PROFILE( __FUNCTION__ );
+
+	while (CPU_KeepRunning())
+	{
+		u32	stuff_to_do( gCPUState.GetStuffToDo() );
+		while(stuff_to_do == 0)
+		{
+			u32 pc( gCPUState.CurrentPC );
+			u32 physical_address( pc & 0x1FFFFFFF );
+
+			// Only KSEG0/KSEG1 addresses backed by RDRAM are decoded
+			if( (pc & 0xC0000000) == 0x80000000 && physical_address < gRamSize )
+			{
+				CPU_ExecuteDecodedPage( physical_address );
+			}
+			else
+			{
+				CPU_EXECUTE_OP< false >();
+			}
+
+			stuff_to_do = gCPUState.GetStuffToDo();
+		}
+
+		if (CPU_CheckStuffToDo())
+			break;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void Inter_InvalidateICacheRange( u32 address, u32 length )
+{
+	// TLB mapped addresses are not decoded, so there's nothing to do for them
+	if( (address & 0xC0000000) != 0x80000000 || length == 0 )
+		return;
+
+	u32 start( address & 0x1FFFFFFF );
+	u32 end( start + length );
+	if( end > MAX_RAM_ADDRESS )
+		end = MAX_RAM_ADDRESS;
+
+	for( u32 current = start & ~3; current < end; )
+	{
+		u32 page_end( (current & ~kDecodedPageMask) + kDecodedPageSize );
+		u32 chunk_end( page_end < end ? page_end : end );
+
+		SDecodedOp * p_ops( gDecodedPages[ current >> kDecodedPageBits ] );
+		if( p_ops != nullptr )
+		{
+			u32 first( (current & kDecodedPageMask) >> 2 );
+			u32 last( ((chunk_end - 1) & kDecodedPageMask) >> 2 );
+			memset( &p_ops[ first ], 0, (last - first + 1) * sizeof( SDecodedOp ) );
+		}
+
+		current = page_end;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void Inter_Reset()
+{
+	for( u32 i = 0; i < kMaxDecodedPages; ++i )
+	{
+		delete [] gDecodedPages[ i ];
+		gDecodedPages[ i ] = nullptr;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
 void Inter_SelectCore()
 {
-   g_pCPUCore = CPU_Go;
+	if (gCachedInterpreterEnabled)
+	{
+		g_pCPUCore = CPU_GoCached;
+	}
+	else
+	{
+		g_pCPUCore = CPU_Go;
+	}
 }
 
 //*****************************************************************************
@@ -212,7 +212,6 @@ static void WriteValue_8440_844F( u32 address, u32 value )
 	*(u32 *)((u8 *)g_pMemoryBuffers[MEM_VI_REG] + offset) = value;
 }
 #else
-extern void RenderFrameBuffer(u32);
 extern u32 gRDPFrame;
 static void WriteValue_8440_844F( u32 address, u32 value )
 {
@@ -240,7 +239,10 @@ static void WriteValue_8440_844F( u32 address, u32 value )
 		 // NB: if no display lists executed, interpret framebuffer
 		if( gRDPFrame == 0 )
 		{
-			RenderFrameBuffer(value & 0x7FFFFF);
+			if (gGraphicsPlugin != NULL)
+			{
+				gGraphicsPlugin->RenderFrameBuffer(value & 0x7FFFFF);
+			}
 		}
 		else
 		{
@@ -608,7 +608,7 @@ void	IController::CommandReadEeprom(u8* cmd)
 
 void	IController::CommandWriteEeprom(u8* cmd)
 {
-	Save_MarkSaveDirty();
+	Save_MarkSaveDirty(cmd[3] * 8, 8);
 	memcpy(mpEepromData + cmd[3] * 8, &cmd[4], 8);
 }
 
@@ -664,7 +664,7 @@ void	IController::CommandWriteMemPack(u32 channel, u8 *cmd)
 
 	if (addr < 0x8000)
     {
-		Save_MarkMempackDirty();
+		Save_MarkMempackDirty(channel * 0x400 * 32 + addr, 32);
 		memcpy(&mMemPack[channel][addr], data, 32);
 	}
 
@@ -1172,7 +1172,6 @@ static void R4300_CALL_TYPE R4300_CACHE( R4300_CALL_SIGNATURE )
 	R4300_CALL_MAKE_OP( op_code );
 //	return;
 
-#ifdef DAEDALUS_ENABLE_DYNAREC
 	u32 cache_op  = op_code.rt;
 	u32 address = (u32)( gGPR[op_code.base]._s32_0 + (s32)(s16)op_code.immediate );
 
@@ -1186,7 +1185,6 @@ static void R4300_CALL_TYPE R4300_CACHE( R4300_CALL_SIGNATURE )
 		CPU_InvalidateICacheRange(address, 0x20);
 	}
 	//DBGConsole_Msg(0, "CACHE %s/%d, 0x%08x", gCacheNames[dwCache], dwAction, address);
-#endif
 }
 
 static void R4300_CALL_TYPE R4300_LWC1( R4300_CALL_SIGNATURE ) 				// Load Word to Copro 1 (FPU)
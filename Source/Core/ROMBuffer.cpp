@@ -55,6 +55,68 @@ namespace
 	const u32		SCRATCH_BUFFER_LENGTH = 16;
 	u8				sScratchBuffer[ SCRATCH_BUFFER_LENGTH ];
 
+#ifdef DAEDALUS_POSIX
+	// Uncompressed roms are mapped copy-on-write rather than read into the heap.
+	// If the file isn't already in our byte order, each page is swapped in place
+	// the first time something touches it, so untouched pages stay shared with
+	// the page cache (and with any other instance running the same rom).
+	// N.B. Only the emulation thread touches the rom, so there's no locking.
+	bool			sRomMapped		= false;
+	ROMFile *		spMappedRomFile	= nullptr;	// Kept to do the swapping
+	u8 *			spPageSwapped	= nullptr;	// One flag per page, or null if no swapping is needed
+	const u32		SWAP_PAGE_BITS	= 12;
+
+	bool		MapRom( ROMFile * p_rom_file, const char * filename )
+	{
+		if( p_rom_file->IsCompressed() )
+			return false;
+
+		u8 *	p_bytes( (u8*)IO::File::Map( filename, sRomSize ) );
+		if( p_bytes == nullptr )
+			return false;
+
+		if( p_rom_file->RequiresSwapping() )
+		{
+			u32		num_pages( (sRomSize + (1 << SWAP_PAGE_BITS) - 1) >> SWAP_PAGE_BITS );
+			spPageSwapped = new u8[ num_pages ];
+			memset( spPageSwapped, 0, num_pages );
+			spMappedRomFile = p_rom_file;
+		}
+		else
+		{
+			delete p_rom_file;
+		}
+
+		spRomData  = p_bytes;
+		sRomMapped = true;
+		sRomFixed  = true;
+		return true;
+	}
+#endif
+
+	// Make sure the given range of a fixed rom is byteswapped before it's accessed.
+	inline void	EnsureSwapped( u32 rom_start, u32 length )
+	{
+#ifdef DAEDALUS_POSIX
+		if( spPageSwapped == nullptr || length == 0 || rom_start >= sRomSize )
+			return;
+
+		u32		first_page( rom_start >> SWAP_PAGE_BITS );
+		u32		last_page( (Min( rom_start + length, sRomSize ) - 1) >> SWAP_PAGE_BITS );
+		for( u32 page = first_page; page <= last_page; ++page )
+		{
+			if( !spPageSwapped[ page ] )
+			{
+				u32		page_start( page << SWAP_PAGE_BITS );
+				u32		page_length( Min( u32( 1 << SWAP_PAGE_BITS ), AlignPow2( sRomSize, 4 ) - page_start ) );
+
+				spMappedRomFile->CorrectSwap( spRomData + page_start, page_length );
+				spPageSwapped[ page ] = 1;
+			}
+		}
+#endif
+	}
+
 	bool		ShouldLoadAsFixed( u32 rom_size )
 	{
 #ifdef DAEDALUS_PSP
@@ -198,6 +260,16 @@ bool RomBuffer::Open()
 
 	sRomSize = p_rom_file->GetRomSize();
 
+#ifdef DAEDALUS_POSIX
+	// On success this takes ownership of p_rom_file
+	if( ShouldLoadAsFixed( sRomSize ) && MapRom( p_rom_file, filename ) )
+	{
+		DBGConsole_Msg(0, "Mapped [C%s]\n", filename);
+		sRomLoaded = true;
+		return true;
+	}
+#endif
+
 	if( ShouldLoadAsFixed( sRomSize ) )
 	{
 		// Now, allocate memory for rom - round up to a 4 byte boundry
@@ -314,6 +386,20 @@ bool RomBuffer::Open()
 //*****************************************************************************
 void	RomBuffer::Close()
 {
+#ifdef DAEDALUS_POSIX
+	if (sRomMapped)
+	{
+		IO::File::Unmap( spRomData, sRomSize );
+		spRomData = nullptr;
+
+		delete [] spPageSwapped;
+		spPageSwapped = nullptr;
+		delete spMappedRomFile;
+		spMappedRomFile = nullptr;
+		sRomMapped = false;
+	}
+#endif
+
 	if (spRomData)
 	{
 		CROMFileMemory::Get()->Free( spRomData );
@@ -383,6 +469,7 @@ void	RomBuffer::GetRomBytesRaw( void * p_dst, u32 rom_start, u32 length )
 {
 	if( sRomFixed )
 	{
+		EnsureSwapped( rom_start, length );
 		memcpy(p_dst, (const u8*)spRomData + rom_start, length );
 	}
 	else
@@ -408,6 +495,7 @@ void	RomBuffer::SaveRomValue( u32 value )
 void	RomBuffer::PutRomBytesRaw( u32 rom_start, const void * p_src, u32 length )
 {
 	DAEDALUS_ASSERT( sRomFixed, "Cannot put rom bytes when the data isn't fixed" );
+	EnsureSwapped( rom_start, length );
 	memcpy( (u8*)spRomData + rom_start, p_src, length );
 }
 
@@ -427,6 +515,7 @@ void * RomBuffer::GetAddressRaw( u32 rom_start )
 	{
 		if( sRomFixed )
 		{
+			EnsureSwapped( rom_start, SCRATCH_BUFFER_LENGTH );
 			return (u8 *)spRomData + rom_start;
 		}
 		else
@@ -452,6 +541,7 @@ bool RomBuffer::CopyToRam( u8 * p_dst, u32 dst_offset, u32 dst_size, u32 src_off
 		const u8* p_src = (const u8 *)spRomData ;
 		u32	src_size = sRomSize;
 
+		EnsureSwapped( src_offset, length );
 		return DMA_HandleTransfer( p_dst, dst_offset, dst_size, p_src, src_offset, src_size, length );
 	}
 	else
@@ -500,6 +590,7 @@ bool RomBuffer::CopyFromRam( u32 dst_offset, const u8 * p_src, u32 src_offset, u
 		u8 * p_dst = (u8 *)spRomData;
 		u32	dst_size = sRomSize;
 
+		EnsureSwapped( dst_offset, length );
 		return DMA_HandleTransfer( p_dst, dst_offset, dst_size, p_src, src_offset, src_size, length );
 	}
 	else
@@ -525,5 +616,7 @@ const void * RomBuffer::GetFixedRomBaseAddress()
 	DAEDALUS_ASSERT( sRomLoaded, "The rom isn't loaded" );
 	DAEDALUS_ASSERT( sRomFixed, "Trying to access the rom base address when it's not fixed" );
 
+	// The caller can read anywhere, so this is the end of lazy swapping
+	EnsureSwapped( 0, sRomSize );
 	return spRomData;
 }
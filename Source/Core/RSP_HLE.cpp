@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
 #include "Debug/Dump.h"			// For Dump_GetDumpDirectory()
+#include "HLEAudio/audiohle.h"
 #include "Math/MathUtil.h"
 #include "OSHLE/ultra_mbi.h"
 #include "OSHLE/ultra_rcp.h"
@@ -163,7 +164,11 @@ static EProcessResult RSP_HLE_Graphics()
 
 	if (gGraphicsEnabled && gGraphicsPlugin != nullptr)
 	{
-		gGraphicsPlugin->ProcessDList();
+		if (gGraphicsPlugin->ProcessDList() == PR_STARTED)
+		{
+			// Leave the RSP running - it's halted when the render thread is done.
+			return PR_STARTED;
+		}
 	}
 	else
 	{
@@ -183,6 +188,50 @@ static EProcessResult RSP_HLE_Graphics()
 	return PR_COMPLETED;
 }
 
+// Called on the render thread.
+void RSP_HLE_SignalGraphicsTaskDone()
+{
+	gCPUState.AddJob( CPU_GRAPHICS_TASK_DONE );
+}
+
+// Called on the cpu thread, once the render thread has signalled that it's done.
+void RSP_HLE_FinishGraphicsTask()
+{
+	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_DP);
+	R4300_Interrupt_UpdateCause3();
+
+	RSP_HLE_Finished(SP_STATUS_TASKDONE|SP_STATUS_BROKE|SP_STATUS_HALT);
+
+#ifdef DAEDALUS_BATCH_TEST_ENABLED
+	if (CBatchTestEventHandler * handler = BatchTest_GetHandler())
+	{
+		handler->OnDisplayListComplete();
+	}
+#endif
+}
+
+// Block until any graphics task in flight has completed, and apply its results.
+void RSP_HLE_SyncGraphicsTask()
+{
+	if (gGraphicsPlugin != nullptr)
+	{
+		gGraphicsPlugin->WaitForDisplayLists();
+	}
+
+	if (gCPUState.IsJobSet( CPU_GRAPHICS_TASK_DONE ))
+	{
+		gCPUState.ClearJob( CPU_GRAPHICS_TASK_DONE );
+		RSP_HLE_FinishGraphicsTask();
+	}
+}
+
+// Block until any audio list in flight has completed. The SP interrupt is still
+// raised by CPU_EVENT_AUDIO, at the usual time.
+void RSP_HLE_SyncAudioTask()
+{
+	Audio_WaitForUcode();
+}
+
 
 //
 
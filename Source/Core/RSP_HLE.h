@@ -36,4 +36,16 @@ enum EProcessResult
 
 void RSP_HLE_ProcessTask();
 
+// Graphics tasks can be run asynchronously by the graphics plugin (see gThreadedDisplayLists).
+// The plugin calls RSP_HLE_SignalGraphicsTaskDone from its render thread when the task
+// completes, and the cpu thread then flags the SP/DP interrupts in RSP_HLE_FinishGraphicsTask.
+void RSP_HLE_SignalGraphicsTaskDone();
+void RSP_HLE_FinishGraphicsTask();
+void RSP_HLE_SyncGraphicsTask();
+
+// Audio tasks can also run on another thread (see Audio_UcodeAsync). Anything which
+// writes RDRAM behind the cpu's back (i.e. DMA) calls this first, so it can't change
+// sample data or mixer state under a list which is still being processed.
+void RSP_HLE_SyncAudioTask();
+
 #endif // CORE_RSP_HLE_H_
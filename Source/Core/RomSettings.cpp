@@ -298,6 +298,10 @@ bool IRomSettingsDB::OpenSettingsFile( const char * filename )
 		{
 			settings.ClearDepthFrameBuffer = p_property->GetBooleanValue( false );
 		}
+		if( p_section->FindProperty( "SyncDisplayLists", &p_property ) )
+		{
+			settings.SyncDisplayLists = p_property->GetBooleanValue( false );
+		}
 		if( p_section->FindProperty( "AudioRateMatch", &p_property ) )
 		{
 			settings.AudioRateMatch = p_property->GetBooleanValue( false );
@@ -437,6 +441,7 @@ void IRomSettingsDB::OutputSectionDetails( const RomID & id, const RomSettings &
 	if( !settings.DoubleDisplayEnabled )		fprintf(fh, "DoubleDisplayEnabled=no\n");
 	if( settings.CleanSceneEnabled )			fprintf(fh, "CleanSceneEnabled=yes\n");
 	if( settings.ClearDepthFrameBuffer )		fprintf(fh, "ClearDepthFrameBuffer=yes\n");
+	if( settings.SyncDisplayLists )				fprintf(fh, "SyncDisplayLists=yes\n");
 	if( settings.AudioRateMatch )				fprintf(fh, "AudioRateMatch=yes\n");
 	if( settings.VideoRateMatch )				fprintf(fh, "VideoRateMatch=yes\n");
 	if( settings.FogEnabled )					fprintf(fh, "FogEnabled=yes\n");
@@ -499,6 +504,7 @@ RomSettings::RomSettings()
 ,	DoubleDisplayEnabled( true )
 ,	CleanSceneEnabled( false )
 ,	ClearDepthFrameBuffer( false )
+,	SyncDisplayLists( false )
 ,	AudioRateMatch( false )
 ,	VideoRateMatch( false )
 ,	FogEnabled( false )
@@ -527,6 +533,7 @@ void	RomSettings::Reset()
 	DoubleDisplayEnabled = true;
 	CleanSceneEnabled = false;
 	ClearDepthFrameBuffer = false;
+	SyncDisplayLists = false;
 	AudioRateMatch = false;
 	VideoRateMatch = false;
 	FogEnabled = false;
@@ -66,6 +66,7 @@ struct RomSettings
 	bool				DoubleDisplayEnabled;
 	bool				CleanSceneEnabled;
 	bool				ClearDepthFrameBuffer;
+	bool				SyncDisplayLists;		// Framebuffer effects need the display list to complete before the cpu continues
 	bool				AudioRateMatch;
 	bool				VideoRateMatch;
 	bool				FogEnabled;
@@ -25,104 +25,312 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Config/ConfigOptions.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/Dump.h"
+#include "Math/MathUtil.h"
 #include "Utility/IO.h"
+#include "Utility/Job.h"
+#include "Utility/Mutex.h"
+
+#ifndef DAEDALUS_PSP
+#include "Utility/JobSystem.h"
+#endif
 
 static void InitMempackContent();
 
-static IO::Filename		gSaveFileName;
-static bool				gSaveDirty;
-static u32				gSaveSize;
-static IO::Filename		gMempackFileName;
-static bool				gMempackDirty;
+//
+// Saves are written out by a job, so a game which saves every few frames doesn't
+// stall the emulation thread on the disk. Save_Flush only copies out the blocks
+// which have changed since the last flush, into a staging copy of the file. The
+// writer takes a copy of that and writes it to a temporary file which is then
+// renamed over the old one, so a crash mid-write never leaves a torn save.
+// Flushes which arrive while a write is in progress are picked up by the same
+// writer when it finishes, rather than queueing a write each.
+//
+namespace
+{
+	// Must be a multiple of 4, so the U8_TWIDDLE swizzle never crosses a block
+	const u32 kSaveBlockBits = 9;
+	const u32 kSaveBlockSize = 1 << kSaveBlockBits;
+	const u32 kMaxSaveSize   = 128 * 1024;
+	const u32 kMaxSaveBlocks = kMaxSaveSize >> kSaveBlockBits;
+
+	struct SSaveFile
+	{
+		IO::Filename	FileName;
+		const u8 *		Memory;				// The emulated memory this file mirrors
+		u32				Size;
+		bool			Swizzled;			// Eeprom/Sram/FlashRam are kept U8_TWIDDLEd in memory
+		u32				DirtyBlocks[ kMaxSaveBlocks / 32 ];	// Changed since the last flush
+
+		// Shared with the writer, guarded by gSaveWriterMutex
+		u8 *			Staging;			// The next version of the file, in file order
+		u8 *			Writing;			// The writer's copy of Staging
+		bool			Pending;			// Staging has changed since the writer last took it
+	};
+}
+
+static SSaveFile		gSave;
+static SSaveFile		gMempack;
+
+static Mutex			gSaveWriterMutex;
+static bool				gSaveWriterBusy;	// A writer job is queued or running
+#ifndef DAEDALUS_PSP
+static JobHandle		gSaveWriterJob = kInvalidJob;
+#endif
+
+static void SaveFile_Init( SSaveFile & file, const u8 * memory, u32 size, bool swizzled )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( size <= kMaxSaveSize && (size & (kSaveBlockSize-1)) == 0, "Unexpected save size %d", size );
+	#endif
+
+	if( file.Size != size )
+	{
+		delete [] file.Staging;
+		delete [] file.Writing;
+		file.Staging = size > 0 ? new u8[ size ] : nullptr;
+		file.Writing = size > 0 ? new u8[ size ] : nullptr;
+	}
+
+	file.Memory = memory;
+	file.Size = size;
+	file.Swizzled = swizzled;
+	file.Pending = false;
+	memset( file.DirtyBlocks, 0, sizeof( file.DirtyBlocks ) );
+}
+
+static void SaveFile_Free( SSaveFile & file )
+{
+	delete [] file.Staging;
+	delete [] file.Writing;
+	file.Staging = nullptr;
+	file.Writing = nullptr;
+	file.Memory = nullptr;
+	file.Size = 0;
+	file.Pending = false;
+}
+
+static void SaveFile_MarkDirty( SSaveFile & file, u32 offset, u32 length )
+{
+	if( length == 0 || offset >= file.Size )
+		return;
+
+	u32 last( Min( offset + length, file.Size ) - 1 );
+	for( u32 block = offset >> kSaveBlockBits; block <= last >> kSaveBlockBits; ++block )
+	{
+		file.DirtyBlocks[ block / 32 ] |= 1 << (block % 32);
+	}
+}
+
+// Copies the dirty blocks into the staging buffer. Returns true if anything was copied.
+static bool SaveFile_Snapshot( SSaveFile & file )
+{
+	bool copied( false );
+	for( u32 block = 0; block < (file.Size >> kSaveBlockBits); ++block )
+	{
+		u32 & bits( file.DirtyBlocks[ block / 32 ] );
+		u32 mask( 1 << (block % 32) );
+		if( (bits & mask) == 0 )
+			continue;
+
+		bits &= ~mask;
+		copied = true;
+
+		const u8 *	src( file.Memory + (block << kSaveBlockBits) );
+		u8 *		dst( file.Staging + (block << kSaveBlockBits) );
+		if( file.Swizzled )
+		{
+			for( u32 i = 0; i < kSaveBlockSize; i++ )
+			{
+				dst[i^U8_TWIDDLE] = src[i];
+			}
+		}
+		else
+		{
+			memcpy( dst, src, kSaveBlockSize );
+		}
+	}
+
+	if( copied )
+	{
+		file.Pending = true;
+	}
+	return copied;
+}
+
+static void WriteSaveFile( const char * filename, const u8 * data, u32 size )
+{
+	IO::Filename	temp_filename;
+	IO::Path::Assign( temp_filename, filename );
+	IO::Path::AddExtension( temp_filename, ".tmp" );
+
+	FILE * fp = fopen( temp_filename, "wb" );
+	if( fp == nullptr )
+		return;
+
+	bool ok( fwrite( data, size, 1, fp ) == 1 );
+	ok &= fclose( fp ) == 0;
+
+	if( !ok )
+	{
+		#ifdef DAEDALUS_DEBUG_CONSOLE
+		DBGConsole_Msg( 0, "Failed to write save [C%s]", temp_filename );
+		#endif
+		IO::File::Delete( temp_filename );
+		return;
+	}
+
+	// Not every platform's rename will replace an existing file
+	if( !IO::File::Move( temp_filename, filename ) )
+	{
+		IO::File::Delete( filename );
+		IO::File::Move( temp_filename, filename );
+	}
+}
+
+static int SaveWriter_DoJob( SJob * arg )
+{
+	for( ;; )
+	{
+		SSaveFile * file( nullptr );
+		IO::Filename filename;
+		{
+			AUTO_CRIT_SECT( gSaveWriterMutex );
+			if( gSave.Pending )
+			{
+				file = &gSave;
+			}
+			else if( gMempack.Pending )
+			{
+				file = &gMempack;
+			}
+			else
+			{
+				gSaveWriterBusy = false;
+				return 0;
+			}
+
+			memcpy( file->Writing, file->Staging, file->Size );
+			IO::Path::Assign( filename, file->FileName );
+			file->Pending = false;
+		}
+
+		#ifdef DAEDALUS_DEBUG_CONSOLE
+		DBGConsole_Msg( 0, "Saving to [C%s]", filename );
+		#endif
+		WriteSaveFile( filename, file->Writing, file->Size );
+	}
+}
+
+static void SaveWriter_Wait()
+{
+#ifndef DAEDALUS_PSP
+	gJobSystem.WaitForJob( gSaveWriterJob );
+	gSaveWriterJob = kInvalidJob;
+#endif
+#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( !gSaveWriterBusy, "Save writer is still running" );
+#endif
+}
 
 bool Save_Reset()
 {
+	// Finish writing out the previous rom's saves before reusing the buffers
+	SaveWriter_Wait();
+
 	const char * ext;
+	u32 save_size;
 	switch (g_ROM.settings.SaveType)
 	{
 	case SAVE_TYPE_EEP4K:
 		ext = ".sav";
-		gSaveSize = 4 * 1024;
+		save_size = 4 * 1024;
 		break;
 	case SAVE_TYPE_EEP16K:
 		ext = ".sav";
-		gSaveSize = 16 * 1024;
+		save_size = 16 * 1024;
 		break;
 	case SAVE_TYPE_SRAM:
 		ext = ".sra";
-		gSaveSize = 32 * 1024;
+		save_size = 32 * 1024;
 		break;
 	case SAVE_TYPE_FLASH:
 		ext = ".fla";
-		gSaveSize = 128 * 1024;
+		save_size = 128 * 1024;
 		break;
 	default:
 		ext = "";
-		gSaveSize = 0;
+		save_size = 0;
 		break;
 	}
 
 #ifdef DAEDALUS_ENABLE_ASSERTS
-	DAEDALUS_ASSERT( gSaveSize <= MemoryRegionSizes[MEM_SAVE], "Save size is larger than allocated memory");
+	DAEDALUS_ASSERT( save_size <= MemoryRegionSizes[MEM_SAVE], "Save size is larger than allocated memory");
 	#endif
-	gSaveDirty = false;
-	if (gSaveSize > 0)
+	SaveFile_Init( gSave, (const u8*)g_pMemoryBuffers[MEM_SAVE], save_size, true );
+	if (save_size > 0)
 	{
-		Dump_GetSaveDirectory(gSaveFileName, g_ROM.mFileName, ext);
+		Dump_GetSaveDirectory(gSave.FileName, g_ROM.mFileName, ext);
 
-		FILE * fp = fopen(gSaveFileName, "rb");
+		FILE * fp = fopen(gSave.FileName, "rb");
 		if (fp != nullptr)
 		{
 			#ifdef DAEDALUS_DEBUG_CONSOLE
-			DBGConsole_Msg(0, "Loading save from [C%s]", gSaveFileName);
+			DBGConsole_Msg(0, "Loading save from [C%s]", gSave.FileName);
 			#endif
 
-			u8 buffer[2048];
 			u8 * dst = (u8*)g_pMemoryBuffers[MEM_SAVE];
 
-			for (u32 d = 0; d < gSaveSize; d += sizeof(buffer))
-			{
-				fread(buffer, sizeof(buffer), 1, fp);
+			// Read straight into the staging copy, as that's in file order
+			memset(gSave.Staging, 0, save_size);
+			fread(gSave.Staging, save_size, 1, fp);
+			fclose(fp);
 
-				for (u32 i = 0; i < sizeof(buffer); i++)
-				{
-					dst[d+i] = buffer[i^U8_TWIDDLE];
-				}
+			for (u32 i = 0; i < save_size; i++)
+			{
+				dst[i] = gSave.Staging[i^U8_TWIDDLE];
 			}
-			fclose(fp);
 		}
-		#ifdef DAEDALUS_DEBUG_CONSOLE
 		else
 		{
-			DBGConsole_Msg(0, "Save File [C%s] cannot be found.", gSaveFileName);
+			#ifdef DAEDALUS_DEBUG_CONSOLE
+			DBGConsole_Msg(0, "Save File [C%s] cannot be found.", gSave.FileName);
+			#endif
+			SaveFile_MarkDirty( gSave, 0, save_size );
+			SaveFile_Snapshot( gSave );
+			gSave.Pending = false;
 		}
-		#endif
 	}
 
 	// init mempack
 	if (g_ROM.settings.SaveType == SAVE_TYPE_UNKNOWN )
 	{
-		Dump_GetSaveDirectory(gMempackFileName, g_ROM.mFileName, ".mpk");
-		FILE * fp = fopen(gMempackFileName, "rb");
+		u32 mempack_size = MemoryRegionSizes[MEM_MEMPACK];
+
+		SaveFile_Init( gMempack, (const u8*)g_pMemoryBuffers[MEM_MEMPACK], mempack_size, false );
+		Dump_GetSaveDirectory(gMempack.FileName, g_ROM.mFileName, ".mpk");
+		FILE * fp = fopen(gMempack.FileName, "rb");
 		if (fp != nullptr)
 		{
 			#ifdef DAEDALUS_DEBUG_CONSOLE
-			DBGConsole_Msg(0, "Loading MemPack from [C%s]", gMempackFileName);
+			DBGConsole_Msg(0, "Loading MemPack from [C%s]", gMempack.FileName);
 			#endif
-			fread(g_pMemoryBuffers[MEM_MEMPACK], MemoryRegionSizes[MEM_MEMPACK], 1, fp);
+			fread(g_pMemoryBuffers[MEM_MEMPACK], mempack_size, 1, fp);
 			fclose(fp);
-			gMempackDirty = false;
+			memcpy(gMempack.Staging, g_pMemoryBuffers[MEM_MEMPACK], mempack_size);
 		}
 		else
 		{
 			#ifdef DAEDALUS_DEBUG_CONSOLE
-			DBGConsole_Msg(0, "MemPack File [C%s] cannot be found.", gMempackFileName);
+			DBGConsole_Msg(0, "MemPack File [C%s] cannot be found.", gMempack.FileName);
 			#endif
 			InitMempackContent();
-			gMempackDirty = true;
+			SaveFile_MarkDirty( gMempack, 0, mempack_size );
 		}
 	}
-
+	else
+	{
+		SaveFile_Init( gMempack, nullptr, 0, false );
+	}
 
 	return true;
 }
@@ -130,58 +338,56 @@ bool Save_Reset()
 void Save_Fini()
 {
 	Save_Flush(true);
+	SaveWriter_Wait();
+
+	SaveFile_Free( gSave );
+	SaveFile_Free( gMempack );
 }
 
-void Save_MarkSaveDirty()
+void Save_MarkSaveDirty( u32 offset, u32 length )
 {
-	gSaveDirty = true;
+	SaveFile_MarkDirty( gSave, offset, length );
 }
 
-void Save_MarkMempackDirty()
+void Save_MarkMempackDirty( u32 offset, u32 length )
 {
-	gMempackDirty = true;
+	SaveFile_MarkDirty( gMempack, offset, length );
 }
 
 void Save_Flush(bool force)
 {
-	if ((gSaveDirty || force) && g_ROM.settings.SaveType != SAVE_TYPE_UNKNOWN)
+	if (force)
 	{
-		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg(0, "Saving to [C%s]", gSaveFileName);
-		#endif
+		SaveFile_MarkDirty( gSave, 0, gSave.Size );
+		SaveFile_MarkDirty( gMempack, 0, gMempack.Size );
+	}
 
-		FILE * fp = fopen(gSaveFileName, "wb");
-		if (fp != nullptr)
-		{
-			u8 buffer[2048];
-			u8 * src = (u8*)g_pMemoryBuffers[MEM_SAVE];
+	bool start_writer = false;
+	{
+		AUTO_CRIT_SECT( gSaveWriterMutex );
 
-			for (u32 d = 0; d < gSaveSize; d += sizeof(buffer))
-			{
-				for (u32 i = 0; i < sizeof(buffer); i++)
-				{
-					buffer[i^U8_TWIDDLE] = src[d+i];
-				}
-				fwrite(buffer, 1, sizeof(buffer), fp);
-			}
-			fclose(fp);
+		bool changed = SaveFile_Snapshot( gSave );
+		changed |= SaveFile_Snapshot( gMempack );
+
+		if (changed && !gSaveWriterBusy)
+		{
+			gSaveWriterBusy = true;
+			start_writer = true;
 		}
-		gSaveDirty = false;
 	}
 
-	if (gMempackDirty || force)
+	if (start_writer)
 	{
-		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg(0, "Saving MemPack to [C%s]", gMempackFileName);
-		#endif
+		SJob job;
+		job.InitJob = nullptr;
+		job.DoJob = &SaveWriter_DoJob;
+		job.FiniJob = nullptr;
 
-		FILE * fp = fopen(gMempackFileName, "wb");
-		if (fp != nullptr)
-		{
-			fwrite(g_pMemoryBuffers[MEM_MEMPACK], MemoryRegionSizes[MEM_MEMPACK], 1, fp);
-			fclose(fp);
-		}
-		gMempackDirty = false;
+#ifdef DAEDALUS_PSP
+		SaveWriter_DoJob( &job );
+#else
+		gSaveWriterJob = gJobSystem.AddJob( &job, sizeof( job ) );
+#endif
 	}
 }
 
@@ -22,7 +22,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 bool Save_Reset();
 void Save_Fini();
 
-void Save_MarkSaveDirty();
-void Save_MarkMempackDirty();
+// Offsets are into the save and mempack memory. Only the blocks covered are
+// written out on the next flush.
+void Save_MarkSaveDirty(u32 offset, u32 length);
+void Save_MarkMempackDirty(u32 offset, u32 length);
 
 void Save_Flush(bool force = false);
@@ -21,9 +21,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stdio.h>
 
+#include <deque>
+#include <vector>
+
 #include "Core/SaveState.h"
 #include "Core/Memory.h"
 #include "Core/CPU.h"
+#include "Core/DMA.h"
 #include "Core/ROM.h"
 #include "Core/R4300.h"
 #include "Debug/DBGConsole.h"
@@ -41,16 +45,21 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 const u32 SAVESTATE_PROJECT64_MAGIC_NUMBER = 0x23D8A6C8;
 
-class SaveState_ostream_gzip
+//
+//	The same code reads and writes both savestate files and in-memory snapshots,
+//	so these wrap either a (gzip) file stream or one of the memory streams below.
+//
+template< typename OutStream >
+class SaveState_ostream
 {
 public:
-	SaveState_ostream_gzip( const char * filename )
-		: mStream( filename )
+	explicit SaveState_ostream( OutStream & stream )
+		: mStream( stream )
 	{
 	}
 
 	template<typename T>
-	inline SaveState_ostream_gzip& operator << (const T& data)
+	inline SaveState_ostream& operator << (const T& data)
 	{
 		write(&data, sizeof(T));
 		return *this;
@@ -105,14 +114,15 @@ public:
 	}
 
 private:
-	COutStream		mStream;
+	OutStream &		mStream;
 };
 
-class SaveState_istream_gzip
+template< typename InStream >
+class SaveState_istream
 {
 public:
-	explicit SaveState_istream_gzip( const char * filename )
-		: mStream( filename )
+	explicit SaveState_istream( InStream & stream )
+		: mStream( stream )
 	{}
 
 	inline bool IsValid() const
@@ -121,7 +131,7 @@ public:
 	}
 
 	template<typename T>
-	inline SaveState_istream_gzip& operator >> (T& data)
+	inline SaveState_istream& operator >> (T& data)
 	{
 		if (read(&data, sizeof(data)) != sizeof(data))
 		{
@@ -183,17 +193,66 @@ public:
 	}
 
 private:
-	CInStream			mStream;
+	InStream &			mStream;
 };
 
+class CMemoryOutStream
+{
+public:
+	explicit CMemoryOutStream( std::vector< u8 > * buffer )
+		: mBuffer( buffer )
+	{
+		mBuffer->clear();
+	}
 
-bool SaveState_SaveToFile( const char * filename )
+	bool IsOpen() const		{ return true; }
+
+	bool WriteData( const void * data, u32 length )
+	{
+		const u8 * p_data( reinterpret_cast< const u8 * >( data ) );
+		mBuffer->insert( mBuffer->end(), p_data, p_data + length );
+		return true;
+	}
+
+private:
+	std::vector< u8 > *	mBuffer;
+};
+
+class CMemoryInStream
 {
-	SaveState_ostream_gzip stream( filename );
+public:
+	explicit CMemoryInStream( const std::vector< u8 > & buffer )
+		: mBuffer( buffer )
+		, mOffset( 0 )
+	{
+	}
+
+	bool IsOpen() const		{ return true; }
+
+	bool ReadData( void * data, u32 length )
+	{
+		if( mOffset + length > mBuffer.size() )
+			return false;
+
+		memcpy( data, &mBuffer[ mOffset ], length );
+		mOffset += length;
+		return true;
+	}
+
+private:
+	const std::vector< u8 > &	mBuffer;
+	u32							mOffset;
+};
+
+// zlib's fastest level. It's several times quicker than the default, for
+// files which are only a little larger.
+static const s32 kSaveStateCompressionLevel = 1;
 
-	if( !stream.IsValid() )
-		return false;
 
+// RDRAM is left out of snapshots, which keep it separately
+template< typename OutStream >
+static void SaveState_Write( SaveState_ostream< OutStream > & stream, bool include_rdram )
+{
 	stream << SAVESTATE_PROJECT64_MAGIC_NUMBER;
 	stream << gRamSize;
 	ROMHeader rom_header;
@@ -245,8 +304,22 @@ bool SaveState_SaveToFile( const char * filename )
 	}
 
 	stream.write( g_pMemoryBuffers[MEM_PIF_RAM], 0x40);
-	stream.write( g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
+	if( include_rdram )
+	{
+		stream.write( g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
+	}
 	stream.write_memory_buffer(MEM_SP_MEM);
+}
+
+bool SaveState_SaveToFile( const char * filename )
+{
+	COutStream file( filename, kSaveStateCompressionLevel );
+	SaveState_ostream< COutStream > stream( file );
+
+	if( !stream.IsValid() )
+		return false;
+
+	SaveState_Write( stream, true );
 	return true;
 }
 
@@ -271,13 +344,11 @@ static void Swap_PIF()
 	}
 }
 
-bool SaveState_LoadFromFile( const char * filename )
+// In-memory snapshots restore RDRAM themselves, and were never written with the PIF RAM
+// bug, so they pass false for both include_rdram and from_file.
+template< typename InStream >
+static bool SaveState_Read( SaveState_istream< InStream > & stream, bool include_rdram, bool from_file )
 {
-	SaveState_istream_gzip stream( filename );
-
-	if( !stream.IsValid() )
-		return false;
-
 	u32 value;
 	stream >> value;
 	if(value != SAVESTATE_PROJECT64_MAGIC_NUMBER)
@@ -388,11 +459,20 @@ bool SaveState_LoadFromFile( const char * filename )
 	//stream.skip(0x40);
 
 	stream.read(g_pMemoryBuffers[MEM_PIF_RAM], 0x40);
-	Swap_PIF();
+	if( from_file )
+	{
+		Swap_PIF();
+	}
 
-	stream.read(g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
+	if( include_rdram )
+	{
+		stream.read(g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
+	}
 	stream.read_memory_buffer(MEM_SP_MEM); //, 0x84000000);
 
+	// Pending events aren't saved, so don't leave any DMAs busy forever
+	DMA_CompletePending();
+
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 	Patch_PatchAll();
 #endif
@@ -400,9 +480,21 @@ bool SaveState_LoadFromFile( const char * filename )
 	return true;
 }
 
+bool SaveState_LoadFromFile( const char * filename )
+{
+	CInStream file( filename );
+	SaveState_istream< CInStream > stream( file );
+
+	if( !stream.IsValid() )
+		return false;
+
+	return SaveState_Read( stream, true, true );
+}
+
 RomID SaveState_GetRomID( const char * filename )
 {
-	SaveState_istream_gzip stream( filename );
+	CInStream file( filename );
+	SaveState_istream< CInStream > stream( file );
 
 	if( !stream.IsValid() )
 		return RomID();
@@ -424,7 +516,8 @@ RomID SaveState_GetRomID( const char * filename )
 
 const char* SaveState_GetRom( const char * filename )
 {
-	SaveState_istream_gzip stream( filename );
+	CInStream file( filename );
+	SaveState_istream< CInStream > stream( file );
 
 	if( !stream.IsValid() )
 		return nullptr;
@@ -444,3 +537,128 @@ const char* SaveState_GetRom( const char * filename )
 	return CRomDB::Get()->QueryFilenameFromID(
 		RomID( rom_header.CRC1, rom_header.CRC2, rom_header.CountryID ));
 }
+
+//
+//	In-memory snapshots. The most recent one is kept whole (gLatestRam/gLatestState).
+//	Each older one only holds what's needed to step back to it from the snapshot
+//	after it - its non-RDRAM state, and the RDRAM pages which differ - so taking
+//	one costs a compare of RDRAM and a copy of the pages which changed.
+//
+namespace
+{
+	const u32 kSnapshotPageBits = 12;
+	const u32 kSnapshotPageSize = 1 << kSnapshotPageBits;
+	const u32 kDefaultSnapshotBudget = 32 * 1024 * 1024;
+
+	struct SSnapshot
+	{
+		std::vector< u8 >	State;
+		std::vector< u32 >	PageIndices;
+		std::vector< u8 >	Pages;			// kSnapshotPageSize for each of PageIndices
+
+		u32 GetBytes() const
+		{
+			return State.size() + PageIndices.size() * (sizeof( u32 ) + kSnapshotPageSize);
+		}
+	};
+}
+
+static std::vector< u8 >		gLatestRam;
+static std::vector< u8 >		gLatestState;
+static std::deque< SSnapshot >	gSnapshots;			// Oldest first
+static u32						gSnapshotBytes = 0;
+static u32						gSnapshotBudget = kDefaultSnapshotBudget;
+
+static void SaveState_TrimSnapshots()
+{
+	while( !gSnapshots.empty() && gSnapshotBytes > gSnapshotBudget )
+	{
+		gSnapshotBytes -= gSnapshots.front().GetBytes();
+		gSnapshots.pop_front();
+	}
+}
+
+void SaveState_SetSnapshotBudget( u32 max_bytes )
+{
+	gSnapshotBudget = max_bytes;
+	SaveState_TrimSnapshots();
+}
+
+void SaveState_ClearSnapshots()
+{
+	gSnapshots.clear();
+	gSnapshotBytes = 0;
+
+	std::vector< u8 >().swap( gLatestRam );
+	std::vector< u8 >().swap( gLatestState );
+}
+
+u32 SaveState_GetNumSnapshots()
+{
+	return gLatestRam.empty() ? 0 : gSnapshots.size() + 1;
+}
+
+bool SaveState_TakeSnapshot()
+{
+	const u8 * ram( g_pu8RamBase );
+
+	if( gLatestRam.size() != gRamSize )
+	{
+		SaveState_ClearSnapshots();
+		gLatestRam.assign( ram, ram + gRamSize );
+	}
+	else
+	{
+		SSnapshot snapshot;
+		snapshot.State.swap( gLatestState );
+
+		u8 * latest( &gLatestRam[0] );
+		for( u32 page = 0; page < (gRamSize >> kSnapshotPageBits); ++page )
+		{
+			u32 offset( page << kSnapshotPageBits );
+			if( memcmp( latest + offset, ram + offset, kSnapshotPageSize ) != 0 )
+			{
+				snapshot.PageIndices.push_back( page );
+				snapshot.Pages.insert( snapshot.Pages.end(), latest + offset, latest + offset + kSnapshotPageSize );
+				memcpy( latest + offset, ram + offset, kSnapshotPageSize );
+			}
+		}
+
+		gSnapshotBytes += snapshot.GetBytes();
+		gSnapshots.push_back( std::move( snapshot ) );
+	}
+
+	CMemoryOutStream buffer( &gLatestState );
+	SaveState_ostream< CMemoryOutStream > stream( buffer );
+	SaveState_Write( stream, false );
+
+	SaveState_TrimSnapshots();
+	return true;
+}
+
+bool SaveState_RestoreSnapshot( u32 age )
+{
+	if( age >= SaveState_GetNumSnapshots() )
+		return false;
+
+	// Step back through the newer snapshots, dropping them as we go
+	for( u32 i = 0; i < age; ++i )
+	{
+		SSnapshot & snapshot( gSnapshots.back() );
+		for( u32 p = 0; p < snapshot.PageIndices.size(); ++p )
+		{
+			memcpy( &gLatestRam[ snapshot.PageIndices[p] << kSnapshotPageBits ], &snapshot.Pages[ p << kSnapshotPageBits ], kSnapshotPageSize );
+		}
+		gLatestState.swap( snapshot.State );
+
+		gSnapshotBytes -= snapshot.GetBytes();
+		gSnapshots.pop_back();
+	}
+
+	// RDRAM goes first, as the rest of the load patches it
+	memcpy( g_pu8RamBase, &gLatestRam[0], gLatestRam.size() );
+
+	CMemoryInStream buffer( gLatestState );
+	SaveState_istream< CMemoryInStream > stream( buffer );
+	return SaveState_Read( stream, false, false );
+}
@@ -30,4 +30,16 @@ bool SaveState_SaveToFile( const char * filename );
 RomID SaveState_GetRomID( const char * filename );
 const char* SaveState_GetRom(const char * filename);
 
+//
+//	In-memory snapshots, cheap enough to take every frame: each one only stores
+//	the RDRAM pages which changed since the one before. The oldest are dropped
+//	once they take up more than the budget. Like the functions above, these must
+//	be called between frames on the emulation thread (see CPU_SetSnapshotInterval).
+//
+bool SaveState_TakeSnapshot();
+bool SaveState_RestoreSnapshot( u32 age );		// 0 is the latest. Anything newer than age is discarded
+u32  SaveState_GetNumSnapshots();
+void SaveState_ClearSnapshots();
+void SaveState_SetSnapshotBudget( u32 max_bytes );
+
 #endif // CORE_SAVESTATE_H_
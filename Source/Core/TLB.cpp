@@ -26,6 +26,42 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 ALIGNED_GLOBAL(TLBEntry, g_TLBs[32], CACHE_ALIGN);
 
+#ifdef DAEDALUS_PROFILE_EXECUTION
+u32 gTLBLookupHit = 0;
+u32 gTLBLookupMiss = 0;
+#endif
+
+// One byte per 4KB virtual page, holding the index+1 of the TLB entry last
+// written over that page (0 if none). It's only a hint - entries can overlap
+// and the ASID isn't part of the key - so Translate always confirms the
+// candidate and falls back to searching all entries when it doesn't match.
+static const u32	kTLBPageShift = 12;
+static const u32	kTLBMaxPages  = (2 * 16 * 1024 * 1024) >> kTLBPageShift;	// 16M even/odd pair
+static u8			gTLBPageLookup[ 1 << (32 - kTLBPageShift) ];
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void TLBEntry::MapPages( u8 value ) const
+{
+	u32 first = addrcheck >> kTLBPageShift;
+	u32 last  = (addrcheck | mask) >> kTLBPageShift;
+
+	// Ignore bogus page masks rather than touching half the table
+	if ( last < first || last - first >= kTLBMaxPages )
+		return;
+
+	u8 old_value = u8( this - g_TLBs + 1 );
+	for ( u32 page = first; page <= last; ++page )
+	{
+		// When unmapping, leave pages which another entry has since claimed
+		if ( value != 0 || gTLBPageLookup[ page ] == old_value )
+		{
+			gTLBPageLookup[ page ] = value;
+		}
+	}
+}
+
 void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 {
 	// From the R4300i Instruction manual:
@@ -35,6 +71,9 @@ void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 	// TLB[INDEX] <- PageMask || (EntryHi AND NOT PageMask) || EntryLo1 || EntryLo0
 	DPF( DEBUG_TLB, "PAGEMASK: 0x%08x ENTRYHI: 0x%08x. ENTRYLO1: 0x%08x. ENTRYLO0: 0x%08x", _pagemask, _hi, _pfno, _pfne);
 
+	// Drop the pages covered by the previous contents of this entry
+	MapPages( 0 );
+
 	pagemask = _pagemask;
 	hi = _hi;
 	pfne = _pfne;
@@ -104,6 +143,8 @@ void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 		checkbit = 0;
 		break;
 	}
+
+	MapPages( u8( this - g_TLBs + 1 ) );
 }
 
 void TLBEntry::Reset()
@@ -154,9 +195,31 @@ inline bool	TLBEntry::FindTLBEntry( u32 address, u32 * p_idx )
 //*****************************************************************************
 u32 TLBEntry::Translate(u32 address, bool& missing)
 {
-	u32 iMatched = 0;
+	u32 iMatched = gTLBPageLookup[ address >> kTLBPageShift ] - 1;
+
+	// Confirm the page table's candidate, as FindTLBEntry would
+	bool found = false;
+	if ( iMatched < 32 )
+	{
+		const TLBEntry & tlb = g_TLBs[iMatched];
+
+		found = (address & tlb.vpnmask) == tlb.addrcheck &&
+				(tlb.g || (tlb.hi & TLBHI_PIDMASK) == (gCPUState.CPUControl[C0_ENTRYHI]._u32 & TLBHI_PIDMASK));
+	}
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+	if ( found )	gTLBLookupHit++;
+	else			gTLBLookupMiss++;
+#endif
+
+	if ( !found && FindTLBEntry( address, &iMatched ) )
+	{
+		// Remember the match so the next access to this page is direct
+		gTLBPageLookup[ address >> kTLBPageShift ] = u8( iMatched + 1 );
+		found = true;
+	}
 
-	missing = !FindTLBEntry( address, &iMatched );
+	missing = !found;
 	if (!missing)
 	{
 		const TLBEntry & tlb = g_TLBs[iMatched];
@@ -39,6 +39,8 @@ private:
 
 	static bool FindTLBEntry( u32 address, u32 * p_idx );
 
+	void MapPages( u8 value ) const;
+
 public:
 	void UpdateValue(u32 _pagemask, u32 _hi, u32 _pfne, u32 _pfno);
 	void Reset();
@@ -46,3 +48,8 @@ public:
 };
 
 ALIGNED_EXTERN(TLBEntry, g_TLBs[32], CACHE_ALIGN);
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+extern u32		gTLBLookupHit;		// Translations resolved through the page table
+extern u32		gTLBLookupMiss;		// Translations which fell back to searching all entries
+#endif
@@ -47,6 +47,12 @@ class CNativeTexture : public CRefCounted
 		void							InstallTexture() const;
 
 		void							SetData( void * data, void * palette );
+#ifdef DAEDALUS_GL
+		// Returns GetBytesRequired() bytes, GetStride() bytes per row, to write texels into.
+		// EndUpdate() uploads them (or discards them), saving SetData's copy.
+		void *							BeginUpdate();
+		void							EndUpdate( bool upload );
+#endif
 
 		inline u32						GetBlockWidth() const			{ return mTextureBlockWidth; }
 		inline u32						GetWidth() const				{ return mWidth; }
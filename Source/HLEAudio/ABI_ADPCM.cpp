@@ -6,6 +6,7 @@
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
+#include "HLEAudio/AudioHLESIMD.h"
 #include "Math/MathUtil.h"
 
 
@@ -171,6 +172,11 @@ void ADPCM2(AudioHLECommand command)
 
   	out+=16;
   	short count=gAudioHLEState.Count;
+
+#ifdef DAEDALUS_SIMD_SSE
+  	AudioSIMD_ADPCMBook simd_book = {};
+#endif
+
   	while(count>0)
   	{
   		u8 idx_code=gAudioHLEState.Buffer[(gAudioHLEState.InBuffer+inPtr)^3];
@@ -198,8 +204,17 @@ void ADPCM2(AudioHLECommand command)
   		}
 
   		// Generate samples
+#ifdef DAEDALUS_SIMD_SSE
+  		if( simd_book.Book != book1 )
+  		{
+  			AudioSIMD_PrepareADPCMBook( simd_book, book1, book2 );
+  		}
+  		AudioSIMD_DecodeADPCM8( out, a[6], a[7], inp1, simd_book );
+  		AudioSIMD_DecodeADPCM8( out+8, a[6], a[7], inp2, simd_book );
+#else
   		ADPCM2_Loop( a, inp1, book1, book2, out );
   		ADPCM2_Loop( a, inp2, book1, book2, out+8 );
+#endif
 
   		out += 16;
   		count-=32;
@@ -224,7 +239,6 @@ void ADPCM3(AudioHLECommand command)
   	s32 vscale;
   	u16 index;
   	u16 j;
-  	s32 a[8];
   	s16 *book1,*book2;
 
   	memset(out,0,32);
@@ -239,6 +253,11 @@ void ADPCM3(AudioHLECommand command)
   	s32 inp1[8];
   	s32 inp2[8];
   	out+=16;
+
+#ifdef DAEDALUS_SIMD_SSE
+  	AudioSIMD_ADPCMBook simd_book = {};
+#endif
+
   	while(count>0)
   	{
   													// the first interation through, these values are
@@ -300,6 +319,17 @@ void ADPCM3(AudioHLECommand command)
   			j++;
   		}
 
+#ifdef DAEDALUS_SIMD_SSE
+  		if( simd_book.Book != book1 )
+  		{
+  			AudioSIMD_PrepareADPCMBook( simd_book, book1, book2 );
+  		}
+  		AudioSIMD_DecodeADPCM8( out + 0, l1, l2, inp1, simd_book );
+  		AudioSIMD_DecodeADPCM8( out + 8, l1, l2, inp2, simd_book );
+  		out += 16;
+#else
+  		s32 a[8];
+
   		a[0]= (s32)book1[0]*(s32)l1;
   		a[0]+=(s32)book2[0]*(s32)l2;
   		a[0]+=(s32)inp1[0]*(s32)2048;
@@ -437,6 +467,7 @@ void ADPCM3(AudioHLECommand command)
   		*(out++) =      Saturate<s16>( a[4] >> 11 );
   		*(out++) = l2 = Saturate<s16>( a[7] >> 11 );
   		*(out++) = l1 = Saturate<s16>( a[6] >> 11 );
+#endif
 
   		count-=32;
   	}
@@ -6,6 +6,7 @@
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
+#include "HLEAudio/AudioHLESIMD.h"
 #include "Math/MathUtil.h"
 
 
@@ -46,12 +47,50 @@ void FILTER2(AudioHLECommand command)
 		lutt5[x] = lutt6[x] = (short)a;
 	}
 	short *inp1, *inp2;
+#ifndef DAEDALUS_SIMD_SSE
 	s32 out1[8];
+#endif
 	s16 outbuff[0x3c0], *outp;
 	u32 inPtr = (u32)(command.cmd0&0xffff);
 	inp1 = (short *)(save);
 	outp = outbuff;
 	inp2 = (short *)(gAudioHLEState.Buffer+inPtr);
+
+#ifdef DAEDALUS_SIMD_SSE
+	// In sample order (i.e. undoing the ^1 twiddle), output j is the sum of input[j+1+k] * lutt6[(7-k)^1]
+	// for k = 0..7 across the 16 samples in inp1:inp2. Do the taps in pairs with pmaddwd.
+	const __m128i taps[4] =
+	{
+		_mm_set1_epi32( s32( u32( u16( lutt6[6] ) ) | (u32( lutt6[7] ) << 16) ) ),
+		_mm_set1_epi32( s32( u32( u16( lutt6[4] ) ) | (u32( lutt6[5] ) << 16) ) ),
+		_mm_set1_epi32( s32( u32( u16( lutt6[2] ) ) | (u32( lutt6[3] ) << 16) ) ),
+		_mm_set1_epi32( s32( u32( u16( lutt6[0] ) ) | (u32( lutt6[1] ) << 16) ) ),
+	};
+	const __m128i round( _mm_set1_epi32( 0x4000 ) );
+
+	for (int x = 0; x < cnt; x+=0x10) {
+		__m128i a( AudioSIMD_SwapPairs( _mm_loadu_si128( (const __m128i *)inp1 ) ) );
+		__m128i b( AudioSIMD_SwapPairs( _mm_loadu_si128( (const __m128i *)inp2 ) ) );
+		__m128i w[8] = { AudioSIMD_Window<1>( a, b ), AudioSIMD_Window<2>( a, b ), AudioSIMD_Window<3>( a, b ), AudioSIMD_Window<4>( a, b ),
+						 AudioSIMD_Window<5>( a, b ), AudioSIMD_Window<6>( a, b ), AudioSIMD_Window<7>( a, b ), b };
+		__m128i lo( round );
+		__m128i hi( round );
+
+		for (int k = 0; k < 4; k++) {
+			lo = _mm_add_epi32( lo, _mm_madd_epi16( _mm_unpacklo_epi16( w[k*2], w[k*2 + 1] ), taps[k] ) );
+			hi = _mm_add_epi32( hi, _mm_madd_epi16( _mm_unpackhi_epi16( w[k*2], w[k*2 + 1] ), taps[k] ) );
+		}
+
+		// Truncate rather than clamp, as below.
+		lo = _mm_srai_epi32( _mm_slli_epi32( _mm_srai_epi32( lo, 15 ), 16 ), 16 );
+		hi = _mm_srai_epi32( _mm_slli_epi32( _mm_srai_epi32( hi, 15 ), 16 ), 16 );
+		_mm_storeu_si128( (__m128i *)outp, AudioSIMD_SwapPairs( _mm_packs_epi32( lo, hi ) ) );
+
+		inp1 = inp2;
+		inp2 += 8;
+		outp += 8;
+	}
+#else
 	for (int x = 0; x < cnt; x+=0x10) {
 		out1[1] =  inp1[0]*lutt6[6];
 		out1[1] += inp1[3]*lutt6[7];
@@ -138,6 +177,7 @@ void FILTER2(AudioHLECommand command)
 		inp2 += 8;
 		outp += 8;
 	}
+#endif
 //			memmove (rdram+(command.cmd1&0xFFFFFF), dmem+0xFB0, 0x20);
 	memmove (save, inp2-8, 0x10);
 	memmove (gAudioHLEState.Buffer+(command.cmd0&0xffff), outbuff, cnt);
@@ -7,6 +7,7 @@
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
+#include "HLEAudio/AudioHLESIMD.h"
 #include "Math/MathUtil.h"
 
 extern bool isMKABI;
@@ -44,6 +45,21 @@ void HILOGAIN( AudioHLECommand command)
 	u32 out = (command.cmd1 >> 16) & 0xffff;
 	s16 *src = (s16 *)(gAudioHLEState.Buffer+out);
 
+#ifdef DAEDALUS_SIMD_SSE
+	// ((val * hi) >> 16) is pmulhw, and adding val * lo is a pmaddwd against (lo, 1).
+	const __m128i vhi( _mm_set1_epi16( s16( hi ) ) );
+	const __m128i vlo( _mm_set1_epi32( s32( lo | 0x10000 ) ) );
+	for( ; count >= 16; count -= 16 )
+	{
+		__m128i val( _mm_loadu_si128( (const __m128i *)src ) );
+		__m128i mh( _mm_mulhi_epi16( val, vhi ) );
+		__m128i r0( _mm_madd_epi16( _mm_unpacklo_epi16( val, mh ), vlo ) );
+		__m128i r1( _mm_madd_epi16( _mm_unpackhi_epi16( val, mh ), vlo ) );
+		_mm_storeu_si128( (__m128i *)src, _mm_packs_epi32( r0, r1 ) );
+		src += 8;
+	}
+#endif
+
 	while( count )
 	{
 		s32 val = *src;
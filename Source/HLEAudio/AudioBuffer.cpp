@@ -23,6 +23,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Config/ConfigOptions.h"
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/AudioBuffer.h"
+#include "Math/MathUtil.h"
+#include "Math/SIMD.h"
+#include "Utility/AtomicPrimitives.h"
 #include "Utility/Thread.h"
 
 #ifdef DAEDALUS_PSP
@@ -31,12 +34,36 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "SysPSP/Utility/CacheUtil.h"
 #endif
 
+// The input is processed in chunks of at most this many samples, which keeps
+// the 16.16 resampling position comfortably inside 32 bits.
+static const u32 kMaxChunkSamples = 8192;
+
+// Filter coefficients are 2.14 fixed point.
+static const u32 kFilterBits = 14;
+
+// Output is generated into blocks of this many samples and then copied into the ring.
+static const u32 kOutputBlockSamples = 64;
+
+// With rate control enabled the step through the input is nudged by at most
+// 1/kRateControlDivisor (0.5%) - enough to absorb host timing differences
+// without the pitch change being audible.
+static const s32 kRateControlDivisor = 200;
+
 CAudioBuffer::CAudioBuffer( u32 buffer_size )
 	:	mBufferBegin( new Sample[ buffer_size ] )
-	,	mBufferEnd( mBufferBegin + buffer_size )
-	,	mReadPtr( mBufferBegin )
-	,	mWritePtr( mBufferBegin )
+	,	mBufferSize( buffer_size )
+	,	mReadIdx( 0 )
+	,	mWriteIdx( 0 )
+	,	mQuality( ARQ_LINEAR )
+	,	mTargetSamples( 0 )
+	,	mSmoothedFill( 0 )
+	,	mPosition( (kMaxTaps / 2 - 1) << 16 )
+	,	mFilterQuality( ARQ_LINEAR )
+	,	mFilterFrequency( 0 )
+	,	mFilterOutputFreq( 0 )
+	,	mNumTaps( 0 )
 {
+	memset( mHistory, 0, sizeof( mHistory ) );
 }
 
 CAudioBuffer::~CAudioBuffer()
@@ -44,29 +71,151 @@ CAudioBuffer::~CAudioBuffer()
 	delete [] mBufferBegin;
 }
 
+void CAudioBuffer::SetResampleQuality( EAudioResampleQuality quality )
+{
+	mQuality = quality;
+}
+
+void CAudioBuffer::SetRateControl( u32 target_samples )
+{
+	mTargetSamples = target_samples;
+	mSmoothedFill = target_samples;
+}
+
 u32 CAudioBuffer::GetNumBufferedSamples() const
 {
-	 //Todo: Check Cache Routines
-// #ifdef DAEDALUS_PSP
-// 	dcache_wbinv_all();
-// #endif
+	// Either index may move while we look, but each is read once so the
+	// result is a count which was valid at some point.
+	u32 read_idx( AtomicLoadAcquire( &mReadIdx ) );
+	u32 write_idx( AtomicLoadAcquire( &mWriteIdx ) );
 
-	// Safe? What if we read mWrite, and then mRead moves to start of buffer?
-	s32 diff = mWritePtr - mReadPtr;
+	return write_idx >= read_idx ? write_idx - read_idx : write_idx + mBufferSize - read_idx;
+}
 
-	if( diff < 0 )
+//*****************************************************************************
+//	Build the polyphase filter table. Row p holds the taps for an output which
+//	lies p/kNumPhases of the way from window[ kMaxTaps/2 - 1 ] to the sample
+//	after it. Shorter filters are centred in the window. Each row is normalised
+//	to unity gain so there's no DC ripple as the phase moves.
+//*****************************************************************************
+void CAudioBuffer::UpdateFilter( u32 frequency, u32 output_freq )
+{
+	if( mNumTaps != 0 && mFilterQuality == mQuality &&
+		mFilterFrequency == frequency && mFilterOutputFreq == output_freq )
 	{
-		diff += (mBufferEnd - mBufferBegin);	// Add on buffer length
+		return;
 	}
 
-	return diff;
+	mFilterQuality = mQuality;
+	mFilterFrequency = frequency;
+	mFilterOutputFreq = output_freq;
+	mNumTaps = mQuality == ARQ_SINC ? kMaxTaps : 4;
+
+	// Cutoff relative to the input Nyquist frequency. Leave a little room for
+	// the transition band, and drop it below the output Nyquist frequency
+	// when downsampling.
+	const f32	cutoff( 0.9f * Min( 1.0f, f32( output_freq ) / f32( frequency ) ) );
+	const f32	half_width( f32( kMaxTaps / 2 ) );
+
+	for( u32 p = 0; p <= kNumPhases; ++p )
+	{
+		const f32	t( f32( p ) / f32( kNumPhases ) );
+		f32			c[ kMaxTaps ];
+
+		switch( mQuality )
+		{
+		case ARQ_LINEAR:
+			c[0] = 0.0f;
+			c[1] = 1.0f - t;
+			c[2] = t;
+			c[3] = 0.0f;
+			break;
+
+		case ARQ_CUBIC:
+			c[0] = 0.5f * (-t*t*t + 2.0f*t*t - t);
+			c[1] = 0.5f * (3.0f*t*t*t - 5.0f*t*t + 2.0f);
+			c[2] = 0.5f * (-3.0f*t*t*t + 4.0f*t*t + t);
+			c[3] = 0.5f * (t*t*t - t*t);
+			break;
+
+		case ARQ_SINC:
+			for( u32 k = 0; k < kMaxTaps; ++k )
+			{
+				// Distance in input samples from the output, and a Blackman window over the taps
+				f32		x( f32( s32( k ) - s32( kMaxTaps / 2 - 1 ) ) - t );
+				f32		a( cutoff * x * PI );
+				f32		sinc( x == 0.0f ? 1.0f : sinf( a ) / a );
+				f32		window( 0.42f + 0.5f * cosf( PI * x / half_width ) + 0.08f * cosf( 2.0f * PI * x / half_width ) );
+
+				c[k] = cutoff * sinc * window;
+			}
+			break;
+		}
+
+		f32		sum( 0.0f );
+		for( u32 k = 0; k < mNumTaps; ++k )
+		{
+			sum += c[k];
+		}
+
+		// Quantise, and give any rounding error to the biggest tap so the row sums to exactly 1.0
+		s16 *	row( mFilter + p * mNumTaps );
+		s32		total( 0 );
+		u32		biggest( 0 );
+		for( u32 k = 0; k < mNumTaps; ++k )
+		{
+			row[k] = s16( floorf( c[k] / sum * f32( 1 << kFilterBits ) + 0.5f ) );
+			total += row[k];
+			if( row[k] > row[biggest] )
+				biggest = k;
+		}
+		row[biggest] += s16( (1 << kFilterBits) - total );
+	}
 }
 
-void CAudioBuffer::AddSamples( const Sample * samples, u32 num_samples, u32 frequency, u32 output_freq )
+//*****************************************************************************
+//	Apply num_taps coefficients to num_taps stereo samples.
+//*****************************************************************************
+static inline Sample FilterSample( const Sample * window, const s16 * coeffs, u32 num_taps )
 {
-	#ifdef DAEDALUS_ENABLE_ASSERTS
-	DAEDALUS_ASSERT( frequency <= output_freq, "Input frequency is too high" );
+#ifdef DAEDALUS_SIMD_SSE
+	// 4 taps at a time: reorder L0 R0 L1 R1 L2 R2 L3 R3 to L0 L1 R0 R1 L2 L3 R2 R3 and
+	// pair it with c0 c1 c0 c1 c2 c3 c2 c3, so pmaddwd yields partial sums of L, R, L, R.
+	__m128i		acc( _mm_setzero_si128() );
+	for( u32 k = 0; k < num_taps; k += 4 )
+	{
+		__m128i	s( _mm_loadu_si128( (const __m128i *)(window + k) ) );
+		__m128i	c( _mm_loadl_epi64( (const __m128i *)(coeffs + k) ) );
+
+		s = _mm_shufflehi_epi16( _mm_shufflelo_epi16( s, _MM_SHUFFLE( 3, 1, 2, 0 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		acc = _mm_add_epi32( acc, _mm_madd_epi16( s, _mm_unpacklo_epi32( c, c ) ) );
+	}
+	acc = _mm_add_epi32( acc, _mm_srli_si128( acc, 8 ) );
+	acc = _mm_srai_epi32( _mm_add_epi32( acc, _mm_set1_epi32( 1 << (kFilterBits - 1) ) ), kFilterBits );
+	acc = _mm_packs_epi32( acc, acc );
+
+	Sample		out;
+	u32			lr( _mm_cvtsi128_si32( acc ) );
+	memcpy( &out, &lr, sizeof( out ) );
+	return out;
+#else
+	s32			l( 1 << (kFilterBits - 1) );
+	s32			r( 1 << (kFilterBits - 1) );
+	for( u32 k = 0; k < num_taps; ++k )
+	{
+		l += window[k].L * coeffs[k];
+		r += window[k].R * coeffs[k];
+	}
+
+	Sample		out;
+	out.L = Saturate<s16>( l >> kFilterBits );
+	out.R = Saturate<s16>( r >> kFilterBits );
+	return out;
 #endif
+}
+
+void CAudioBuffer::AddSamples( const Sample * samples, u32 num_samples, u32 frequency, u32 output_freq )
+{
 	//static FILE * fh = nullptr;
 	//if( !fh )
 	//{
@@ -74,113 +223,151 @@ void CAudioBuffer::AddSamples( const Sample * samples, u32 num_samples, u32 freq
 	//}
 	//fwrite( samples, sizeof( Sample ), num_samples, fh );
 	//fflush( fh );
-	//clear the Cache
-	#ifdef DAEDALUS_PSP
-	//sceKernelDcacheWritebackInvalidateAll();
-	#endif
-	const Sample *	read_ptr( mReadPtr );		// No need to invalidate, as this is uncached/volatile
-	Sample *		write_ptr( mWritePtr );
 
-	//
-	//	'r' is the number of input samples we progress through for each output sample.
-	//	's' keeps track of how far between the current two input samples we are.
-	//	We increment it by 'r' for each output sample we generate.
-	//	When it reaches 1.0, we know we've hit the next sample, so we increment in_idx
-	//	and reduce s by 1.0 (to keep it in the range 0.0 .. 1.0)
-	//	Principle is the same but rewritten to integer mode (faster & less ASM) //Corn
-
-	const s32 r( (frequency << 12)  / output_freq );
-	s32		  s( 0 );
-	u32		  in_idx( 0 );
-	u32		  output_samples( (( num_samples * output_freq ) / frequency) - 1);
-
-	for( u32 i = output_samples; i != 0 ; i-- )
+	if( num_samples == 0 || frequency == 0 || output_freq == 0 )
+		return;
+
+	UpdateFilter( frequency, output_freq );
+
+	// How far through the input we move for each output sample, in 16.16
+	u32		step( u32( (u64( frequency ) << 16) / output_freq ) );
+
+	if( mTargetSamples > 0 )
 	{
+		// Steer the buffer towards the target fill level by resampling very slightly faster
+		// or slower. The fill is smoothed as the consumer drains in big bursts.
+		const s32	target( mTargetSamples );
+		mSmoothedFill += (s32( GetNumBufferedSamples() ) - mSmoothedFill) / 16;
+
+		s32		error( Clamp( mSmoothedFill - target, -target, target ) );
+		step += s32( s64( step ) * error / (s64( target ) * kRateControlDivisor) );
+	}
+
+	while( num_samples > 0 )
+	{
+		u32		chunk( Min( num_samples, kMaxChunkSamples ) );
+		ResampleChunk( samples, chunk, step );
+
+		samples += chunk;
+		num_samples -= chunk;
+	}
+}
+
+//*****************************************************************************
+//	Conceptually the input is mHistory followed by samples, and an output at
+//	position p is filtered from the kMaxTaps inputs starting at p - (kMaxTaps/2 - 1).
+//	We stop once the filter would run off the end of the input, and carry the
+//	remainder of the position over to the next call.
+//*****************************************************************************
+void CAudioBuffer::ResampleChunk( const Sample * samples, u32 num_samples, u32 step )
+{
+	// The first few outputs straddle the history and the new samples.
+	Sample	joined[ kMaxTaps * 2 ];
+	memcpy( joined, mHistory, sizeof( mHistory ) );
+	memcpy( joined + kMaxTaps, samples, Min( num_samples, u32( kMaxTaps ) ) * sizeof( Sample ) );
+
+	const u32		tap_offset( (kMaxTaps - mNumTaps) / 2 );
+	const u32		end( (kMaxTaps / 2 + num_samples) << 16 );
+
+	Sample			out[ kOutputBlockSamples ];
+	u32				num_out( 0 );
+	u32				pos( mPosition );
+
+	while( pos < end )
+	{
+		u32				first( (pos >> 16) - (kMaxTaps / 2 - 1) );
+		const Sample *	window( first < kMaxTaps ? joined + first : samples + (first - kMaxTaps) );
+		u32				phase( ((pos & 0xffff) + (1 << (15 - kPhaseBits))) >> (16 - kPhaseBits) );
+
 		#ifdef DAEDALUS_ENABLE_ASSERTS
-		DAEDALUS_ASSERT( in_idx + 1 < num_samples, "Input index out of range - %d / %d", in_idx+1, num_samples );
-#endif
-//#if 0 // 1->Sine tone, 0->Normal
-		//static float c= 0.0f;
-		//c += 100.0f / 44100.0f;
-		//if( c >= 1.0f )
-		//  c-=1.f;
-		//s16 v( s16( SHRT_MAX * sinf( c * 3.141f*2 ) ) );
-		// Sample	out;
-		// s16 v = WriteCounter++;
-		// if( WriteCounter >= MAX_COUNTER )
-		// {
-		// 	printf( "Loop write\n" );
-		// 	WriteCounter = 0;
-		// }
-		// out.L = out.R = v;
-		//
-// #else
-		// Resample in integer mode (faster & less ASM code) //Corn
-		Sample	out;
-
-		out.L = samples[ in_idx ].L + ((( samples[ in_idx + 1 ].L - samples[ in_idx ].L ) * s ) >> 12 );
-		out.R = samples[ in_idx ].R + ((( samples[ in_idx + 1 ].R - samples[ in_idx ].R ) * s ) >> 12 );
-
-		s += r;
-		in_idx += s >> 12;
-		s &= 4095;
-// #endif
-
-		write_ptr++;
-		if( write_ptr >= mBufferEnd )
-			write_ptr = mBufferBegin;
-
-		while( write_ptr == read_ptr )
+		DAEDALUS_ASSERT( first + kMaxTaps <= kMaxTaps + num_samples, "Input index out of range - %d / %d", first, num_samples );
+		#endif
+
+		out[ num_out ] = FilterSample( window + tap_offset, mFilter + phase * mNumTaps, mNumTaps );
+		pos += step;
+
+		if( ++num_out == kOutputBlockSamples )
 		{
-			// The buffer is full - spin until the read pointer advances.
+			WriteSamples( out, num_out );
+			num_out = 0;
+		}
+	}
+	WriteSamples( out, num_out );
+
+	// Keep the last kMaxTaps samples of input for the next call
+	if( num_samples >= kMaxTaps )
+	{
+		memcpy( mHistory, samples + num_samples - kMaxTaps, sizeof( mHistory ) );
+	}
+	else
+	{
+		memmove( mHistory, mHistory + num_samples, (kMaxTaps - num_samples) * sizeof( Sample ) );
+		memcpy( mHistory + kMaxTaps - num_samples, samples, num_samples * sizeof( Sample ) );
+	}
+	mPosition = pos - (num_samples << 16);
+}
+
+void CAudioBuffer::WriteSamples( const Sample * samples, u32 num_samples )
+{
+	u32		read_idx( AtomicLoadAcquire( &mReadIdx ) );
+	u32		write_idx( mWriteIdx );			// We're the only writer
+
+	while( num_samples > 0 )
+	{
+		// One slot is always left empty, so a full buffer isn't mistaken for an empty one.
+		u32		space( read_idx > write_idx ? read_idx - write_idx - 1 : mBufferSize - write_idx - (read_idx == 0 ? 1 : 0) );
+		if( space == 0 )
+		{
+			// The buffer is full. Publish what we've written so far so the
+			// reader can make progress, then spin until it does.
 			//    Note - spends a lot of time here if program is running
 			//    fast. This loop locks the speed to the playback rate
 			//    as the program winds up waiting for the buffer to empty.
-			// ToDo: Adjust Audio Frequency/ Look at Turok in this regard.
-			// We might want to put a Sleep in when executing on the SC?
-			//Give time to other threads when using SYNC mode.
-		//ThreadYield();
-
-			read_ptr = mReadPtr;
+			AtomicStoreRelease( &mWriteIdx, write_idx );
+
+			u32		full_read_idx( read_idx );
+			do
+			{
+				read_idx = AtomicLoadAcquire( &mReadIdx );
+			}
+			while( read_idx == full_read_idx );
+			continue;
 		}
 
-		*write_ptr = out;
-	}
+		u32		run( Min( space, num_samples ) );
+		memcpy( mBufferBegin + write_idx, samples, run * sizeof( Sample ) );
 
-	//Todo: Check Cache Routines
-	// Ensure samples array is written back before mWritePtr
-	//dcache_wbinv_range_unaligned( mBufferBegin, mBufferEnd );
+		samples += run;
+		num_samples -= run;
+		write_idx += run;
+		if( write_idx >= mBufferSize )
+			write_idx = 0;
+	}
 
-	mWritePtr = write_ptr;		// Needs cache wbinv
+	AtomicStoreRelease( &mWriteIdx, write_idx );
 }
 
 u32	CAudioBuffer::Drain( Sample * samples, u32 num_samples )
 {
-	//Todo: Check Cache Routines
-	// Ideally we could just invalidate this range?
-	//clear the Cache
-	#ifdef DAEDALUS_PSP
-	//sceKernelDcacheWritebackInvalidateAll();
-	#endif
-
-	const Sample *	read_ptr( mReadPtr );		// No need to invalidate, as this is uncached/volatile
-	const Sample *	write_ptr( mWritePtr );		//
+	u32			read_idx( mReadIdx );			// We're the only reader
+	u32			write_idx( AtomicLoadAcquire( &mWriteIdx ) );
 
 	Sample *	out_ptr( samples );
 	u32			samples_required( num_samples );
 
-	while( samples_required > 0 )
+	// Copy out in at most two runs - up to the end of the buffer, then from the start
+	while( samples_required > 0 && read_idx != write_idx )
 	{
-		// Check if empty
-		if( read_ptr == write_ptr )
-			break;
+		u32		run_end( write_idx > read_idx ? write_idx : mBufferSize );
+		u32		run( Min( run_end - read_idx, samples_required ) );
 
-		*out_ptr++ = *read_ptr++;
+		memcpy( out_ptr, mBufferBegin + read_idx, run * sizeof( Sample ) );
 
-		if( read_ptr >= mBufferEnd )
-			read_ptr = mBufferBegin;
-
-		samples_required--;
+		out_ptr += run;
+		samples_required -= run;
+		read_idx += run;
+		if( read_idx >= mBufferSize )
+			read_idx = 0;
 	}
 
 	//static FILE * fh = nullptr;
@@ -191,11 +378,8 @@ u32	CAudioBuffer::Drain( Sample * samples, u32 num_samples )
 	//fwrite( samples, sizeof( Sample ), (num_samples-samples_required), fh );
 	//fflush( fh );
 
-	mReadPtr = read_ptr;		// No need to invalidate, as this is uncached
-	//clear the Cache
-	#ifdef DAEDALUS_PSP
-	//sceKernelDcacheWritebackInvalidateAll();
-	#endif
+	AtomicStoreRelease( &mReadIdx, read_idx );
+
 	//
 	//	If there weren't enough samples, zero out the buffer
 	//	FIXME(strmnnrmn): Unnecessary on OSX...
@@ -203,7 +387,6 @@ u32	CAudioBuffer::Drain( Sample * samples, u32 num_samples )
 	if( samples_required > 0 )
 	{
 		//DBGConsole_Msg( 0, "Buffer underflow (%d samples)\n", samples_required );
-		//printf( "Buffer underflow (%d samples)\n", samples_required );
 		memset( out_ptr, 0, samples_required * sizeof( Sample ) );
 	}
 
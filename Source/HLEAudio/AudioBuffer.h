@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef HLEAUDIO_AUDIOBUFFER_H_
 #define HLEAUDIO_AUDIOBUFFER_H_
 
+#include "Config/ConfigOptions.h"
 #include "Utility/DaedalusTypes.h"
 
 struct Sample
@@ -30,28 +31,61 @@ struct Sample
 	s16		R;
 };
 
-// A utility class for buffering up samples, upsampling to the desired
+// A utility class for buffering up samples, resampling to the desired
 // output frequency and copying them to the desired output buffer.
 //
-// N.B. This class currently does no synchronisation - it's assumed that
-// the calling code will handle this
+// N.B. This is a single producer/single consumer ring - one thread may call
+// AddSamples while another calls Drain, without any other locking.
 class CAudioBuffer
 {
 public:
 	CAudioBuffer( u32 buffer_size );
 	~CAudioBuffer();
 
+	// These belong to the producer - call them from the thread calling AddSamples.
+	void			SetResampleQuality( EAudioResampleQuality quality );
+	void			SetRateControl( u32 target_samples );		// 0 to disable
+
 	void			AddSamples( const Sample * samples, u32 num_samples, u32 frequency, u32 output_freq );
 	u32				Drain( Sample * samples, u32 num_samples );
 
 	u32				GetNumBufferedSamples() const;
 
+private:
+	void			UpdateFilter( u32 frequency, u32 output_freq );
+	void			ResampleChunk( const Sample * samples, u32 num_samples, u32 step );
+	void			WriteSamples( const Sample * samples, u32 num_samples );
+
+	enum
+	{
+		kMaxTaps	= 16,					// Must be a multiple of 4
+		kPhaseBits	= 8,
+		kNumPhases	= 1 << kPhaseBits,
+	};
+
 private:
 	Sample *		mBufferBegin;
-	Sample *		mBufferEnd;
+	u32				mBufferSize;
+
+	// Only Drain writes mReadIdx and only AddSamples writes mWriteIdx.
+	// Each is published with release semantics after the samples it covers.
+	volatile u32	mReadIdx;
+	volatile u32	mWriteIdx;
+
+	// Resampler state, only touched by the producer.
+	EAudioResampleQuality	mQuality;
+	u32				mTargetSamples;
+	s32				mSmoothedFill;
+	u32				mPosition;							// 16.16, into mHistory followed by the new samples
+	Sample			mHistory[ kMaxTaps ];				// The tail of the previous input
 
-	const Sample * volatile	mReadPtr;
-	Sample * volatile		mWritePtr;
+	// The filter is a table of kNumTaps coefficients for each of kNumPhases + 1
+	// fractional positions, rebuilt whenever the quality or rates change.
+	EAudioResampleQuality	mFilterQuality;
+	u32				mFilterFrequency;
+	u32				mFilterOutputFreq;
+	u32				mNumTaps;
+	s16				mFilter[ (kNumPhases + 1) * kMaxTaps ];
 };
 
 
@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
+#include "HLEAudio/AudioHLESIMD.h"
 #include "Math/MathUtil.h"
 #include "Utility/FastMemcpy.h"
 
@@ -72,10 +73,10 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 	s16 *aux1=(s16 *)(Buffer+AuxA);
 	s16 *aux2=(s16 *)(Buffer+AuxC);
 	s16 *aux3=(s16 *)(Buffer+AuxE);
-	s32 MainR;
-	s32 MainL;
-	s32 AuxR;
-	s32 AuxL;
+	s32 MainR[8];	// Gains for the current 8 samples, in buffer (ptr^1) order
+	s32 MainL[8];
+	s32 AuxR[8];
+	s32 AuxL[8];
 	s32 i1,o1,a1,a2=0,a3=0;
 	u16 AuxIncRate=1;
 	s16 zero[8];
@@ -131,6 +132,11 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 		aux2=aux3=zero;
 	}
 
+#ifdef DAEDALUS_SIMD_SSE
+	u32 aux_bits = AuxIncRate ? ((InBuffer ^ AuxC) | (InBuffer ^ AuxE)) : 0;
+	bool vectorise = (((InBuffer ^ OutBuffer) | (InBuffer ^ AuxA) | aux_bits) & 0xf) == 0;
+#endif
+
 	oMainL = (Dry * (LTrg>>16) + 0x4000) >> 15;
 	oAuxL  = (Wet * (LTrg>>16) + 0x4000) >> 15;
 	oMainR = (Dry * (RTrg>>16) + 0x4000) >> 15;
@@ -180,14 +186,8 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 
 		for (s32 x = 0; x < 8; x++)
 		{
-			i1=(s32)inp[ptr^1];
-			o1=(s32)out[ptr^1];
-			a1=(s32)aux1[ptr^1];
-			if (AuxIncRate)
-			{
-				a2=(s32)aux2[ptr^1];
-				a3=(s32)aux3[ptr^1];
-			}
+			u32 g = x^1;
+
 			// TODO: here...
 			//LAcc = LTrg;
 			//RAcc = RTrg;
@@ -202,13 +202,13 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 				{
 					LAcc = LTrg;
 					LAdderStart = LTrg;
-					MainL = oMainL;
-					AuxL  = oAuxL;
+					MainL[g] = oMainL;
+					AuxL[g]  = oAuxL;
 				}
 				else
 				{
-					MainL = (Dry * ((s32)LAcc>>16) + 0x4000) >> 15;
-					AuxL  = (Wet * ((s32)LAcc>>16) + 0x4000) >> 15;
+					MainL[g] = (Dry * ((s32)LAcc>>16) + 0x4000) >> 15;
+					AuxL[g]  = (Wet * ((s32)LAcc>>16) + 0x4000) >> 15;
 				}
 			}
 			else
@@ -217,13 +217,13 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 				{
 					LAcc = LTrg;
 					LAdderStart = LTrg;
-					MainL = oMainL;
-					AuxL  = oAuxL;
+					MainL[g] = oMainL;
+					AuxL[g]  = oAuxL;
 				}
 				else
 				{
-					MainL = (Dry * ((s32)LAcc>>16) + 0x4000) >> 15;
-					AuxL  = (Wet * ((s32)LAcc>>16) + 0x4000) >> 15;
+					MainL[g] = (Dry * ((s32)LAcc>>16) + 0x4000) >> 15;
+					AuxL[g]  = (Wet * ((s32)LAcc>>16) + 0x4000) >> 15;
 				}
 			}
 
@@ -234,13 +234,13 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 				{
 					RAcc = RTrg;
 					RAdderStart = RTrg;
-					MainR = oMainR;
-					AuxR  = oAuxR;
+					MainR[g] = oMainR;
+					AuxR[g]  = oAuxR;
 				}
 				else
 				{
-					MainR = (Dry * ((s32)RAcc>>16) + 0x4000) >> 15;
-					AuxR  = (Wet * ((s32)RAcc>>16) + 0x4000) >> 15;
+					MainR[g] = (Dry * ((s32)RAcc>>16) + 0x4000) >> 15;
+					AuxR[g]  = (Wet * ((s32)RAcc>>16) + 0x4000) >> 15;
 				}
 			}
 			else
@@ -249,28 +249,53 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 				{
 					RAcc = RTrg;
 					RAdderStart = RTrg;
-					MainR = oMainR;
-					AuxR  = oAuxR;
+					MainR[g] = oMainR;
+					AuxR[g]  = oAuxR;
 				}
 				else
 				{
-					MainR = (Dry * ((s32)RAcc>>16) + 0x4000) >> 15;
-					AuxR  = (Wet * ((s32)RAcc>>16) + 0x4000) >> 15;
+					MainR[g] = (Dry * ((s32)RAcc>>16) + 0x4000) >> 15;
+					AuxR[g]  = (Wet * ((s32)RAcc>>16) + 0x4000) >> 15;
 				}
 			}
 
 			//fprintf (dfile, "%04X ", (LAcc>>16));
+		}
 
-			o1+=(/*(o1*0x7fff)+*/(i1*MainR)+0x4000) >> 15;
-			a1+=(/*(a1*0x7fff)+*/(i1*MainL)+0x4000) >> 15;
+#ifdef DAEDALUS_SIMD_SSE
+		if (vectorise)
+		{
+			s16 * const dst[4] = { out + ptr, aux1 + ptr, aux2 + ptr, aux3 + ptr };
+			const s32 * const gains[4] = { MainR, MainL, AuxR, AuxL };
+
+			if (AudioSIMD_EnvMix8( inp + ptr, dst, gains, AuxIncRate ? 4 : 2 ))
+			{
+				ptr += 8;
+				continue;
+			}
+		}
+#endif
+
+		for (s32 x = 0; x < 8; x++)
+		{
+			u32 g = x^1;
+
+			i1=(s32)inp[ptr^1];
+			o1=(s32)out[ptr^1];
+			a1=(s32)aux1[ptr^1];
+			if (AuxIncRate)
+			{
+				a2=(s32)aux2[ptr^1];
+				a3=(s32)aux3[ptr^1];
+			}
+
+			o1 = AudioHLE_MixRound( o1, i1, MainR[g] );
+			a1 = AudioHLE_MixRound( a1, i1, MainL[g] );
 
 			/*		o1=((s64)(((s64)o1*0xfffe)+((s64)i1*MainR*2)+0x8000)>>16);
 
 			a1=((s64)(((s64)a1*0xfffe)+((s64)i1*MainL*2)+0x8000)>>16);*/
 
-			o1 = Saturate<s16>( o1 );
-			a1 = Saturate<s16>( a1 );
-
 			out[ptr^1]=o1;
 			aux1[ptr^1]=a1;
 			if (AuxIncRate)
@@ -278,11 +303,8 @@ void	AudioHLEState::EnvMixer( u8 flags, u32 address )
 				//a2=((s64)(((s64)a2*0xfffe)+((s64)i1*AuxR*2)+0x8000)>>16);
 
 				//a3=((s64)(((s64)a3*0xfffe)+((s64)i1*AuxL*2)+0x8000)>>16);
-				a2+=(/*(a2*0x7fff)+*/(i1*AuxR)+0x4000)>>15;
-				a3+=(/*(a3*0x7fff)+*/(i1*AuxL)+0x4000)>>15;
-
-				a2 = Saturate<s16>( a2 );
-				a3 = Saturate<s16>( a3 );
+				a2 = AudioHLE_MixRound( a2, i1, AuxR[g] );
+				a3 = AudioHLE_MixRound( a3, i1, AuxL[g] );
 
 				aux2[ptr^1]=a2;
 				aux3[ptr^1]=a3;
@@ -492,7 +514,7 @@ inline void AudioHLEState::ExtractSamples( s32 * output, u32 inPtr ) const
 //	l1/l2 are IN/OUT
 //
 #if 1 //1->fast, 0->original Azimer //Corn
-inline void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, const s16 * book1, const s16 * book2 )
+void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, const s16 * book1, const s16 * book2 )
 {
 	s32 a[8];
 
@@ -567,7 +589,7 @@ inline void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, con
 }
 
 #else
-inline void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, const s16 * book1, const s16 * book2 )
+void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, const s16 * book1, const s16 * book2 )
 {
 	s32 a[8];
 
@@ -669,6 +691,10 @@ void AudioHLEState::ADPCMDecode( u8 flags, u32 address )
 	s32 inp1[8];
 	s32 inp2[8];
 
+#ifdef DAEDALUS_SIMD_SSE
+	AudioSIMD_ADPCMBook simd_book = {};
+#endif
+
 	s32 count = (s16)Count;		// XXXX why convert this to signed?
 	while(count>0)
 	{
@@ -702,8 +728,17 @@ void AudioHLEState::ADPCMDecode( u8 flags, u32 address )
 			ExtractSamples( inp2, inPtr + 4 );
 		}
 
+#ifdef DAEDALUS_SIMD_SSE
+		if( simd_book.Book != book1 )
+		{
+			AudioSIMD_PrepareADPCMBook( simd_book, book1, book2 );
+		}
+		AudioSIMD_DecodeADPCM8( out + 0, l1, l2, inp1, simd_book );
+		AudioSIMD_DecodeADPCM8( out + 8, l1, l2, inp2, simd_book );
+#else
 		DecodeSamples( out + 0, l1, l2, inp1, book1, book2 );
 		DecodeSamples( out + 8, l1, l2, inp2, book1, book2 );
+#endif
 
 		inPtr += 8;
 		out += 16;
@@ -818,8 +853,22 @@ void	AudioHLEState::Interleave( u16 outaddr, u16 laddr, u16 raddr, u16 count )
 	u32 *		out = (u32 *)(Buffer + outaddr);	//Save some bandwith also corrected left and right//Corn
 	const u16 *	inr = (const u16 *)(Buffer + raddr);
 	const u16 *	inl = (const u16 *)(Buffer + laddr);
+	u32			x = count >> 2;
+
+#ifdef DAEDALUS_SIMD_SSE
+	if( outaddr + count * 2 <= Min( laddr, raddr ) || outaddr >= Max( laddr, raddr ) + count )
+	{
+		for( ; x >= 4; x -= 4 )
+		{
+			AudioSIMD_Interleave8( out, inl, inr );
+			out += 8;
+			inl += 8;
+			inr += 8;
+		}
+	}
+#endif
 
-	for( u32 x = (count >> 2); x != 0; x-- )
+	for( ; x != 0; x-- )
 	{
 		const u16 right = *inr++;
 		const u16 left  = *inl++;
@@ -841,10 +890,24 @@ void	AudioHLEState::Mixer( u16 dmemout, u16 dmemin, s32 gain, u16 count )
 	// Make sure we are on even address (YOSHI)
 	s16*  in( (s16 *)(Buffer + dmemin) );
 	s16* out( (s16 *)(Buffer + dmemout) );
+	u32  x( count >> 1 );
+
+#ifdef DAEDALUS_SIMD_SSE
+	if( gain == s16( gain ) && AudioSIMD_CanVectorise( dmemout, dmemin, count ) )
+	{
+		const __m128i g( _mm_set1_epi16( s16( gain ) ) );
+		for( ; x >= 8; x -= 8 )
+		{
+			AudioSIMD_Mix8( out, in, g );
+			out += 8;
+			in += 8;
+		}
+	}
+#endif
 
-	for( u32 x = count >> 1; x != 0; x-- )
+	for( ; x != 0; x-- )
 	{
-		*out = Saturate<s16>( FixedPointMul15( *in++, gain ) + s32( *out ) );
+		*out = AudioHLE_Mix( *out, *in++, gain );
 		out++;
 	}
 
@@ -854,13 +917,28 @@ void	AudioHLEState::Mixer( u16 dmemout, u16 dmemin, s32 gain, u16 count )
 		s16 in( *(s16 *)(Buffer+(dmemin+x)) );
 		s16 out( *(s16 *)(Buffer+(dmemout+x)) );
 
-		*(s16 *)(Buffer+((dmemout+x) & (N64_AUDIO_BUFF - 2)) ) = Saturate<s16>( FixedPointMul15( in, gain ) + s32( out ) );
+		*(s16 *)(Buffer+((dmemout+x) & (N64_AUDIO_BUFF - 2)) ) = AudioHLE_Mix( out, in, gain );
 	}
 #endif
 }
 
 void	AudioHLEState::Deinterleave( u16 outaddr, u16 inaddr, u16 count )
 {
+#ifdef DAEDALUS_SIMD_SSE
+	// Writes trail the reads, so this is safe as long as the output doesn't run ahead of the input.
+	u32		in_end( inaddr + count * 4 );
+	u32		out_end( outaddr + count * 2 );
+	if( ((outaddr | inaddr) & 3) == 0 && (outaddr <= inaddr || in_end <= outaddr) && Max( in_end, out_end ) <= sizeof( Buffer ) )
+	{
+		for( ; count >= 8; count -= 8 )
+		{
+			AudioSIMD_Deinterleave8( (s16 *)(Buffer + outaddr), (const s16 *)(Buffer + inaddr) );
+			outaddr += 16;
+			inaddr  += 32;
+		}
+	}
+#endif
+
 	while( count-- )
 	{
 		*(s16 *)(Buffer+(outaddr^2)) = *(s16 *)(Buffer+(inaddr^2));
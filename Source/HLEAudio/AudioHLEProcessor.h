@@ -26,9 +26,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef HLEAUDIO_AUDIOHLEPROCESSOR_H_
 #define HLEAUDIO_AUDIOHLEPROCESSOR_H_
 
+#include "Math/MathUtil.h"
 #include "Utility/Alignment.h"
 #include "Utility/DaedalusTypes.h"
 
+// Adds in * gain (1.15 fixed point) to acc, as the Mixer command does
+inline s16 AudioHLE_Mix( s16 acc, s16 in, s32 gain )
+{
+	return Saturate<s16>( s32( ( in * gain ) >> 15 ) + s32( acc ) );
+}
+
+// As AudioHLE_Mix, but rounding the product - this is what the envelope mixers do
+inline s16 AudioHLE_MixRound( s16 acc, s16 in, s32 gain )
+{
+	return Saturate<s16>( s32( acc ) + ( ( ( in * gain ) + 0x4000 ) >> 15 ) );
+}
+
+// Decodes one block of 8 ADPCM samples (pair swapped). l1/l2 are IN/OUT
+void DecodeSamples( s16 * out, s32 & l1, s32 & l2, const s32 * input, const s16 * book1, const s16 * book2 );
+
 struct AudioHLEState
 {
 	void	ClearBuffer( u16 addr, u16 count );
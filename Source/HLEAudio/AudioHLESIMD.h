@@ -0,0 +1,195 @@
+#ifndef HLEAUDIO_AUDIOHLESIMD_H_
+#define HLEAUDIO_AUDIOHLESIMD_H_
+
+#include "Math/SIMD.h"
+
+#ifdef DAEDALUS_SIMD_SSE
+
+#include "Utility/DaedalusTypes.h"
+
+// SSE2 versions of the inner loops of the audio ucode commands, 8 samples at a time.
+// SSE2 is always there on x86-64, so these are picked at compile time like the rest
+// of SIMD.h. The scalar loops they sit in front of are still the reference code, and
+// pick up any remainder and any case the kernels can't reproduce exactly.
+//
+// NB: all of these are bit-exact with the scalar code - saturation, rounding and the
+// 32 bit wraparound in the ADPCM predictor included. Keep it that way if you touch this.
+
+// Sign extend the low/high 4 lanes of 8 x s16 to 4 x s32.
+inline __m128i	AudioSIMD_Lo32( __m128i a )					{ return _mm_srai_epi32( _mm_unpacklo_epi16( a, a ), 16 ); }
+inline __m128i	AudioSIMD_Hi32( __m128i a )					{ return _mm_srai_epi32( _mm_unpackhi_epi16( a, a ), 16 ); }
+
+// Swap each pair of s16 lanes, i.e. the ^1 twiddle on sample indices.
+inline __m128i	AudioSIMD_SwapPairs( __m128i a )
+{
+	return _mm_shufflehi_epi16( _mm_shufflelo_epi16( a, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+}
+
+// Lanes N..N+7 of the 16 samples in a:b.
+template< int N >
+inline __m128i	AudioSIMD_Window( __m128i a, __m128i b )
+{
+	return _mm_or_si128( _mm_srli_si128( a, N * 2 ), _mm_slli_si128( b, 16 - N * 2 ) );
+}
+
+// (s16)( ((s32)a * (u32)b) >> 16 ) - the high half of a signed by unsigned multiply.
+inline __m128i	AudioSIMD_MulHiSU( __m128i a, __m128i b )
+{
+	return _mm_sub_epi16( _mm_mulhi_epu16( a, b ), _mm_and_si128( b, _mm_srai_epi16( a, 15 ) ) );
+}
+
+// The scalar loops work a sample at a time, so buffers which overlap can feed results
+// back into later samples. Blocks of 8 see exactly the same values as long as any
+// overlapping buffers are a whole number of blocks apart.
+inline bool		AudioSIMD_CanVectorise( u32 a, u32 b, u32 count )
+{
+	return ((a ^ b) & 0xf) == 0 || a + count <= b || b + count <= a;
+}
+
+// out[i] = Saturate<s16>( ((in[i] * gain) >> 15) + out[i] ), gain being s16.
+inline void		AudioSIMD_Mix8( s16 * out, const s16 * in, __m128i gain )
+{
+	__m128i	x( _mm_loadu_si128( (const __m128i *)in ) );
+	__m128i	o( _mm_loadu_si128( (const __m128i *)out ) );
+	__m128i	lo( _mm_mullo_epi16( x, gain ) );
+	__m128i	hi( _mm_mulhi_epi16( x, gain ) );
+	__m128i	r0( _mm_add_epi32( _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 15 ), AudioSIMD_Lo32( o ) ) );
+	__m128i	r1( _mm_add_epi32( _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 15 ), AudioSIMD_Hi32( o ) ) );
+
+	_mm_storeu_si128( (__m128i *)out, _mm_packs_epi32( r0, r1 ) );
+}
+
+// Saturate<s16>( acc[i] + ((in[i] * gain[i] + 0x4000) >> 15) ), gains being s16.
+inline __m128i	AudioSIMD_MixRound( __m128i in, __m128i acc, __m128i gain )
+{
+	const __m128i	one( _mm_set1_epi16( 1 ) );
+	const __m128i	round( _mm_set1_epi16( 0x4000 ) );
+
+	__m128i	r0( _mm_madd_epi16( _mm_unpacklo_epi16( in, one ), _mm_unpacklo_epi16( gain, round ) ) );
+	__m128i	r1( _mm_madd_epi16( _mm_unpackhi_epi16( in, one ), _mm_unpackhi_epi16( gain, round ) ) );
+	r0 = _mm_add_epi32( _mm_srai_epi32( r0, 15 ), AudioSIMD_Lo32( acc ) );
+	r1 = _mm_add_epi32( _mm_srai_epi32( r1, 15 ), AudioSIMD_Hi32( acc ) );
+
+	return _mm_packs_epi32( r0, r1 );
+}
+
+// The per-sample half of the envelope mixers: dst[n][i] += (in[i] * gains[n][i] + 0x4000) >> 15,
+// saturated, for up to 4 destinations. Gains are in buffer order. Everything is loaded before
+// anything is stored, as the scalar loops do. Returns false (having written nothing) if any of
+// the gains is outside s16 range, which happens at full volume.
+inline bool		AudioSIMD_EnvMix8( const s16 * in, s16 * const * dst, const s32 * const * gains, u32 num_dst )
+{
+	__m128i	g[4];
+	__m128i	acc[4];
+	for( u32 n = 0; n < num_dst; ++n )
+	{
+		__m128i	g0( _mm_loadu_si128( (const __m128i *)gains[n] ) );
+		__m128i	g1( _mm_loadu_si128( (const __m128i *)(gains[n] + 4) ) );
+		g[n] = _mm_packs_epi32( g0, g1 );
+
+		__m128i	same( _mm_and_si128( _mm_cmpeq_epi32( AudioSIMD_Lo32( g[n] ), g0 ), _mm_cmpeq_epi32( AudioSIMD_Hi32( g[n] ), g1 ) ) );
+		if( _mm_movemask_epi8( same ) != 0xffff )
+			return false;
+	}
+
+	__m128i	x( _mm_loadu_si128( (const __m128i *)in ) );
+	for( u32 n = 0; n < num_dst; ++n )
+	{
+		acc[n] = _mm_loadu_si128( (const __m128i *)dst[n] );
+	}
+	for( u32 n = 0; n < num_dst; ++n )
+	{
+		_mm_storeu_si128( (__m128i *)dst[n], AudioSIMD_MixRound( x, acc[n], g[n] ) );
+	}
+	return true;
+}
+
+// Interleave 8 samples from each of l and r into 8 stereo words. Like the scalar loop,
+// each pair of words is swapped.
+inline void		AudioSIMD_Interleave8( u32 * out, const u16 * l, const u16 * r )
+{
+	__m128i	vl( _mm_loadu_si128( (const __m128i *)l ) );
+	__m128i	vr( _mm_loadu_si128( (const __m128i *)r ) );
+
+	_mm_storeu_si128( (__m128i *)(out + 0), _mm_shuffle_epi32( _mm_unpacklo_epi16( vl, vr ), _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	_mm_storeu_si128( (__m128i *)(out + 4), _mm_shuffle_epi32( _mm_unpackhi_epi16( vl, vr ), _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+}
+
+// Take every other sample from the 16 at in. Both pointers must be word aligned
+// relative to the start of the buffer, so the ^2 address twiddle is a pair swap.
+inline void		AudioSIMD_Deinterleave8( s16 * out, const s16 * in )
+{
+	__m128i	a( _mm_loadu_si128( (const __m128i *)(in + 0) ) );
+	__m128i	b( _mm_loadu_si128( (const __m128i *)(in + 8) ) );
+	__m128i	odd( _mm_packs_epi32( _mm_srai_epi32( a, 16 ), _mm_srai_epi32( b, 16 ) ) );
+
+	_mm_storeu_si128( (__m128i *)out, AudioSIMD_SwapPairs( odd ) );
+}
+
+// The ADPCM predictor. Output sample j is
+//
+//   book1[j]*l1 + book2[j]*l2 + sum( book2[j-1-k]*input[k], k < j ) + 2048*input[j]
+//
+// which is a dot product of (l1, l2, input[0..7]) with a column of coefficients that
+// only depends on the codebook. Every term is s16 x s16, so it maps onto pmaddwd.
+struct AudioSIMD_ADPCMBook
+{
+	const s16 *	Book;			// The book1 these were built from (book2 follows it)
+	__m128i		Coeffs[5][2];	// [pair of inputs][outputs 0-3, 4-7]
+};
+
+inline void		AudioSIMD_PrepareADPCMBook( AudioSIMD_ADPCMBook & book, const s16 * book1, const s16 * book2 )
+{
+	s16		c[5][8][2];
+
+	for( u32 j = 0; j < 8; ++j )
+	{
+		c[0][j][0] = book1[j];
+		c[0][j][1] = book2[j];
+
+		for( u32 k = 0; k < 8; ++k )
+		{
+			s16		v( k < j ? book2[j-1-k] : k == j ? 2048 : 0 );
+			c[1 + k/2][j][k&1] = v;
+		}
+	}
+
+	for( u32 p = 0; p < 5; ++p )
+	{
+		book.Coeffs[p][0] = _mm_loadu_si128( (const __m128i *)&c[p][0][0] );
+		book.Coeffs[p][1] = _mm_loadu_si128( (const __m128i *)&c[p][4][0] );
+	}
+	book.Book = book1;
+}
+
+// Decode 8 samples. input must be in s16 range, which all the ADPCM decoders guarantee.
+// As in DecodeSamples(), l1/l2 are in/out and the output is pair swapped.
+inline void		AudioSIMD_DecodeADPCM8( s16 * out, s32 & l1, s32 & l2, const s32 * input, const AudioSIMD_ADPCMBook & book )
+{
+	__m128i	in( _mm_packs_epi32( _mm_loadu_si128( (const __m128i *)(input + 0) ), _mm_loadu_si128( (const __m128i *)(input + 4) ) ) );
+	__m128i	x[5];
+
+	x[0] = _mm_set1_epi32( s32( u32( u16( l1 ) ) | (u32( l2 ) << 16) ) );
+	x[1] = _mm_shuffle_epi32( in, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+	x[2] = _mm_shuffle_epi32( in, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+	x[3] = _mm_shuffle_epi32( in, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+	x[4] = _mm_shuffle_epi32( in, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+
+	__m128i	a0( _mm_madd_epi16( x[0], book.Coeffs[0][0] ) );
+	__m128i	a1( _mm_madd_epi16( x[0], book.Coeffs[0][1] ) );
+	for( u32 p = 1; p < 5; ++p )
+	{
+		a0 = _mm_add_epi32( a0, _mm_madd_epi16( x[p], book.Coeffs[p][0] ) );
+		a1 = _mm_add_epi32( a1, _mm_madd_epi16( x[p], book.Coeffs[p][1] ) );
+	}
+
+	__m128i	r( _mm_packs_epi32( _mm_srai_epi32( a0, 11 ), _mm_srai_epi32( a1, 11 ) ) );
+	_mm_storeu_si128( (__m128i *)out, AudioSIMD_SwapPairs( r ) );
+
+	l1 = s16( _mm_extract_epi16( r, 6 ) );
+	l2 = s16( _mm_extract_epi16( r, 7 ) );
+}
+
+#endif // DAEDALUS_SIMD_SSE
+
+#endif // HLEAUDIO_AUDIOHLESIMD_H_
@@ -0,0 +1,266 @@
+#include <stdafx.h>
+#include "HLEAudio/AudioHLESIMD.h"
+
+#ifdef DAEDALUS_SIMD_SSE
+
+#include "HLEAudio/AudioHLEProcessor.h"
+
+#include <string.h>
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+// The kernels in AudioHLESIMD.h claim to be bit-exact with the scalar code in
+// AudioHLEProcessor.h/.cpp.
+
+namespace
+{
+
+static const u32 kNumRuns = 20000;
+
+// Mostly anything, but with the extremes turning up often enough to hit saturation.
+static s16 RandomSample( std::mt19937 & rng )
+{
+	switch( rng() & 7 )
+	{
+	case 0:		return -32768;
+	case 1:		return 32767;
+	default:	return s16( rng() );
+	}
+}
+
+static void MixScalar( s16 * out, const s16 * in, s32 gain, u32 count )
+{
+	for( u32 x = 0; x < count; x++ )
+		out[x] = AudioHLE_Mix( out[x], in[x], gain );
+}
+
+}
+
+TEST(AudioSIMD_Mix8, MatchesScalar)
+{
+	std::mt19937	rng( 0x5eed );
+
+	for( u32 run = 0; run < kNumRuns; ++run )
+	{
+		s16		in[8];
+		s16		out[8];
+		s16		expected[8];
+		s16		gain( RandomSample( rng ) );
+
+		for( u32 i = 0; i < 8; ++i )
+		{
+			in[i]  = RandomSample( rng );
+			out[i] = expected[i] = RandomSample( rng );
+		}
+
+		AudioSIMD_Mix8( out, in, _mm_set1_epi16( gain ) );
+		MixScalar( expected, in, gain, 8 );
+
+		ASSERT_EQ( 0, memcmp( expected, out, sizeof( out ) ) ) << "run " << run << " gain " << gain;
+	}
+}
+
+TEST(AudioSIMD_Mix8, Saturates)
+{
+	// -32768 * -32768 >> 15 is +32768, which only fits once it's been added to out.
+	s16		in[8]       = { -32768, -32768, -32768, 32767, 32767, -32768, 0, 1 };
+	s16		out[8]      = { 32767, -32768, 0, 32767, -32768, -1, -32768, 32767 };
+	s16		expected[8];
+
+	memcpy( expected, out, sizeof( out ) );
+
+	AudioSIMD_Mix8( out, in, _mm_set1_epi16( -32768 ) );
+	MixScalar( expected, in, -32768, 8 );
+
+	for( u32 i = 0; i < 8; ++i )
+		EXPECT_EQ( expected[i], out[i] ) << "sample " << i;
+	EXPECT_EQ( 32767, out[0] );
+	EXPECT_EQ( 0, out[1] );
+	EXPECT_EQ( 32767, out[2] );
+	EXPECT_EQ( 0, out[3] );
+	EXPECT_EQ( -32768, out[4] );
+}
+
+TEST(AudioSIMD_MixRound, MatchesScalar)
+{
+	std::mt19937	rng( 0xfeed );
+
+	for( u32 run = 0; run < kNumRuns; ++run )
+	{
+		s16		in[8];
+		s16		acc[8];
+		s16		gain[8];
+		s16		out[8];
+		s16		expected[8];
+
+		for( u32 i = 0; i < 8; ++i )
+		{
+			in[i]   = RandomSample( rng );
+			acc[i]  = RandomSample( rng );
+			gain[i] = RandomSample( rng );
+			expected[i] = AudioHLE_MixRound( acc[i], in[i], gain[i] );
+		}
+
+		__m128i	r( AudioSIMD_MixRound( _mm_loadu_si128( (const __m128i *)in ), _mm_loadu_si128( (const __m128i *)acc ), _mm_loadu_si128( (const __m128i *)gain ) ) );
+		_mm_storeu_si128( (__m128i *)out, r );
+
+		ASSERT_EQ( 0, memcmp( expected, out, sizeof( out ) ) ) << "run " << run;
+	}
+}
+
+TEST(AudioSIMD_EnvMix8, MatchesScalar)
+{
+	std::mt19937	rng( 0xbeef );
+
+	for( u32 run = 0; run < kNumRuns; ++run )
+	{
+		u32		num_dst( (rng() & 1) ? 4 : 2 );
+		s16		in[8];
+		s16		dst[4][8];
+		s16		expected[4][8];
+		s32		gains[4][8];
+
+		// Gains come from (Dry * (Acc>>16) + 0x4000) >> 15, so every now and then
+		// one is just outside s16 range and the kernel has to back out.
+		bool	in_range( true );
+		for( u32 n = 0; n < 4; ++n )
+		{
+			for( u32 i = 0; i < 8; ++i )
+			{
+				gains[n][i] = (rng() % 64) == 0 ? 32768 : RandomSample( rng );
+				dst[n][i]   = RandomSample( rng );
+				if( n < num_dst && gains[n][i] != s16( gains[n][i] ) )
+					in_range = false;
+			}
+		}
+		for( u32 i = 0; i < 8; ++i )
+			in[i] = RandomSample( rng );
+
+		memcpy( expected, dst, sizeof( dst ) );
+		if( in_range )
+		{
+			for( u32 n = 0; n < num_dst; ++n )
+				for( u32 i = 0; i < 8; ++i )
+					expected[n][i] = AudioHLE_MixRound( expected[n][i], in[i], gains[n][i] );
+		}
+
+		s16 * const			p_dst[4]   = { dst[0], dst[1], dst[2], dst[3] };
+		const s32 * const	p_gains[4] = { gains[0], gains[1], gains[2], gains[3] };
+
+		ASSERT_EQ( in_range, AudioSIMD_EnvMix8( in, p_dst, p_gains, num_dst ) ) << "run " << run;
+		ASSERT_EQ( 0, memcmp( expected, dst, sizeof( dst ) ) ) << "run " << run;
+	}
+}
+
+TEST(AudioSIMD_EnvMix8, AliasedOutputs)
+{
+	// The mixers load everything before storing anything, so a destination
+	// which is also the input sees the original samples.
+	s16		buf[8]  = { 1000, -1000, 32767, -32768, 12345, -12345, 0, 1 };
+	s16		in[8];
+	s32		gains[8] = { 32767, 32767, 32767, 32767, -32768, -32768, 100, -100 };
+	s16		expected[8];
+
+	memcpy( in, buf, sizeof( buf ) );
+	for( u32 i = 0; i < 8; ++i )
+		expected[i] = AudioHLE_MixRound( buf[i], in[i], gains[i] );
+
+	s16 * const			p_dst[2]   = { buf, buf };
+	const s32 * const	p_gains[2] = { gains, gains };
+
+	// Both destinations are the same buffer: the second store wins, and both were computed from the original.
+	ASSERT_TRUE( AudioSIMD_EnvMix8( buf, p_dst, p_gains, 2 ) );
+	EXPECT_EQ( 0, memcmp( expected, buf, sizeof( buf ) ) );
+}
+
+TEST(AudioSIMD_DecodeADPCM8, MatchesScalar)
+{
+	std::mt19937	rng( 0xadbc );
+
+	for( u32 run = 0; run < kNumRuns; ++run )
+	{
+		s16		book[16];
+		s32		input[8];
+		s16		out[8];
+		s16		expected[8];
+
+		for( u32 i = 0; i < 16; ++i )
+			book[i] = RandomSample( rng );
+		for( u32 i = 0; i < 8; ++i )
+			input[i] = RandomSample( rng );
+
+		s32		l1( RandomSample( rng ) ), l2( RandomSample( rng ) );
+		s32		ref_l1( l1 ), ref_l2( l2 );
+
+		AudioSIMD_ADPCMBook simd_book = {};
+		AudioSIMD_PrepareADPCMBook( simd_book, book, book + 8 );
+		AudioSIMD_DecodeADPCM8( out, l1, l2, input, simd_book );
+		DecodeSamples( expected, ref_l1, ref_l2, input, book, book + 8 );
+
+		ASSERT_EQ( 0, memcmp( expected, out, sizeof( out ) ) ) << "run " << run;
+		ASSERT_EQ( ref_l1, l1 ) << "run " << run;
+		ASSERT_EQ( ref_l2, l2 ) << "run " << run;
+	}
+}
+
+TEST(AudioSIMD_DecodeADPCM8, WrapsAround)
+{
+	// With everything at -32768 the 32 bit sums overflow (more than once for the
+	// later samples), and the result has to wrap exactly as the scalar code does.
+	s16		book[16];
+	s32		input[8];
+	s16		out[8];
+	s16		expected[8];
+
+	for( u32 i = 0; i < 16; ++i )
+		book[i] = -32768;
+	for( u32 i = 0; i < 8; ++i )
+		input[i] = -32768;
+
+	s32		l1( -32768 ), l2( -32768 );
+	s32		ref_l1( l1 ), ref_l2( l2 );
+
+	AudioSIMD_ADPCMBook simd_book = {};
+	AudioSIMD_PrepareADPCMBook( simd_book, book, book + 8 );
+	AudioSIMD_DecodeADPCM8( out, l1, l2, input, simd_book );
+	DecodeSamples( expected, ref_l1, ref_l2, input, book, book + 8 );
+
+	for( u32 i = 0; i < 8; ++i )
+		EXPECT_EQ( expected[i], out[i] ) << "sample " << i;
+	EXPECT_EQ( ref_l1, l1 );
+	EXPECT_EQ( ref_l2, l2 );
+}
+
+TEST(AudioSIMD_DecodeADPCM8, CarriesHistoryAcrossBlocks)
+{
+	std::mt19937	rng( 0x1234 );
+	s16		book[16];
+
+	for( u32 i = 0; i < 16; ++i )
+		book[i] = s16( rng() ) >> 4;
+
+	AudioSIMD_ADPCMBook simd_book = {};
+	AudioSIMD_PrepareADPCMBook( simd_book, book, book + 8 );
+
+	s32		l1( 0 ), l2( 0 );
+	s32		ref_l1( 0 ), ref_l2( 0 );
+
+	for( u32 block = 0; block < 256; ++block )
+	{
+		s32		input[8];
+		s16		out[8];
+		s16		expected[8];
+
+		for( u32 i = 0; i < 8; ++i )
+			input[i] = s16( (rng() & 0xf) << 12 );
+
+		AudioSIMD_DecodeADPCM8( out, l1, l2, input, simd_book );
+		DecodeSamples( expected, ref_l1, ref_l2, input, book, book + 8 );
+
+		ASSERT_EQ( 0, memcmp( expected, out, sizeof( out ) ) ) << "block " << block;
+	}
+}
+
+#endif // DAEDALUS_SIMD_SSE
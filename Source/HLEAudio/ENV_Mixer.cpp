@@ -6,6 +6,7 @@
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
+#include "HLEAudio/AudioHLESIMD.h"
 #include "Math/MathUtil.h"
 
 
@@ -20,6 +21,27 @@ inline u16 Sample_Mask( u32 x )
 	return (u16)( x & 0xffff );
 }
 
+#ifdef DAEDALUS_SIMD_SSE
+// 8 samples of ENVMIXER2. The buffers are all 16 byte aligned, so the ^1 twiddle just
+// permutes the lanes. Each buffer is loaded right before it's updated, so this gives
+// the same results as the scalar loop even if some of them are the same buffer.
+static void EnvMixer2_SIMD( const s16 * s3, s16 * t6, s16 * t7, s16 * s0, s16 * s1, u16 env_a, u16 env_b, u16 env_c, const s16 * v2, bool swap )
+{
+	__m128i in( _mm_loadu_si128( (const __m128i *)s3 ) );
+	__m128i vec9 ( _mm_xor_si128( AudioSIMD_MulHiSU( in, _mm_set1_epi16( s16( env_a ) ) ), _mm_set1_epi16( v2[0] ) ) );
+	__m128i vec10( _mm_xor_si128( AudioSIMD_MulHiSU( in, _mm_set1_epi16( s16( env_b ) ) ), _mm_set1_epi16( v2[1] ) ) );
+
+	_mm_storeu_si128( (__m128i *)t6, _mm_adds_epi16( _mm_loadu_si128( (const __m128i *)t6 ), vec9 ) );
+	_mm_storeu_si128( (__m128i *)t7, _mm_adds_epi16( _mm_loadu_si128( (const __m128i *)t7 ), vec10 ) );
+
+	vec9  = _mm_xor_si128( AudioSIMD_MulHiSU( vec9,  _mm_set1_epi16( s16( env_c ) ) ), _mm_set1_epi16( v2[2] ) );
+	vec10 = _mm_xor_si128( AudioSIMD_MulHiSU( vec10, _mm_set1_epi16( s16( env_c ) ) ), _mm_set1_epi16( v2[3] ) );
+
+	_mm_storeu_si128( (__m128i *)s0, _mm_adds_epi16( _mm_loadu_si128( (const __m128i *)s0 ), swap ? vec10 : vec9 ) );
+	_mm_storeu_si128( (__m128i *)s1, _mm_adds_epi16( _mm_loadu_si128( (const __m128i *)s1 ), swap ? vec9 : vec10 ) );
+}
+#endif
+
 
 void ENVSETUP1(AudioHLECommand command)
 {
@@ -70,8 +92,6 @@ void ENVMIXER_GE(AudioHLECommand command)
 void ENVMIXER2(AudioHLECommand command)
 {
   //fprintf (dfile, "ENVMIXER: cmd0 = %08X, cmd1 = %08X\n", command.cmd0, command.cmd1);
-  	s16 vec9, vec10;
-
   	s16 *buffs3 = (s16 *)(gAudioHLEState.Buffer + ((command.cmd0 >> 0x0c)&0x0ff0));
   	s16 *bufft6 = (s16 *)(gAudioHLEState.Buffer + ((command.cmd1 >> 0x14)&0x0ff0));
   	s16 *bufft7 = (s16 *)(gAudioHLEState.Buffer + ((command.cmd1 >> 0x0c)&0x0ff0));
@@ -103,6 +123,14 @@ void ENVMIXER2(AudioHLECommand command)
 
   	while (count > 0)
   	{
+#ifdef DAEDALUS_SIMD_SSE
+  		bool swap = (command.cmd0 & 0x10) != 0;
+
+  		EnvMixer2_SIMD( buffs3, bufft6, bufft7, buffs0, buffs1, env[0], env[2], env[4], v2, swap );
+  		if (!isMKABI)
+  			EnvMixer2_SIMD( buffs3 + 8, bufft6 + 8, bufft7 + 8, buffs0 + 8, buffs1 + 8, env[1], env[3], env[5], v2, swap );
+#else
+  		s16 vec9, vec10;
   		int temp;
   		for (int x=0; x < 0x8; x++)
   		{
@@ -156,6 +184,7 @@ void ENVMIXER2(AudioHLECommand command)
   				buffs1[x^1] = Saturate<s16>( temp );
   			}
   		}
+#endif
   		bufft6 += adder; bufft7 += adder;
   		buffs0 += adder; buffs1 += adder;
   		buffs3 += adder; count  -= adder;
@@ -178,10 +207,6 @@ void ENVMIXER3(AudioHLECommand command)
   	s16 *aux1=(s16 *)(gAudioHLEState.Buffer+0xB40);
   	s16 *aux2=(s16 *)(gAudioHLEState.Buffer+0xCB0);
   	s16 *aux3=(s16 *)(gAudioHLEState.Buffer+0xE20);
-  	s32 MainR;
-  	s32 MainL;
-  	s32 AuxR;
-  	s32 AuxL;
   	s32 i1,o1,a1,a2,a3;
 
   	s32 LAdder, LAcc, LVol;
@@ -235,78 +260,89 @@ void ENVMIXER3(AudioHLECommand command)
   	//	aux2=aux3=zero;
   	//}
 
-  	for (s32 y = 0; y < (0x170/2); y++) {
+  	s32 MainL[8], MainR[8], AuxL[8], AuxR[8];	// Gains for the current 8 samples, in buffer (y^1) order
+
+  	for (s32 y = 0; y < (0x170/2); y += 8) {
+
+  		for (s32 x = 0; x < 8; x++) {
+  			u32 g = x^1;
 
-  		// Left
-  		LAcc += LAdder;
-  		LVol += (LAcc >> 16);
-  		LAcc &= 0xFFFF;
+  			// Left
+  			LAcc += LAdder;
+  			LVol += (LAcc >> 16);
+  			LAcc &= 0xFFFF;
 
-  		// Right
-  		RAcc += RAdder;
-  		RVol += (RAcc >> 16);
-  		RAcc &= 0xFFFF;
+  			// Right
+  			RAcc += RAdder;
+  			RVol += (RAcc >> 16);
+  			RAcc &= 0xFFFF;
   // ****************************************************************
-  		// Clamp Left
-  		if (LSig >= 0) { // VLT
-  			if (LVol > LTrg) {
-  				LVol = LTrg;
+  			// Clamp Left
+  			if (LSig >= 0) { // VLT
+  				if (LVol > LTrg) {
+  					LVol = LTrg;
+  				}
+  			} else { // VGE
+  				if (LVol < LTrg) {
+  					LVol = LTrg;
+  				}
   			}
-  		} else { // VGE
-  			if (LVol < LTrg) {
-  				LVol = LTrg;
-  			}
-  		}
 
-  		// Clamp Right
-  		if (RSig >= 0) { // VLT
-  			if (RVol > RTrg) {
-  				RVol = RTrg;
-  			}
-  		} else { // VGE
-  			if (RVol < RTrg) {
-  				RVol = RTrg;
+  			// Clamp Right
+  			if (RSig >= 0) { // VLT
+  				if (RVol > RTrg) {
+  					RVol = RTrg;
+  				}
+  			} else { // VGE
+  				if (RVol < RTrg) {
+  					RVol = RTrg;
+  				}
   			}
-  		}
   // ****************************************************************
-  		MainL = ((Dry * LVol) + 0x4000) >> 15;
-  		MainR = ((Dry * RVol) + 0x4000) >> 15;
+  			MainL[g] = ((Dry * LVol) + 0x4000) >> 15;
+  			MainR[g] = ((Dry * RVol) + 0x4000) >> 15;
+  			AuxL[g]  = ((Wet * LVol) + 0x4000) >> 15;
+  			AuxR[g]  = ((Wet * RVol) + 0x4000) >> 15;
+  		}
 
-  		o1 = out [y^1];
-  		a1 = aux1[y^1];
-  		i1 = inp [y^1];
+#ifdef DAEDALUS_SIMD_SSE
+  		// The buffers are all 16 byte aligned and don't overlap.
+  		s16 * const dst[4] = { out + y, aux1 + y, aux2 + y, aux3 + y };
+  		const s32 * const gains[4] = { MainL, MainR, AuxL, AuxR };
 
-  		o1+=((i1*MainL)+0x4000)>>15;
-  		a1+=((i1*MainR)+0x4000)>>15;
+  		if (AudioSIMD_EnvMix8( inp + y, dst, gains, 4 ))
+  			continue;
+#endif
 
-  // ****************************************************************
+  		for (s32 x = 0; x < 8; x++) {
+  			u32 g = x^1;
+  			u32 i = y + g;
 
-  		o1 = Saturate<s16>( o1 );
-  		a1 = Saturate<s16>( a1 );
+  			o1 = out [i];
+  			a1 = aux1[i];
+  			i1 = inp [i];
 
-  // ****************************************************************
-
-  		out[y^1]=o1;
-  		aux1[y^1]=a1;
+  			o1 = AudioHLE_MixRound( o1, i1, MainL[g] );
+  			a1 = AudioHLE_MixRound( a1, i1, MainR[g] );
 
   // ****************************************************************
-  		//if (!(flags&A_AUX)) {
-  			a2 = aux2[y^1];
-  			a3 = aux3[y^1];
 
-  			AuxL  = ((Wet * LVol) + 0x4000) >> 15;
-  			AuxR  = ((Wet * RVol) + 0x4000) >> 15;
+  			out[i]=o1;
+  			aux1[i]=a1;
 
-  			a2+=((i1*AuxL)+0x4000)>>15;
-  			a3+=((i1*AuxR)+0x4000)>>15;
+  // ****************************************************************
+  			//if (!(flags&A_AUX)) {
+  				a2 = aux2[i];
+  				a3 = aux3[i];
 
-  			a2 = Saturate<s16>( a2 );
-  			a3 = Saturate<s16>( a3 );
+  				a2 = AudioHLE_MixRound( a2, i1, AuxL[g] );
+  				a3 = AudioHLE_MixRound( a3, i1, AuxR[g] );
 
-  			aux2[y^1]=a2;
-  			aux3[y^1]=a3;
+  				aux2[i]=a2;
+  				aux3[i]=a3;
+  			//}
   		}
-  	//}
+  	}
 
   	*(s16 *)(buff +  0) = Wet; // 0-1
   	*(s16 *)(buff +  2) = Dry; // 2-3
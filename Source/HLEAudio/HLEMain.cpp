@@ -27,11 +27,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "stdafx.h"
 
+#include <string.h>
+
 #include "HLEAudio/audiohle.h"
 #include "HLEAudio/AudioHLEProcessor.h"
 #include "OSHLE/ultra_sptask.h"
 #include "Utility/Profiler.h"
 
+#ifndef DAEDALUS_PSP
+#include "Utility/JobSystem.h"
+#endif
+
 // Audio UCode lists
 // Dummy UCode Handler
 //
@@ -84,6 +90,7 @@ extern bool isZeldaABI;
 //*****************************************************************************
 void Audio_Reset()
 {
+	Audio_WaitForUcode();
 	bAudioChanged = false;
 	isMKABI		  = false;
 	isZeldaABI	  = false;
@@ -111,6 +118,28 @@ inline void Audio_Ucode_Detect(OSTask * pTask)
 	}
 }
 
+//*****************************************************************************
+//
+//*****************************************************************************
+static void Audio_ProcessAList( const u32 * p_alist, u32 ucode_size )
+{
+	gAudioHLEState.LoopVal = 0;
+	//memset( gAudioHLEState.Segments, 0, sizeof( gAudioHLEState.Segments ) );
+
+	while( ucode_size )
+	{
+		AudioHLECommand command;
+		command.cmd0 = *p_alist++;
+		command.cmd1 = *p_alist++;
+
+		ABI[command.cmd](command);
+
+		--ucode_size;
+
+		//printf("%08X %08X\n",command.cmd0,command.cmd1);
+	}
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -128,22 +157,89 @@ void Audio_Ucode()
 		Audio_Ucode_Detect( pTask );
 	}
 
-	gAudioHLEState.LoopVal = 0;
-	//memset( gAudioHLEState.Segments, 0, sizeof( gAudioHLEState.Segments ) );
-
-	u32 * p_alist = (u32 *)(g_pu8RamBase + (uintptr_t)pTask->t.data_ptr);
+	const u32 * p_alist = (const u32 *)(g_pu8RamBase + (uintptr_t)pTask->t.data_ptr);
 	u32 ucode_size = (pTask->t.data_size >> 3);	//ABI5 can return 0 here!!!
 
-	while( ucode_size )
+	Audio_ProcessAList( p_alist, ucode_size );
+}
+
+#ifndef DAEDALUS_PSP
+//*****************************************************************************
+//	Asynchronous processing. The task's command list is copied when the task
+//	is started, so the RSP's DMEM is free as soon as we return. Only one
+//	audio task is ever in flight - the game waits for the SP interrupt before
+//	starting the next - so a single copy is enough.
+//
+//	The RDRAM the list reads (sample data, ADPCM tables, mixer state) is NOT
+//	copied. DMAs into RDRAM wait for the list first (RSP_HLE_SyncAudioTask),
+//	but cpu stores can't be caught. On hardware the RSP reads those buffers
+//	while the cpu runs too, so games leave them alone until the task is done.
+//*****************************************************************************
+static const u32	kMaxAListCommands = 4096;	// Longer lists are processed synchronously
+
+static u32			gAList[ kMaxAListCommands * 2 ];
+static JobHandle	gAudioJob = kInvalidJob;
+
+class SAudioTaskJob : public SJob
+{
+public:
+	explicit SAudioTaskJob( u32 num_commands )
+		:	mNumCommands( num_commands )
 	{
-		AudioHLECommand command;
-		command.cmd0 = *p_alist++;
-		command.cmd1 = *p_alist++;
+		InitJob = nullptr;
+		DoJob = &DoAudioTaskStatic;
+		FiniJob = nullptr;
+	}
 
-		ABI[command.cmd](command);
+	static int DoAudioTaskStatic( SJob * arg )
+	{
+		SAudioTaskJob * job( static_cast< SAudioTaskJob * >( arg ) );
+		Audio_ProcessAList( gAList, job->mNumCommands );
+		return 0;
+	}
 
-		--ucode_size;
+private:
+	u32		mNumCommands;
+};
 
-		//printf("%08X %08X\n",command.cmd0,command.cmd1);
+//*****************************************************************************
+//
+//*****************************************************************************
+bool Audio_UcodeAsync()
+{
+	OSTask * pTask = (OSTask *)(g_pu8SpMemBase + 0x0FC0);
+	u32 ucode_size = (pTask->t.data_size >> 3);
+
+	if ( ucode_size > kMaxAListCommands || gJobSystem.GetNumWorkers() == 0 )
+		return false;
+
+	// Should already have been waited for when the last task's interrupt was raised
+	Audio_WaitForUcode();
+
+	if ( !bAudioChanged )
+	{
+		bAudioChanged = true;
+		Audio_Ucode_Detect( pTask );
+	}
+
+	memcpy( gAList, g_pu8RamBase + (uintptr_t)pTask->t.data_ptr, ucode_size * 8 );
+
+	SAudioTaskJob	job( ucode_size );
+	gAudioJob = gJobSystem.AddJob( &job, sizeof( job ) );
+	return true;
+}
+
+void Audio_WaitForUcode()
+{
+	if ( gAudioJob != kInvalidJob )
+	{
+		gJobSystem.WaitForJob( gAudioJob );
+		gAudioJob = kInvalidJob;
 	}
 }
+#else
+// The PSP runs async audio lists on the ME through its own job manager.
+void Audio_WaitForUcode()
+{
+}
+#endif // DAEDALUS_PSP
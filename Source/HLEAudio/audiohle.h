@@ -438,4 +438,10 @@ void UNKNOWN(AudioHLECommand command);
 void Audio_Ucode();
 void Audio_Reset();
 
+// Copy the current task and process it on a worker thread. Returns false if
+// the task couldn't be started, in which case it should be run with Audio_Ucode.
+bool Audio_UcodeAsync();
+// Block until the task started by Audio_UcodeAsync has finished.
+void Audio_WaitForUcode();
+
 #endif // HLEAUDIO_AUDIOHLE_H_
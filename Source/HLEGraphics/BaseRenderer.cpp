@@ -30,6 +30,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "HLEGraphics/TextureCache.h"
 #include "HLEGraphics/RDPStateManager.h"
 #include "HLEGraphics/DLDebug.h"
+#include "HLEGraphics/TnLScalar.h"
+#include "HLEGraphics/TnLSIMD.h"
 #include "Math/Math.h"			// VFPU Math
 #include "Math/MathUtil.h"
 #include "OSHLE/ultra_gbi.h"
@@ -141,6 +143,7 @@ BaseRenderer::BaseRenderer()
 ,	mWorldProjectValid(false)
 ,	mReloadProj(true)
 ,	mWPmodified(false)
+,	mHardwareClipping(false)
 
 ,	mScreenWidth(0.f)
 ,	mScreenHeight(0.f)
@@ -383,6 +386,8 @@ void BaseRenderer::UpdateViewport()
 	sceGuOffset(vx - (vp_w/2),vy - (vp_h/2));
 	sceGuViewport(vx + vp_x, vy + vp_y, vp_w, vp_h);
 #elif defined(DAEDALUS_GL)
+	// Anything already batched was meant for the old viewport
+	FlushBatchedDraws();
 	glViewport(vp_x, (s32)mScreenHeight - (vp_h + vp_y), vp_w, vp_h);
 #ifdef DAEDALUS_ENABLE_ASSERTS
 #else
@@ -511,6 +516,21 @@ void BaseRenderer::FlushTris()
 
 	TempVerts temp_verts;
 
+	// Triangles entirely outside the frustum were already rejected in AddTri, so
+	// if the hardware can clip the rest, hand them over as they are. Each vertex
+	// is only converted once, however many triangles share it.
+	if( mHardwareClipping )
+	{
+		u16 indices[kMaxIndices];
+		PrepareTrisIndexed( &temp_verts, indices );
+
+		RenderTrianglesIndexed( temp_verts.Verts, temp_verts.Count, indices, mNumIndices, gRDPOtherMode.depth_source ? true : false );
+
+		mNumIndices = 0;
+		mVtxClipFlagsUnion = 0;
+		return;
+	}
+
 	// If any bit is set here it means we have to clip the trianlges since PSP HW clipping sux!
 	if(mVtxClipFlagsUnion != 0)
 	{
@@ -945,70 +965,61 @@ void BaseRenderer::PrepareTrisUnclipped( TempVerts * temp_verts ) const
  #endif
 }
 
-#ifndef DAEDALUS_PSP_USE_VFPU
 //*****************************************************************************
 //
 //*****************************************************************************
-v3 BaseRenderer::LightVert( const v3 & norm ) const
+void BaseRenderer::PrepareTrisIndexed( TempVerts * temp_verts, u16 * indices ) const
 {
-	const v3 & col = mTnL.Lights[mTnL.NumLights].Colour;
-	v3 result( col.x, col.y, col.z );
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( mNumIndices > 0, "The number of indices should have been checked" );
+	#endif
+	static const u16 kUnused = 0xffff;
 
-	for ( u32 l = 0; l < mTnL.NumLights; l++ )
+	u16 remap[kMaxN64Vertices];
+	memset( remap, 0xff, sizeof( remap ) );
+
+	// There can't be more unique vertices than indices.
+	DaedalusVtx *	p_vertices   = temp_verts->Alloc(mNumIndices);
+	u32				num_vertices = 0;
+
+	for( u32 i = 0; i < mNumIndices; ++i )
 	{
-		f32 fCosT = norm.Dot( mTnL.Lights[l].Direction );
-		if (fCosT > 0.0f)
+		u32 index = mIndexBuffer[ i ];
+
+		if( remap[ index ] == kUnused )
 		{
-			result.x += mTnL.Lights[l].Colour.x * fCosT;
-			result.y += mTnL.Lights[l].Colour.y * fCosT;
-			result.z += mTnL.Lights[l].Colour.z * fCosT;
+			DaedalusVtx & vtx = p_vertices[ num_vertices ];
+
+			vtx.Texture = mVtxProjected[ index ].Texture;
+			vtx.Colour = c32( mVtxProjected[ index ].Colour );
+			vtx.Position.x = mVtxProjected[ index ].TransformedPos.x;
+			vtx.Position.y = mVtxProjected[ index ].TransformedPos.y;
+			vtx.Position.z = mVtxProjected[ index ].TransformedPos.z;
+
+			remap[ index ] = (u16)num_vertices++;
 		}
-	}
 
-	//Clamp to 1.0
-	if( result.x > 1.0f ) result.x = 1.0f;
-	if( result.y > 1.0f ) result.y = 1.0f;
-	if( result.z > 1.0f ) result.z = 1.0f;
+		indices[ i ] = remap[ index ];
+	}
 
-	return result;
+	temp_verts->Count = num_vertices;
 }
 
 //*****************************************************************************
 //
 //*****************************************************************************
-v3 BaseRenderer::LightPointVert( const v4 & w ) const
+void BaseRenderer::RenderTrianglesIndexed( DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer )
 {
-	const v3 & col = mTnL.Lights[mTnL.NumLights].Colour;
-	v3 result( col.x, col.y, col.z );
+	TempVerts temp_verts;
+	DaedalusVtx * p_expanded = temp_verts.Alloc( num_indices );
 
-	for ( u32 l = 0; l < mTnL.NumLights; l++ )
+	for( u32 i = 0; i < num_indices; ++i )
 	{
-		if ( mTnL.Lights[l].SkipIfZero )
-		{
-			v3 distance_vec( mTnL.Lights[l].Position.x-w.x, mTnL.Lights[l].Position.y-w.y, mTnL.Lights[l].Position.z-w.z );
-
-			f32 light_qlen = distance_vec.LengthSq();
-			f32 light_llen = sqrtf( light_qlen );
-
-			f32 at = mTnL.Lights[l].ca + mTnL.Lights[l].la * light_llen + mTnL.Lights[l].qa * light_qlen;
-			if (at > 0.0f)
-			{
-				f32 fCosT = 1.0f/at;
-				result.x += mTnL.Lights[l].Colour.x * fCosT;
-				result.y += mTnL.Lights[l].Colour.y * fCosT;
-				result.z += mTnL.Lights[l].Colour.z * fCosT;
-			}
-		}
+		p_expanded[ i ] = p_vertices[ indices[ i ] ];
 	}
 
-	//Clamp to 1.0
-	if( result.x > 1.0f ) result.x = 1.0f;
-	if( result.y > 1.0f ) result.y = 1.0f;
-	if( result.z > 1.0f ) result.z = 1.0f;
-
-	return result;
+	RenderTriangles( p_expanded, num_indices, disable_zbuffer );
 }
-#endif
 
 //*****************************************************************************
 // Standard rendering pipeline using FPU/CPU
@@ -1035,113 +1046,18 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 		//Point light for Zelda MM
 		_TnLVFPU_Plight( &mat_world, &mat_world_project, pVtxBase, &mVtxProjected[v0], n, &mTnL );
 	}
+#elif defined(DAEDALUS_SIMD)
+	TnL_SIMD( mat_world, mat_world_project, pVtxBase, &mVtxProjected[v0], n, mTnL );
 #else
-	// Transform and Project + Lighting or Transform and Project with Colour
-	//
-	for (u32 i = v0; i < v0 + n; i++)
-	{
-		const FiddledVtx & vert = pVtxBase[i - v0];
-
-		// VTX Transform
-		//
-		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
-
-		v4 & projected( mVtxProjected[i].ProjectedPos );
-		projected = mat_world_project.Transform( w );
-		mVtxProjected[i].TransformedPos = mat_world.Transform( w );
-
-		//	Initialise the clipping flags
-		//
-		u32 clip_flags = 0;
-		if		(projected.x < -projected.w)	clip_flags |= X_POS;
-		else if (projected.x > projected.w)		clip_flags |= X_NEG;
-
-		if		(projected.y < -projected.w)	clip_flags |= Y_POS;
-		else if (projected.y > projected.w)		clip_flags |= Y_NEG;
-
-		if		(projected.z < -projected.w)	clip_flags |= Z_POS;
-		else if (projected.z > projected.w)		clip_flags |= Z_NEG;
-		mVtxProjected[i].ClipFlags = clip_flags;
-
-		// LIGHTING OR COLOR
-		//
-		if ( mTnL.Flags.Light )
-		{
-			v3 model_normal(f32( vert.norm_x ), f32( vert.norm_y ), f32( vert.norm_z ) );
-			v3 vecTransformedNormal;
-			vecTransformedNormal = mat_world.TransformNormal( model_normal );
-			vecTransformedNormal.Normalise();
-
-			v3 col;
-
-			if ( mTnL.Flags.PointLight )
-			{//POINT LIGHT
-				col = LightPointVert(w); // Majora's Mask uses this
-			}
-			else
-			{//NORMAL LIGHT
-				col = LightVert(vecTransformedNormal);
-			}
-			mVtxProjected[i].Colour.x = col.x;
-			mVtxProjected[i].Colour.y = col.y;
-			mVtxProjected[i].Colour.z = col.z;
-			mVtxProjected[i].Colour.w = vert.rgba_a * (1.0f / 255.0f);
-
-			// ENV MAPPING
-			//
-			if ( mTnL.Flags.TexGen )
-			{
-				// Update texture coords n.b. need to divide tu/tv by bogus scale on addition to buffer
-				// If the vert is already lit, then there is no normal (and hence we can't generate tex coord)
-#if 1			// 1->Lets use mat_world_project instead of mat_world for nicer effect (see SSV space ship) //Corn
-				vecTransformedNormal = mat_world_project.TransformNormal( model_normal );
-				vecTransformedNormal.Normalise();
-#endif
-
-				const v3 & norm = vecTransformedNormal;
-
-				if( mTnL.Flags.TexGenLin )
-				{
-					mVtxProjected[i].Texture.x = 0.5f * ( 1.0f + norm.x );
-					mVtxProjected[i].Texture.y = 0.5f * ( 1.0f + norm.y );
-				}
-				else
-				{
-					//Cheap way to do Acos(x)/Pi (abs() fixes star in SM64, sort of) //Corn
-					f32 NormX = fabsf( norm.x );
-					f32 NormY = fabsf( norm.y );
-					mVtxProjected[i].Texture.x =  0.5f - 0.25f * NormX - 0.25f * NormX * NormX * NormX;
-					mVtxProjected[i].Texture.y =  0.5f - 0.25f * NormY - 0.25f * NormY * NormY * NormY;
-				}
-			}
-			else
-			{
-				//Set Texture coordinates
-				mVtxProjected[i].Texture.x = (float)vert.tu * mTnL.TextureScaleX;
-				mVtxProjected[i].Texture.y = (float)vert.tv * mTnL.TextureScaleY;
-			}
-		}
-		else
-		{
-			//if( mTnL.Flags.Shade )
-			{// FLAT shade
-				mVtxProjected[i].Colour = v4( vert.rgba_r * (1.0f / 255.0f), vert.rgba_g * (1.0f / 255.0f), vert.rgba_b * (1.0f / 255.0f), vert.rgba_a * (1.0f / 255.0f) );
-			}
-			/*else
-			{// PRIM shade, SSV uses this, doesn't seem to do anything????
-				mVtxProjected[i].Colour = mPrimitiveColour.GetColourV4();
-			}*/
-
-
-			//Set Texture coordinates
-			mVtxProjected[i].Texture.x = (float)vert.tu * mTnL.TextureScaleX;
-			mVtxProjected[i].Texture.y = (float)vert.tv * mTnL.TextureScaleY;
-		}
+	TnL_Scalar( mat_world, mat_world_project, pVtxBase, &mVtxProjected[v0], n, mTnL );
 
 #ifdef DAEDALUS_PSP
-		//Fog
-		if ( mTnL.Flags.Fog )
+	//Fog
+	if ( mTnL.Flags.Fog )
+	{
+		for (u32 i = v0; i < v0 + n; i++)
 		{
+			const v4 & projected( mVtxProjected[i].ProjectedPos );
 			if(projected.w > 0.0f)	//checking for positive w fixes near plane fog errors //Corn
 			{
 				f32 eye_z = projected.z / projected.w;
@@ -1154,8 +1070,8 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 				mVtxProjected[i].Colour.w = 0.0f;
 			}
 		}
-#endif // DAEDALUS_PSP
 	}
+#endif // DAEDALUS_PSP
 #endif // DAEDALUS_PSP_USE_VFPU
 }
 
@@ -1176,135 +1092,10 @@ void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 	
 #ifdef DAEDALUS_PSP_USE_VFPU	
 	_TnLVFPUCBFD( &mat_world, &mat_project, pVtxBase, &mVtxProjected[v0], n, &mTnL, mn, v0<<1 );
+#elif defined(DAEDALUS_SIMD)
+	TnL_SIMD_CBFD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn, v0 );
 #else
-	// Transform and Project + Lighting or Transform and Project with Colour
-	//
-	for (u32 i = v0; i < v0 + n; i++)
-	{
-		const FiddledVtx & vert = pVtxBase[i - v0];
-
-		// VTX Transform
-		//
-		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
-
-		v4 & transformed( mVtxProjected[i].TransformedPos );
-		transformed = mat_world.Transform( w );
-
-		v4 & projected( mVtxProjected[i].ProjectedPos );
-		projected = mat_project.Transform( transformed );
-
-		//	Initialise the clipping flags
-		//
-		u32 clip_flags = 0;
-		if		(projected.x < -projected.w)	clip_flags |= X_POS;
-		else if (projected.x > projected.w)		clip_flags |= X_NEG;
-
-		if		(projected.y < -projected.w)	clip_flags |= Y_POS;
-		else if (projected.y > projected.w)		clip_flags |= Y_NEG;
-
-		if		(projected.z < -projected.w)	clip_flags |= Z_POS;
-		else if (projected.z > projected.w)		clip_flags |= Z_NEG;
-		mVtxProjected[i].ClipFlags = clip_flags;
-
-		mVtxProjected[i].Colour.x = (f32)vert.rgba_r * (1.0f / 255.0f);
-		mVtxProjected[i].Colour.y = (f32)vert.rgba_g * (1.0f / 255.0f);
-		mVtxProjected[i].Colour.z = (f32)vert.rgba_b * (1.0f / 255.0f);
-		mVtxProjected[i].Colour.w = (f32)vert.rgba_a * (1.0f / 255.0f);	//Pass alpha channel unmodified
-
-		// LIGHTING OR COLOR
-		//
-		if ( mTnL.Flags.Light )
-		{
-			v3 model_normal( mn[((i<<1)+0)^3], mn[((i<<1)+1)^3], vert.normz );
-			v3 vecTransformedNormal = mat_world.TransformNormal( model_normal );
-			vecTransformedNormal.Normalise();
-			const v3 & norm = vecTransformedNormal;
-			const v3 & col = mTnL.Lights[mTnL.NumLights].Colour;
-
-			v4 Pos;
-			Pos.x = (projected.x + mTnL.CoordMod[8]) * mTnL.CoordMod[12];
-			Pos.y = (projected.y + mTnL.CoordMod[9]) * mTnL.CoordMod[13];
-			Pos.z = (projected.z + mTnL.CoordMod[10])* mTnL.CoordMod[14];
-			Pos.w = (projected.w + mTnL.CoordMod[11])* mTnL.CoordMod[15];
-
-			v3 result( col.x, col.y, col.z );
-			f32 fCosT;
-			u32 l;
-
-			if ( mTnL.Flags.PointLight )
-			{	//POINT LIGHT
-				for (l = 0; l < mTnL.NumLights-1; l++)
-				{
-					if ( mTnL.Lights[l].SkipIfZero )
-					{
-						fCosT = norm.Dot( mTnL.Lights[l].Direction );
-						if (fCosT > 0.0f)
-						{
-							f32 pi = mTnL.Lights[l].Iscale / (Pos - mTnL.Lights[l].Position).LengthSq();
-							if (pi < 1.0f) fCosT *= pi;
-
-							result.x += mTnL.Lights[l].Colour.x * fCosT;
-							result.y += mTnL.Lights[l].Colour.y * fCosT;
-							result.z += mTnL.Lights[l].Colour.z * fCosT;
-						}
-					}
-				}
-
-				fCosT = norm.Dot( mTnL.Lights[l].Direction );
-				if (fCosT > 0.0f)
-				{
-					result.x += mTnL.Lights[l].Colour.x * fCosT;
-					result.y += mTnL.Lights[l].Colour.y * fCosT;
-					result.z += mTnL.Lights[l].Colour.z * fCosT;
-				}
-			}
-			else
-			{	//NORMAL LIGHT
-				for (l = 0; l < mTnL.NumLights; l++)
-				{
-					if ( mTnL.Lights[l].SkipIfZero )
-					{
-						f32 pi = mTnL.Lights[l].Iscale / (Pos - mTnL.Lights[l].Position).LengthSq();
-						if (pi > 1.0f) pi = 1.0f;
-
-						result.x += mTnL.Lights[l].Colour.x * pi;
-						result.y += mTnL.Lights[l].Colour.y * pi;
-						result.z += mTnL.Lights[l].Colour.z * pi;
-					}
-				}
-			}
-
-			//Clamp result to 1.0
-			if( result.x < 1.0f ) mVtxProjected[i].Colour.x *= result.x;
-			if( result.y < 1.0f ) mVtxProjected[i].Colour.y *= result.y;
-			if( result.z < 1.0f ) mVtxProjected[i].Colour.z *= result.z;
-
-			// ENV MAPPING
-			if ( mTnL.Flags.TexGen )
-			{
-				if( mTnL.Flags.TexGenLin )
-				{
-					mVtxProjected[i].Texture.x =  0.5f - 0.25f * norm.x - 0.25f * norm.x * norm.x * norm.x;	//Cheap way to do ~Acos(x)/Pi //Corn
-					mVtxProjected[i].Texture.y =  0.5f - 0.25f * norm.y - 0.25f * norm.y * norm.y * norm.y;
-				}
-				else
-				{
-					mVtxProjected[i].Texture.x = 0.5f * ( 1.0f + norm.x );
-					mVtxProjected[i].Texture.y = 0.5f * ( 1.0f + norm.y );
-				}
-			}
-			else
-			{	//TEXTURE SCALE
-				mVtxProjected[i].Texture.x = (f32)vert.tu * mTnL.TextureScaleX;
-				mVtxProjected[i].Texture.y = (f32)vert.tv * mTnL.TextureScaleY;
-			}
-		}
-		else
-		{	//TEXTURE SCALE
-			mVtxProjected[i].Texture.x = (f32)vert.tu * mTnL.TextureScaleX;
-			mVtxProjected[i].Texture.y = (f32)vert.tv * mTnL.TextureScaleY;
-		}
-	}
+	TnL_Scalar_CBFD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn, v0 );
 #endif
 }
 
@@ -1343,35 +1134,18 @@ void BaseRenderer::SetNewVertexInfoDKR(u32 address, u32 v0, u32 n, bool billboar
 		mat.mRaw[6] *= mModelViewStack[2].mRaw[10] * 0.5f;
 		mat.mRaw[10] *= mModelViewStack[2].mRaw[10] * 0.5f;
 
-		for (u32 i = v0; i < v0 + n; i++)
+#ifdef DAEDALUS_SIMD
+		u32 first = 0;
+		if (v0 == 0 && n > 0)
 		{
-			v3 w;
-			w.x = *(s16*)((pVtxBase + 0) ^ 2);
-			w.y = *(s16*)((pVtxBase + 2) ^ 2);
-			w.z = *(s16*)((pVtxBase + 4) ^ 2);
-
-			w = mat.TransformNormal( w );
-
-			v4 & transformed( mVtxProjected[i].TransformedPos );
-			transformed.x = BaseVec.x + w.x;
-			transformed.y = BaseVec.y + w.y;
-			transformed.z = BaseVec.z + w.z;
-			transformed.w = 1.0f;
-
-			// Set Clipflags, zero clippflags if billbording //Corn
-			mVtxProjected[i].ClipFlags = 0;
-
-			// Assign true vert colour
-			const u32 WL = *(u16*)((pVtxBase + 6) ^ 2);
-			const u32 WH = *(u16*)((pVtxBase + 8) ^ 2);
-
-			mVtxProjected[i].Colour.x = (1.0f / 255.0f) * (WL >> 8);
-			mVtxProjected[i].Colour.y = (1.0f / 255.0f) * (WL & 0xFF);
-			mVtxProjected[i].Colour.z = (1.0f / 255.0f) * (WH >> 8);
-			mVtxProjected[i].Colour.w = (1.0f / 255.0f) * (WH & 0xFF);
-
-			pVtxBase += 10;
+			// The base vector is vertex 0, so it changes once that's been written.
+			TnL_SIMD_DKRB( mat, BaseVec, pVtxBase, &mVtxProjected[0], 1 );
+			first = 1;
 		}
+		TnL_SIMD_DKRB( mat, BaseVec, pVtxBase + first * 10, &mVtxProjected[v0 + first], n - first );
+#else
+		TnL_Scalar_DKRB( mat, BaseVec, pVtxBase, &mVtxProjected[v0], n );
+#endif // DAEDALUS_SIMD
 #endif
 	}
 	else
@@ -1385,41 +1159,10 @@ void BaseRenderer::SetNewVertexInfoDKR(u32 address, u32 v0, u32 n, bool billboar
 		}
 #ifdef DAEDALUS_PSP_USE_VFPU
 		_TnLVFPUDKR( n, &mat_world_project, (const FiddledVtx*)pVtxBase, &mVtxProjected[v0] );
+#elif defined(DAEDALUS_SIMD)
+		TnL_SIMD_DKR( mat_world_project, pVtxBase, &mVtxProjected[v0], n );
 #else
-		for (u32 i = v0; i < v0 + n; i++)
-		{
-			v4 & transformed( mVtxProjected[i].TransformedPos );
-			transformed.x = *(s16*)((pVtxBase + 0) ^ 2);
-			transformed.y = *(s16*)((pVtxBase + 2) ^ 2);
-			transformed.z = *(s16*)((pVtxBase + 4) ^ 2);
-			transformed.w = 1.0f;
-
-			v4 & projected( mVtxProjected[i].ProjectedPos );
-			projected = mat_world_project.Transform( transformed );	//Do projection
-
-			// Set Clipflags
-			u32 clip_flags = 0;
-			if		(projected.x < -projected.w)	clip_flags |= X_POS;
-			else if (projected.x > projected.w)		clip_flags |= X_NEG;
-
-			if		(projected.y < -projected.w)	clip_flags |= Y_POS;
-			else if (projected.y > projected.w)		clip_flags |= Y_NEG;
-
-			if		(projected.z < -projected.w)	clip_flags |= Z_POS;
-			else if (projected.z > projected.w)		clip_flags |= Z_NEG;
-			mVtxProjected[i].ClipFlags = clip_flags;
-
-			// Assign true vert colour
-			const u32 WL = *(u16*)((pVtxBase + 6) ^ 2);
-			const u32 WH = *(u16*)((pVtxBase + 8) ^ 2);
-
-			mVtxProjected[i].Colour.x = (1.0f / 255.0f) * (WL >> 8);
-			mVtxProjected[i].Colour.y = (1.0f / 255.0f) * (WL & 0xFF);
-			mVtxProjected[i].Colour.z = (1.0f / 255.0f) * (WH >> 8);
-			mVtxProjected[i].Colour.w = (1.0f / 255.0f) * (WH & 0xFF);
-
-			pVtxBase += 10;
-		}
+		TnL_Scalar_DKR( mat_world_project, pVtxBase, &mVtxProjected[v0], n );
 #endif
 	}
 }
@@ -1441,81 +1184,10 @@ void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 
 #ifdef DAEDALUS_PSP_USE_VFPU	
 	_TnLVFPUPD( &mat_world, &mat_project, pVtxBase, &mVtxProjected[v0], n, &mTnL, mn );
+#elif defined(DAEDALUS_SIMD)
+	TnL_SIMD_PD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn );
 #else
-	for (u32 i = v0; i < v0 + n; i++)
-	{
-		const FiddledVtxPD & vert = pVtxBase[i - v0];
-
-		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
-
-		// VTX Transform
-		//
-		v4 & transformed( mVtxProjected[i].TransformedPos );
-		transformed = mat_world.Transform( w );
-		v4 & projected( mVtxProjected[i].ProjectedPos );
-		projected = mat_project.Transform( transformed );
-
-
-		// Set Clipflags //Corn
-		u32 clip_flags = 0;
-		if		(projected.x < -projected.w)	clip_flags |= X_POS;
-		else if (projected.x > projected.w)		clip_flags |= X_NEG;
-
-		if		(projected.y < -projected.w)	clip_flags |= Y_POS;
-		else if (projected.y > projected.w)		clip_flags |= Y_NEG;
-
-		if		(projected.z < -projected.w)	clip_flags |= Z_POS;
-		else if (projected.z > projected.w)		clip_flags |= Z_NEG;
-		mVtxProjected[i].ClipFlags = clip_flags;
-
-		if( mTnL.Flags.Light )
-		{
-			v3	model_normal((f32)mn[vert.cidx+3], (f32)mn[vert.cidx+2], (f32)mn[vert.cidx+1] );
-
-			v3 vecTransformedNormal;
-			vecTransformedNormal = mat_world.TransformNormal( model_normal );
-			vecTransformedNormal.Normalise();
-
-			const v3 col = LightVert(vecTransformedNormal);
-			mVtxProjected[i].Colour.x = col.x;
-			mVtxProjected[i].Colour.y = col.y;
-			mVtxProjected[i].Colour.z = col.z;
-			mVtxProjected[i].Colour.w = (f32)mn[vert.cidx+0] * (1.0f / 255.0f);
-
-			if ( mTnL.Flags.TexGen )
-			{
-				const v3 & norm = vecTransformedNormal;
-
-				//Env mapping
-				if( mTnL.Flags.TexGenLin )
-				{	//Cheap way to do Acos(x)/Pi //Corn
-					mVtxProjected[i].Texture.x =  0.5f - 0.25f * norm.x - 0.25f * norm.x * norm.x * norm.x;
-					mVtxProjected[i].Texture.y =  0.5f - 0.25f * norm.y - 0.25f * norm.y * norm.y * norm.y;
-				}
-				else
-				{
-					mVtxProjected[i].Texture.x = 0.5f * ( 1.0f + norm.x );
-					mVtxProjected[i].Texture.y = 0.5f * ( 1.0f + norm.y );
-				}
-			}
-			else
-			{
-				mVtxProjected[i].Texture.x = (float)vert.tu * mTnL.TextureScaleX;
-				mVtxProjected[i].Texture.y = (float)vert.tv * mTnL.TextureScaleY;
-			}
-		}
-		else
-		{
-
-			mVtxProjected[i].Colour.x = (f32)mn[vert.cidx+3] * (1.0f / 255.0f);
-			mVtxProjected[i].Colour.y = (f32)mn[vert.cidx+2] * (1.0f / 255.0f);
-			mVtxProjected[i].Colour.z = (f32)mn[vert.cidx+1] * (1.0f / 255.0f);
-			mVtxProjected[i].Colour.w = (f32)mn[vert.cidx+0] * (1.0f / 255.0f);
-
-			mVtxProjected[i].Texture.x = (float)vert.tu * mTnL.TextureScaleX;
-			mVtxProjected[i].Texture.y = (float)vert.tv * mTnL.TextureScaleY;
-		}
-	}
+	TnL_Scalar_PD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn );
 #endif
 }
 
@@ -1948,6 +1620,7 @@ void BaseRenderer::SetScissor( u32 x0, u32 y0, u32 x1, u32 y1 )
 	// NB: OpenGL is x,y,w,h. Errors if width or height is negative, so clamp this.
 	s32 w = Max<s32>( r - l, 0 );
 	s32 h = Max<s32>( b - t, 0 );
+	FlushBatchedDraws();
 	glScissor( l, (s32)mScreenHeight - (t + h), w, h );
 	#ifdef DAEDALUS_DEBUG_CONSOLE
 #else
@@ -375,6 +375,8 @@ protected:
 	}
 
 	virtual void		RenderTriangles( DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer ) = 0;
+	// Used instead of RenderTriangles when mHardwareClipping is set. The default just expands the indices.
+	virtual void		RenderTrianglesIndexed( DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer );
 
 	void 				TestVFPUVerts( u32 v0, u32 num, const FiddledVtx * verts, const Matrix4x4 & mat_world );
 	template< bool FogEnable, int TextureMode >
@@ -383,9 +385,7 @@ protected:
 
 	void				PrepareTrisClipped( TempVerts * temp_verts ) const;
 	void				PrepareTrisUnclipped( TempVerts * temp_verts ) const;
-
-	v3					LightVert( const v3 & norm ) const;
-	v3					LightPointVert( const v4 & w ) const;
+	void				PrepareTrisIndexed( TempVerts * temp_verts, u16 * indices ) const;
 
 private:
 	void				InitViewport();
@@ -450,6 +450,8 @@ protected:
 	mutable bool		mWorldProjectValid;
 	bool				mReloadProj;
 	bool				mWPmodified;
+
+	bool				mHardwareClipping;		// Set by renderers whose hardware clips properly, so FlushTris can skip the software clipper
 	u32					mDKRMatIdx;
 
 	float				mScreenWidth;
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 #include "Config/ConfigOptions.h"
+#include "Core/Memory.h"
 #include "Core/ROM.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/Dump.h"
@@ -39,21 +40,26 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Math/MathUtil.h"
 #include "OSHLE/ultra_gbi.h"
 #include "Utility/AuxFunc.h"
+#include "Utility/Hash.h"
 #include "Utility/IO.h"
 #include "Utility/Profiler.h"
 
 static std::vector<u8>		gTexelBuffer;
 static NativePf8888			gPaletteBuffer[ 256 ];
 
-// NB: On the PSP we generate a lightweight hash of the texture data before
-// updating the native texture. This avoids some expensive work where possible.
-// On other platforms (e.g. OSX) updating textures is relatively inexpensive, so
-// we just skip the hashing process entirely, and update textures every frame
-// regardless of whether they've actually changed.
+#ifdef DAEDALUS_ACCURATE_TMEM
+ALIGNED_EXTERN(u8, gTMEM[4096], 16);
+#endif
+
+// NB: On the PSP we generate a lightweight, sampled hash of the texture data
+// every gCheckTextureHashFrequency frames before updating the native texture.
+// On other platforms we hash the full source span (and palette) every frame
+// the texture is used, and only convert and upload the texels when the hash
+// changes. Most textures are static, so this skips nearly all the conversion.
 #ifdef DAEDALUS_PSP
-static const bool kUpdateTexturesEveryFrame = false;
+static const bool kCheckTexturesEveryFrame = false;
 #else
-static const bool kUpdateTexturesEveryFrame = true;
+static const bool kCheckTexturesEveryFrame = true;
 #endif
 
 
@@ -101,14 +107,16 @@ static ETextureFormat SelectNativeFormat(const TextureInfo & ti)
 }
 #endif
 
+// If dst is null, the texels are generated in a shared scratch buffer.
 static bool GenerateTexels(void ** p_texels,
 						   void ** p_palette,
 						   const TextureInfo & ti,
 						   ETextureFormat texture_format,
 						   u32 pitch,
-						   u32 buffer_size)
+						   u32 buffer_size,
+						   void * dst = nullptr)
 {
-	if( gTexelBuffer.size() < buffer_size ) //|| gTexelBuffer.size() > (128 * 1024))//Cut off for downsizing may need to be adjusted to prevent some thrashing
+	if( dst == nullptr && gTexelBuffer.size() < buffer_size ) //|| gTexelBuffer.size() > (128 * 1024))//Cut off for downsizing may need to be adjusted to prevent some thrashing
 	{
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 		printf( "Resizing texel buffer to %d bytes. Texture is %dx%d\n", buffer_size, ti.GetWidth(), ti.GetHeight() );
@@ -116,7 +124,7 @@ static bool GenerateTexels(void ** p_texels,
 		gTexelBuffer.resize( buffer_size );
 	}
 
-	void *			texels  = &gTexelBuffer[0];
+	void *			texels  = dst ? dst : &gTexelBuffer[0];
 	NativePf8888 *	palette = IsTextureFormatPalettised( texture_format ) ? gPaletteBuffer : nullptr;
 
 #ifdef DAEDALUS_ACCURATE_TMEM
@@ -147,7 +155,67 @@ static bool GenerateTexels(void ** p_texels,
 	return false;
 }
 
-static void UpdateTexture( const TextureInfo & ti, CNativeTexture * texture )
+// Hash everything ConvertTexture/ConvertTile will read for this texture.
+static u64 GenerateContentsHash( const TextureInfo & ti )
+{
+	#ifdef DAEDALUS_PROFILE
+	DAEDALUS_PROFILE( "Texture Hash" );
+	#endif
+	u64 hash = 0;
+
+#ifdef DAEDALUS_ACCURATE_TMEM
+	if (ti.GetLine() > 0)
+	{
+		const u32 tmem_size = sizeof( gTMEM );
+
+		if (ti.GetFormat() == G_IM_FMT_CI)
+		{
+			// Palettes live in the upper half of tmem, one entry every 8 bytes
+			u32 palette_offset = 0x800;
+			u32 palette_bytes  = 0x800;
+			if (ti.GetSize() == G_IM_SIZ_4b)
+			{
+				palette_offset += ti.GetPalette() << 7;
+				palette_bytes   = 16 * 8;
+			}
+			hash = xxhash64( gTMEM + palette_offset, palette_bytes, hash );
+		}
+
+		u32 row_bytes = ti.GetLine() << 3;
+		if (ti.GetSize() == G_IM_SIZ_32b)
+			row_bytes *= 2;		// RGBA/32 line is doubled, see ConvertRGBA32
+
+		u32 offset = ti.GetTmemAddress() << 3;
+		u32 bytes  = ti.GetHeight() * row_bytes;
+		if (offset + bytes > tmem_size)
+			bytes = tmem_size - offset;
+
+		return xxhash64( gTMEM + offset, bytes, hash );
+	}
+#endif
+
+	if (ti.GetFormat() == G_IM_FMT_CI)
+	{
+		u32 palette_address = ti.GetTlutAddress();
+		u32 palette_bytes   = (ti.GetSize() == G_IM_SIZ_4b ? 16 : 256) * sizeof( u16 );
+		if (palette_address + palette_bytes <= gRamSize)
+		{
+			hash = xxhash64( g_pu8RamBase + palette_address, palette_bytes, hash );
+		}
+	}
+
+	u32 address = ti.GetLoadAddress();
+	u32 bytes   = ti.GetHeight() * ti.GetPitch();
+	if (address >= gRamSize)
+		return hash;
+	if (address + bytes > gRamSize)
+		bytes = gRamSize - address;
+
+	return xxhash64( g_pu8RamBase + address, bytes, hash );
+}
+
+// Returns false if the texels couldn't be generated (e.g. missing palette).
+static bool UpdateTexture( const TextureInfo & ti, CNativeTexture * texture )
 {
 	#ifdef DAEDALUS_PROFILE
 	DAEDALUS_PROFILE( "Texture Conversion" );
@@ -162,6 +230,24 @@ static void UpdateTexture( const TextureInfo & ti, CNativeTexture * texture )
 
 		void *	texels;
 		void *	palette;
+
+#ifdef DAEDALUS_GL
+		//
+		//	If nothing needs to read the texels back, decode straight into the
+		//	texture's upload buffer. It's write-only, so anything else goes through
+		//	the scratch buffer and SetData.
+		//
+		if( !ti.GetWhite() && !ti.GetEmulateMirrorS() && !ti.GetEmulateMirrorT() &&
+			!IsTextureFormatPalettised( format ) &&
+			ti.GetWidth() == texture->GetCorrectedWidth() && ti.GetHeight() == texture->GetCorrectedHeight() )
+		{
+			void *	dst = texture->BeginUpdate();
+			bool	ok  = GenerateTexels( &texels, &palette, ti, format, stride, texture->GetBytesRequired(), dst );
+			texture->EndUpdate( ok );
+			return ok;
+		}
+#endif
+
 		if( GenerateTexels( &texels, &palette, ti, format, stride, texture->GetBytesRequired() ) )
 		{
 			//
@@ -190,8 +276,11 @@ static void UpdateTexture( const TextureInfo & ti, CNativeTexture * texture )
 			}
 
 			texture->SetData( texels, palette );
+			return true;
 		}
 	}
+
+	return false;
 }
 
 CachedTexture * CachedTexture::Create( const TextureInfo & ti )
@@ -219,6 +308,8 @@ CachedTexture::CachedTexture( const TextureInfo & ti )
 ,	mTextureContentsHash( 0 )
 ,	mFrameLastUpToDate( gRDPFrame )
 ,	mFrameLastUsed( gRDPFrame )
+,	mpMoreRecentlyUsed( nullptr )
+,	mpLessRecentlyUsed( nullptr )
 {
 }
 
@@ -249,7 +340,11 @@ bool CachedTexture::Initialise()
 			mFrameLastUpToDate = gRDPFrame + (FastRand() & (gCheckTextureHashFrequency - 1));
 		}
 		UpdateTextureHash();
-		UpdateTexture( mTextureInfo, mpTexture );
+		if (!UpdateTexture( mTextureInfo, mpTexture ))
+		{
+			// Make sure we try again next time round
+			mTextureContentsHash = 0;
+		}
 	}
 
 	return mpTexture != nullptr;
@@ -258,13 +353,7 @@ bool CachedTexture::Initialise()
 // Update the hash of the texture. Returns true if the texture should be updated.
 bool CachedTexture::UpdateTextureHash()
 {
-	if (kUpdateTexturesEveryFrame)
-	{
-		// NB always assume we need updating.
-		return true;
-	}
-
-	u32 new_hash_value = mTextureInfo.GenerateHashValue();
+	u64 new_hash_value = kCheckTexturesEveryFrame ? GenerateContentsHash( mTextureInfo ) : mTextureInfo.GenerateHashValue();
 	bool changed       = new_hash_value != mTextureContentsHash;
 
 	mTextureContentsHash = new_hash_value;
@@ -277,7 +366,10 @@ void CachedTexture::UpdateIfNecessary()
 	{
 		if (UpdateTextureHash())
 		{
-			UpdateTexture( mTextureInfo, mpTexture );
+			if (!UpdateTexture( mTextureInfo, mpTexture ))
+			{
+				mTextureContentsHash = 0;
+			}
 		}
 
 		// FIXME(strmnrmn): should probably recreate mpWhiteTexture if it exists, else it may have stale data.
@@ -294,9 +386,9 @@ bool CachedTexture::IsFresh() const
 	if (gRDPFrame == mFrameLastUsed)
 		return true;
 
-	// If we're not updating textures every frame, check how long it's been
+	// If we're not checking textures every frame, check how long it's been
 	// since we last updated it.
-	if (!kUpdateTexturesEveryFrame)
+	if (!kCheckTexturesEveryFrame)
 	{
 		return (gCheckTextureHashFrequency == 0 ||
 				gRDPFrame < mFrameLastUpToDate + gCheckTextureHashFrequency);
@@ -307,7 +399,7 @@ bool CachedTexture::IsFresh() const
 
 bool CachedTexture::HasExpired() const
 {
-	if (!kUpdateTexturesEveryFrame)
+	if (!kCheckTexturesEveryFrame)
 	{
 		if (!IsFresh())
 		{
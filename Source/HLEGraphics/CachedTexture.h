@@ -58,9 +58,12 @@ class CachedTexture
 
 		CRefPtr<CNativeTexture>			mpTexture;
 
-		u32								mTextureContentsHash;
+		u64								mTextureContentsHash;
 		u32								mFrameLastUpToDate;	// Frame # that this was last updated
 		u32								mFrameLastUsed;		// Frame # that this was last used
+
+		CachedTexture *					mpMoreRecentlyUsed;	// Links for CTextureCache's LRU list
+		CachedTexture *					mpLessRecentlyUsed;
 };
 
 
@@ -456,15 +456,8 @@ static u32 DLParser_ProcessDList(u32 instruction_limit)
 //*****************************************************************************
 //
 //*****************************************************************************
-u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
+static u32 DLParser_RunTask(const OSTask * pTask, u32 instruction_limit, DLDebugOutput * debug_output)
 {
-	DAEDALUS_PROFILE( "DLParser_Process" );
-
-	if ( !CGraphicsContext::Get()->IsInitialised() || !gRenderer )
-	{
-		return 0;
-	}
-
 	// Shut down the debug console when we start rendering
 	// TODO: Clear the front/backbuffer the first time this function is called
 	// to remove any stuff lingering on the screen.
@@ -478,7 +471,6 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 	// Update Screen only when something is drawn, otherwise several games ex Army Men will flash or shake.
 	if( g_ROM.GameHacks != CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
 
-	OSTask * pTask = (OSTask *)(g_pu8SpMemBase + 0x0FC0);
 	u32 code_base = (u32)pTask->t.ucode & 0x1fffffff;
 	//u32 code_size = pTask->t.ucode_size; // Conker sets this to 0..
 	u32 code_size = 0x1000;
@@ -532,9 +524,6 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 	//
 	if( g_ROM.GameHacks == CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
 
-	// Do this regardless!
-	FinishRDPJob();
-
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	DLDebug_SetOutput(NULL);
 
@@ -544,6 +533,26 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 		gNumInstructionsExecuted = count;
 #endif
 
+	return count;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
+{
+	DAEDALUS_PROFILE( "DLParser_Process" );
+
+	if ( !CGraphicsContext::Get()->IsInitialised() || !gRenderer )
+	{
+		return 0;
+	}
+
+	u32 count = DLParser_RunTask( (OSTask *)(g_pu8SpMemBase + 0x0FC0), instruction_limit, debug_output );
+
+	// Do this regardless!
+	FinishRDPJob();
+
 #ifdef DAEDALUS_BATCH_TEST_ENABLED
 	CBatchTestEventHandler * handler( BatchTest_GetHandler() );
 	if( handler )
@@ -553,6 +562,21 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 	return count;
 }
 
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 DLParser_ProcessTask(const OSTask & task)
+{
+	DAEDALUS_PROFILE( "DLParser_ProcessTask" );
+
+	if ( !CGraphicsContext::Get()->IsInitialised() || !gRenderer )
+	{
+		return 0;
+	}
+
+	return DLParser_RunTask( &task, kUnlimitedInstructionCount, nullptr );
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <stdlib.h>
 
 #include "Utility/DaedalusTypes.h"
+#include "OSHLE/ultra_sptask.h"
 
 class DLDebugOutput;
 
@@ -33,4 +34,11 @@ void DLParser_Finalise();
 const u32 kUnlimitedInstructionCount = u32( ~0 );
 u32 DLParser_Process(u32 instruction_limit = kUnlimitedInstructionCount, DLDebugOutput * debug_output = nullptr);
 
+// Processes a copy of the task taken when the RSP was started. Unlike DLParser_Process
+// this doesn't raise the DP interrupt - the caller is responsible for that.
+u32 DLParser_ProcessTask(const OSTask & task);
+
+// Draws the frame buffer at origin, for games which write VI_ORIGIN without running any display lists.
+void DLParser_RenderFrameBuffer(u32 origin);
+
 #endif // HLEGRAPHICS_DLPARSER_H_
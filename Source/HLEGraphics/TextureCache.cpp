@@ -18,7 +18,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 // Manages textures for RDP code
-// Uses a HashTable (hashing on TImg) to allow quick access
+// Uses a HashTable (hashing on TextureInfo) to allow quick access
 //  to previously used textures
 
 #include "stdafx.h"
@@ -27,10 +27,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "HLEGraphics/TextureCache.h"
 #include "HLEGraphics/TextureInfo.h"
 
+#include "Utility/Hash.h"
 #include "Utility/Profiler.h"
 
 #include <vector>
-#include <algorithm>
 
 //#define PROFILE_TEXTURE_CACHE
 
@@ -44,11 +44,18 @@ template<> bool CSingleton< CTextureCache >::Create()
 }
 
 CTextureCache::CTextureCache()
+:	mEntries( INITIAL_TABLE_SIZE )
+,	mNumTextures( 0 )
+,	mpMostRecentlyUsed( nullptr )
+,	mpLeastRecentlyUsed( nullptr )
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
-:	mDebugMutex("TextureCache")
+,	mDebugMutex("TextureCache")
 #endif
 {
-	memset( mpCacheHashTable, 0, sizeof(mpCacheHashTable) );
+	for( u32 i = 0; i < mEntries.size(); ++i )
+	{
+		mEntries[i].Texture = nullptr;
+	}
 }
 
 CTextureCache::~CTextureCache()
@@ -56,19 +63,139 @@ CTextureCache::~CTextureCache()
 	DropTextures();
 }
 
-inline u32 CTextureCache::MakeHashIdxA( const TextureInfo & ti )
+inline u32 CTextureCache::MakeHash( const TextureInfo & ti )
+{
+	return murmur2_hash( &ti, sizeof( TextureInfo ), 0 );
+}
+
+// Returns the slot containing ti, or the empty slot where it should be inserted.
+u32 CTextureCache::FindSlot( const TextureInfo & ti, u32 hash ) const
 {
-	u32 address( ti.GetLoadAddress() );
-	u32 hash( (address >> (HASH_TABLE_BITS*2)) ^ (address >> HASH_TABLE_BITS) ^ address );
+	u32 mask = mEntries.size() - 1;
+	u32 slot = hash & mask;
+
+	for( ;; )
+	{
+		const SCacheEntry & entry = mEntries[slot];
+		if( entry.Texture == nullptr ||
+			(entry.Hash == hash && entry.Info == ti) )
+		{
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+}
 
-	hash ^= ti.GetPalette() >> 2;			// Useful for palettised fonts, e.g in Starfox
+void CTextureCache::InsertTexture( u32 slot, u32 hash, CachedTexture * texture )
+{
+	SCacheEntry & entry = mEntries[slot];
+	entry.Info    = texture->GetTextureInfo();
+	entry.Texture = texture;
+	entry.Hash    = hash;
+	++mNumTextures;
 
-	return hash & (HASH_TABLE_SIZE-1);
+	if( mNumTextures * 2 > mEntries.size() )
+	{
+		GrowTable();
+	}
 }
 
-inline u32 CTextureCache::MakeHashIdxB( const TextureInfo & ti )
+// Removes the entry in slot, shifting back any following entries in the
+// same probe sequence so lookups never need tombstones.
+void CTextureCache::RemoveSlot( u32 slot )
 {
-	return ti.GetHashCode() & (HASH_TABLE_SIZE-1);
+	u32 mask = mEntries.size() - 1;
+	u32 hole = slot;
+
+	--mNumTextures;
+
+	for( ;; )
+	{
+		mEntries[hole].Texture = nullptr;
+
+		u32 next = hole;
+		for( ;; )
+		{
+			next = (next + 1) & mask;
+			if( mEntries[next].Texture == nullptr )
+				return;
+
+			// Leave the entry where it is if its home slot lies cyclically in (hole, next]
+			u32 home = mEntries[next].Hash & mask;
+			bool in_range = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+			if( !in_range )
+				break;
+		}
+
+		mEntries[hole] = mEntries[next];
+		hole = next;
+	}
+}
+
+void CTextureCache::GrowTable()
+{
+	EntryVec old_entries( mEntries.size() * 2 );
+	old_entries.swap( mEntries );
+
+	for( u32 i = 0; i < mEntries.size(); ++i )
+	{
+		mEntries[i].Texture = nullptr;
+	}
+
+	u32 mask = mEntries.size() - 1;
+	for( u32 i = 0; i < old_entries.size(); ++i )
+	{
+		const SCacheEntry & entry = old_entries[i];
+		if( entry.Texture != nullptr )
+		{
+			u32 slot = entry.Hash & mask;
+			while( mEntries[slot].Texture != nullptr )
+			{
+				slot = (slot + 1) & mask;
+			}
+			mEntries[slot] = entry;
+		}
+	}
+}
+
+void CTextureCache::LinkMostRecentlyUsed( CachedTexture * texture )
+{
+	texture->mpMoreRecentlyUsed = nullptr;
+	texture->mpLessRecentlyUsed = mpMostRecentlyUsed;
+
+	if( mpMostRecentlyUsed != nullptr )
+	{
+		mpMostRecentlyUsed->mpMoreRecentlyUsed = texture;
+	}
+	else
+	{
+		mpLeastRecentlyUsed = texture;
+	}
+	mpMostRecentlyUsed = texture;
+}
+
+void CTextureCache::Unlink( CachedTexture * texture )
+{
+	if( texture->mpMoreRecentlyUsed != nullptr )
+	{
+		texture->mpMoreRecentlyUsed->mpLessRecentlyUsed = texture->mpLessRecentlyUsed;
+	}
+	else
+	{
+		mpMostRecentlyUsed = texture->mpLessRecentlyUsed;
+	}
+
+	if( texture->mpLessRecentlyUsed != nullptr )
+	{
+		texture->mpLessRecentlyUsed->mpMoreRecentlyUsed = texture->mpMoreRecentlyUsed;
+	}
+	else
+	{
+		mpLeastRecentlyUsed = texture->mpMoreRecentlyUsed;
+	}
+
+	texture->mpMoreRecentlyUsed = nullptr;
+	texture->mpLessRecentlyUsed = nullptr;
 }
 
 // Purge any textures that haven't been used recently
@@ -77,30 +204,26 @@ void CTextureCache::PurgeOldTextures()
 	MutexLock lock(GetDebugMutex());
 
 	//
-	//	Erase expired textures in reverse order, which should require less
-	//	copying when large clumps of textures are released simultaneously.
+	//	Walk from the least recently used end. Everything in front of the first
+	//	texture which hasn't expired was used more recently than it, so we can
+	//	stop there rather than rescanning the whole grace period every frame.
 	//
-	for( s32 i = mTextures.size() - 1; i >= 0; --i )
+	CachedTexture * texture = mpLeastRecentlyUsed;
+	while( texture != nullptr && texture->HasExpired() )
 	{
-		CachedTexture * texture = mTextures[ i ];
-		if ( texture->HasExpired() )
-		{
-			u32	ixa = MakeHashIdxA( texture->GetTextureInfo() );
-			u32 ixb = MakeHashIdxB( texture->GetTextureInfo() );
+		CachedTexture * next = texture->mpMoreRecentlyUsed;
 
-			if( mpCacheHashTable[ixa] == texture )
-			{
-				mpCacheHashTable[ixa] = nullptr;
-			}
-			if( mpCacheHashTable[ixb] == texture )
-			{
-				mpCacheHashTable[ixb] = nullptr;
-			}
+		const TextureInfo & ti = texture->GetTextureInfo();
+		u32 slot = FindSlot( ti, MakeHash( ti ) );
+		#ifdef DAEDALUS_ENABLE_ASSERTS
+		DAEDALUS_ASSERT( mEntries[slot].Texture == texture, "Texture is not in the cache" );
+		#endif
+		RemoveSlot( slot );
+		Unlink( texture );
 
-			mTextures.erase( mTextures.begin() + i );
+		delete texture;
 
-			delete texture;
-		}
+		texture = next;
 	}
 }
 
@@ -108,61 +231,38 @@ void CTextureCache::DropTextures()
 {
 	MutexLock lock(GetDebugMutex());
 
-	for( u32 i = 0; i < mTextures.size(); ++i)
+	for( u32 i = 0; i < mEntries.size(); ++i)
 	{
-		delete mTextures[i];
-	}
-	mTextures.clear();
-	for( u32 i = 0; i < HASH_TABLE_SIZE; ++i )
-	{
-		mpCacheHashTable[i] = nullptr;
+		delete mEntries[i].Texture;
+		mEntries[i].Texture = nullptr;
 	}
+	mNumTextures = 0;
+	mpMostRecentlyUsed = nullptr;
+	mpLeastRecentlyUsed = nullptr;
 }
 
 #ifdef PROFILE_TEXTURE_CACHE
-#define RECORD_CACHE_HIT( a, b )		TextureCacheStat( a, b, mTextures.size() )
+#define RECORD_CACHE_HIT( a )		TextureCacheStat( a, mNumTextures, mEntries.size() )
 
-static void TextureCacheStat( u32 l1_hit, u32 l2_hit, u32 size )
+static void TextureCacheStat( u32 hit, u32 size, u32 table_size )
 {
-	static u32 total_lookups = 0, total_l1_hits = 0, total_l2_hits = 0;
+	static u32 total_lookups = 0, total_hits = 0;
 
-	total_l1_hits += l1_hit;
-	total_l2_hits += l2_hit;
+	total_hits += hit;
 	++total_lookups;
 
 	if( total_lookups == 1000 )
 	{
-		printf( "L1 hits[%d] L2 hits[%d] Miss[%d] (%d entries)\n", total_l1_hits, total_l2_hits, total_lookups - (total_l1_hits+total_l2_hits), size );
-		total_lookups = total_l1_hits = total_l2_hits = 0;
+		printf( "Hits[%d] Miss[%d] (%d entries, %d slots)\n", total_hits, total_lookups - total_hits, size, table_size );
+		total_lookups = total_hits = 0;
 	}
 }
 #else
 
-#define RECORD_CACHE_HIT( a, b )
+#define RECORD_CACHE_HIT( a )
 
 #endif
 
-struct SSortTextureEntries
-{
-public:
-	bool operator()( const TextureInfo & a, const TextureInfo & b ) const
-	{
-		return a < b;
-	}
-	bool operator()( const CachedTexture * a, const TextureInfo & b ) const
-	{
-		return a->GetTextureInfo() < b;
-	}
-	bool operator()( const TextureInfo & a, const CachedTexture * b ) const
-	{
-		return a < b->GetTextureInfo();
-	}
-	bool operator()( const CachedTexture * a, const CachedTexture * b ) const
-	{
-		return a->GetTextureInfo() < b->GetTextureInfo();
-	}
-};
-
 // If already in table, return cached copy
 // Otherwise, create surfaces, and load texture into memory
 CachedTexture * CTextureCache::GetOrCreateCachedTexture(const TextureInfo & ti)
@@ -173,53 +273,33 @@ CachedTexture * CTextureCache::GetOrCreateCachedTexture(const TextureInfo & ti)
 	// NB: this is a no-op in normal builds.
 	MutexLock lock(GetDebugMutex());
 
-	//
-	// Retrieve the texture from the cache (if it already exists)
-	//
-	u32	ixa = MakeHashIdxA( ti );
-	if( mpCacheHashTable[ixa] && mpCacheHashTable[ixa]->GetTextureInfo() == ti )
-	{
-		RECORD_CACHE_HIT( 1, 0 );
-		mpCacheHashTable[ixa]->UpdateIfNecessary();
-
-		return mpCacheHashTable[ixa];
-	}
+	u32 hash = MakeHash( ti );
+	u32 slot = FindSlot( ti, hash );
 
-	u32 ixb = MakeHashIdxB( ti );
-	if( mpCacheHashTable[ixb] && mpCacheHashTable[ixb]->GetTextureInfo() == ti )
+	CachedTexture *	texture = mEntries[slot].Texture;
+	if( texture != nullptr )
 	{
-		RECORD_CACHE_HIT( 1, 0 );
-		mpCacheHashTable[ixb]->UpdateIfNecessary();
+		RECORD_CACHE_HIT( 1 );
 
-		return mpCacheHashTable[ixb];
-	}
-
-	CachedTexture *	texture = nullptr;
-	TextureVec::iterator	it = std::lower_bound( mTextures.begin(), mTextures.end(), ti, SSortTextureEntries() );
-	if( it != mTextures.end() && (*it)->GetTextureInfo() == ti )
-	{
-		texture = *it;
-		RECORD_CACHE_HIT( 0, 1 );
+		if( texture != mpMostRecentlyUsed )
+		{
+			Unlink( texture );
+			LinkMostRecentlyUsed( texture );
+		}
 	}
 	else
 	{
+		RECORD_CACHE_HIT( 0 );
+
 		texture = CachedTexture::Create( ti );
-		if (texture != nullptr)
-		{
-			mTextures.insert( it, texture );
-		}
+		if (texture == nullptr)
+			return nullptr;
 
-		RECORD_CACHE_HIT( 0, 0 );
+		InsertTexture( slot, hash, texture );
+		LinkMostRecentlyUsed( texture );
 	}
 
-	// Update the hashtable
-	if( texture )
-	{
-		texture->UpdateIfNecessary();
-
-		mpCacheHashTable[ixa] = texture;
-		mpCacheHashTable[ixb] = texture;
-	}
+	texture->UpdateIfNecessary();
 
 	return texture;
 }
@@ -240,9 +320,9 @@ void CTextureCache::Snapshot(const MutexLock & lock, std::vector< STextureInfoSn
 
 	snapshot.erase( snapshot.begin(), snapshot.end() );
 
-	for( TextureVec::const_iterator it = mTextures.begin(); it != mTextures.end(); ++it )
+	for( const CachedTexture * texture = mpMostRecentlyUsed; texture != nullptr; texture = texture->mpLessRecentlyUsed )
 	{
-		STextureInfoSnapshot	info( (*it)->GetTextureInfo(), (*it)->GetTexture() );
+		STextureInfoSnapshot	info( texture->GetTextureInfo(), texture->GetTexture() );
 		snapshot.push_back( info );
 	}
 }
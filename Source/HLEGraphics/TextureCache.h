@@ -67,20 +67,38 @@ private:
 	CachedTexture * GetOrCreateCachedTexture(const TextureInfo & ti);
 
 	//
-	//	We implement a 2-way skewed associative cache.
-	//	Each TextureInfo is hashed using two different methods, to reduce the chance of collisions
+	//	Open addressed (linear probing) hash table. The keys are stored inline
+	//	so a probe only touches the table itself, and the hash is kept to
+	//	reject most mismatches without comparing the whole TextureInfo.
+	//	The table doubles in size when it becomes half full.
 	//
-	static const u32 HASH_TABLE_BITS {9};
-	static const u32 HASH_TABLE_SIZE {1<<HASH_TABLE_BITS};
+	struct SCacheEntry
+	{
+		TextureInfo			Info;
+		CachedTexture *		Texture;		// nullptr if the slot is empty
+		u32					Hash;
+	};
+
+	static const u32 INITIAL_TABLE_SIZE {256};
 
-	inline static u32 MakeHashIdxA( const TextureInfo & ti );
-	inline static u32 MakeHashIdxB( const TextureInfo & ti );
+	inline static u32 MakeHash( const TextureInfo & ti );
+	u32				FindSlot( const TextureInfo & ti, u32 hash ) const;
+	void			InsertTexture( u32 slot, u32 hash, CachedTexture * texture );
+	void			RemoveSlot( u32 slot );
+	void			GrowTable();
 
-	// FIXME(strmnnrmn): we should have a struct of TextureInfo+CachedTexture instead -
-	// doing binary search on this array needs a memory indirect for every probe.
-	typedef std::vector< CachedTexture * >	TextureVec;
-	TextureVec			mTextures;
-	CachedTexture *		mpCacheHashTable[HASH_TABLE_SIZE];
+	//
+	//	Textures are also kept in a doubly linked list, most recently used
+	//	first, so PurgeOldTextures only needs to look at the tail.
+	//
+	void			LinkMostRecentlyUsed( CachedTexture * texture );
+	void			Unlink( CachedTexture * texture );
+
+	typedef std::vector< SCacheEntry >	EntryVec;
+	EntryVec			mEntries;
+	u32					mNumTextures;
+	CachedTexture *		mpMostRecentlyUsed;
+	CachedTexture *		mpLeastRecentlyUsed;
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	Mutex				mDebugMutex;
 #endif
@@ -0,0 +1,653 @@
+#include "stdafx.h"
+#include "HLEGraphics/TnLSIMD.h"
+
+#ifdef DAEDALUS_SIMD
+
+#include <algorithm>
+
+// Vertices are loaded into SoA form, 4 at a time. Any spare lanes in the last
+// group are filled with copies of the last vertex and never written back.
+//
+// NB: the arithmetic is ordered exactly as in the scalar code (and never fused),
+// so the results are bit-identical. Keep it that way if you touch this.
+
+namespace
+{
+
+static const u32 kLanes = 4;
+
+struct SoA3
+{
+	simd4f	x, y, z;
+};
+
+struct SoA4
+{
+	simd4f	x, y, z, w;
+};
+
+inline SoA3 LoadSoA3( const f32 (&x)[kLanes], const f32 (&y)[kLanes], const f32 (&z)[kLanes] )
+{
+	SoA3 r;
+	r.x = simd_loadu( x );
+	r.y = simd_loadu( y );
+	r.z = simd_loadu( z );
+	return r;
+}
+
+inline simd4f Row( const simd4f & x, const simd4f & y, const simd4f & z, f32 mx, f32 my, f32 mz )
+{
+	return simd_add( simd_add( simd_mul( x, simd_set1( mx ) ), simd_mul( y, simd_set1( my ) ) ), simd_mul( z, simd_set1( mz ) ) );
+}
+
+// Matrix4x4::Transform( v4(x, y, z, 1.0f) )
+inline SoA4 TransformPoint( const Matrix4x4 & m, const SoA3 & v )
+{
+	SoA4 r;
+	r.x = simd_add( Row( v.x, v.y, v.z, m.m11, m.m21, m.m31 ), simd_set1( m.m41 ) );
+	r.y = simd_add( Row( v.x, v.y, v.z, m.m12, m.m22, m.m32 ), simd_set1( m.m42 ) );
+	r.z = simd_add( Row( v.x, v.y, v.z, m.m13, m.m23, m.m33 ), simd_set1( m.m43 ) );
+	r.w = simd_add( Row( v.x, v.y, v.z, m.m14, m.m24, m.m34 ), simd_set1( m.m44 ) );
+	return r;
+}
+
+// Matrix4x4::Transform( v4 )
+inline SoA4 Transform( const Matrix4x4 & m, const SoA4 & v )
+{
+	SoA4 r;
+	r.x = simd_add( Row( v.x, v.y, v.z, m.m11, m.m21, m.m31 ), simd_mul( v.w, simd_set1( m.m41 ) ) );
+	r.y = simd_add( Row( v.x, v.y, v.z, m.m12, m.m22, m.m32 ), simd_mul( v.w, simd_set1( m.m42 ) ) );
+	r.z = simd_add( Row( v.x, v.y, v.z, m.m13, m.m23, m.m33 ), simd_mul( v.w, simd_set1( m.m43 ) ) );
+	r.w = simd_add( Row( v.x, v.y, v.z, m.m14, m.m24, m.m34 ), simd_mul( v.w, simd_set1( m.m44 ) ) );
+	return r;
+}
+
+// Matrix4x4::TransformNormal
+inline SoA3 TransformNormal( const Matrix4x4 & m, const SoA3 & v )
+{
+	SoA3 r;
+	r.x = Row( v.x, v.y, v.z, m.m11, m.m21, m.m31 );
+	r.y = Row( v.x, v.y, v.z, m.m12, m.m22, m.m32 );
+	r.z = Row( v.x, v.y, v.z, m.m13, m.m23, m.m33 );
+	return r;
+}
+
+inline simd4f Dot( const SoA3 & a, const v3 & b )
+{
+	return simd_add( simd_add( simd_mul( a.x, simd_set1( b.x ) ), simd_mul( a.y, simd_set1( b.y ) ) ), simd_mul( a.z, simd_set1( b.z ) ) );
+}
+
+inline simd4f LengthSq( const simd4f & x, const simd4f & y, const simd4f & z )
+{
+	return simd_add( simd_add( simd_mul( x, x ), simd_mul( y, y ) ), simd_mul( z, z ) );
+}
+
+// v3::Normalise
+inline void Normalise( SoA3 & v )
+{
+	simd4f len_sq = LengthSq( v.x, v.y, v.z );
+	simd4f valid  = simd_cmpgt( len_sq, simd_zero() );
+	simd4f r      = simd_div( simd_set1( 1.0f ), simd_sqrt( len_sq ) );
+
+	v.x = simd_select( valid, v.x, simd_mul( v.x, r ) );
+	v.y = simd_select( valid, v.y, simd_mul( v.y, r ) );
+	v.z = simd_select( valid, v.z, simd_mul( v.z, r ) );
+}
+
+// if( a > 1.0f ) a = 1.0f;
+inline simd4f ClampToOne( const simd4f & a )
+{
+	simd4f one = simd_set1( 1.0f );
+	return simd_select( simd_cmpgt( a, one ), a, one );
+}
+
+inline void AddLight( SoA3 & result, const v3 & colour, const simd4f & scale )
+{
+	result.x = simd_add( result.x, simd_mul( simd_set1( colour.x ), scale ) );
+	result.y = simd_add( result.y, simd_mul( simd_set1( colour.y ), scale ) );
+	result.z = simd_add( result.z, simd_mul( simd_set1( colour.z ), scale ) );
+}
+
+// Only lanes with mask set are lit.
+inline void AddLight( SoA3 & result, const v3 & colour, const simd4f & scale, const simd4f & mask )
+{
+	AddLight( result, colour, simd_and( mask, scale ) );
+}
+
+inline SoA3 AmbientColour( const TnLParams & params )
+{
+	const v3 & col = params.Lights[params.NumLights].Colour;
+
+	SoA3 result;
+	result.x = simd_set1( col.x );
+	result.y = simd_set1( col.y );
+	result.z = simd_set1( col.z );
+	return result;
+}
+
+// BaseRenderer::LightVert
+inline SoA3 LightVert( const TnLParams & params, const SoA3 & norm )
+{
+	SoA3 result = AmbientColour( params );
+
+	for ( u32 l = 0; l < params.NumLights; l++ )
+	{
+		simd4f cos_t = Dot( norm, params.Lights[l].Direction );
+		AddLight( result, params.Lights[l].Colour, cos_t, simd_cmpgt( cos_t, simd_zero() ) );
+	}
+
+	result.x = ClampToOne( result.x );
+	result.y = ClampToOne( result.y );
+	result.z = ClampToOne( result.z );
+	return result;
+}
+
+// BaseRenderer::LightPointVert
+inline SoA3 LightPointVert( const TnLParams & params, const SoA3 & w )
+{
+	SoA3 result = AmbientColour( params );
+
+	for ( u32 l = 0; l < params.NumLights; l++ )
+	{
+		const DaedalusLight & light = params.Lights[l];
+		if ( light.SkipIfZero )
+		{
+			simd4f dx = simd_sub( simd_set1( light.Position.x ), w.x );
+			simd4f dy = simd_sub( simd_set1( light.Position.y ), w.y );
+			simd4f dz = simd_sub( simd_set1( light.Position.z ), w.z );
+
+			simd4f light_qlen = LengthSq( dx, dy, dz );
+			simd4f light_llen = simd_sqrt( light_qlen );
+
+			simd4f at = simd_add( simd_add( simd_set1( light.ca ), simd_mul( simd_set1( light.la ), light_llen ) ), simd_mul( simd_set1( light.qa ), light_qlen ) );
+			simd4f cos_t = simd_div( simd_set1( 1.0f ), at );
+			AddLight( result, light.Colour, cos_t, simd_cmpgt( at, simd_zero() ) );
+		}
+	}
+
+	result.x = ClampToOne( result.x );
+	result.y = ClampToOne( result.y );
+	result.z = ClampToOne( result.z );
+	return result;
+}
+
+inline simd4i ClipFlags( const SoA4 & p )
+{
+	simd4f neg_w = simd_sub( simd_zero(), p.w );
+
+	simd4f x_pos = simd_cmplt( p.x, neg_w );
+	simd4f x_neg = simd_andnot( x_pos, simd_cmpgt( p.x, p.w ) );
+	simd4f y_pos = simd_cmplt( p.y, neg_w );
+	simd4f y_neg = simd_andnot( y_pos, simd_cmpgt( p.y, p.w ) );
+	simd4f z_pos = simd_cmplt( p.z, neg_w );
+	simd4f z_neg = simd_andnot( z_pos, simd_cmpgt( p.z, p.w ) );
+
+	simd4i flags = simd_maski( x_pos, simd_set1i( X_POS ) );
+	flags = simd_ori( flags, simd_maski( x_neg, simd_set1i( X_NEG ) ) );
+	flags = simd_ori( flags, simd_maski( y_pos, simd_set1i( Y_POS ) ) );
+	flags = simd_ori( flags, simd_maski( y_neg, simd_set1i( Y_NEG ) ) );
+	flags = simd_ori( flags, simd_maski( z_pos, simd_set1i( Z_POS ) ) );
+	flags = simd_ori( flags, simd_maski( z_neg, simd_set1i( Z_NEG ) ) );
+	return flags;
+}
+
+// Cheap way to do ~Acos(x)/Pi //Corn
+inline simd4f TexGenSpherical( const simd4f & n )
+{
+	simd4f quarter = simd_set1( 0.25f );
+	simd4f cube    = simd_mul( simd_mul( simd_mul( quarter, n ), n ), n );
+	return simd_sub( simd_sub( simd_set1( 0.5f ), simd_mul( quarter, n ) ), cube );
+}
+
+inline simd4f TexGenLinear( const simd4f & n )
+{
+	return simd_mul( simd_set1( 0.5f ), simd_add( simd_set1( 1.0f ), n ) );
+}
+
+// Transposes a SoA4 and writes the first count lanes to the given v4 member of each output vertex.
+inline void StoreV4( DaedalusVtx4 * p_out, v4 DaedalusVtx4::* member, SoA4 v, u32 count )
+{
+	simd_transpose( v.x, v.y, v.z, v.w );
+	const simd4f rows[kLanes] = { v.x, v.y, v.z, v.w };
+
+	for ( u32 l = 0; l < count; ++l )
+	{
+		simd_storeu( &(p_out[l].*member).x, rows[l] );
+	}
+}
+
+inline void StoreClipFlags( DaedalusVtx4 * p_out, const simd4i & flags, u32 count )
+{
+	u32 f[kLanes];
+	simd_storei( f, flags );
+	for ( u32 l = 0; l < count; ++l )
+	{
+		p_out[l].ClipFlags = f[l];
+	}
+}
+
+inline void StoreTexture( DaedalusVtx4 * p_out, const simd4f & s, const simd4f & t, u32 count )
+{
+	f32 fs[kLanes];
+	f32 ft[kLanes];
+	simd_storeu( fs, s );
+	simd_storeu( ft, t );
+	for ( u32 l = 0; l < count; ++l )
+	{
+		p_out[l].Texture.x = fs[l];
+		p_out[l].Texture.y = ft[l];
+	}
+}
+
+// Per-lane inputs, gathered from whatever vertex format the ucode uses.
+struct VertexLanes
+{
+	f32		x[kLanes], y[kLanes], z[kLanes];
+	f32		nx[kLanes], ny[kLanes], nz[kLanes];
+	f32		r[kLanes], g[kLanes], b[kLanes], a[kLanes];
+	f32		tu[kLanes], tv[kLanes];
+};
+
+inline SoA4 LoadColour( const VertexLanes & lanes )
+{
+	simd4f scale = simd_set1( 1.0f / 255.0f );
+
+	SoA4 colour;
+	colour.x = simd_mul( simd_loadu( lanes.r ), scale );
+	colour.y = simd_mul( simd_loadu( lanes.g ), scale );
+	colour.z = simd_mul( simd_loadu( lanes.b ), scale );
+	colour.w = simd_mul( simd_loadu( lanes.a ), scale );
+	return colour;
+}
+
+inline void ScaledTexture( const VertexLanes & lanes, const TnLParams & params, simd4f & s, simd4f & t )
+{
+	s = simd_mul( simd_loadu( lanes.tu ), simd_set1( params.TextureScaleX ) );
+	t = simd_mul( simd_loadu( lanes.tv ), simd_set1( params.TextureScaleY ) );
+}
+
+}
+
+//*****************************************************************************
+// Standard pipeline - see BaseRenderer::SetNewVertexInfo
+//*****************************************************************************
+void TnL_SIMD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params )
+{
+	for ( u32 base = 0; base < num_vertices; base += kLanes )
+	{
+		const u32 count = std::min( kLanes, num_vertices - base );
+
+		VertexLanes lanes;
+		for ( u32 l = 0; l < kLanes; ++l )
+		{
+			const FiddledVtx & vert = p_in[base + std::min( l, count - 1 )];
+
+			lanes.x[l]  = f32( vert.x );
+			lanes.y[l]  = f32( vert.y );
+			lanes.z[l]  = f32( vert.z );
+			lanes.nx[l] = f32( vert.norm_x );
+			lanes.ny[l] = f32( vert.norm_y );
+			lanes.nz[l] = f32( vert.norm_z );
+			lanes.r[l]  = vert.rgba_r;
+			lanes.g[l]  = vert.rgba_g;
+			lanes.b[l]  = vert.rgba_b;
+			lanes.a[l]  = vert.rgba_a;
+			lanes.tu[l] = (float)vert.tu;
+			lanes.tv[l] = (float)vert.tv;
+		}
+
+		DaedalusVtx4 * out = p_out + base;
+
+		// VTX Transform
+		SoA3 w = LoadSoA3( lanes.x, lanes.y, lanes.z );
+		SoA4 projected = TransformPoint( mat_world_project, w );
+
+		StoreV4( out, &DaedalusVtx4::ProjectedPos, projected, count );
+		StoreV4( out, &DaedalusVtx4::TransformedPos, TransformPoint( mat_world, w ), count );
+		StoreClipFlags( out, ClipFlags( projected ), count );
+
+		SoA4 colour = LoadColour( lanes );
+		simd4f tex_s, tex_t;
+
+		// LIGHTING OR COLOR
+		if ( params.Flags.Light )
+		{
+			SoA3 model_normal = LoadSoA3( lanes.nx, lanes.ny, lanes.nz );
+			SoA3 norm = TransformNormal( mat_world, model_normal );
+			Normalise( norm );
+
+			SoA3 col = params.Flags.PointLight ? LightPointVert( params, w ) : LightVert( params, norm );
+			colour.x = col.x;
+			colour.y = col.y;
+			colour.z = col.z;
+
+			// ENV MAPPING
+			if ( params.Flags.TexGen )
+			{
+				// NB: uses mat_world_project rather than mat_world, as the scalar path does.
+				norm = TransformNormal( mat_world_project, model_normal );
+				Normalise( norm );
+
+				if ( params.Flags.TexGenLin )
+				{
+					tex_s = TexGenLinear( norm.x );
+					tex_t = TexGenLinear( norm.y );
+				}
+				else
+				{
+					// abs() fixes star in SM64, sort of
+					tex_s = TexGenSpherical( simd_abs( norm.x ) );
+					tex_t = TexGenSpherical( simd_abs( norm.y ) );
+				}
+			}
+			else
+			{
+				ScaledTexture( lanes, params, tex_s, tex_t );
+			}
+		}
+		else
+		{
+			ScaledTexture( lanes, params, tex_s, tex_t );
+		}
+
+		StoreV4( out, &DaedalusVtx4::Colour, colour, count );
+		StoreTexture( out, tex_s, tex_t, count );
+	}
+}
+
+//*****************************************************************************
+// Conker Bad Fur Day pipeline - see BaseRenderer::SetNewVertexInfoConker
+//*****************************************************************************
+void TnL_SIMD_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 )
+{
+	for ( u32 base = 0; base < num_vertices; base += kLanes )
+	{
+		const u32 count = std::min( kLanes, num_vertices - base );
+
+		VertexLanes lanes;
+		for ( u32 l = 0; l < kLanes; ++l )
+		{
+			const u32 idx = base + std::min( l, count - 1 );
+			const u32 i   = v0 + idx;
+			const FiddledVtx & vert = p_in[idx];
+
+			lanes.x[l]  = f32( vert.x );
+			lanes.y[l]  = f32( vert.y );
+			lanes.z[l]  = f32( vert.z );
+			lanes.nx[l] = model_norm[((i<<1)+0)^3];
+			lanes.ny[l] = model_norm[((i<<1)+1)^3];
+			lanes.nz[l] = vert.normz;
+			lanes.r[l]  = (f32)vert.rgba_r;
+			lanes.g[l]  = (f32)vert.rgba_g;
+			lanes.b[l]  = (f32)vert.rgba_b;
+			lanes.a[l]  = (f32)vert.rgba_a;
+			lanes.tu[l] = (f32)vert.tu;
+			lanes.tv[l] = (f32)vert.tv;
+		}
+
+		DaedalusVtx4 * out = p_out + base;
+
+		// VTX Transform
+		SoA4 transformed = TransformPoint( mat_world, LoadSoA3( lanes.x, lanes.y, lanes.z ) );
+		SoA4 projected   = Transform( mat_project, transformed );
+
+		StoreV4( out, &DaedalusVtx4::TransformedPos, transformed, count );
+		StoreV4( out, &DaedalusVtx4::ProjectedPos, projected, count );
+		StoreClipFlags( out, ClipFlags( projected ), count );
+
+		SoA4 colour = LoadColour( lanes );		//Pass alpha channel unmodified
+		simd4f tex_s, tex_t;
+
+		// LIGHTING OR COLOR
+		if ( params.Flags.Light )
+		{
+			SoA3 norm = TransformNormal( mat_world, LoadSoA3( lanes.nx, lanes.ny, lanes.nz ) );
+			Normalise( norm );
+
+			SoA4 pos;
+			pos.x = simd_mul( simd_add( projected.x, simd_set1( params.CoordMod[8] ) ),  simd_set1( params.CoordMod[12] ) );
+			pos.y = simd_mul( simd_add( projected.y, simd_set1( params.CoordMod[9] ) ),  simd_set1( params.CoordMod[13] ) );
+			pos.z = simd_mul( simd_add( projected.z, simd_set1( params.CoordMod[10] ) ), simd_set1( params.CoordMod[14] ) );
+			pos.w = simd_mul( simd_add( projected.w, simd_set1( params.CoordMod[11] ) ), simd_set1( params.CoordMod[15] ) );
+
+			SoA3 result = AmbientColour( params );
+			u32 l;
+
+			if ( params.Flags.PointLight )
+			{	//POINT LIGHT
+				for (l = 0; l < params.NumLights-1; l++)
+				{
+					const DaedalusLight & light = params.Lights[l];
+					if ( light.SkipIfZero )
+					{
+						simd4f cos_t = Dot( norm, light.Direction );
+						simd4f lit   = simd_cmpgt( cos_t, simd_zero() );
+
+						simd4f dx = simd_sub( pos.x, simd_set1( light.Position.x ) );
+						simd4f dy = simd_sub( pos.y, simd_set1( light.Position.y ) );
+						simd4f dz = simd_sub( pos.z, simd_set1( light.Position.z ) );
+						simd4f dw = simd_sub( pos.w, simd_set1( light.Position.w ) );
+						simd4f len_sq = simd_add( LengthSq( dx, dy, dz ), simd_mul( dw, dw ) );
+
+						simd4f pi = simd_div( simd_set1( light.Iscale ), len_sq );
+						cos_t = simd_select( simd_cmplt( pi, simd_set1( 1.0f ) ), cos_t, simd_mul( cos_t, pi ) );
+
+						AddLight( result, light.Colour, cos_t, lit );
+					}
+				}
+
+				simd4f cos_t = Dot( norm, params.Lights[l].Direction );
+				AddLight( result, params.Lights[l].Colour, cos_t, simd_cmpgt( cos_t, simd_zero() ) );
+			}
+			else
+			{	//NORMAL LIGHT
+				for (l = 0; l < params.NumLights; l++)
+				{
+					const DaedalusLight & light = params.Lights[l];
+					if ( light.SkipIfZero )
+					{
+						simd4f dx = simd_sub( pos.x, simd_set1( light.Position.x ) );
+						simd4f dy = simd_sub( pos.y, simd_set1( light.Position.y ) );
+						simd4f dz = simd_sub( pos.z, simd_set1( light.Position.z ) );
+						simd4f dw = simd_sub( pos.w, simd_set1( light.Position.w ) );
+						simd4f len_sq = simd_add( LengthSq( dx, dy, dz ), simd_mul( dw, dw ) );
+
+						simd4f pi = ClampToOne( simd_div( simd_set1( light.Iscale ), len_sq ) );
+						AddLight( result, light.Colour, pi );
+					}
+				}
+			}
+
+			//Clamp result to 1.0
+			simd4f one = simd_set1( 1.0f );
+			colour.x = simd_select( simd_cmplt( result.x, one ), colour.x, simd_mul( colour.x, result.x ) );
+			colour.y = simd_select( simd_cmplt( result.y, one ), colour.y, simd_mul( colour.y, result.y ) );
+			colour.z = simd_select( simd_cmplt( result.z, one ), colour.z, simd_mul( colour.z, result.z ) );
+
+			// ENV MAPPING
+			if ( params.Flags.TexGen )
+			{
+				if( params.Flags.TexGenLin )
+				{
+					tex_s = TexGenSpherical( norm.x );
+					tex_t = TexGenSpherical( norm.y );
+				}
+				else
+				{
+					tex_s = TexGenLinear( norm.x );
+					tex_t = TexGenLinear( norm.y );
+				}
+			}
+			else
+			{	//TEXTURE SCALE
+				ScaledTexture( lanes, params, tex_s, tex_t );
+			}
+		}
+		else
+		{	//TEXTURE SCALE
+			ScaledTexture( lanes, params, tex_s, tex_t );
+		}
+
+		StoreV4( out, &DaedalusVtx4::Colour, colour, count );
+		StoreTexture( out, tex_s, tex_t, count );
+	}
+}
+
+//*****************************************************************************
+// DKR/Jet Force Gemini pipeline - see BaseRenderer::SetNewVertexInfoDKR
+//*****************************************************************************
+static void GatherDKR( uintptr_t p_in, u32 count, VertexLanes & lanes )
+{
+	for ( u32 l = 0; l < kLanes; ++l )
+	{
+		const uintptr_t p = p_in + std::min( l, count - 1 ) * 10;
+
+		lanes.x[l] = *(s16*)((p + 0) ^ 2);
+		lanes.y[l] = *(s16*)((p + 2) ^ 2);
+		lanes.z[l] = *(s16*)((p + 4) ^ 2);
+
+		// Assign true vert colour
+		const u32 WL = *(u16*)((p + 6) ^ 2);
+		const u32 WH = *(u16*)((p + 8) ^ 2);
+
+		lanes.r[l] = (f32)(WL >> 8);
+		lanes.g[l] = (f32)(WL & 0xFF);
+		lanes.b[l] = (f32)(WH >> 8);
+		lanes.a[l] = (f32)(WH & 0xFF);
+	}
+}
+
+void TnL_SIMD_DKR( const Matrix4x4 & mat_world_project, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices )
+{
+	for ( u32 base = 0; base < num_vertices; base += kLanes )
+	{
+		const u32 count = std::min( kLanes, num_vertices - base );
+
+		VertexLanes lanes;
+		GatherDKR( p_in + base * 10, count, lanes );
+
+		DaedalusVtx4 * out = p_out + base;
+
+		SoA4 transformed;
+		transformed.x = simd_loadu( lanes.x );
+		transformed.y = simd_loadu( lanes.y );
+		transformed.z = simd_loadu( lanes.z );
+		transformed.w = simd_set1( 1.0f );
+
+		SoA4 projected = Transform( mat_world_project, transformed );	//Do projection
+
+		StoreV4( out, &DaedalusVtx4::TransformedPos, transformed, count );
+		StoreV4( out, &DaedalusVtx4::ProjectedPos, projected, count );
+		StoreClipFlags( out, ClipFlags( projected ), count );
+		StoreV4( out, &DaedalusVtx4::Colour, LoadColour( lanes ), count );
+	}
+}
+
+void TnL_SIMD_DKRB( const Matrix4x4 & mat, const v4 & base_vec, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices )
+{
+	for ( u32 base = 0; base < num_vertices; base += kLanes )
+	{
+		const u32 count = std::min( kLanes, num_vertices - base );
+
+		VertexLanes lanes;
+		GatherDKR( p_in + base * 10, count, lanes );
+
+		DaedalusVtx4 * out = p_out + base;
+
+		SoA3 w = TransformNormal( mat, LoadSoA3( lanes.x, lanes.y, lanes.z ) );
+
+		SoA4 transformed;
+		transformed.x = simd_add( simd_set1( base_vec.x ), w.x );
+		transformed.y = simd_add( simd_set1( base_vec.y ), w.y );
+		transformed.z = simd_add( simd_set1( base_vec.z ), w.z );
+		transformed.w = simd_set1( 1.0f );
+
+		StoreV4( out, &DaedalusVtx4::TransformedPos, transformed, count );
+		// Set Clipflags, zero clippflags if billbording //Corn
+		StoreClipFlags( out, simd_zeroi(), count );
+		StoreV4( out, &DaedalusVtx4::Colour, LoadColour( lanes ), count );
+	}
+}
+
+//*****************************************************************************
+// Perfect Dark pipeline - see BaseRenderer::SetNewVertexInfoPD
+//*****************************************************************************
+void TnL_SIMD_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm )
+{
+	for ( u32 base = 0; base < num_vertices; base += kLanes )
+	{
+		const u32 count = std::min( kLanes, num_vertices - base );
+
+		VertexLanes lanes;
+		for ( u32 l = 0; l < kLanes; ++l )
+		{
+			const FiddledVtxPD & vert = p_in[base + std::min( l, count - 1 )];
+			const u8 * mn = &model_norm[vert.cidx];
+
+			lanes.x[l]  = f32( vert.x );
+			lanes.y[l]  = f32( vert.y );
+			lanes.z[l]  = f32( vert.z );
+			lanes.nx[l] = (f32)mn[3];
+			lanes.ny[l] = (f32)mn[2];
+			lanes.nz[l] = (f32)mn[1];
+			lanes.r[l]  = (f32)mn[3];
+			lanes.g[l]  = (f32)mn[2];
+			lanes.b[l]  = (f32)mn[1];
+			lanes.a[l]  = (f32)mn[0];
+			lanes.tu[l] = (float)vert.tu;
+			lanes.tv[l] = (float)vert.tv;
+		}
+
+		DaedalusVtx4 * out = p_out + base;
+
+		// VTX Transform
+		SoA4 transformed = TransformPoint( mat_world, LoadSoA3( lanes.x, lanes.y, lanes.z ) );
+		SoA4 projected   = Transform( mat_project, transformed );
+
+		StoreV4( out, &DaedalusVtx4::TransformedPos, transformed, count );
+		StoreV4( out, &DaedalusVtx4::ProjectedPos, projected, count );
+		StoreClipFlags( out, ClipFlags( projected ), count );
+
+		SoA4 colour = LoadColour( lanes );
+		simd4f tex_s, tex_t;
+
+		if( params.Flags.Light )
+		{
+			SoA3 norm = TransformNormal( mat_world, LoadSoA3( lanes.nx, lanes.ny, lanes.nz ) );
+			Normalise( norm );
+
+			SoA3 col = LightVert( params, norm );
+			colour.x = col.x;
+			colour.y = col.y;
+			colour.z = col.z;
+
+			if ( params.Flags.TexGen )
+			{
+				//Env mapping
+				if( params.Flags.TexGenLin )
+				{
+					tex_s = TexGenSpherical( norm.x );
+					tex_t = TexGenSpherical( norm.y );
+				}
+				else
+				{
+					tex_s = TexGenLinear( norm.x );
+					tex_t = TexGenLinear( norm.y );
+				}
+			}
+			else
+			{
+				ScaledTexture( lanes, params, tex_s, tex_t );
+			}
+		}
+		else
+		{
+			ScaledTexture( lanes, params, tex_s, tex_t );
+		}
+
+		StoreV4( out, &DaedalusVtx4::Colour, colour, count );
+		StoreTexture( out, tex_s, tex_t, count );
+	}
+}
+
+#endif // DAEDALUS_SIMD
@@ -0,0 +1,22 @@
+#ifndef HLEGRAPHICS_TNLSIMD_H_
+#define HLEGRAPHICS_TNLSIMD_H_
+
+#include "Math/SIMD.h"
+
+#ifdef DAEDALUS_SIMD
+
+#include "HLEGraphics/BaseRenderer.h"
+
+// Batch transform and lighting, working on 4 vertices at a time.
+// These are the desktop equivalents of the PSP's _TnLVFPU* functions, and
+// produce exactly the same results as the scalar loops in BaseRenderer.
+
+void TnL_SIMD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params );
+void TnL_SIMD_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 );
+void TnL_SIMD_DKR( const Matrix4x4 & mat_world_project, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices );
+void TnL_SIMD_DKRB( const Matrix4x4 & mat, const v4 & base_vec, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices );
+void TnL_SIMD_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm );
+
+#endif // DAEDALUS_SIMD
+
+#endif // HLEGRAPHICS_TNLSIMD_H_
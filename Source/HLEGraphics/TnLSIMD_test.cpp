@@ -0,0 +1,242 @@
+#include <stdafx.h>
+#include "HLEGraphics/TnLSIMD.h"
+
+#ifdef DAEDALUS_SIMD
+
+#include "HLEGraphics/TnLScalar.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+
+#include <gtest/gtest.h>
+
+// The SIMD paths claim to be bit-identical to the scalar ones in TnLScalar.cpp.
+
+namespace
+{
+
+static const u32 kNumBatches   = 2000;
+static const u32 kMaxVertices  = 33;	// Not a multiple of 4, so the spare lanes get exercised
+
+static f32 RandomFloat( std::mt19937 & rng, f32 lo, f32 hi )
+{
+	return std::uniform_real_distribution< f32 >( lo, hi )( rng );
+}
+
+static bool RandomBool( std::mt19937 & rng )
+{
+	return (rng() & 1) != 0;
+}
+
+static void RandomMatrix( std::mt19937 & rng, Matrix4x4 & mat )
+{
+	for (u32 i = 0; i < 16; ++i)
+		mat.mRaw[i] = RandomFloat( rng, -2.0f, 2.0f );
+}
+
+static void RandomParams( std::mt19937 & rng, TnLParams & params )
+{
+	params = TnLParams();
+	params.Flags.Light      = RandomBool( rng );
+	params.Flags.TexGen     = RandomBool( rng );
+	params.Flags.TexGenLin  = RandomBool( rng );
+	params.Flags.PointLight = RandomBool( rng );
+	params.NumLights        = 1 + rng() % 7;
+	params.TextureScaleX    = RandomFloat( rng, 0.0f, 1.0f / 32.0f );
+	params.TextureScaleY    = RandomFloat( rng, 0.0f, 1.0f / 32.0f );
+
+	for (u32 l = 0; l <= params.NumLights; ++l)
+	{
+		DaedalusLight & light = params.Lights[l];
+		light.Direction  = v3( RandomFloat( rng, -1.0f, 1.0f ), RandomFloat( rng, -1.0f, 1.0f ), RandomFloat( rng, -1.0f, 1.0f ) );
+		light.Direction.Normalise();
+		light.SkipIfZero = rng() % 3;
+		light.Colour     = v3( RandomFloat( rng, 0.0f, 1.0f ), RandomFloat( rng, 0.0f, 1.0f ), RandomFloat( rng, 0.0f, 1.0f ) );
+		light.Iscale     = RandomFloat( rng, 0.0f, 65536.0f );
+		light.Position   = v4( RandomFloat( rng, -512.0f, 512.0f ), RandomFloat( rng, -512.0f, 512.0f ), RandomFloat( rng, -512.0f, 512.0f ), RandomFloat( rng, -512.0f, 512.0f ) );
+		light.ca         = RandomFloat( rng, -1.0f, 1.0f );
+		light.la         = RandomFloat( rng, 0.0f, 0.01f );
+		light.qa         = RandomFloat( rng, 0.0f, 0.0001f );
+	}
+
+	for (u32 i = 0; i < 16; ++i)
+		params.CoordMod[i] = RandomFloat( rng, -2.0f, 2.0f );
+}
+
+static void RandomBytes( std::mt19937 & rng, void * p, u32 len )
+{
+	u8 * p8 = (u8*)p;
+	for (u32 i = 0; i < len; ++i)
+		p8[i] = u8( rng() );
+}
+
+// Vertices are small, like the ones games actually send, so the clip flags flip about.
+static void RandomFiddledVtx( std::mt19937 & rng, FiddledVtx * verts, u32 n )
+{
+	RandomBytes( rng, verts, n * sizeof( FiddledVtx ) );
+	for (u32 i = 0; i < n; ++i)
+	{
+		verts[i].x = verts[i].x >> 6;
+		verts[i].y = verts[i].y >> 6;
+		verts[i].z = verts[i].z >> 6;
+	}
+}
+
+class TnLSIMDTest : public ::testing::Test
+{
+protected:
+	TnLSIMDTest() : mRandom( 0x1234567 ) {}
+
+	virtual void SetUp()
+	{
+		// Fill both with the same junk, so anything one side writes and the other doesn't shows up.
+		DaedalusVtx4	junk;
+		junk.TransformedPos = v4( -1234.5f, -1234.5f, -1234.5f, -1234.5f );
+		junk.ProjectedPos   = junk.TransformedPos;
+		junk.Colour         = junk.TransformedPos;
+		junk.Texture        = v2( -1234.5f, -1234.5f );
+		junk.ClipFlags      = 0xcdcdcdcd;
+		junk.Pad            = 0xcdcdcdcd;
+
+		std::fill( mOut, mOut + kMaxVertices, junk );
+		std::fill( mExpected, mExpected + kMaxVertices, junk );
+	}
+
+	u32 RandomCount()
+	{
+		return 1 + mRandom() % kMaxVertices;
+	}
+
+	// Compare the raw bits - "close enough" isn't good enough here.
+	void ExpectIdentical( u32 batch, u32 n )
+	{
+		for (u32 i = 0; i < kMaxVertices; ++i)
+		{
+			EXPECT_EQ( 0, memcmp( &mExpected[i], &mOut[i], sizeof( DaedalusVtx4 ) ) ) << "batch " << batch << " vertex " << i << " of " << n;
+		}
+	}
+
+	std::mt19937	mRandom;
+
+	Matrix4x4		mMatA;
+	Matrix4x4		mMatB;
+	TnLParams		mParams;
+	DaedalusVtx4	mOut[kMaxVertices];
+	DaedalusVtx4	mExpected[kMaxVertices];
+	ALIGNED_MEMBER(u8, mDKRBuffer[kMaxVertices * 10 + 4], 16);
+};
+
+}
+
+TEST_F(TnLSIMDTest, MatchesScalar)
+{
+	FiddledVtx verts[kMaxVertices];
+
+	for (u32 batch = 0; batch < kNumBatches; ++batch)
+	{
+		u32 n = RandomCount();
+		RandomMatrix( mRandom, mMatA );
+		RandomMatrix( mRandom, mMatB );
+		RandomParams( mRandom, mParams );
+		RandomFiddledVtx( mRandom, verts, n );
+
+		TnL_SIMD( mMatA, mMatB, verts, mOut, n, mParams );
+		TnL_Scalar( mMatA, mMatB, verts, mExpected, n, mParams );
+		ExpectIdentical( batch, n );
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST_F(TnLSIMDTest, CBFDMatchesScalar)
+{
+	FiddledVtx verts[kMaxVertices];
+	s8 model_norm[(kMaxN64Vertices + kMaxVertices) * 2];
+
+	for (u32 batch = 0; batch < kNumBatches; ++batch)
+	{
+		u32 n  = RandomCount();
+		u32 v0 = mRandom() % kMaxN64Vertices;
+		RandomMatrix( mRandom, mMatA );
+		RandomMatrix( mRandom, mMatB );
+		RandomParams( mRandom, mParams );
+		RandomFiddledVtx( mRandom, verts, n );
+		RandomBytes( mRandom, model_norm, sizeof( model_norm ) );
+
+		TnL_SIMD_CBFD( mMatA, mMatB, verts, mOut, n, mParams, model_norm, v0 );
+		TnL_Scalar_CBFD( mMatA, mMatB, verts, mExpected, n, mParams, model_norm, v0 );
+		ExpectIdentical( batch, n );
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST_F(TnLSIMDTest, DKRMatchesScalar)
+{
+	for (u32 batch = 0; batch < kNumBatches; ++batch)
+	{
+		u32 n = RandomCount();
+		RandomMatrix( mRandom, mMatA );
+		RandomBytes( mRandom, mDKRBuffer, sizeof( mDKRBuffer ) );
+
+		// DKR vertices are 10 bytes, so they start on odd halfwords too.
+		uintptr_t p_in = reinterpret_cast< uintptr_t >( mDKRBuffer ) + (mRandom() & 2);
+
+		TnL_SIMD_DKR( mMatA, p_in, mOut, n );
+		TnL_Scalar_DKR( mMatA, p_in, mExpected, n );
+		ExpectIdentical( batch, n );
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST_F(TnLSIMDTest, DKRBillboardMatchesScalar)
+{
+	for (u32 batch = 0; batch < kNumBatches; ++batch)
+	{
+		u32 n = RandomCount();
+		RandomMatrix( mRandom, mMatA );
+		RandomBytes( mRandom, mDKRBuffer, sizeof( mDKRBuffer ) );
+		v4 base_vec( RandomFloat( mRandom, -512.0f, 512.0f ), RandomFloat( mRandom, -512.0f, 512.0f ), RandomFloat( mRandom, -512.0f, 512.0f ), 1.0f );
+
+		uintptr_t p_in = reinterpret_cast< uintptr_t >( mDKRBuffer ) + (mRandom() & 2);
+
+		TnL_SIMD_DKRB( mMatA, base_vec, p_in, mOut, n );
+		TnL_Scalar_DKRB( mMatA, base_vec, p_in, mExpected, n );
+		ExpectIdentical( batch, n );
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST_F(TnLSIMDTest, PDMatchesScalar)
+{
+	FiddledVtxPD verts[kMaxVertices];
+	u8 model_norm[256 + 4];
+
+	for (u32 batch = 0; batch < kNumBatches; ++batch)
+	{
+		u32 n = RandomCount();
+		RandomMatrix( mRandom, mMatA );
+		RandomMatrix( mRandom, mMatB );
+		RandomParams( mRandom, mParams );
+		RandomBytes( mRandom, verts, n * sizeof( FiddledVtxPD ) );
+		RandomBytes( mRandom, model_norm, sizeof( model_norm ) );
+		for (u32 i = 0; i < n; ++i)
+		{
+			verts[i].x = verts[i].x >> 6;
+			verts[i].y = verts[i].y >> 6;
+			verts[i].z = verts[i].z >> 6;
+		}
+
+		TnL_SIMD_PD( mMatA, mMatB, verts, mOut, n, mParams, model_norm );
+		TnL_Scalar_PD( mMatA, mMatB, verts, mExpected, n, mParams, model_norm );
+		ExpectIdentical( batch, n );
+		if (HasFailure())
+			return;
+	}
+}
+
+#endif // DAEDALUS_SIMD
@@ -0,0 +1,457 @@
+#include "stdafx.h"
+#include "HLEGraphics/TnLScalar.h"
+
+#ifndef DAEDALUS_PSP_USE_VFPU
+
+#include "Math/Math.h"
+
+static inline u32 ClipFlags( const v4 & projected )
+{
+	u32 clip_flags = 0;
+	if		(projected.x < -projected.w)	clip_flags |= X_POS;
+	else if (projected.x > projected.w)		clip_flags |= X_NEG;
+
+	if		(projected.y < -projected.w)	clip_flags |= Y_POS;
+	else if (projected.y > projected.w)		clip_flags |= Y_NEG;
+
+	if		(projected.z < -projected.w)	clip_flags |= Z_POS;
+	else if (projected.z > projected.w)		clip_flags |= Z_NEG;
+
+	return clip_flags;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+v3 TnL_LightVert( const TnLParams & params, const v3 & norm )
+{
+	const v3 & col = params.Lights[params.NumLights].Colour;
+	v3 result( col.x, col.y, col.z );
+
+	for ( u32 l = 0; l < params.NumLights; l++ )
+	{
+		f32 fCosT = norm.Dot( params.Lights[l].Direction );
+		if (fCosT > 0.0f)
+		{
+			result.x += params.Lights[l].Colour.x * fCosT;
+			result.y += params.Lights[l].Colour.y * fCosT;
+			result.z += params.Lights[l].Colour.z * fCosT;
+		}
+	}
+
+	//Clamp to 1.0
+	if( result.x > 1.0f ) result.x = 1.0f;
+	if( result.y > 1.0f ) result.y = 1.0f;
+	if( result.z > 1.0f ) result.z = 1.0f;
+
+	return result;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+v3 TnL_LightPointVert( const TnLParams & params, const v4 & w )
+{
+	const v3 & col = params.Lights[params.NumLights].Colour;
+	v3 result( col.x, col.y, col.z );
+
+	for ( u32 l = 0; l < params.NumLights; l++ )
+	{
+		if ( params.Lights[l].SkipIfZero )
+		{
+			v3 distance_vec( params.Lights[l].Position.x-w.x, params.Lights[l].Position.y-w.y, params.Lights[l].Position.z-w.z );
+
+			f32 light_qlen = distance_vec.LengthSq();
+			f32 light_llen = sqrtf( light_qlen );
+
+			f32 at = params.Lights[l].ca + params.Lights[l].la * light_llen + params.Lights[l].qa * light_qlen;
+			if (at > 0.0f)
+			{
+				f32 fCosT = 1.0f/at;
+				result.x += params.Lights[l].Colour.x * fCosT;
+				result.y += params.Lights[l].Colour.y * fCosT;
+				result.z += params.Lights[l].Colour.z * fCosT;
+			}
+		}
+	}
+
+	//Clamp to 1.0
+	if( result.x > 1.0f ) result.x = 1.0f;
+	if( result.y > 1.0f ) result.y = 1.0f;
+	if( result.z > 1.0f ) result.z = 1.0f;
+
+	return result;
+}
+
+//*****************************************************************************
+// Standard rendering pipeline
+//*****************************************************************************
+void TnL_Scalar( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params )
+{
+	// Transform and Project + Lighting or Transform and Project with Colour
+	//
+	for (u32 i = 0; i < num_vertices; i++)
+	{
+		const FiddledVtx & vert = p_in[i];
+		DaedalusVtx4 & out = p_out[i];
+
+		// VTX Transform
+		//
+		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
+
+		v4 & projected( out.ProjectedPos );
+		projected = mat_world_project.Transform( w );
+		out.TransformedPos = mat_world.Transform( w );
+
+		//	Initialise the clipping flags
+		//
+		out.ClipFlags = ClipFlags( projected );
+
+		// LIGHTING OR COLOR
+		//
+		if ( params.Flags.Light )
+		{
+			v3 model_normal(f32( vert.norm_x ), f32( vert.norm_y ), f32( vert.norm_z ) );
+			v3 vecTransformedNormal;
+			vecTransformedNormal = mat_world.TransformNormal( model_normal );
+			vecTransformedNormal.Normalise();
+
+			v3 col;
+
+			if ( params.Flags.PointLight )
+			{//POINT LIGHT
+				col = TnL_LightPointVert( params, w ); // Majora's Mask uses this
+			}
+			else
+			{//NORMAL LIGHT
+				col = TnL_LightVert( params, vecTransformedNormal );
+			}
+			out.Colour.x = col.x;
+			out.Colour.y = col.y;
+			out.Colour.z = col.z;
+			out.Colour.w = vert.rgba_a * (1.0f / 255.0f);
+
+			// ENV MAPPING
+			//
+			if ( params.Flags.TexGen )
+			{
+				// Update texture coords n.b. need to divide tu/tv by bogus scale on addition to buffer
+				// If the vert is already lit, then there is no normal (and hence we can't generate tex coord)
+#if 1			// 1->Lets use mat_world_project instead of mat_world for nicer effect (see SSV space ship) //Corn
+				vecTransformedNormal = mat_world_project.TransformNormal( model_normal );
+				vecTransformedNormal.Normalise();
+#endif
+
+				const v3 & norm = vecTransformedNormal;
+
+				if( params.Flags.TexGenLin )
+				{
+					out.Texture.x = 0.5f * ( 1.0f + norm.x );
+					out.Texture.y = 0.5f * ( 1.0f + norm.y );
+				}
+				else
+				{
+					//Cheap way to do Acos(x)/Pi (abs() fixes star in SM64, sort of) //Corn
+					f32 NormX = fabsf( norm.x );
+					f32 NormY = fabsf( norm.y );
+					out.Texture.x =  0.5f - 0.25f * NormX - 0.25f * NormX * NormX * NormX;
+					out.Texture.y =  0.5f - 0.25f * NormY - 0.25f * NormY * NormY * NormY;
+				}
+			}
+			else
+			{
+				//Set Texture coordinates
+				out.Texture.x = (float)vert.tu * params.TextureScaleX;
+				out.Texture.y = (float)vert.tv * params.TextureScaleY;
+			}
+		}
+		else
+		{
+			//if( params.Flags.Shade )
+			{// FLAT shade
+				out.Colour = v4( vert.rgba_r * (1.0f / 255.0f), vert.rgba_g * (1.0f / 255.0f), vert.rgba_b * (1.0f / 255.0f), vert.rgba_a * (1.0f / 255.0f) );
+			}
+			/*else
+			{// PRIM shade, SSV uses this, doesn't seem to do anything????
+				out.Colour = mPrimitiveColour.GetColourV4();
+			}*/
+
+
+			//Set Texture coordinates
+			out.Texture.x = (float)vert.tu * params.TextureScaleX;
+			out.Texture.y = (float)vert.tv * params.TextureScaleY;
+		}
+	}
+}
+
+//*****************************************************************************
+// Conker Bad Fur Day rendering pipeline
+//*****************************************************************************
+void TnL_Scalar_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 )
+{
+	const s8 * mn = model_norm;
+
+	// Transform and Project + Lighting or Transform and Project with Colour
+	//
+	for (u32 i = v0; i < v0 + num_vertices; i++)
+	{
+		const FiddledVtx & vert = p_in[i - v0];
+		DaedalusVtx4 & out = p_out[i - v0];
+
+		// VTX Transform
+		//
+		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
+
+		v4 & transformed( out.TransformedPos );
+		transformed = mat_world.Transform( w );
+
+		v4 & projected( out.ProjectedPos );
+		projected = mat_project.Transform( transformed );
+
+		//	Initialise the clipping flags
+		//
+		out.ClipFlags = ClipFlags( projected );
+
+		out.Colour.x = (f32)vert.rgba_r * (1.0f / 255.0f);
+		out.Colour.y = (f32)vert.rgba_g * (1.0f / 255.0f);
+		out.Colour.z = (f32)vert.rgba_b * (1.0f / 255.0f);
+		out.Colour.w = (f32)vert.rgba_a * (1.0f / 255.0f);	//Pass alpha channel unmodified
+
+		// LIGHTING OR COLOR
+		//
+		if ( params.Flags.Light )
+		{
+			v3 model_normal( mn[((i<<1)+0)^3], mn[((i<<1)+1)^3], vert.normz );
+			v3 vecTransformedNormal = mat_world.TransformNormal( model_normal );
+			vecTransformedNormal.Normalise();
+			const v3 & norm = vecTransformedNormal;
+			const v3 & col = params.Lights[params.NumLights].Colour;
+
+			v4 Pos;
+			Pos.x = (projected.x + params.CoordMod[8]) * params.CoordMod[12];
+			Pos.y = (projected.y + params.CoordMod[9]) * params.CoordMod[13];
+			Pos.z = (projected.z + params.CoordMod[10])* params.CoordMod[14];
+			Pos.w = (projected.w + params.CoordMod[11])* params.CoordMod[15];
+
+			v3 result( col.x, col.y, col.z );
+			f32 fCosT;
+			u32 l;
+
+			if ( params.Flags.PointLight )
+			{	//POINT LIGHT
+				for (l = 0; l < params.NumLights-1; l++)
+				{
+					if ( params.Lights[l].SkipIfZero )
+					{
+						fCosT = norm.Dot( params.Lights[l].Direction );
+						if (fCosT > 0.0f)
+						{
+							f32 pi = params.Lights[l].Iscale / (Pos - params.Lights[l].Position).LengthSq();
+							if (pi < 1.0f) fCosT *= pi;
+
+							result.x += params.Lights[l].Colour.x * fCosT;
+							result.y += params.Lights[l].Colour.y * fCosT;
+							result.z += params.Lights[l].Colour.z * fCosT;
+						}
+					}
+				}
+
+				fCosT = norm.Dot( params.Lights[l].Direction );
+				if (fCosT > 0.0f)
+				{
+					result.x += params.Lights[l].Colour.x * fCosT;
+					result.y += params.Lights[l].Colour.y * fCosT;
+					result.z += params.Lights[l].Colour.z * fCosT;
+				}
+			}
+			else
+			{	//NORMAL LIGHT
+				for (l = 0; l < params.NumLights; l++)
+				{
+					if ( params.Lights[l].SkipIfZero )
+					{
+						f32 pi = params.Lights[l].Iscale / (Pos - params.Lights[l].Position).LengthSq();
+						if (pi > 1.0f) pi = 1.0f;
+
+						result.x += params.Lights[l].Colour.x * pi;
+						result.y += params.Lights[l].Colour.y * pi;
+						result.z += params.Lights[l].Colour.z * pi;
+					}
+				}
+			}
+
+			//Clamp result to 1.0
+			if( result.x < 1.0f ) out.Colour.x *= result.x;
+			if( result.y < 1.0f ) out.Colour.y *= result.y;
+			if( result.z < 1.0f ) out.Colour.z *= result.z;
+
+			// ENV MAPPING
+			if ( params.Flags.TexGen )
+			{
+				if( params.Flags.TexGenLin )
+				{
+					out.Texture.x =  0.5f - 0.25f * norm.x - 0.25f * norm.x * norm.x * norm.x;	//Cheap way to do ~Acos(x)/Pi //Corn
+					out.Texture.y =  0.5f - 0.25f * norm.y - 0.25f * norm.y * norm.y * norm.y;
+				}
+				else
+				{
+					out.Texture.x = 0.5f * ( 1.0f + norm.x );
+					out.Texture.y = 0.5f * ( 1.0f + norm.y );
+				}
+			}
+			else
+			{	//TEXTURE SCALE
+				out.Texture.x = (f32)vert.tu * params.TextureScaleX;
+				out.Texture.y = (f32)vert.tv * params.TextureScaleY;
+			}
+		}
+		else
+		{	//TEXTURE SCALE
+			out.Texture.x = (f32)vert.tu * params.TextureScaleX;
+			out.Texture.y = (f32)vert.tv * params.TextureScaleY;
+		}
+	}
+}
+
+//*****************************************************************************
+// DKR/Jet Force Gemini rendering pipeline
+//*****************************************************************************
+void TnL_Scalar_DKR( const Matrix4x4 & mat_world_project, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices )
+{
+	for (u32 i = 0; i < num_vertices; i++)
+	{
+		v4 & transformed( p_out[i].TransformedPos );
+		transformed.x = *(s16*)((p_in + 0) ^ 2);
+		transformed.y = *(s16*)((p_in + 2) ^ 2);
+		transformed.z = *(s16*)((p_in + 4) ^ 2);
+		transformed.w = 1.0f;
+
+		v4 & projected( p_out[i].ProjectedPos );
+		projected = mat_world_project.Transform( transformed );	//Do projection
+
+		// Set Clipflags
+		p_out[i].ClipFlags = ClipFlags( projected );
+
+		// Assign true vert colour
+		const u32 WL = *(u16*)((p_in + 6) ^ 2);
+		const u32 WH = *(u16*)((p_in + 8) ^ 2);
+
+		p_out[i].Colour.x = (1.0f / 255.0f) * (WL >> 8);
+		p_out[i].Colour.y = (1.0f / 255.0f) * (WL & 0xFF);
+		p_out[i].Colour.z = (1.0f / 255.0f) * (WH >> 8);
+		p_out[i].Colour.w = (1.0f / 255.0f) * (WH & 0xFF);
+
+		p_in += 10;
+	}
+}
+
+//*****************************************************************************
+// DKR/Jet Force Gemini billboards
+//*****************************************************************************
+void TnL_Scalar_DKRB( const Matrix4x4 & mat, const v4 & base_vec, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices )
+{
+	for (u32 i = 0; i < num_vertices; i++)
+	{
+		v3 w;
+		w.x = *(s16*)((p_in + 0) ^ 2);
+		w.y = *(s16*)((p_in + 2) ^ 2);
+		w.z = *(s16*)((p_in + 4) ^ 2);
+
+		w = mat.TransformNormal( w );
+
+		v4 & transformed( p_out[i].TransformedPos );
+		transformed.x = base_vec.x + w.x;
+		transformed.y = base_vec.y + w.y;
+		transformed.z = base_vec.z + w.z;
+		transformed.w = 1.0f;
+
+		// Set Clipflags, zero clippflags if billbording //Corn
+		p_out[i].ClipFlags = 0;
+
+		// Assign true vert colour
+		const u32 WL = *(u16*)((p_in + 6) ^ 2);
+		const u32 WH = *(u16*)((p_in + 8) ^ 2);
+
+		p_out[i].Colour.x = (1.0f / 255.0f) * (WL >> 8);
+		p_out[i].Colour.y = (1.0f / 255.0f) * (WL & 0xFF);
+		p_out[i].Colour.z = (1.0f / 255.0f) * (WH >> 8);
+		p_out[i].Colour.w = (1.0f / 255.0f) * (WH & 0xFF);
+
+		p_in += 10;
+	}
+}
+
+//*****************************************************************************
+// Perfect Dark rendering pipeline
+//*****************************************************************************
+void TnL_Scalar_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm )
+{
+	const u8 * mn = model_norm;
+
+	for (u32 i = 0; i < num_vertices; i++)
+	{
+		const FiddledVtxPD & vert = p_in[i];
+		DaedalusVtx4 & out = p_out[i];
+
+		v4 w( f32( vert.x ), f32( vert.y ), f32( vert.z ), 1.0f );
+
+		// VTX Transform
+		//
+		v4 & transformed( out.TransformedPos );
+		transformed = mat_world.Transform( w );
+		v4 & projected( out.ProjectedPos );
+		projected = mat_project.Transform( transformed );
+
+		// Set Clipflags //Corn
+		out.ClipFlags = ClipFlags( projected );
+
+		if( params.Flags.Light )
+		{
+			v3	model_normal((f32)mn[vert.cidx+3], (f32)mn[vert.cidx+2], (f32)mn[vert.cidx+1] );
+
+			v3 vecTransformedNormal;
+			vecTransformedNormal = mat_world.TransformNormal( model_normal );
+			vecTransformedNormal.Normalise();
+
+			const v3 col = TnL_LightVert( params, vecTransformedNormal );
+			out.Colour.x = col.x;
+			out.Colour.y = col.y;
+			out.Colour.z = col.z;
+			out.Colour.w = (f32)mn[vert.cidx+0] * (1.0f / 255.0f);
+
+			if ( params.Flags.TexGen )
+			{
+				const v3 & norm = vecTransformedNormal;
+
+				//Env mapping
+				if( params.Flags.TexGenLin )
+				{	//Cheap way to do Acos(x)/Pi //Corn
+					out.Texture.x =  0.5f - 0.25f * norm.x - 0.25f * norm.x * norm.x * norm.x;
+					out.Texture.y =  0.5f - 0.25f * norm.y - 0.25f * norm.y * norm.y * norm.y;
+				}
+				else
+				{
+					out.Texture.x = 0.5f * ( 1.0f + norm.x );
+					out.Texture.y = 0.5f * ( 1.0f + norm.y );
+				}
+			}
+			else
+			{
+				out.Texture.x = (float)vert.tu * params.TextureScaleX;
+				out.Texture.y = (float)vert.tv * params.TextureScaleY;
+			}
+		}
+		else
+		{
+			out.Colour.x = (f32)mn[vert.cidx+3] * (1.0f / 255.0f);
+			out.Colour.y = (f32)mn[vert.cidx+2] * (1.0f / 255.0f);
+			out.Colour.z = (f32)mn[vert.cidx+1] * (1.0f / 255.0f);
+			out.Colour.w = (f32)mn[vert.cidx+0] * (1.0f / 255.0f);
+
+			out.Texture.x = (float)vert.tu * params.TextureScaleX;
+			out.Texture.y = (float)vert.tv * params.TextureScaleY;
+		}
+	}
+}
+
+#endif // DAEDALUS_PSP_USE_VFPU
@@ -0,0 +1,24 @@
+#ifndef HLEGRAPHICS_TNLSCALAR_H_
+#define HLEGRAPHICS_TNLSCALAR_H_
+
+#include "HLEGraphics/BaseRenderer.h"
+
+#ifndef DAEDALUS_PSP_USE_VFPU
+
+// Transform and lighting using the FPU, one vertex at a time. These are what
+// BaseRenderer uses when there's neither the VFPU nor SIMD (see TnLSIMD.h),
+// and they define the results the other paths have to reproduce.
+
+v3   TnL_LightVert( const TnLParams & params, const v3 & norm );
+v3   TnL_LightPointVert( const TnLParams & params, const v4 & w );
+
+void TnL_Scalar( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params );
+void TnL_Scalar_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 );
+void TnL_Scalar_DKR( const Matrix4x4 & mat_world_project, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices );
+// NB: base_vec may be p_out[0].TransformedPos - the vertices after it then see the updated value.
+void TnL_Scalar_DKRB( const Matrix4x4 & mat, const v4 & base_vec, uintptr_t p_in, DaedalusVtx4 * p_out, u32 num_vertices );
+void TnL_Scalar_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm );
+
+#endif // DAEDALUS_PSP_USE_VFPU
+
+#endif // HLEGRAPHICS_TNLSCALAR_H_
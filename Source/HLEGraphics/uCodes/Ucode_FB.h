@@ -80,7 +80,9 @@ static inline void DrawFrameBuffer(u32 origin, const CNativeTexture * texture)
 			src_offset += 2;
 		}
 	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FB_WIDTH, FB_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels);
+	// The texture's storage is allocated once (and is immutable with ARB_texture_storage), so only replace its contents
+	texture->InstallTexture();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, FB_WIDTH, FB_HEIGHT, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels);
 
 	//ToDO: Implement me PSP
 	//Doesn't work
@@ -93,7 +95,7 @@ static inline void DrawFrameBuffer(u32 origin, const CNativeTexture * texture)
 }
 
 
-void RenderFrameBuffer(u32 origin)
+void DLParser_RenderFrameBuffer(u32 origin)
 {
 	gRenderer->SetVIScales();
 	gRenderer->BeginScene();
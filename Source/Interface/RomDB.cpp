@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <stdio.h>
+#include <string>
 #include <vector>
 
 #include "Core/ROM.h"
@@ -30,15 +31,18 @@
 #include "Interface/RomDB.h"
 #include "Math/MathUtil.h"
 #include "System/Paths.h"
+#include "Utility/AtomicPrimitives.h"
 #include "Utility/IO.h"
+#include "Utility/Job.h"
 #include "Utility/ROMFile.h"
 #include "Utility/Stream.h"
 
-static const u64 ROMDB_MAGIC_NO	= 0x42444D5244454144LL; //DAEDRMDB		// 44 41 45 44 52 4D 44 42
-static const u32 ROMDB_CURRENT_VERSION = 4;
+#ifndef DAEDALUS_PSP
+#include "Utility/JobSystem.h"
+#endif
 
-static const u32 MAX_SENSIBLE_FILES = 2048;
-static const u32 MAX_SENSIBLE_DETAILS = 2048;
+static const u64 ROMDB_MAGIC_NO	= 0x42444D5244454144LL; //DAEDRMDB		// 44 41 45 44 52 4D 44 42
+static const u32 ROMDB_CURRENT_VERSION = 5;
 
 CRomDB::~CRomDB() {}
 
@@ -61,62 +65,35 @@ class IRomDB : public CRomDB
 		const char *	QueryFilenameFromID( const RomID & id ) const;
 
 	private:
-		void			AddRomFile(const char * filename);
-
-		void			AddRomEntry( const char * filename, const RomID & id, u32 rom_size, ECicType cic_type );
+		bool			IsEntryCurrent( const char * filename, u64 file_size, u64 file_time, RomID * id ) const;
+		void			AddRomEntry( const char * filename, u64 file_size, u64 file_time, const RomID & id, u32 rom_size, ECicType cic_type );
 		bool			OpenDB( const char * filename );
 
 	private:
 
-		// For serialisation we used a fixed size struct for ease of reading
-		struct RomFilesKeyValue
+		// Files are keyed on their size and modification time as well as their
+		// name, so that a rom which has been replaced gets scanned again.
+		struct RomFileEntry
 		{
-			RomFilesKeyValue()
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-			}
-			RomFilesKeyValue( const RomFilesKeyValue & rhs )
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, rhs.FileName );
-				ID = rhs.ID;
-			}
-			RomFilesKeyValue & operator=( const RomFilesKeyValue & rhs )
-			{
-				if( this == &rhs )
-					return *this;
-				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, rhs.FileName );
-				ID = rhs.ID;
-				return *this;
-			}
-
-			RomFilesKeyValue( const char * filename, const RomID & id )
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, filename );
-				ID = id;
-			}
-
-			// This is actually IO::Path::kMaxPathLen+1, but we need to ensure that it doesn't change if we ever change the kMaxPathLen constant.
-			static const u32 kMaxFilenameLen = 260;
-			char		FileName[ kMaxFilenameLen + 1 ];
-			RomID		ID;
+			std::string			FileName;
+			u64					FileSize;
+			u64					FileTime;
+			RomID				ID;
 		};
 
 		struct SSortByFilename
 		{
-			bool operator()( const RomFilesKeyValue & a, const RomFilesKeyValue & b ) const
+			bool operator()( const RomFileEntry & a, const RomFileEntry & b ) const
 			{
-				return strcmp( a.FileName, b.FileName ) < 0;
+				return strcmp( a.FileName.c_str(), b.FileName.c_str() ) < 0;
 			}
-			bool operator()( const char * a, const RomFilesKeyValue & b ) const
+			bool operator()( const char * a, const RomFileEntry & b ) const
 			{
-				return strcmp( a, b.FileName ) < 0;
+				return strcmp( a, b.FileName.c_str() ) < 0;
 			}
-			bool operator()( const RomFilesKeyValue & a, const char * b ) const
+			bool operator()( const RomFileEntry & a, const char * b ) const
 			{
-				return strcmp( a.FileName, b ) < 0;
+				return strcmp( a.FileName.c_str(), b ) < 0;
 			}
 		};
 
@@ -157,7 +134,32 @@ class IRomDB : public CRomDB
 			}
 		};
 
-		typedef std::vector< RomFilesKeyValue >	FilenameVec;
+		//
+		// On disk the database is a single block, read with one fread:
+		//
+		//	SFileHeader
+		//	SFileEntry[ NumFiles ]		sorted by filename
+		//	RomDetails[ NumDetails ]	sorted by id
+		//	char[ StringBytes ]			the filenames, nul terminated, indexed by SFileEntry::NameOffset
+		//
+		struct SFileHeader
+		{
+			u64					Magic;
+			u32					Version;
+			u32					NumFiles;
+			u32					NumDetails;
+			u32					StringBytes;
+		};
+
+		struct SFileEntry
+		{
+			u64					FileSize;
+			u64					FileTime;
+			u32					NameOffset;
+			RomID				ID;
+		};
+
+		typedef std::vector< RomFileEntry >		FilenameVec;
 		typedef std::vector< RomDetails >		DetailsVec;
 
 		IO::Filename					mRomDBFileName;
@@ -201,8 +203,6 @@ void IRomDB::Reset()
 
 bool IRomDB::OpenDB( const char * filename )
 {
-	u32 num_read;
-
 	//
 	// Remember the filename
 	//
@@ -217,90 +217,93 @@ bool IRomDB::OpenDB( const char * filename )
 		return false;
 	}
 
-	//
-	// Check the magic number
-	//
-	u64 magic;
-	num_read = fread( &magic, sizeof( magic ), 1, fh );
-	if ( num_read != 1 || magic != ROMDB_MAGIC_NO )
+	fseek( fh, 0, SEEK_END );
+	long	file_bytes( ftell( fh ) );
+	fseek( fh, 0, SEEK_SET );
+
+	std::vector< u8 >	data( file_bytes > 0 ? file_bytes : 0 );
+	bool	read_ok( !data.empty() && fread( &data[0], data.size(), 1, fh ) == 1 );
+	fclose( fh );
+
+	if ( !read_ok || data.size() < sizeof( SFileHeader ) )
 	{
 		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB has wrong magic number." );
+		DBGConsole_Msg( 0, "RomDB is truncated." );
 		#endif
-		goto fail;
+		return false;
 	}
 
+	SFileHeader		header;
+	memcpy( &header, &data[0], sizeof( header ) );
+
 	//
-	// Check the version number
+	// Check the magic number and version
 	//
-	u32 version;
-	num_read = fread( &version, sizeof( version ), 1, fh );
-	if ( num_read != 1 || version != ROMDB_CURRENT_VERSION )
+	if ( header.Magic != ROMDB_MAGIC_NO )
 	{
 		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB has wrong version for this build of Daedalus." );
+		DBGConsole_Msg( 0, "RomDB has wrong magic number." );
 		#endif
-		goto fail;
+		return false;
 	}
 
-	u32		num_files;
-	num_read = fread( &num_files, sizeof( num_files ), 1, fh );
-	if ( num_read != 1 )
-	{
-		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB EOF reading number of files." );
-		#endif
-		goto fail;
-	}
-	else if ( num_files > MAX_SENSIBLE_FILES )
+	if ( header.Version != ROMDB_CURRENT_VERSION )
 	{
 		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB has unexpectedly large number of files (%d).", num_files );
+		DBGConsole_Msg( 0, "RomDB has wrong version for this build of Daedalus." );
 		#endif
-		goto fail;
+		return false;
 	}
 
-	mRomFiles.resize( num_files );
-	if( fread( &mRomFiles[0], sizeof(RomFilesKeyValue), num_files, fh ) != num_files )
-	{
-		goto fail;
-	}
-	// Redundant?
-	std::sort( mRomFiles.begin(), mRomFiles.end(), SSortByFilename() );
+	//
+	// The counts have to account for exactly the bytes we read
+	//
+	const u64	files_offset( sizeof( SFileHeader ) );
+	const u64	details_offset( files_offset + u64( header.NumFiles ) * sizeof( SFileEntry ) );
+	const u64	strings_offset( details_offset + u64( header.NumDetails ) * sizeof( RomDetails ) );
 
-	u32		num_details;
-	num_read = fread( &num_details, sizeof( num_details ), 1, fh );
-	if ( num_read != 1 )
+	if ( strings_offset + header.StringBytes != data.size() ||
+		 (header.StringBytes > 0 && data.back() != '\0') )
 	{
 		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB EOF reading number of details." );
+		DBGConsole_Msg( 0, "RomDB is corrupt (%d files, %d details).", header.NumFiles, header.NumDetails );
 		#endif
-		goto fail;
+		return false;
 	}
-	else if ( num_details > MAX_SENSIBLE_DETAILS )
+
+	const char *	strings( reinterpret_cast< const char * >( &data[0] + strings_offset ) );
+
+	mRomFiles.resize( header.NumFiles );
+	for ( u32 i = 0; i < header.NumFiles; ++i )
 	{
-		#ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg( 0, "RomDB has unexpectedly large number of details (%d).", num_details );
-		#endif
-		goto fail;
+		SFileEntry	entry;
+		memcpy( &entry, &data[0] + files_offset + i * sizeof( SFileEntry ), sizeof( entry ) );
+
+		if ( entry.NameOffset >= header.StringBytes )
+		{
+			mRomFiles.clear();
+			return false;
+		}
+
+		mRomFiles[ i ].FileName = strings + entry.NameOffset;
+		mRomFiles[ i ].FileSize = entry.FileSize;
+		mRomFiles[ i ].FileTime = entry.FileTime;
+		mRomFiles[ i ].ID = entry.ID;
 	}
 
-	mRomDetails.resize( num_details );
-	if( fread( &mRomDetails[0], sizeof(RomDetails), num_details, fh ) != num_details )
+	mRomDetails.resize( header.NumDetails );
+	if ( header.NumDetails > 0 )
 	{
-		goto fail;
+		memcpy( &mRomDetails[0], &data[0] + details_offset, header.NumDetails * sizeof( RomDetails ) );
 	}
+
 	// Redundant?
+	std::sort( mRomFiles.begin(), mRomFiles.end(), SSortByFilename() );
 	std::sort( mRomDetails.begin(), mRomDetails.end(), SSortDetailsByID() );
 	#ifdef DAEDALUS_DEBUG_CONSOLE
 	DBGConsole_Msg( 0, "RomDB initialised with %d files and %d details.", mRomFiles.size(), mRomDetails.size() );
 #endif
-	fclose( fh );
 	return true;
-
-fail:
-	fclose( fh );
-	return false;
 }
 
 bool IRomDB::Commit()
@@ -314,52 +317,79 @@ bool IRomDB::Commit()
 	if ( strlen( mRomDBFileName ) <= 0 )
 		return false;
 
-	FILE * fh = fopen( mRomDBFileName, "wb" );
-
-	if ( !fh )
-		return false;
-
 	//
-	// Write the magic
+	// Build the whole file in memory, so it goes out in one write
 	//
-	fwrite( &ROMDB_MAGIC_NO, sizeof( ROMDB_MAGIC_NO ), 1, fh );
+	u32		string_bytes( 0 );
+	for ( u32 i = 0; i < mRomFiles.size(); ++i )
+	{
+		string_bytes += mRomFiles[ i ].FileName.size() + 1;
+	}
 
-	//
-	// Write the version
-	//
-	fwrite( &ROMDB_CURRENT_VERSION, sizeof( ROMDB_CURRENT_VERSION ), 1, fh );
+	SFileHeader		header;
+	header.Magic		= ROMDB_MAGIC_NO;
+	header.Version		= ROMDB_CURRENT_VERSION;
+	header.NumFiles		= mRomFiles.size();
+	header.NumDetails	= mRomDetails.size();
+	header.StringBytes	= string_bytes;
+
+	std::vector< u8 >	data( sizeof( SFileHeader ) + header.NumFiles * sizeof( SFileEntry ) +
+							  header.NumDetails * sizeof( RomDetails ) + string_bytes );
+	u8 *	p_out( &data[0] );
+
+	memcpy( p_out, &header, sizeof( header ) );
+	p_out += sizeof( header );
+
+	u32		name_offset( 0 );
+	for ( u32 i = 0; i < mRomFiles.size(); ++i )
+	{
+		SFileEntry	entry = SFileEntry();		// Value-initialised, so no uninitialised padding is written out
+		entry.FileSize   = mRomFiles[ i ].FileSize;
+		entry.FileTime   = mRomFiles[ i ].FileTime;
+		entry.NameOffset = name_offset;
+		entry.ID         = mRomFiles[ i ].ID;
+
+		memcpy( p_out, &entry, sizeof( entry ) );
+		p_out += sizeof( entry );
+		name_offset += mRomFiles[ i ].FileName.size() + 1;
+	}
 
+	if ( !mRomDetails.empty() )
 	{
-		u32 num_files( mRomFiles.size() );
-		fwrite( &num_files, sizeof( num_files ), 1, fh );
-		fwrite( &mRomFiles[0], sizeof(RomFilesKeyValue), num_files, fh );
+		memcpy( p_out, &mRomDetails[0], mRomDetails.size() * sizeof( RomDetails ) );
+		p_out += mRomDetails.size() * sizeof( RomDetails );
 	}
 
+	for ( u32 i = 0; i < mRomFiles.size(); ++i )
 	{
-		u32 num_details( mRomDetails.size() );
-		fwrite( &num_details, sizeof( num_details ), 1, fh );
-		fwrite( &mRomDetails[0], sizeof(RomDetails), num_details, fh );
+		memcpy( p_out, mRomFiles[ i ].FileName.c_str(), mRomFiles[ i ].FileName.size() + 1 );
+		p_out += mRomFiles[ i ].FileName.size() + 1;
 	}
 
+	FILE * fh = fopen( mRomDBFileName, "wb" );
+
+	if ( !fh )
+		return false;
+
+	bool	ok( fwrite( &data[0], data.size(), 1, fh ) == 1 );
 	fclose( fh );
 
-	mDirty = true;
-	return true;
+	mDirty = !ok;
+	return ok;
 }
 
-void IRomDB::AddRomEntry( const char * filename, const RomID & id, u32 rom_size, ECicType cic_type )
+void IRomDB::AddRomEntry( const char * filename, u64 file_size, u64 file_time, const RomID & id, u32 rom_size, ECicType cic_type )
 {
 	// Update filename/id map
 	FilenameVec::iterator fit( std::lower_bound( mRomFiles.begin(), mRomFiles.end(), filename, SSortByFilename() ) );
-	if( fit != mRomFiles.end() && strcmp( fit->FileName, filename ) == 0 )
-	{
-		fit->ID = id;
-	}
-	else
+	if( fit == mRomFiles.end() || strcmp( fit->FileName.c_str(), filename ) != 0 )
 	{
-		RomFilesKeyValue	filename_id( filename, id );
-		mRomFiles.insert( fit, filename_id );
+		fit = mRomFiles.insert( fit, RomFileEntry() );
+		fit->FileName = filename;
 	}
+	fit->FileSize = file_size;
+	fit->FileTime = file_time;
+	fit->ID = id;
 
 	// Update id/details map
 	DetailsVec::iterator dit( std::lower_bound( mRomDetails.begin(), mRomDetails.end(), id, SSortDetailsByID() ) );
@@ -377,41 +407,17 @@ void IRomDB::AddRomEntry( const char * filename, const RomID & id, u32 rom_size,
 	mDirty = true;
 }
 
-void IRomDB::AddRomDirectory(const char * directory)
+bool IRomDB::IsEntryCurrent( const char * filename, u64 file_size, u64 file_time, RomID * id ) const
 {
-	#ifdef DAEDALUS_DEBUG_CONSOLE
-	DBGConsole_Msg(0, "Adding roms directory [C%s]", directory);
-	#endif
-	std::string			full_path;
-
-	IO::FindHandleT		find_handle;
-	IO::FindDataT		find_data;
-	if(IO::FindFileOpen( directory, &find_handle, find_data ))
-	{
-		do
-		{
-			const char * rom_filename = find_data.Name;
-			if(IsRomfilename( rom_filename ))
-			{
-				IO::Filename full_path;
-				IO::Path::Combine(full_path, directory, rom_filename);
-
-				AddRomFile(full_path);
-			}
-		}
-		while(IO::FindFileNext( find_handle, find_data ));
-
-		IO::FindFileClose( find_handle );
-	}
-}
+	FilenameVec::const_iterator fit( std::lower_bound( mRomFiles.begin(), mRomFiles.end(), filename, SSortByFilename() ) );
+	if( fit == mRomFiles.end() || strcmp( fit->FileName.c_str(), filename ) != 0 )
+		return false;
 
-void IRomDB::AddRomFile(const char * filename)
-{
-	RomID id;
-	u32 rom_size;
-	ECicType boot_type;
+	if( fit->FileSize != file_size || fit->FileTime != file_time )
+		return false;
 
-	QueryByFilename(filename, &id, &rom_size, &boot_type);
+	*id = fit->ID;
+	return std::binary_search( mRomDetails.begin(), mRomDetails.end(), fit->ID, SSortDetailsByID() );
 }
 
 static bool GenerateRomDetails( const char * filename, RomID * id, u32 * rom_size, ECicType * cic_type )
@@ -476,27 +482,166 @@ static bool GenerateRomDetails( const char * filename, RomID * id, u32 * rom_siz
 	return true;
 }
 
-bool IRomDB::QueryByFilename( const char * filename, RomID * id, u32 * rom_size, ECicType * cic_type )
+namespace
 {
+	struct SRomScanEntry
+	{
+		std::string		FileName;
+		u64				FileSize;
+		u64				FileTime;
+
+		// Filled in by the scan
+		bool			Valid;
+		RomID			ID;
+		u32				RomSize;
+		ECicType		CicType;
+	};
+
 	//
-	// First of all, check if we have these details cached in the rom database
+	//	Each copy of this job pulls files off the shared list until there are none
+	//	left. GenerateRomDetails only touches the file it's given, so it's safe to
+	//	run any number at once.
 	//
-	FilenameVec::const_iterator fit( std::lower_bound( mRomFiles.begin(), mRomFiles.end(), filename, SSortByFilename() ) );
-	if( fit != mRomFiles.end() && strcmp( fit->FileName, filename ) == 0 )
+	class SRomScanJob : public SJob
+	{
+	public:
+		SRomScanJob( SRomScanEntry * entries, u32 num_entries, volatile u32 * next_entry )
+			:	mEntries( entries )
+			,	mNumEntries( num_entries )
+			,	mNextEntry( next_entry )
+		{
+			InitJob = nullptr;
+			DoJob = &DoScanStatic;
+			FiniJob = nullptr;
+		}
+
+		static int DoScanStatic( SJob * arg )
+		{
+			SRomScanJob * job( static_cast< SRomScanJob * >( arg ) );
+
+			for( ;; )
+			{
+				u32		idx( AtomicIncrement( job->mNextEntry ) - 1 );
+				if( idx >= job->mNumEntries )
+					break;
+
+				SRomScanEntry & entry( job->mEntries[ idx ] );
+				entry.Valid = GenerateRomDetails( entry.FileName.c_str(), &entry.ID, &entry.RomSize, &entry.CicType );
+			}
+			return 0;
+		}
+
+	private:
+		SRomScanEntry *		mEntries;
+		u32					mNumEntries;
+		volatile u32 *		mNextEntry;
+	};
+
+	void ScanRomFiles( SRomScanEntry * entries, u32 num_entries )
+	{
+		volatile u32	next_entry( 0 );
+		SRomScanJob		job( entries, num_entries, &next_entry );
+
+#ifndef DAEDALUS_PSP
+		JobHandle		handles[ CJobSystem::kMaxWorkers ];
+		u32				num_jobs( Min( gJobSystem.GetNumWorkers(), num_entries ) );
+
+		for( u32 i = 0; i < num_jobs; ++i )
+		{
+			handles[ i ] = gJobSystem.AddJob( &job, sizeof( job ) );
+		}
+#endif
+
+		// Help out rather than sitting idle
+		SRomScanJob::DoScanStatic( &job );
+
+#ifndef DAEDALUS_PSP
+		for( u32 i = 0; i < num_jobs; ++i )
+		{
+			gJobSystem.WaitForJob( handles[ i ] );
+		}
+#endif
+	}
+}
+
+void IRomDB::AddRomDirectory(const char * directory)
+{
+	#ifdef DAEDALUS_DEBUG_CONSOLE
+	DBGConsole_Msg(0, "Adding roms directory [C%s]", directory);
+	#endif
+
+	//
+	// Only files which are new, or have changed since we last saw them, need opening
+	//
+	std::vector< SRomScanEntry >	to_scan;
+
+	IO::FindHandleT		find_handle;
+	IO::FindDataT		find_data;
+	if(IO::FindFileOpen( directory, &find_handle, find_data ))
+	{
+		do
+		{
+			const char * rom_filename = find_data.Name;
+			if(IsRomfilename( rom_filename ))
+			{
+				IO::Filename full_path;
+				IO::Path::Combine(full_path, directory, rom_filename);
+
+				SRomScanEntry	entry;
+				RomID			id;
+				if( IO::File::GetSizeAndTime( full_path, &entry.FileSize, &entry.FileTime ) &&
+					!IsEntryCurrent( full_path, entry.FileSize, entry.FileTime, &id ) )
+				{
+					entry.FileName = full_path;
+					entry.Valid = false;
+					to_scan.push_back( entry );
+				}
+			}
+		}
+		while(IO::FindFileNext( find_handle, find_data ));
+
+		IO::FindFileClose( find_handle );
+	}
+
+	if( to_scan.empty() )
+		return;
+
+	#ifdef DAEDALUS_DEBUG_CONSOLE
+	DBGConsole_Msg(0, "Scanning [M%d] new or changed roms", to_scan.size());
+	#endif
+
+	ScanRomFiles( &to_scan[0], to_scan.size() );
+
+	for( u32 i = 0; i < to_scan.size(); ++i )
 	{
-		if( QueryByID( fit->ID, rom_size, cic_type ) )
+		const SRomScanEntry & entry( to_scan[ i ] );
+		if( entry.Valid )
 		{
-			*id = fit->ID;
-			return true;
+			AddRomEntry( entry.FileName.c_str(), entry.FileSize, entry.FileTime, entry.ID, entry.RomSize, entry.CicType );
 		}
 	}
+}
+
+bool IRomDB::QueryByFilename( const char * filename, RomID * id, u32 * rom_size, ECicType * cic_type )
+{
+	//
+	// First of all, check if we have up to date details cached in the rom database
+	//
+	u64		file_size( 0 );
+	u64		file_time( 0 );
+	IO::File::GetSizeAndTime( filename, &file_size, &file_time );
+
+	if( IsEntryCurrent( filename, file_size, file_time, id ) && QueryByID( *id, rom_size, cic_type ) )
+	{
+		return true;
+	}
 
 	if( GenerateRomDetails( filename, id, rom_size, cic_type ) )
 	{
 		//
 		// Store this information for future reference
 		//
-		AddRomEntry( filename, *id, *rom_size, *cic_type );
+		AddRomEntry( filename, file_size, file_time, *id, *rom_size, *cic_type );
 		return true;
 	}
 
@@ -523,7 +668,7 @@ const char * IRomDB::QueryFilenameFromID( const RomID & id ) const
 	{
 		if( mRomFiles[ i ].ID == id )
 		{
-			return mRomFiles[ i ].FileName;
+			return mRomFiles[ i ].FileName.c_str();
 		}
 	}
 
@@ -0,0 +1,138 @@
+#ifndef MATH_SIMD_H_
+#define MATH_SIMD_H_
+
+#include <math.h>
+
+#include "Utility/DaedalusTypes.h"
+
+// Thin wrappers around 4-wide float vectors, so the batch code paths (TnL etc)
+// can be written once and built for SSE or NEON. Nothing here is used on the PSP,
+// which has the VFPU paths instead.
+
+#if defined(DAEDALUS_PSP)
+// Use the VFPU code.
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DAEDALUS_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DAEDALUS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(DAEDALUS_SIMD_SSE) || defined(DAEDALUS_SIMD_NEON)
+#define DAEDALUS_SIMD
+
+#if defined(DAEDALUS_SIMD_SSE)
+
+typedef __m128	simd4f;
+typedef __m128i	simd4i;
+
+inline simd4f	simd_load( const f32 * p )							{ return _mm_load_ps( p ); }
+inline simd4f	simd_loadu( const f32 * p )							{ return _mm_loadu_ps( p ); }
+inline void		simd_store( f32 * p, simd4f a )						{ _mm_store_ps( p, a ); }
+inline void		simd_storeu( f32 * p, simd4f a )					{ _mm_storeu_ps( p, a ); }
+inline simd4f	simd_set1( f32 a )									{ return _mm_set1_ps( a ); }
+inline simd4f	simd_zero()											{ return _mm_setzero_ps(); }
+
+inline simd4f	simd_add( simd4f a, simd4f b )						{ return _mm_add_ps( a, b ); }
+inline simd4f	simd_sub( simd4f a, simd4f b )						{ return _mm_sub_ps( a, b ); }
+inline simd4f	simd_mul( simd4f a, simd4f b )						{ return _mm_mul_ps( a, b ); }
+inline simd4f	simd_div( simd4f a, simd4f b )						{ return _mm_div_ps( a, b ); }
+inline simd4f	simd_sqrt( simd4f a )								{ return _mm_sqrt_ps( a ); }
+inline simd4f	simd_min( simd4f a, simd4f b )						{ return _mm_min_ps( a, b ); }
+inline simd4f	simd_max( simd4f a, simd4f b )						{ return _mm_max_ps( a, b ); }
+inline simd4f	simd_abs( simd4f a )								{ return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+
+// Comparisons return all-ones lanes where true.
+inline simd4f	simd_cmplt( simd4f a, simd4f b )					{ return _mm_cmplt_ps( a, b ); }
+inline simd4f	simd_cmpgt( simd4f a, simd4f b )					{ return _mm_cmpgt_ps( a, b ); }
+inline simd4f	simd_and( simd4f a, simd4f b )						{ return _mm_and_ps( a, b ); }
+inline simd4f	simd_andnot( simd4f mask, simd4f a )				{ return _mm_andnot_ps( mask, a ); }
+// mask ? b : a
+inline simd4f	simd_select( simd4f mask, simd4f a, simd4f b )		{ return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) ); }
+inline bool		simd_any( simd4f mask )								{ return _mm_movemask_ps( mask ) != 0; }
+
+inline simd4i	simd_set1i( s32 a )									{ return _mm_set1_epi32( a ); }
+inline simd4i	simd_zeroi()										{ return _mm_setzero_si128(); }
+inline simd4i	simd_ori( simd4i a, simd4i b )						{ return _mm_or_si128( a, b ); }
+inline simd4i	simd_maski( simd4f mask, simd4i a )					{ return _mm_and_si128( _mm_castps_si128( mask ), a ); }
+inline void		simd_storei( u32 * p, simd4i a )					{ _mm_storeu_si128( (__m128i *)p, a ); }
+
+inline void		simd_transpose( simd4f & a, simd4f & b, simd4f & c, simd4f & d )	{ _MM_TRANSPOSE4_PS( a, b, c, d ); }
+
+#elif defined(DAEDALUS_SIMD_NEON)
+
+typedef float32x4_t	simd4f;
+typedef int32x4_t	simd4i;
+
+inline simd4f	simd_load( const f32 * p )							{ return vld1q_f32( p ); }
+inline simd4f	simd_loadu( const f32 * p )							{ return vld1q_f32( p ); }
+inline void		simd_store( f32 * p, simd4f a )						{ vst1q_f32( p, a ); }
+inline void		simd_storeu( f32 * p, simd4f a )					{ vst1q_f32( p, a ); }
+inline simd4f	simd_set1( f32 a )									{ return vdupq_n_f32( a ); }
+inline simd4f	simd_zero()											{ return vdupq_n_f32( 0.0f ); }
+
+inline simd4f	simd_add( simd4f a, simd4f b )						{ return vaddq_f32( a, b ); }
+inline simd4f	simd_sub( simd4f a, simd4f b )						{ return vsubq_f32( a, b ); }
+inline simd4f	simd_mul( simd4f a, simd4f b )						{ return vmulq_f32( a, b ); }
+#if defined(__aarch64__)
+inline simd4f	simd_div( simd4f a, simd4f b )						{ return vdivq_f32( a, b ); }
+inline simd4f	simd_sqrt( simd4f a )								{ return vsqrtq_f32( a ); }
+#else
+// ARMv7 NEON has no divide or square root, and the estimates aren't exact, so do these a lane at a time.
+inline simd4f	simd_div( simd4f a, simd4f b )
+{
+	f32 fa[4];
+	f32 fb[4];
+	vst1q_f32( fa, a );
+	vst1q_f32( fb, b );
+	for( u32 i = 0; i < 4; ++i ) fa[i] /= fb[i];
+	return vld1q_f32( fa );
+}
+inline simd4f	simd_sqrt( simd4f a )
+{
+	f32 fa[4];
+	vst1q_f32( fa, a );
+	for( u32 i = 0; i < 4; ++i ) fa[i] = sqrtf( fa[i] );
+	return vld1q_f32( fa );
+}
+#endif
+inline simd4f	simd_min( simd4f a, simd4f b )						{ return vminq_f32( a, b ); }
+inline simd4f	simd_max( simd4f a, simd4f b )						{ return vmaxq_f32( a, b ); }
+inline simd4f	simd_abs( simd4f a )								{ return vabsq_f32( a ); }
+
+inline simd4f	simd_cmplt( simd4f a, simd4f b )					{ return vreinterpretq_f32_u32( vcltq_f32( a, b ) ); }
+inline simd4f	simd_cmpgt( simd4f a, simd4f b )					{ return vreinterpretq_f32_u32( vcgtq_f32( a, b ) ); }
+inline simd4f	simd_and( simd4f a, simd4f b )						{ return vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( b ) ) ); }
+inline simd4f	simd_andnot( simd4f mask, simd4f a )				{ return vreinterpretq_f32_u32( vbicq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( mask ) ) ); }
+inline simd4f	simd_select( simd4f mask, simd4f a, simd4f b )		{ return vbslq_f32( vreinterpretq_u32_f32( mask ), b, a ); }
+inline bool		simd_any( simd4f mask )
+{
+	uint32x2_t m = vorr_u32( vget_low_u32( vreinterpretq_u32_f32( mask ) ), vget_high_u32( vreinterpretq_u32_f32( mask ) ) );
+	return (vget_lane_u32( m, 0 ) | vget_lane_u32( m, 1 )) != 0;
+}
+
+inline simd4i	simd_set1i( s32 a )									{ return vdupq_n_s32( a ); }
+inline simd4i	simd_zeroi()										{ return vdupq_n_s32( 0 ); }
+inline simd4i	simd_ori( simd4i a, simd4i b )						{ return vorrq_s32( a, b ); }
+inline simd4i	simd_maski( simd4f mask, simd4i a )					{ return vandq_s32( vreinterpretq_s32_f32( mask ), a ); }
+inline void		simd_storei( u32 * p, simd4i a )					{ vst1q_u32( p, vreinterpretq_u32_s32( a ) ); }
+
+inline void		simd_transpose( simd4f & a, simd4f & b, simd4f & c, simd4f & d )
+{
+	float32x4x2_t ab = vtrnq_f32( a, b );
+	float32x4x2_t cd = vtrnq_f32( c, d );
+	a = vcombine_f32( vget_low_f32( ab.val[0] ),  vget_low_f32( cd.val[0] ) );
+	b = vcombine_f32( vget_low_f32( ab.val[1] ),  vget_low_f32( cd.val[1] ) );
+	c = vcombine_f32( vget_high_f32( ab.val[0] ), vget_high_f32( cd.val[0] ) );
+	d = vcombine_f32( vget_high_f32( ab.val[1] ), vget_high_f32( cd.val[1] ) );
+}
+
+#endif
+
+// a*b + c. NB: deliberately not fused, so results match the scalar code.
+inline simd4f	simd_madd( simd4f a, simd4f b, simd4f c )			{ return simd_add( simd_mul( a, b ), c ); }
+
+#endif // DAEDALUS_SIMD_SSE || DAEDALUS_SIMD_NEON
+
+#endif // MATH_SIMD_H_
@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef PLUGINS_GRAPHICSPLUGIN_H_
 #define PLUGINS_GRAPHICSPLUGIN_H_
 
+#include "Core/RSP_HLE.h"
+
 class CGraphicsPlugin
 {
 	public:
@@ -31,7 +33,9 @@ class CGraphicsPlugin
 
 		virtual void		ViStatusChanged() = 0;
 		virtual void		ViWidthChanged() = 0;
-		virtual void		ProcessDList() = 0;
+		virtual EProcessResult	ProcessDList() = 0;
+		virtual void		WaitForDisplayLists() = 0;		// Blocks until any queued display lists have been processed
+		virtual void		RenderFrameBuffer( u32 origin ) = 0;	// Draws the frame buffer in RDRAM, for games which haven't run any display lists
 
 		virtual void		UpdateScreen() = 0;
 
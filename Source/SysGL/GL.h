@@ -31,5 +31,12 @@ struct ScePspFMatrix4
 
 void sceGuSetMatrix(EGuMatrixType type, const ScePspFMatrix4 * mtx);
 
+// Draws anything RendererGL has batched up. Call before touching GL state behind its back.
+void FlushBatchedDraws();
+
+// Binds (or releases) the graphics context on the calling thread, whether it's the window's or a headless one.
+void MakeGLContextCurrent( bool current );
+void * GetGLProcAddress( const char * name );
+
 
 #endif // SYSGL_GL_H_
@@ -0,0 +1,440 @@
+#include "stdafx.h"
+
+#include "SysGL/Graphics/FrameCaptureGL.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
+#include "Graphics/PngUtil.h"
+#include "OSHLE/ultra_os.h"
+#include "SysGL/GL.h"
+#include "Utility/Cond.h"
+#include "Utility/IO.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+enum
+{
+	kCaptureScreenshot	= 1 << 0,
+	kCaptureVideo		= 1 << 1,
+};
+
+// A frame that's been read back, waiting for the writer. Rows are bottom-up, as GL returns them.
+struct SCapturedFrame
+{
+	u8 *			Pixels;				// RGBA, malloced
+	u32				Width;
+	u32				Height;
+	u32				Flags;
+	u32				FrameRate;
+	IO::Filename	GameName;
+};
+
+// A readback in flight.
+struct SCaptureSlot
+{
+	GLuint			Buffer;
+	u32				BufferSize;
+	GLsync			Fence;
+	u32				Width;
+	u32				Height;
+	u32				Flags;
+};
+
+static const u32		kNumCaptureSlots = 3;			// How many frames the readback can trail the GPU by
+static const u32		kMaxQueuedFrames = 4;			// How many frames can wait for the writer before capturing blocks
+static const GLuint64	kFenceTimeout	 = 100000000;	// 100ms, in ns
+
+static SCaptureSlot		gCaptureSlots[kNumCaptureSlots];
+static u32				gCaptureHead  = 0;
+static u32				gCaptureCount = 0;
+
+static volatile bool	gScreenshotRequested = false;
+static bool				gCapturingVideo = false;
+
+// Protected by gWriterMutex.
+static Mutex						gWriterMutex;
+static std::deque<SCapturedFrame>	gWriterQueue;		// Includes the frame currently being written
+static bool							gWriterQuit = false;
+
+static Cond *			gFrameQueued  = NULL;
+static Cond *			gFrameWritten = NULL;
+static ThreadHandle		gWriterThread = kInvalidThreadHandle;
+
+// Only touched by the writer once it's started.
+static FILE *			gVideoFile   = NULL;
+static bool				gVideoIsY4M  = false;
+static u32				gVideoWidth  = 0;			// Set from the first frame written
+static u32				gVideoHeight = 0;
+static std::vector<u8>	gVideoBuffer;
+
+//*****************************************************************************
+//	Writer
+//*****************************************************************************
+static void WriteScreenshot( const SCapturedFrame & frame )
+{
+	IO::Filename dumpdir;
+	IO::Path::Combine(dumpdir, frame.GameName, "ScreenShots");
+
+	IO::Filename filepath;
+	Dump_GetDumpDirectory(filepath, dumpdir);
+
+	IO::Filename unique_filename;
+	u32 count = 0;
+	do
+	{
+		IO::Filename test_name;
+
+		sprintf(test_name, "sd%04d.png", count++);
+		IO::Path::Combine( unique_filename, filepath, test_name );
+
+	} while( IO::File::Exists( unique_filename ) );
+
+	// A negative pitch flips the rows the right way up.
+	PngSaveImage( unique_filename, frame.Pixels, NULL, TexFmt_8888, -(s32)(frame.Width * 4), frame.Width, frame.Height, false );
+}
+
+static void WriteVideoFrame( const SCapturedFrame & frame )
+{
+	const u32 width  = frame.Width;
+	const u32 height = frame.Height;
+
+	if (gVideoWidth == 0)
+	{
+		gVideoWidth  = width;
+		gVideoHeight = height;
+
+		if (gVideoIsY4M)
+		{
+			fprintf( gVideoFile, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height, frame.FrameRate );
+		}
+	}
+	else if (width != gVideoWidth || height != gVideoHeight)
+	{
+		// Neither format can change size part way through, so drop the frame.
+		return;
+	}
+
+	const u32 num_pixels = width * height;
+	gVideoBuffer.resize( num_pixels * 3 );
+
+	u8 * out = &gVideoBuffer[0];
+	for (u32 y = 0; y < height; ++y)
+	{
+		const u8 *	src = frame.Pixels + (height - 1 - y) * width * 4;
+		u32			row = y * width;
+
+		for (u32 x = 0; x < width; ++x, src += 4)
+		{
+			s32 r = src[0];
+			s32 g = src[1];
+			s32 b = src[2];
+
+			if (gVideoIsY4M)
+			{
+				// BT.601, studio range, in separate Y, U and V planes.
+				out[row + x]                  = (u8)(16  + (( 66 * r + 129 * g +  25 * b + 128) >> 8));
+				out[row + x + num_pixels]     = (u8)(128 + ((-38 * r -  74 * g + 112 * b + 128) >> 8));
+				out[row + x + num_pixels * 2] = (u8)(128 + ((112 * r -  94 * g -  18 * b + 128) >> 8));
+			}
+			else
+			{
+				u8 * dst = &out[(row + x) * 3];
+				dst[0] = (u8)r;
+				dst[1] = (u8)g;
+				dst[2] = (u8)b;
+			}
+		}
+	}
+
+	if (gVideoIsY4M)
+	{
+		fputs( "FRAME\n", gVideoFile );
+	}
+	fwrite( out, num_pixels * 3, 1, gVideoFile );
+}
+
+static void WriteFrame( const SCapturedFrame & frame )
+{
+	if (frame.Flags & kCaptureScreenshot)
+	{
+		WriteScreenshot( frame );
+	}
+	if ((frame.Flags & kCaptureVideo) && gVideoFile != NULL)
+	{
+		WriteVideoFrame( frame );
+	}
+	free( frame.Pixels );
+}
+
+static u32 DAEDALUS_THREAD_CALL_TYPE WriterThreadFunc( void * arg )
+{
+	while (true)
+	{
+		gWriterMutex.Lock();
+		while (gWriterQueue.empty() && !gWriterQuit)
+		{
+			CondWait( gFrameQueued, &gWriterMutex, kTimeoutInfinity );
+		}
+		if (gWriterQueue.empty())
+		{
+			gWriterMutex.Unlock();
+			break;
+		}
+		SCapturedFrame frame = gWriterQueue.front();
+		gWriterMutex.Unlock();
+
+		WriteFrame( frame );
+
+		gWriterMutex.Lock();
+		gWriterQueue.pop_front();
+		gWriterMutex.Unlock();
+		CondSignal( gFrameWritten );
+	}
+	return 0;
+}
+
+static void StartWriter()
+{
+	if (gWriterThread != kInvalidThreadHandle)
+		return;
+
+	if (gFrameQueued == NULL)
+	{
+		gFrameQueued  = CondCreate();
+		gFrameWritten = CondCreate();
+	}
+
+	gWriterQuit   = false;
+	gWriterThread = CreateThread( "FrameCapture", &WriterThreadFunc, NULL );
+	#ifdef DAEDALUS_DEBUG_CONSOLE
+	if (gWriterThread == kInvalidThreadHandle)
+	{
+		DBGConsole_Msg( 0, "Failed to start the frame capture thread, writing frames synchronously" );
+	}
+	#endif
+}
+
+static void StopWriter()
+{
+	if (gWriterThread == kInvalidThreadHandle)
+		return;
+
+	// The thread drains the queue before exiting.
+	gWriterMutex.Lock();
+	gWriterQuit = true;
+	gWriterMutex.Unlock();
+	CondSignal( gFrameQueued );
+
+	JoinThread( gWriterThread, -1 );
+	gWriterThread = kInvalidThreadHandle;
+}
+
+static void QueueFrame( const SCapturedFrame & frame )
+{
+	StartWriter();
+
+	if (gWriterThread == kInvalidThreadHandle)
+	{
+		WriteFrame( frame );
+		return;
+	}
+
+	// Block rather than drop frames if the disk can't keep up - regression tests need every one.
+	MutexLock lock( &gWriterMutex );
+	while (gWriterQueue.size() >= kMaxQueuedFrames)
+	{
+		CondWait( gFrameWritten, &gWriterMutex, kTimeoutInfinity );
+	}
+	gWriterQueue.push_back( frame );
+	CondSignal( gFrameQueued );
+}
+
+//*****************************************************************************
+//	Readback
+//*****************************************************************************
+
+// Hands the oldest readback to the writer once its fence has signalled. Returns false
+// if it hasn't finished yet and wait is false. If wait is true it always succeeds.
+static bool CollectOldestSlot( bool wait )
+{
+	DAEDALUS_ASSERT( gCaptureCount > 0, "No readbacks in flight" );
+
+	SCaptureSlot & slot = gCaptureSlots[gCaptureHead];
+
+	GLenum status = glClientWaitSync( slot.Fence, 0, 0 );
+	while (wait && status == GL_TIMEOUT_EXPIRED)
+	{
+		status = glClientWaitSync( slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout );
+	}
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync( slot.Fence );
+	slot.Fence = NULL;
+
+	gCaptureHead = (gCaptureHead + 1) % kNumCaptureSlots;
+	gCaptureCount--;
+
+	// If the wait failed the contents are undefined, so drop the frame.
+	if (status == GL_WAIT_FAILED)
+		return true;
+
+	const u32 bytes = slot.Width * slot.Height * 4;
+
+	SCapturedFrame frame;
+	frame.Pixels    = static_cast<u8 *>( malloc( bytes ) );
+	frame.Width     = slot.Width;
+	frame.Height    = slot.Height;
+	frame.Flags     = slot.Flags;
+	frame.FrameRate = g_ROM.TvType == OS_TV_PAL ? 50 : 60;
+	IO::Path::Assign( frame.GameName, g_ROM.settings.GameName.c_str() );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.Buffer );
+	const void * src = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT );
+	if (src != NULL && frame.Pixels != NULL)
+	{
+		memcpy( frame.Pixels, src, bytes );
+	}
+	else
+	{
+		free( frame.Pixels );
+		frame.Pixels = NULL;
+	}
+	if (src != NULL)
+	{
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	if (frame.Pixels != NULL)
+	{
+		QueueFrame( frame );
+	}
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void FrameCapture_RequestScreenshot()
+{
+	gScreenshotRequested = true;
+}
+
+bool FrameCapture_StartVideo( const char * filename )
+{
+	if (gVideoFile != NULL)
+		return false;
+
+	gVideoFile = fopen( filename, "wb" );
+	if (gVideoFile == NULL)
+		return false;
+
+	const char * ext = IO::Path::FindExtension( filename );
+	gVideoIsY4M  = ext != NULL && _strcmpi( ext, ".y4m" ) == 0;
+	gVideoWidth  = 0;
+	gVideoHeight = 0;
+
+	StartWriter();
+	gCapturingVideo = true;
+	return true;
+}
+
+void FrameCapture_EndFrame( u32 width, u32 height )
+{
+	// Pick up any readbacks which have finished, oldest first.
+	while (gCaptureCount > 0 && CollectOldestSlot( false ))
+	{
+	}
+
+	u32 flags = 0;
+	if (gScreenshotRequested)
+	{
+		gScreenshotRequested = false;
+		flags |= kCaptureScreenshot;
+	}
+	if (gCapturingVideo)
+	{
+		flags |= kCaptureVideo;
+	}
+
+	if (flags == 0 || width == 0 || height == 0)
+		return;
+
+	// This only stalls if the GPU is more than kNumCaptureSlots frames behind.
+	if (gCaptureCount == kNumCaptureSlots)
+	{
+		CollectOldestSlot( true );
+	}
+
+	SCaptureSlot &	slot  = gCaptureSlots[(gCaptureHead + gCaptureCount) % kNumCaptureSlots];
+	const u32		bytes = width * height * 4;
+
+	if (slot.Buffer == 0)
+	{
+		glGenBuffers( 1, &slot.Buffer );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, slot.Buffer );
+	if (slot.BufferSize < bytes)
+	{
+		glBufferData( GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ );
+		slot.BufferSize = bytes;
+	}
+
+	// With a pack buffer bound, this just queues the copy.
+	glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+	glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	slot.Fence  = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	slot.Width  = width;
+	slot.Height = height;
+	slot.Flags  = flags;
+	gCaptureCount++;
+}
+
+void FrameCapture_Finalise()
+{
+	while (gCaptureCount > 0)
+	{
+		CollectOldestSlot( true );
+	}
+
+	for (u32 i = 0; i < kNumCaptureSlots; ++i)
+	{
+		SCaptureSlot & slot = gCaptureSlots[i];
+		if (slot.Buffer != 0)
+		{
+			glDeleteBuffers( 1, &slot.Buffer );
+		}
+		slot.Buffer     = 0;
+		slot.BufferSize = 0;
+	}
+	gCaptureHead = 0;
+
+	StopWriter();
+
+	if (gFrameQueued != NULL)
+	{
+		CondDestroy( gFrameQueued );
+		CondDestroy( gFrameWritten );
+		gFrameQueued  = NULL;
+		gFrameWritten = NULL;
+	}
+
+	if (gVideoFile != NULL)
+	{
+		fclose( gVideoFile );
+		gVideoFile = NULL;
+	}
+	gCapturingVideo = false;
+}
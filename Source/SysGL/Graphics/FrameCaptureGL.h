@@ -0,0 +1,26 @@
+#ifndef SYSGL_GRAPHICS_FRAMECAPTUREGL_H_
+#define SYSGL_GRAPHICS_FRAMECAPTUREGL_H_
+
+#include "Utility/DaedalusTypes.h"
+
+//
+//	Captures presented frames without stalling the GPU. Each frame is read back
+//	into one of a small ring of pixel pack buffers, and collected a few frames
+//	later once its fence has signalled. Encoding and file IO happen on a
+//	background thread.
+//
+
+// Saves the next presented frame as a PNG in the screenshot directory.
+void FrameCapture_RequestScreenshot();
+
+// Appends every presented frame to filename, as a Y4M stream if it ends in ".y4m"
+// and as raw top-down RGB24 otherwise. Returns false if the file can't be created.
+bool FrameCapture_StartVideo( const char * filename );
+
+// Call with the context current, after the frame is drawn and before it's presented.
+void FrameCapture_EndFrame( u32 width, u32 height );
+
+// Waits for any outstanding frames to be written and frees everything. Needs the context.
+void FrameCapture_Finalise();
+
+#endif // SYSGL_GRAPHICS_FRAMECAPTUREGL_H_
@@ -5,15 +5,33 @@
 
 #include "SysGL/GL.h"
 
+#include "Config/ConfigOptions.h"
 #include "Graphics/GraphicsContext.h"
+#include "SysGL/Graphics/FrameCaptureGL.h"
 
 #include "Graphics/ColourValue.h"
 
+#ifdef DAEDALUS_LINUX
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 
 static u32 SCR_WIDTH = 640;
 static u32 SCR_HEIGHT = 480;
 
 SDL_Window * gWindow = NULL;
+SDL_GLContext gContext = NULL;
+
+#ifdef DAEDALUS_LINUX
+EVideoOutput	gVideoOutput = VO_WINDOW;
+
+// Headless output renders into gOffscreenFramebuffer on a context with no surface at all.
+static EGLDisplay	gEGLDisplay = EGL_NO_DISPLAY;
+static EGLContext	gEGLContext = EGL_NO_CONTEXT;
+static GLuint		gOffscreenFramebuffer = 0;
+static GLuint		gOffscreenRenderbuffers[2] = { 0, 0 };		// Colour, depth
+#endif
 
 
 class GraphicsContextGL : public CGraphicsContext
@@ -38,8 +56,8 @@ public:
 	virtual void ViewportType(u32 * width, u32 * height) const;
 
 	virtual void SetDebugScreenTarget( ETargetSurface buffer ) {}
-	virtual void DumpNextScreen() {}
-	virtual void DumpScreenShot() {}
+	virtual void DumpNextScreen()		{ FrameCapture_RequestScreenshot(); }
+	virtual void DumpScreenShot()		{ FrameCapture_RequestScreenshot(); }
 };
 
 template<> bool CSingleton< CGraphicsContext >::Create()
@@ -53,11 +71,132 @@ template<> bool CSingleton< CGraphicsContext >::Create()
 
 GraphicsContextGL::~GraphicsContextGL()
 {
+	FrameCapture_Finalise();
+
+#ifdef DAEDALUS_LINUX
+	if (gEGLContext != EGL_NO_CONTEXT)
+	{
+		glDeleteFramebuffers(1, &gOffscreenFramebuffer);
+		glDeleteRenderbuffers(2, gOffscreenRenderbuffers);
+		gOffscreenFramebuffer = 0;
+
+		eglMakeCurrent(gEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(gEGLDisplay, gEGLContext);
+		eglTerminate(gEGLDisplay);
+		gEGLContext = EGL_NO_CONTEXT;
+		gEGLDisplay = EGL_NO_DISPLAY;
+		return;
+	}
+#endif
 		SDL_DestroyWindow(gWindow);
 		gWindow = NULL;
 		SDL_Quit();
 }
 
+void MakeGLContextCurrent( bool current )
+{
+#ifdef DAEDALUS_LINUX
+	if (gEGLContext != EGL_NO_CONTEXT)
+	{
+		eglMakeCurrent(gEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? gEGLContext : EGL_NO_CONTEXT);
+		return;
+	}
+#endif
+	SDL_GL_MakeCurrent(gWindow, current ? gContext : NULL);
+}
+
+void * GetGLProcAddress( const char * name )
+{
+#ifdef DAEDALUS_LINUX
+	if (gEGLContext != EGL_NO_CONTEXT)
+		return (void *)eglGetProcAddress(name);
+#endif
+	return SDL_GL_GetProcAddress(name);
+}
+
+#ifdef DAEDALUS_LINUX
+static bool CreateHeadlessContext()
+{
+	// Prefer Mesa's surfaceless platform, which doesn't need a display server at all.
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display != NULL)
+	{
+		gEGLDisplay = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (gEGLDisplay == EGL_NO_DISPLAY)
+	{
+		gEGLDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (gEGLDisplay == EGL_NO_DISPLAY || !eglInitialize(gEGLDisplay, &major, &minor))
+	{
+		printf( "Couldn't initialise EGL\n" );
+		return false;
+	}
+
+	// We never create a surface, so any config will do.
+	const EGLint config_attribs[] =
+	{
+		EGL_SURFACE_TYPE,		0,
+		EGL_RENDERABLE_TYPE,	EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	const EGLint context_attribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION_KHR,			3,
+		EGL_CONTEXT_MINOR_VERSION_KHR,			3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,	EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	EGLConfig	config;
+	EGLint		num_configs = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+		!eglChooseConfig(gEGLDisplay, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+	{
+		printf( "Couldn't find an EGL config for OpenGL\n" );
+		eglTerminate(gEGLDisplay);
+		gEGLDisplay = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	gEGLContext = eglCreateContext(gEGLDisplay, config, EGL_NO_CONTEXT, context_attribs);
+	if (gEGLContext == EGL_NO_CONTEXT ||
+		!eglMakeCurrent(gEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, gEGLContext))
+	{
+		printf( "Couldn't create a surfaceless EGL context: 0x%x\n", eglGetError() );
+		if (gEGLContext != EGL_NO_CONTEXT)
+			eglDestroyContext(gEGLDisplay, gEGLContext);
+		eglTerminate(gEGLDisplay);
+		gEGLContext = EGL_NO_CONTEXT;
+		gEGLDisplay = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	return true;
+}
+
+// Stands in for the window's back buffer. It stays bound, as nothing else binds a framebuffer.
+static bool CreateOffscreenFramebuffer()
+{
+	glGenRenderbuffers(2, gOffscreenRenderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, gOffscreenRenderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, gOffscreenRenderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &gOffscreenFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, gOffscreenFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gOffscreenRenderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gOffscreenRenderbuffers[1]);
+
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+#endif
+
 static void error_callback(int error, const char* description)
 {
 	fprintf(stderr, "Error: %d - %s\n", error, description);
@@ -67,6 +206,27 @@ static void error_callback(int error, const char* description)
 extern bool initgl();
 bool GraphicsContextGL::Initialise()
 {
+#ifdef DAEDALUS_LINUX
+	if (gVideoOutput != VO_WINDOW)
+	{
+		if (!CreateHeadlessContext())
+			return false;
+
+		// GLEW built for GLX complains that there's no X display, but the GL entry points are set up by then.
+		GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+			err = GLEW_OK;
+#endif
+		if (err != GLEW_OK || !GLEW_VERSION_3_2 || !CreateOffscreenFramebuffer())
+		{
+			printf( "Couldn't set up headless rendering\n" );
+			return false;
+		}
+
+		return initgl();
+	}
+#endif
 
 	//Initialize SDL
 	if( SDL_Init( SDL_INIT_VIDEO) < 0 )
@@ -90,7 +250,7 @@ bool GraphicsContextGL::Initialise()
 		}
 
 			//Create context
-	SDL_GLContext	gContext = SDL_GL_CreateContext( gWindow );
+	gContext = SDL_GL_CreateContext( gWindow );
 
 	SDL_GL_SetSwapInterval(1);
 
@@ -111,6 +271,13 @@ return initgl();
 
 void GraphicsContextGL::GetScreenSize(u32 * width, u32 * height) const
 {
+	if (gWindow == NULL)
+	{
+		*width  = SCR_WIDTH;
+		*height = SCR_HEIGHT;
+		return;
+	}
+
 	int window_width, window_height;
 	SDL_GL_GetDrawableSize(gWindow, &window_width, &window_height);
 
@@ -133,6 +300,7 @@ void GraphicsContextGL::ClearAllSurfaces()
 
 void GraphicsContextGL::ClearToBlack()
 {
+	FlushBatchedDraws();
 	glDepthMask(GL_TRUE);
 	glClearDepth( 1.0f );
 	glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
@@ -141,6 +309,7 @@ void GraphicsContextGL::ClearToBlack()
 
 void GraphicsContextGL::ClearZBuffer()
 {
+	FlushBatchedDraws();
 	glDepthMask(GL_TRUE);
 	glClearDepth( 1.0f );
 	glClear( GL_DEPTH_BUFFER_BIT );
@@ -148,12 +317,14 @@ void GraphicsContextGL::ClearZBuffer()
 
 void GraphicsContextGL::ClearColBuffer(const c32 & colour)
 {
+	FlushBatchedDraws();
 	glClearColor( colour.GetRf(), colour.GetGf(), colour.GetBf(), colour.GetAf() );
 	glClear( GL_COLOR_BUFFER_BIT );
 }
 
 void GraphicsContextGL::ClearColBufferAndDepth(const c32 & colour)
 {
+	FlushBatchedDraws();
 	glDepthMask(GL_TRUE);
 	glClearDepth( 1.0f );
 	glClearColor( colour.GetRf(), colour.GetGf(), colour.GetBf(), colour.GetAf() );
@@ -162,6 +333,8 @@ void GraphicsContextGL::ClearColBufferAndDepth(const c32 & colour)
 
 void GraphicsContextGL::BeginFrame()
 {
+	FlushBatchedDraws();
+
 	// Get window size (may be different than the requested size)
 	u32 width, height;
 	GetScreenSize(&width, &height);
@@ -175,10 +348,24 @@ void GraphicsContextGL::BeginFrame()
 
 void GraphicsContextGL::EndFrame()
 {
+	FlushBatchedDraws();
 }
 
 void GraphicsContextGL::UpdateFrame( bool wait_for_vbl )
 {
+	FlushBatchedDraws();
+
+	u32 width, height;
+	GetScreenSize(&width, &height);
+	FrameCapture_EndFrame(width, height);
+
+	if (gWindow == NULL)
+	{
+		// Nothing to present. Just make sure the frame gets going on the GPU.
+		glFlush();
+		return;
+	}
+
 	SDL_GL_SwapWindow(gWindow);
 
 //	if( gCleanSceneEnabled ) //TODO: This should be optional
@@ -23,14 +23,116 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Graphics/NativePixelFormat.h"
 
 #include "Math/MathUtil.h"
+#include "SysGL/GL.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <png.h>
 
+#include <vector>
+
 static const u32 kPalette4BytesRequired = 16 * sizeof( NativePf8888 );
 static const u32 kPalette8BytesRequired = 256 * sizeof( NativePf8888 );
 
+// Release builds don't keep a copy of the texels once they're uploaded. The
+// display list debugger needs one to dump textures.
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+static const bool kKeepShadowCopy = true;
+#else
+static const bool kKeepShadowCopy = false;
+#endif
+
+//
+//	Texels are written into a pixel unpack buffer and copied into the texture
+//	from there, so the driver can do the transfer asynchronously rather than
+//	copying out of our memory before glTexSubImage2D returns. Like the vertex
+//	ring in RendererGL, each update takes the next chunk of the buffer, and the
+//	buffer is orphaned when it wraps, so we never wait for the GPU.
+//
+static const u32	kUploadRingSize = 8 * 1024 * 1024;
+
+static GLuint				gUploadPBO = 0;
+static u32					gUploadRingOffset = 0;
+static std::vector< u8 >	gUploadFallback;		// For when the buffer can't be mapped
+static void *				gUploadMapped = NULL;	// Set while an upload is being written
+
+static void * BeginUpload( u32 bytes )
+{
+	DAEDALUS_ASSERT( gUploadMapped == NULL, "Upload already in progress" );
+
+	if( gUploadPBO == 0 )
+	{
+		glGenBuffers( 1, &gUploadPBO );
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, gUploadPBO );
+		glBufferData( GL_PIXEL_UNPACK_BUFFER, kUploadRingSize, NULL, GL_STREAM_DRAW );
+		gUploadRingOffset = 0;
+	}
+	else
+	{
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, gUploadPBO );
+	}
+
+	if( bytes <= kUploadRingSize )
+	{
+		if( gUploadRingOffset + bytes > kUploadRingSize )
+		{
+			glBufferData( GL_PIXEL_UNPACK_BUFFER, kUploadRingSize, NULL, GL_STREAM_DRAW );
+			gUploadRingOffset = 0;
+		}
+
+		// Nothing in flight references this part of the buffer, so there's no need to synchronise.
+		gUploadMapped = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, gUploadRingOffset, bytes,
+										  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+	}
+
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	if( gUploadMapped != NULL )
+		return gUploadMapped;
+
+	if( gUploadFallback.size() < bytes )
+		gUploadFallback.resize( bytes );
+	return &gUploadFallback[0];
+}
+
+static void EndUpload( GLuint texture_id, bool upload, u32 bytes, u32 width, u32 height, u32 row_length, GLenum format, GLenum type )
+{
+	const void * pixels = &gUploadFallback[0];
+	if( gUploadMapped != NULL )
+	{
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, gUploadPBO );
+		glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+
+		// With a buffer bound, the pointer is an offset into it
+		pixels = reinterpret_cast< const void * >( uintptr_t( gUploadRingOffset ) );
+		gUploadRingOffset = AlignPow2( gUploadRingOffset + bytes, 256 );
+		gUploadMapped = NULL;
+	}
+
+	if( upload )
+	{
+		glBindTexture( GL_TEXTURE_2D, texture_id );
+		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		glPixelStorei( GL_UNPACK_ROW_LENGTH, row_length );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pixels );
+		glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+	}
+
+	// Anything else uploading from client memory mustn't see the buffer
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+}
+
+static void GetUploadFormat( ETextureFormat texture_format, GLenum * format, GLenum * type )
+{
+	switch( texture_format )
+	{
+	case TexFmt_5650:	*format = GL_RGB;	*type = GL_UNSIGNED_SHORT_5_6_5_REV;	break;
+	case TexFmt_5551:	*format = GL_RGBA;	*type = GL_UNSIGNED_SHORT_1_5_5_5_REV;	break;
+	case TexFmt_4444:	*format = GL_RGBA;	*type = GL_UNSIGNED_SHORT_4_4_4_4_REV;	break;
+	default:			*format = GL_RGBA;	*type = GL_UNSIGNED_INT_8_8_8_8_REV;	break;	// Palettised textures are expanded to 8888
+	}
+}
+
 static u32 GetTextureBlockWidth( u32 dimension, ETextureFormat texture_format )
 {
 	DAEDALUS_ASSERT( GetNextPowerOf2( dimension ) == dimension, "This is not a power of 2" );
@@ -68,22 +170,39 @@ CNativeTexture::CNativeTexture( u32 w, u32 h, ETextureFormat texture_format )
 {
 	glGenTextures( 1, &mTextureId );
 
-	size_t data_len = GetBytesRequired();
-	mpData = malloc(data_len);
-	memset(mpData, 0, data_len);
-
-	if (texture_format == TexFmt_CI4_8888)
+	// Allocate the storage once - updates only ever replace the contents
+	glBindTexture( GL_TEXTURE_2D, mTextureId );
+	if (GLEW_ARB_texture_storage)
 	{
-		mpPalette = malloc(kPalette8BytesRequired);
+		glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8, mCorrectedWidth, mCorrectedHeight );
 	}
-	else if (texture_format == TexFmt_CI8_8888)
+	else
 	{
-		mpPalette = malloc(kPalette4BytesRequired);
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, mCorrectedWidth, mCorrectedHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	}
+
+	if (kKeepShadowCopy)
+	{
+		size_t data_len = GetBytesRequired();
+		mpData = malloc(data_len);
+		memset(mpData, 0, data_len);
+
+		if (texture_format == TexFmt_CI4_8888)
+		{
+			mpPalette = malloc(kPalette4BytesRequired);
+		}
+		else if (texture_format == TexFmt_CI8_8888)
+		{
+			mpPalette = malloc(kPalette8BytesRequired);
+		}
 	}
 }
 
 CNativeTexture::~CNativeTexture()
 {
+	// Pending draws may still reference this texture.
+	FlushBatchedDraws();
+
 	if (mpData)
 		free(mpData);
 	if (mpPalette)
@@ -270,120 +389,101 @@ CRefPtr<CNativeTexture>	CNativeTexture::CreateFromPng( const char * p_filename,
 
 void CNativeTexture::SetData( void * data, void * palette )
 {
-	// It's pretty gross that we don't pass this in, or better yet, provide a way for
-	// the caller to write directly to our buffers instead of setting the data.
-	size_t data_len = GetBytesRequired();
-	memcpy(mpData, data, data_len);
-
-	if (mTextureFormat == TexFmt_CI4_8888)
-	{
-		memcpy(mpPalette, palette, kPalette4BytesRequired);
-	}
-	else if (mTextureFormat == TexFmt_CI8_8888)
+	if (kKeepShadowCopy)
 	{
-		memcpy(mpPalette, palette, kPalette8BytesRequired);
-	}
+		memcpy(mpData, data, GetBytesRequired());
 
-	if (HasData())
-	{
-		glBindTexture( GL_TEXTURE_2D, mTextureId );
-		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-
-		switch (mTextureFormat)
+		if (mTextureFormat == TexFmt_CI4_8888)
 		{
-		case TexFmt_5650:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5_REV, data );
-			break;
-		case TexFmt_5551:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, data );
-			break;
-		case TexFmt_4444:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4_REV, data );
-
-			break;
-		case TexFmt_8888:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, data );
-
-			break;
-		case TexFmt_CI4_8888:
-			{
-				// Convert palletised texture to non-palletised. This is wsteful - we should avoid generating these updated for OSX.
-				const NativePfCI44 * pix_ptr = static_cast< const NativePfCI44 * >( data );
-				const NativePf8888 * pal_ptr = static_cast< const NativePf8888 * >( palette );
+			memcpy(mpPalette, palette, kPalette4BytesRequired);
+		}
+		else if (mTextureFormat == TexFmt_CI8_8888)
+		{
+			memcpy(mpPalette, palette, kPalette8BytesRequired);
+		}
+	}
 
-				NativePf8888 * out = static_cast<NativePf8888 *>( malloc(mCorrectedWidth * mCorrectedHeight * sizeof(NativePf8888)) );
-				NativePf8888 * out_ptr = out;
+	if (!HasData())
+		return;
 
-				u32 pitch = GetStride();
+	if (!IsTextureFormatPalettised( mTextureFormat ))
+	{
+		DAEDALUS_ASSERT( palette == NULL, "Palette provided when not needed" );
 
-				for (u32 y = 0; y < mCorrectedHeight; ++y)
-				{
-					for (u32 x = 0; x < mCorrectedWidth; ++x)
-					{
-						NativePfCI44	colors  = pix_ptr[ x / 2 ];
-						u8				pal_idx = (x&1) ? colors.GetIdxA() : colors.GetIdxB();
+		// BeginUpdate() hands back the shadow copy, if there is one, which is already up to date.
+		void * dst = BeginUpdate();
+		if (dst != mpData)
+		{
+			memcpy(dst, data, GetBytesRequired());
+		}
+		EndUpdate(true);
+		return;
+	}
 
-						*out_ptr = pal_ptr[ pal_idx ];
-						out_ptr++;
-					}
+	// Convert palletised texture to non-palletised, straight into the upload buffer.
+	FlushBatchedDraws();
 
-					pix_ptr = reinterpret_cast<const NativePfCI44 *>( reinterpret_cast<const u8 *>(pix_ptr) + pitch );
-				}
+	const u32		bytes   = mCorrectedWidth * mCorrectedHeight * sizeof(NativePf8888);
+	NativePf8888 *	out_ptr = static_cast<NativePf8888 *>( BeginUpload( bytes ) );
+	const u8 *		pix_ptr = static_cast< const u8 * >( data );
+	const NativePf8888 * pal_ptr = static_cast< const NativePf8888 * >( palette );
+	u32				pitch   = GetStride();
 
-				glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-							  mCorrectedWidth, mCorrectedHeight,
-							  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
+	for (u32 y = 0; y < mCorrectedHeight; ++y)
+	{
+		if (mTextureFormat == TexFmt_CI4_8888)
+		{
+			const NativePfCI44 * row = reinterpret_cast< const NativePfCI44 * >( pix_ptr );
+			for (u32 x = 0; x < mCorrectedWidth; ++x)
+			{
+				NativePfCI44	colors  = row[ x / 2 ];
+				u8				pal_idx = (x&1) ? colors.GetIdxA() : colors.GetIdxB();
 
-				free(out);
+				*out_ptr++ = pal_ptr[ pal_idx ];
 			}
-			break;
-
-		case TexFmt_CI8_8888:
+		}
+		else
+		{
+			const NativePfCI8 * row = reinterpret_cast< const NativePfCI8 * >( pix_ptr );
+			for (u32 x = 0; x < mCorrectedWidth; ++x)
 			{
-				// Convert palletised texture to non-palletised. This is wsteful - we should avoid generating these updated for OSX.
-				const NativePfCI8 *  pix_ptr = static_cast< const NativePfCI8 * >( data );
-				const NativePf8888 * pal_ptr = static_cast< const NativePf8888 * >( palette );
+				*out_ptr++ = pal_ptr[ row[ x ].Bits ];
+			}
+		}
 
-				NativePf8888 * out = static_cast<NativePf8888 *>( malloc(mCorrectedWidth * mCorrectedHeight * sizeof(NativePf8888)) );
-				NativePf8888 * out_ptr = out;
+		pix_ptr += pitch;
+	}
 
-				u32 pitch = GetStride();
+	EndUpload( mTextureId, true, bytes, mCorrectedWidth, mCorrectedHeight, mCorrectedWidth, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV );
+}
 
-				for (u32 y = 0; y < mCorrectedHeight; ++y)
-				{
-					for (u32 x = 0; x < mCorrectedWidth; ++x)
-					{
-						u8	pal_idx = pix_ptr[ x ].Bits;
+void * CNativeTexture::BeginUpdate()
+{
+	DAEDALUS_ASSERT( !IsTextureFormatPalettised( mTextureFormat ), "Palettised textures must use SetData" );
 
-						*out_ptr = pal_ptr[ pal_idx ];
-						out_ptr++;
-					}
+	// Write into the shadow copy if we have one, so it stays up to date
+	if (kKeepShadowCopy)
+		return mpData;
 
-					pix_ptr = reinterpret_cast<const NativePfCI8 *>( reinterpret_cast<const u8 *>(pix_ptr) + pitch );
-				}
+	return BeginUpload( GetBytesRequired() );
+}
 
-				glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-							  mCorrectedWidth, mCorrectedHeight,
-							  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
+void CNativeTexture::EndUpdate( bool upload )
+{
+	// Pending draws may still reference this texture.
+	if (upload)
+		FlushBatchedDraws();
 
-				free(out);
-			}
-			break;
+	GLenum format, type;
+	GetUploadFormat( mTextureFormat, &format, &type );
 
-		default:
-			DAEDALUS_ASSERT( !IsTextureFormatPalettised( mTextureFormat ), "Unhandled palette texture" );
-			DAEDALUS_ASSERT( palette == NULL, "Palette provided when not needed" );
-			break;
-		}
+	const u32 bytes = GetBytesRequired();
+	if (kKeepShadowCopy)
+	{
+		memcpy( BeginUpload( bytes ), mpData, bytes );
 	}
+
+	EndUpload( mTextureId, upload, bytes, mCorrectedWidth, mCorrectedHeight, mTextureBlockWidth, format, type );
 }
 
 u32	CNativeTexture::GetStride() const
@@ -2,7 +2,9 @@
 
 #include <stdio.h>
 
+#include "Config/ConfigOptions.h"
 #include "Core/Memory.h"
+#include "Core/RSP_HLE.h"
 
 #include "Debug/DBGConsole.h"
 
@@ -15,11 +17,15 @@
 
 #include "Plugins/GraphicsPlugin.h"
 
+#include "Utility/Cond.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
 #include "Utility/Timing.h"
 
 #include "SysGL/GL.h"
 
 extern SDL_Window * gWindow;
+extern u32 gRDPFrame;
 
 EFrameskipValue     gFrameskipValue = FV_DISABLED;
 u32                 gVISyncRate     = 1500;
@@ -79,6 +85,12 @@ static void	UpdateFramerate()
 		gFlipCount = 0;
 		gLastFramerateCalcTime = now;
 
+		// Headless runs have no title bar to show this in.
+		if (gWindow == NULL)
+		{
+			printf( "FPS %#.1f\n", gCurrentFramerate );
+		}
+
 #ifdef DAEDALUS_FRAMERATE_ANALYSIS
 		if( gFramerateFile != NULL )
 		{
@@ -102,23 +114,62 @@ class CGraphicsPluginImpl : public CGraphicsPlugin
 
 		virtual void		ViStatusChanged()		{}
 		virtual void		ViWidthChanged()		{}
-		virtual void		ProcessDList();
+		virtual EProcessResult	ProcessDList();
+		virtual void		WaitForDisplayLists();
+		virtual void		RenderFrameBuffer( u32 origin );
 
 		virtual void		UpdateScreen();
 
 		virtual void		RomClosed();
 
+	private:
+				void		StartRenderThread();
+				void		StopRenderThread();
+				void		RenderThread();
+				void		QueueTask( const OSTask * task, u32 frame_buffer_origin );
+		static	u32 DAEDALUS_THREAD_CALL_TYPE	RenderThreadFunc( void * arg );
+
 	private:
 		u32					LastOrigin;
+
+		// When gThreadedDisplayLists is set, tasks are copied into this queue and
+		// processed on mRenderThread, which owns the GL context until the rom is closed.
+		// Frame buffer draws go through the queue too, as they need the context.
+		static const u32	kMaxQueuedTasks = 2;
+
+		struct SQueuedTask
+		{
+			OSTask			Task;
+			u32				FrameBufferOrigin;
+			bool			IsFrameBuffer;		// Draw the frame buffer at FrameBufferOrigin rather than running Task
+		};
+
+		ThreadHandle		mRenderThread;
+		Mutex				mQueueMutex;
+		Cond *				mTaskQueued;
+		Cond *				mTaskDone;
+		SQueuedTask			mTasks[ kMaxQueuedTasks ];
+		u32					mQueueHead;
+		u32					mQueueCount;		// Includes the task currently being processed
+		bool				mQuit;
 };
 
 CGraphicsPluginImpl::CGraphicsPluginImpl()
 :	LastOrigin( 0 )
+,	mRenderThread( kInvalidThreadHandle )
+,	mTaskQueued( CondCreate() )
+,	mTaskDone( CondCreate() )
+,	mQueueHead( 0 )
+,	mQueueCount( 0 )
+,	mQuit( false )
 {
 }
 
 CGraphicsPluginImpl::~CGraphicsPluginImpl()
 {
+	StopRenderThread();
+	CondDestroy( mTaskQueued );
+	CondDestroy( mTaskDone );
 }
 
 bool CGraphicsPluginImpl::Initialise()
@@ -138,10 +189,108 @@ bool CGraphicsPluginImpl::Initialise()
 		return false;
 	}
 
+	// The display list debugger expects to be driven from the cpu thread.
+#ifndef DAEDALUS_DEBUG_DISPLAYLIST
+	if (gThreadedDisplayLists)
+	{
+		StartRenderThread();
+	}
+#endif
+
 	return true;
 }
 
-void CGraphicsPluginImpl::ProcessDList()
+void CGraphicsPluginImpl::StartRenderThread()
+{
+	mQuit = false;
+	mQueueHead = 0;
+	mQueueCount = 0;
+
+	// Hand the context over to the render thread.
+	FlushBatchedDraws();
+	MakeGLContextCurrent( false );
+
+	mRenderThread = CreateThread( "Render", &RenderThreadFunc, this );
+	if (mRenderThread == kInvalidThreadHandle)
+	{
+		DBGConsole_Msg( 0, "Failed to start the render thread, processing display lists synchronously" );
+		MakeGLContextCurrent( true );
+	}
+}
+
+void CGraphicsPluginImpl::StopRenderThread()
+{
+	if (mRenderThread == kInvalidThreadHandle)
+		return;
+
+	// The thread drains any queued tasks before exiting.
+	mQueueMutex.Lock();
+	mQuit = true;
+	mQueueMutex.Unlock();
+	CondSignal( mTaskQueued );
+
+	JoinThread( mRenderThread, -1 );
+	mRenderThread = kInvalidThreadHandle;
+
+	// Take the context back, so the renderer can be torn down on this thread.
+	MakeGLContextCurrent( true );
+}
+
+u32 DAEDALUS_THREAD_CALL_TYPE CGraphicsPluginImpl::RenderThreadFunc( void * arg )
+{
+	static_cast< CGraphicsPluginImpl * >( arg )->RenderThread();
+	return 0;
+}
+
+void CGraphicsPluginImpl::RenderThread()
+{
+	MakeGLContextCurrent( true );
+
+	while (true)
+	{
+		mQueueMutex.Lock();
+		while (mQueueCount == 0 && !mQuit)
+		{
+			CondWait( mTaskQueued, &mQueueMutex, kTimeoutInfinity );
+		}
+		if (mQueueCount == 0)
+		{
+			mQueueMutex.Unlock();
+			break;
+		}
+		SQueuedTask task = mTasks[ mQueueHead ];
+		mQueueMutex.Unlock();
+
+		if (task.IsFrameBuffer)
+		{
+			// Display lists queued ahead of this may have run since the cpu thread checked gRDPFrame
+			if (gRDPFrame == 0)
+			{
+				DLParser_RenderFrameBuffer( task.FrameBufferOrigin );
+			}
+		}
+		else
+		{
+			DLParser_ProcessTask( task.Task );
+		}
+		FlushBatchedDraws();
+
+		mQueueMutex.Lock();
+		mQueueHead = (mQueueHead + 1) % kMaxQueuedTasks;
+		mQueueCount--;
+		mQueueMutex.Unlock();
+
+		if (!task.IsFrameBuffer)
+		{
+			RSP_HLE_SignalGraphicsTaskDone();
+		}
+		CondSignal( mTaskDone );
+	}
+
+	MakeGLContextCurrent( false );
+}
+
+EProcessResult CGraphicsPluginImpl::ProcessDList()
 {
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	if (!DLDebugger_Process())
@@ -149,8 +298,62 @@ void CGraphicsPluginImpl::ProcessDList()
 		DLParser_Process();
 	}
 #else
+	if (mRenderThread != kInvalidThreadHandle)
+	{
+		// Snapshot the task from DMEM - the display list itself lives in RDRAM, which
+		// the game leaves alone until it sees the task complete.
+		QueueTask( (const OSTask *)(g_pu8SpMemBase + 0x0FC0), 0 );
+		return PR_STARTED;
+	}
+
 	DLParser_Process();
 #endif
+	return PR_COMPLETED;
+}
+
+void CGraphicsPluginImpl::QueueTask( const OSTask * task, u32 frame_buffer_origin )
+{
+	MutexLock lock( &mQueueMutex );
+	while (mQueueCount == kMaxQueuedTasks)
+	{
+		CondWait( mTaskDone, &mQueueMutex, kTimeoutInfinity );
+	}
+
+	SQueuedTask & queued = mTasks[ (mQueueHead + mQueueCount) % kMaxQueuedTasks ];
+	queued.IsFrameBuffer = (task == NULL);
+	queued.FrameBufferOrigin = frame_buffer_origin;
+	if (task != NULL)
+	{
+		queued.Task = *task;
+	}
+	mQueueCount++;
+	CondSignal( mTaskQueued );
+}
+
+void CGraphicsPluginImpl::RenderFrameBuffer( u32 origin )
+{
+	// The render thread owns the GL context, so the draw has to happen there.
+	// The frame buffer is copied out of RDRAM when it's drawn, just as a
+	// display list is read when it's processed.
+	if (mRenderThread != kInvalidThreadHandle)
+	{
+		QueueTask( NULL, origin );
+		return;
+	}
+
+	DLParser_RenderFrameBuffer( origin );
+}
+
+void CGraphicsPluginImpl::WaitForDisplayLists()
+{
+	if (mRenderThread == kInvalidThreadHandle)
+		return;
+
+	MutexLock lock( &mQueueMutex );
+	while (mQueueCount > 0)
+	{
+		CondWait( mTaskDone, &mQueueMutex, kTimeoutInfinity );
+	}
 }
 
 void CGraphicsPluginImpl::UpdateScreen()
@@ -165,7 +368,10 @@ void CGraphicsPluginImpl::UpdateScreen()
 		char string[22];
 		sprintf(string, "Daedalus | FPS %#.1f", gCurrentFramerate);
 
-	SDL_SetWindowTitle(gWindow, string);
+		if (gWindow != NULL)
+		{
+			SDL_SetWindowTitle(gWindow, string);
+		}
 
 		if (gTakeScreenshot)
 		{
@@ -182,6 +388,7 @@ void CGraphicsPluginImpl::UpdateScreen()
 void CGraphicsPluginImpl::RomClosed()
 {
 	DBGConsole_Msg(0, "Finalising GLGraphics");
+	StopRenderThread();
 	DLParser_Finalise();
 	CTextureCache::Destroy();
 	DestroyRenderer();
@@ -1,11 +1,15 @@
 #include "stdafx.h"
 
 
+#include <stddef.h>
+#include <unordered_map>
 #include <vector>
 #include <GL/glew.h>
 
+#include "Config/ConfigOptions.h"
 #include "Core/ROM.h"
 #include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
 #include "Graphics/ColourValue.h"
 #include "Graphics/GraphicsContext.h"
 #include "Graphics/NativeTexture.h"
@@ -14,8 +18,10 @@
 #include "OSHLE/ultra_gbi.h"
 #include "SysGL/GL.h"
 #include "SysGL/HLEGraphics/RendererGL.h"
+#include "SysGL/HLEGraphics/RendererNull.h"
 
 #include "System/Paths.h"
+#include "Utility/Hash.h"
 #include "Utility/IO.h"
 #include "Utility/Macros.h"
 #include "Utility/Profiler.h"
@@ -37,13 +43,18 @@ static PFN_glDeleteVertexArrays         pglDeleteVertexArrays = NULL;
 // We read n64.psh into this.
 static const char * 					gN64FramentLibrary = NULL;
 
+// Set if the driver can hand back linked program binaries, so we can cache them on disk.
+static bool								gProgramBinarySupported = false;
+// Identifies the driver and shader source that produced a cached binary.
+static u32								gShaderCacheDriverHash = 0;
+
 static const u32 kNumTextures = 2;
 
 
 #define RESOLVE_GL_FCN(type, var, name) \
     if (status == GL_TRUE) \
     {\
-        var = (type)SDL_GL_GetProcAddress((name));\
+        var = (type)GetGLProcAddress((name));\
         if ((var) == NULL)\
         {\
             status = GL_FALSE;\
@@ -71,23 +82,43 @@ const float kShiftScales[] = {
 };
 DAEDALUS_STATIC_ASSERT(ARRAYSIZE(kShiftScales) == 16);
 
-enum
+// Interleaved vertex, as streamed to the GPU.
+struct GLVertex
 {
-	kPositionBuffer,
-	kTexCoordBuffer,
-	kColorBuffer,
+	float		Position[3];
+	TexCoord	UV;
+	u32			Colour;
+};
+DAEDALUS_STATIC_ASSERT(sizeof(GLVertex) == 20);
 
-	kNumBuffers,
+enum
+{
+	kPositionAttrib,
+	kTexCoordAttrib,
+	kColourAttrib,
 };
 
 static GLuint gVAO;
-static GLuint gVBOs[kNumBuffers];
-
-const int kMaxVertices = 1000;
-
-static float 	gPositionBuffer[kMaxVertices][3];
-static TexCoord gTexCoordBuffer[kMaxVertices];
-static u32 		gColorBuffer[kMaxVertices];
+static GLuint gVBO;
+static GLuint gIBO;
+
+// Vertices and indices are accumulated here while the render state stays the
+// same, and submitted with a single glDrawElements when it changes (or
+// something else needs the GL state). Indices are relative to the start of
+// the batch. They're streamed into ring buffers which are orphaned each time
+// they wrap, so we never have to wait for the GPU.
+static const u32 kMaxBatchVertices = 32 * 1024;
+static const u32 kMaxBatchIndices  = 2 * kMaxBatchVertices;
+static const u32 kVertexRingSize   = 4 * kMaxBatchVertices;
+static const u32 kIndexRingSize    = 4 * kMaxBatchIndices;
+DAEDALUS_STATIC_ASSERT(kMaxBatchVertices <= 0x10000);
+
+static GLVertex		gBatchVertices[kMaxBatchVertices];
+static u16			gBatchIndices[kMaxBatchIndices];
+static u32			gNumBatchVertices = 0;
+static u32			gNumBatchIndices = 0;
+static u32			gVertexRingOffset = 0;
+static u32			gIndexRingOffset = 0;
 
 bool initgl()
 {
@@ -117,6 +148,29 @@ bool initgl()
 		gN64FramentLibrary = p;
 	}
 
+	// Program binaries are only valid for the exact driver (and shader source) that built them.
+	{
+		GLint num_formats = 0;
+		if (GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		gProgramBinarySupported = num_formats > 0;
+
+		const char * strings[] = {
+			(const char *)glGetString(GL_VENDOR),
+			(const char *)glGetString(GL_RENDERER),
+			(const char *)glGetString(GL_VERSION),
+			gN64FramentLibrary,
+		};
+
+		u32 hash = 0;
+		for (u32 i = 0; i < ARRAYSIZE(strings); ++i)
+		{
+			if (strings[i] != NULL)
+				hash = murmur2_hash(strings[i], strlen(strings[i]), hash);
+		}
+		gShaderCacheDriverHash = hash;
+	}
+
 	// Only do software emulation of mirror_s/mirror_t if we're not doing accurate UV handling
 	gRDPStateManager.SetEmulateMirror(!gAccurateUVPipe);
 
@@ -129,16 +183,27 @@ bool initgl()
 	pglGenVertexArrays(1, &gVAO);
 	pglBindVertexArray(gVAO);
 
-	glGenBuffers(kNumBuffers, gVBOs);
+	glGenBuffers(1, &gVBO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+	glBufferData(GL_ARRAY_BUFFER, kVertexRingSize * sizeof(GLVertex), NULL, GL_STREAM_DRAW);
+	gVertexRingOffset = 0;
+
+	// NB: the element array binding is part of the VAO state.
+	glGenBuffers(1, &gIBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gIBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, kIndexRingSize * sizeof(u16), NULL, GL_STREAM_DRAW);
+	gIndexRingOffset = 0;
 
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kPositionBuffer]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(gPositionBuffer), gPositionBuffer, GL_DYNAMIC_DRAW);
+	// NB: the attribute locations are bound to these indices in make_shader_program.
+	glEnableVertexAttribArray(kPositionAttrib);
+	glVertexAttribPointer(kPositionAttrib, 3, GL_FLOAT, GL_FALSE, sizeof(GLVertex), (const void *)offsetof(GLVertex, Position));
 
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kTexCoordBuffer]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(gTexCoordBuffer), gTexCoordBuffer, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(kTexCoordAttrib);
+	glVertexAttribPointer(kTexCoordAttrib, 2, GL_SHORT, GL_FALSE, sizeof(GLVertex), (const void *)offsetof(GLVertex, UV));
 
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kColorBuffer]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(gColorBuffer), gColorBuffer, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(kColourAttrib);
+	glVertexAttribPointer(kColourAttrib, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GLVertex), (const void *)offsetof(GLVertex, Colour));
 	return true;
 }
 
@@ -207,7 +272,27 @@ struct ShaderProgram
 
 	GLint				uloc_foo;
 };
-static std::vector<ShaderProgram *>		gShaders;
+
+struct ShaderConfigurationHash
+{
+	size_t operator()(const ShaderConfiguration & config) const
+	{
+		u64 h = config.Mux;
+		h ^= (u64)config.CycleType      << 3;
+		h ^= (u64)config.BilerpFilter   << 11;
+		h ^= (u64)config.ClampS0        << 19;
+		h ^= (u64)config.ClampT0        << 27;
+		h ^= (u64)config.ClampS1        << 35;
+		h ^= (u64)config.ClampT1        << 43;
+		h ^= (u64)config.AlphaThreshold << 51;
+		h *= 0x9E3779B97F4A7C15ULL;
+		return (size_t)(h ^ (h >> 32));
+	}
+};
+
+typedef std::unordered_map<ShaderConfiguration, ShaderProgram *, ShaderConfigurationHash> ShaderMap;
+static ShaderMap		gShaders;
+static bool				gShaderCacheDirty = false;
 
 
 /* Creates a shader object of the specified type using the specified text
@@ -265,6 +350,13 @@ static GLuint make_shader_program(const char ** vertex_lines, size_t num_vertex_
 				glAttachShader(program, vertex_shader);
 				glAttachShader(program, fragment_shader);
 
+				glBindAttribLocation(program, kPositionAttrib, "in_pos");
+				glBindAttribLocation(program, kTexCoordAttrib, "in_uv");
+				glBindAttribLocation(program, kColourAttrib,   "in_col");
+
+				if (gProgramBinarySupported)
+					glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 				glLinkProgram(program);
 				glGetProgramiv(program, GL_LINK_STATUS, &program_ok);
 
@@ -496,22 +588,6 @@ static void InitShaderProgram(ShaderProgram * program, const ShaderConfiguration
 	program->uloc_tilemirror[1] = glGetUniformLocation(shader_program, "uTileMirror1");
 	program->uloc_texscale[1]   = glGetUniformLocation(shader_program, "uTexScale1");
 	program->uloc_texture[1]    = glGetUniformLocation(shader_program, "uTexture1");
-
-	GLuint attrloc;
-	attrloc = glGetAttribLocation(program->program, "in_pos");
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kPositionBuffer]);
-	glEnableVertexAttribArray(attrloc);
-	glVertexAttribPointer(attrloc, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	attrloc = glGetAttribLocation(program->program, "in_uv");
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kTexCoordBuffer]);
-	glEnableVertexAttribArray(attrloc);
-	glVertexAttribPointer(attrloc, 2, GL_SHORT, GL_FALSE, 0, 0);
-
-	attrloc = glGetAttribLocation(program->program, "in_col");
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kColorBuffer]);
-	glEnableVertexAttribArray(attrloc);
-	glVertexAttribPointer(attrloc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, 0);
 }
 
 void RendererGL::MakeShaderConfigFromCurrentState(ShaderConfiguration * config) const
@@ -569,17 +645,8 @@ void RendererGL::MakeShaderConfigFromCurrentState(ShaderConfiguration * config)
 	}
 }
 
-static ShaderProgram * GetShaderForConfig(const ShaderConfiguration & config)
+static ShaderProgram * CompileShaderForConfig(const ShaderConfiguration & config)
 {
-	DAEDALUS_ASSERT( gN64FramentLibrary != NULL, "Haven't initialised the n64 fragment library" );
-
-	for (u32 i = 0; i < gShaders.size(); ++i)
-	{
-		ShaderProgram * program = gShaders[i];
-		if (program->config == config)
-			return program;
-	}
-
 	char frag_shader[2048];
 	SprintShader(frag_shader, config);
 
@@ -597,13 +664,483 @@ static ShaderProgram * GetShaderForConfig(const ShaderConfiguration & config)
 
 	ShaderProgram * program = new ShaderProgram;
 	InitShaderProgram(program, config, shader_program);
-	gShaders.push_back(program);
+	return program;
+}
 
+static ShaderProgram * GetShaderForConfig(const ShaderConfiguration & config)
+{
+	DAEDALUS_ASSERT( gN64FramentLibrary != NULL, "Haven't initialised the n64 fragment library" );
+
+	ShaderMap::const_iterator it = gShaders.find(config);
+	if (it != gShaders.end())
+		return it->second;
+
+	ShaderProgram * program = CompileShaderForConfig(config);
+	if (program != NULL)
+	{
+		gShaders[config] = program;
+		gShaderCacheDirty = true;
+	}
 	return program;
 }
 
+//*****************************************************************************
+// Shader cache
+//*****************************************************************************
+// Every program built while a rom is running is written to <rom>.gls in the
+// cache directory when the rom is closed. Next time the rom is loaded the
+// programs are all created up front, so we don't stall the first time each
+// combiner mode is seen. If the driver supports it the linked binaries are
+// stored too; if they're rejected (or the driver has changed) we just compile
+// the configuration from source instead.
+static const u32 kShaderCacheMagic   = 0x474C5343;	// 'GLSC'
+static const u32 kShaderCacheVersion = 1;
+static const u32 kMaxCachedPrograms  = 4096;		// Far more than any rom uses - anything above this is a corrupt file
+
+struct ShaderCacheHeader
+{
+	u32		Magic;
+	u32		Version;
+	u32		RomCRC[2];
+	u32		DriverHash;
+	u32		NumPrograms;
+};
+
+struct ShaderCacheEntry
+{
+	u64		Mux;
+	u32		Flags;
+	u32		BinaryFormat;
+	u32		BinaryLength;
+};
+
+static u32 PackShaderConfigFlags(const ShaderConfiguration & config)
+{
+	return	(config.CycleType      << 0) |
+			(config.BilerpFilter   << 2) |
+			(config.ClampS0        << 3) |
+			(config.ClampT0        << 4) |
+			(config.ClampS1        << 5) |
+			(config.ClampT1        << 6) |
+			(config.AlphaThreshold << 8);
+}
+
+static void UnpackShaderConfigFlags(ShaderConfiguration * config, u64 mux, u32 flags)
+{
+	memset(config, 0, sizeof(ShaderConfiguration));
+	config->Mux            = mux;
+	config->CycleType      = (flags >> 0) & 3;
+	config->BilerpFilter   = (flags >> 2) & 1;
+	config->ClampS0        = (flags >> 3) & 1;
+	config->ClampT0        = (flags >> 4) & 1;
+	config->ClampS1        = (flags >> 5) & 1;
+	config->ClampT1        = (flags >> 6) & 1;
+	config->AlphaThreshold = (flags >> 8) & 0xff;
+}
+
+static ShaderProgram * LoadShaderBinary(const ShaderConfiguration & config, GLenum format, const void * binary, GLsizei length)
+{
+	GLuint shader_program = glCreateProgram();
+	if (shader_program == 0)
+		return NULL;
+
+	glProgramBinary(shader_program, format, binary, length);
+
+	GLint program_ok = GL_FALSE;
+	glGetProgramiv(shader_program, GL_LINK_STATUS, &program_ok);
+	if (program_ok != GL_TRUE)
+	{
+		glDeleteProgram(shader_program);
+		return NULL;
+	}
+
+	ShaderProgram * program = new ShaderProgram;
+	InitShaderProgram(program, config, shader_program);
+	return program;
+}
+
+static void WarmShaderCache()
+{
+	IO::Filename name;
+	Dump_GetCacheDirectory(name, g_ROM.mFileName, ".gls");
+
+	FILE * fh = fopen(name, "rb");
+	if (fh == NULL)
+		return;
+
+	fseek(fh, 0, SEEK_END);
+	long file_size = ftell(fh);
+	fseek(fh, 0, SEEK_SET);
+
+	// The counts and lengths come straight from disk, so check they're plausible before
+	// allocating anything. If not, ignore the file - everything gets compiled on demand,
+	// and the file is rewritten on exit.
+	ShaderCacheHeader header;
+	if (fread(&header, sizeof(header), 1, fh) != 1 ||
+		header.Magic != kShaderCacheMagic ||
+		header.Version != kShaderCacheVersion ||
+		header.RomCRC[0] != g_ROM.mRomID.CRC[0] ||
+		header.RomCRC[1] != g_ROM.mRomID.CRC[1] ||
+		header.NumPrograms > kMaxCachedPrograms ||
+		header.NumPrograms * sizeof(ShaderCacheEntry) > u32(file_size) - sizeof(header))
+	{
+		gShaderCacheDirty = true;
+		fclose(fh);
+		return;
+	}
+
+	// Binaries from a different driver are useless, but the list of configurations still holds.
+	bool use_binaries = gProgramBinarySupported && header.DriverHash == gShaderCacheDriverHash;
+
+	u32 num_binaries = 0;
+	u32 num_compiled = 0;
+	std::vector<u8> binary;
+
+	for (u32 i = 0; i < header.NumPrograms; ++i)
+	{
+		// If the file is truncated or corrupt, keep what we've loaded and rewrite it on exit.
+		ShaderCacheEntry entry;
+		if (fread(&entry, sizeof(entry), 1, fh) != 1 ||
+			entry.BinaryLength > u32(file_size - ftell(fh)))
+		{
+			gShaderCacheDirty = true;
+			break;
+		}
+
+		binary.resize(entry.BinaryLength);
+		if (entry.BinaryLength > 0 && fread(&binary[0], entry.BinaryLength, 1, fh) != 1)
+		{
+			gShaderCacheDirty = true;
+			break;
+		}
+
+		ShaderConfiguration config;
+		UnpackShaderConfigFlags(&config, entry.Mux, entry.Flags);
+
+		if (gShaders.find(config) != gShaders.end())
+			continue;
+
+		ShaderProgram * program = NULL;
+		if (use_binaries && entry.BinaryLength > 0)
+		{
+			program = LoadShaderBinary(config, entry.BinaryFormat, &binary[0], entry.BinaryLength);
+			if (program != NULL)
+				++num_binaries;
+		}
+
+		if (program == NULL)
+		{
+			program = CompileShaderForConfig(config);
+			if (program == NULL)
+				continue;
+
+			// The binary needs regenerating.
+			gShaderCacheDirty = true;
+			++num_compiled;
+		}
+
+		gShaders[config] = program;
+	}
+
+	fclose(fh);
+
+#ifdef DAEDALUS_DEBUG_CONSOLE
+	DBGConsole_Msg(0, "Shader cache: %d programs from binaries, %d compiled from %s", num_binaries, num_compiled, name);
+#endif
+}
+
+static void FlushShaderCache()
+{
+	if (!gShaderCacheDirty)
+		return;
+
+	IO::Filename name;
+	Dump_GetCacheDirectory(name, g_ROM.mFileName, ".gls");
+
+	FILE * fh = fopen(name, "wb");
+	if (fh == NULL)
+		return;
+
+#ifdef DAEDALUS_DEBUG_CONSOLE
+	DBGConsole_Msg(0, "Write shader cache: %s", name);
+#endif
+
+	ShaderCacheHeader header;
+	header.Magic       = kShaderCacheMagic;
+	header.Version     = kShaderCacheVersion;
+	header.RomCRC[0]   = g_ROM.mRomID.CRC[0];
+	header.RomCRC[1]   = g_ROM.mRomID.CRC[1];
+	header.DriverHash  = gShaderCacheDriverHash;
+	header.NumPrograms = gShaders.size();
+	fwrite(&header, sizeof(header), 1, fh);
+
+	std::vector<u8> binary;
+
+	for (ShaderMap::const_iterator it = gShaders.begin(); it != gShaders.end(); ++it)
+	{
+		const ShaderProgram * program = it->second;
+
+		ShaderCacheEntry entry;
+		entry.Mux          = program->config.Mux;
+		entry.Flags        = PackShaderConfigFlags(program->config);
+		entry.BinaryFormat = 0;
+		entry.BinaryLength = 0;
+
+		if (gProgramBinarySupported)
+		{
+			GLint length = 0;
+			glGetProgramiv(program->program, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length > 0)
+			{
+				binary.resize(length);
+
+				GLenum format = 0;
+				glGetProgramBinary(program->program, length, &length, &format, &binary[0]);
+
+				entry.BinaryFormat = format;
+				entry.BinaryLength = length;
+			}
+		}
+
+		fwrite(&entry, sizeof(entry), 1, fh);
+		if (entry.BinaryLength > 0)
+			fwrite(&binary[0], entry.BinaryLength, 1, fh);
+	}
+
+	fclose(fh);
+	gShaderCacheDirty = false;
+}
+
+// The programs are only cached per rom, so they're thrown away when it's closed.
+static void DestroyShaders()
+{
+	FlushBatchedDraws();
+
+	for (ShaderMap::iterator it = gShaders.begin(); it != gShaders.end(); ++it)
+	{
+		glDeleteProgram(it->second->program);
+		delete it->second;
+	}
+	gShaders.clear();
+}
+
+enum BlendType
+{
+	kBlendModeOpaque,
+	kBlendModeAlphaTrans,
+	kBlendModeFade,
+};
+
+struct GLTextureState
+{
+	const CNativeTexture *	Texture;		// NULL if this stage isn't used
+	s32						ClampS, ClampT;
+	f32						ShiftS, ShiftT;
+	u32						MaskS, MaskT;
+	u32						MirrorS, MirrorT;
+	s32						TopLeftS, TopLeftT;
+	s32						BottomRightS, BottomRightT;
+	f32						ScaleS, ScaleT;
+	s32						Filter;
+	s32						WrapS, WrapT;
+};
+
+// Everything PrepareRenderState sends to GL. Consecutive draws with an
+// identical GLRenderState are merged into a single batch. This is memset
+// and compared with memcmp, so keep it free of anything with padding quirks.
+struct GLRenderState
+{
+	const ShaderProgram *	Program;
+	float					Projection[16];
+	f32						PrimColour[4];
+	f32						EnvColour[4];
+	f32						PrimLODFrac;
+	u32						Frame;
+	u8						DepthTest;
+	u8						DepthWrite;
+	u8						DecalOffset;
+	u8						Blend;
+	GLTextureState			Textures[kNumTextures];
+};
+
+static GLRenderState	gBatchState;
+static bool				gBatchStateValid = false;
+
+// Copies count elements into the ring buffer bound to target, returning the element offset they were written at.
+static u32 StreamToRing(GLenum target, u32 & ring_offset, u32 ring_size, const void * data, u32 count, u32 element_size)
+{
+	if (ring_offset + count > ring_size)
+	{
+		// Orphan the old storage - the driver hands us a fresh block while the GPU finishes with it.
+		glBufferData(target, ring_size * element_size, NULL, GL_STREAM_DRAW);
+		ring_offset = 0;
+	}
+
+	GLintptr	offset = ring_offset * element_size;
+	GLsizeiptr	length = count * element_size;
+
+	// Nothing in flight references this part of the buffer, so there's no need to synchronise.
+	void * dst = glMapBufferRange(target, offset, length,
+								  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst != NULL)
+	{
+		memcpy(dst, data, length);
+		glUnmapBuffer(target);
+	}
+	else
+	{
+		glBufferSubData(target, offset, length, data);
+	}
+
+	u32 start = ring_offset;
+	ring_offset += count;
+	return start;
+}
+
+static void FlushBatch()
+{
+	if (gNumBatchIndices == 0)
+		return;
+
+	DAEDALUS_PROFILE( "RendererGL::FlushBatch" );
+
+	glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+	u32 base_vertex = StreamToRing(GL_ARRAY_BUFFER, gVertexRingOffset, kVertexRingSize, gBatchVertices, gNumBatchVertices, sizeof(GLVertex));
+	u32 first_index = StreamToRing(GL_ELEMENT_ARRAY_BUFFER, gIndexRingOffset, kIndexRingSize, gBatchIndices, gNumBatchIndices, sizeof(u16));
+
+	glDrawElementsBaseVertex(GL_TRIANGLES, gNumBatchIndices, GL_UNSIGNED_SHORT,
+							 (const void *)(first_index * sizeof(u16)), base_vertex);
+
+	gNumBatchVertices = 0;
+	gNumBatchIndices = 0;
+}
+
+void FlushBatchedDraws()
+{
+	FlushBatch();
+	gBatchStateValid = false;
+}
+
+// Makes room for the vertices and indices in the batch, returning the index of the first vertex.
+static u32 ReserveBatch(u32 num_vertices, u32 num_indices)
+{
+	DAEDALUS_ASSERT(num_vertices <= kMaxBatchVertices && num_indices <= kMaxBatchIndices, "Too many vertices!");
+
+	if (gNumBatchVertices + num_vertices > kMaxBatchVertices ||
+		gNumBatchIndices + num_indices > kMaxBatchIndices)
+		FlushBatch();
+
+	u32 first = gNumBatchVertices;
+	gNumBatchVertices += num_vertices;
+	return first;
+}
+
+// Allocates vertices to be drawn as a plain triangle list.
+static GLVertex * AllocBatchVertices(u32 count)
+{
+	u32 first = ReserveBatch(count, count);
+
+	u16 * indices = &gBatchIndices[gNumBatchIndices];
+	for (u32 i = 0; i < count; ++i)
+		indices[i] = (u16)(first + i);
+	gNumBatchIndices += count;
+
+	return &gBatchVertices[first];
+}
+
+static void ApplyRenderState(const GLRenderState & state)
+{
+	if (state.DepthTest)	glEnable(GL_DEPTH_TEST);
+	else					glDisable(GL_DEPTH_TEST);
+
+	glDepthMask(state.DepthWrite ? GL_TRUE : GL_FALSE);
+
+	if (state.DecalOffset)	glPolygonOffset(-1.0, -1.0);
+	else					glPolygonOffset(0.0, 0.0);
+
+	switch (state.Blend)
+	{
+	case kBlendModeOpaque:
+		glDisable(GL_BLEND);
+		break;
+	case kBlendModeAlphaTrans:
+		glBlendColor(0.f, 0.f, 0.f, 0.f);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_BLEND);
+		break;
+	case kBlendModeFade:
+		glBlendColor(0.f, 0.f, 0.f, 0.f);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_BLEND);
+		break;
+	}
+
+	const ShaderProgram * program = state.Program;
+
+	glUseProgram(program->program);
+
+	glUniformMatrix4fv(program->uloc_project, 1, GL_FALSE, state.Projection);
+
+	glUniform4fv(program->uloc_primcol, 1, state.PrimColour);
+	glUniform4fv(program->uloc_envcol,  1, state.EnvColour);
+	glUniform1f(program->uloc_primlodfrac, state.PrimLODFrac);
+
+	glUniform1i(program->uloc_foo, state.Frame);
+
+	for (u32 i = 0; i < kNumTextures; ++i)
+	{
+		const GLTextureState & tex = state.Textures[i];
+		if (tex.Texture == NULL)
+			continue;
+
+		glActiveTexture(GL_TEXTURE0 + i);
+
+		tex.Texture->InstallTexture();
+
+		// NB: think this can be done just once per program.
+		glUniform1i(program->uloc_texture[i], i);
+
+		glUniform2i(program->uloc_tileclamp[i],  tex.ClampS,   tex.ClampT);
+		glUniform2f(program->uloc_tileshift[i],  tex.ShiftS,   tex.ShiftT);
+		glUniform2i(program->uloc_tilemask[i],   tex.MaskS,    tex.MaskT);
+		glUniform2i(program->uloc_tilemirror[i], tex.MirrorS,  tex.MirrorT);
+		glUniform2i(program->uloc_tiletl[i],     tex.TopLeftS, tex.TopLeftT);
+		glUniform2i(program->uloc_tilebr[i],     tex.BottomRightS, tex.BottomRightT);
+		glUniform2f(program->uloc_texscale[i],   tex.ScaleS,   tex.ScaleT);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tex.Filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, tex.Filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, tex.WrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, tex.WrapT);
+	}
+}
+
+// Applies state, unless it matches the batch we're building, in which case
+// subsequent vertices are just appended to it.
+static void SetRenderState(const GLRenderState & state)
+{
+	if (gBatchStateValid && memcmp(&state, &gBatchState, sizeof(GLRenderState)) == 0)
+		return;
+
+	FlushBatch();
+	ApplyRenderState(state);
+
+	memcpy(&gBatchState, &state, sizeof(GLRenderState));
+	gBatchStateValid = true;
+}
+
+RendererGL::RendererGL()
+{
+	// GL clips against the same projection (see sceGuSetMatrix), so the CPU clipper isn't needed.
+	mHardwareClipping = true;
+}
+
 void RendererGL::RestoreRenderStates()
 {
+	FlushBatchedDraws();
+
 	// Initialise the device to our default state
 
 	// No fog
@@ -641,49 +1178,91 @@ void RendererGL::RestoreRenderStates()
 	glEnable(GL_POLYGON_OFFSET_FILL);
 }
 
-// Strip out vertex stream into separate buffers.
-// TODO(strmnnrmn): Renderer should support generating this data directly.
-void RendererGL::RenderDaedalusVtx(int prim, const DaedalusVtx * vertices, int count)
+static void ConvertDaedalusVtx(GLVertex * out, const DaedalusVtx * vertices, u32 count)
 {
-	DAEDALUS_ASSERT(count <= kMaxVertices, "Too many vertices!");
-
-	// Avoid crashing in the unlikely even that our buffers aren't long enough.
-	if (count > kMaxVertices)
-		count = kMaxVertices;
-
 	// Hack to fix the sun in Zelda OOT/MM
 	const f32 scale = ( g_ROM.ZELDA_HACK &&(gRDPOtherMode.L == 0x0c184241) ) ? 16.f : 32.f;
 
-	for (int i = 0; i < count; ++i)
+	for (u32 i = 0; i < count; ++i)
 	{
 		const DaedalusVtx * vtx = &vertices[i];
 
-		gPositionBuffer[i][0] = vtx->Position.x;
-		gPositionBuffer[i][1] = vtx->Position.y;
-		gPositionBuffer[i][2] = vtx->Position.z;
+		out[i].Position[0] = vtx->Position.x;
+		out[i].Position[1] = vtx->Position.y;
+		out[i].Position[2] = vtx->Position.z;
 
 		// FIXME(strmnnrmn): maintain the texture coords in 10.5 format.
-		gTexCoordBuffer[i].s = (int)(vtx->Texture.x * scale);
-		gTexCoordBuffer[i].t = (int)(vtx->Texture.y * scale);
+		out[i].UV.s = (int)(vtx->Texture.x * scale);
+		out[i].UV.t = (int)(vtx->Texture.y * scale);
 
-		gColorBuffer[i] = vtx->Colour.GetColour();
+		out[i].Colour = vtx->Colour.GetColour();
 	}
+}
 
-	RenderDaedalusVtxStreams(prim, &gPositionBuffer[0][0], &gTexCoordBuffer[0], &gColorBuffer[0], count);
+// Convert the vertices straight into the interleaved batch buffer.
+// TODO(strmnnrmn): Renderer should support generating this data directly.
+void RendererGL::RenderDaedalusVtx(int prim, const DaedalusVtx * vertices, int count)
+{
+	DAEDALUS_ASSERT(prim == GL_TRIANGLES, "Only triangle lists can be batched");
+
+	// Avoid crashing in the unlikely even that our buffers aren't long enough.
+	if (count > (int)kMaxBatchVertices)
+		count = kMaxBatchVertices;
+
+	ConvertDaedalusVtx(AllocBatchVertices(count), vertices, count);
+}
+
+// Each vertex is converted once, and the indices rebased onto the batch.
+void RendererGL::RenderDaedalusVtxIndexed(const DaedalusVtx * vertices, u32 num_vertices, const u16 * indices, u32 num_indices)
+{
+	// Avoid crashing in the unlikely even that our buffers aren't long enough.
+	if (num_vertices > kMaxBatchVertices || num_indices > kMaxBatchIndices)
+		return;
+
+	u32 first = ReserveBatch(num_vertices, num_indices);
+
+	ConvertDaedalusVtx(&gBatchVertices[first], vertices, num_vertices);
+
+	u16 * out = &gBatchIndices[gNumBatchIndices];
+	for (u32 i = 0; i < num_indices; ++i)
+		out[i] = (u16)(first + indices[i]);
+	gNumBatchIndices += num_indices;
 }
 
+// Strips and fans are expanded to triangle lists, so they can share a batch with everything else.
 void RendererGL::RenderDaedalusVtxStreams(int prim, const float * positions, const TexCoord * uvs, const u32 * colours, int count)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kPositionBuffer]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 3 * count, positions);
+	DAEDALUS_ASSERT(prim == GL_TRIANGLE_STRIP || prim == GL_TRIANGLE_FAN, "Unhandled primitive type");
 
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kTexCoordBuffer]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TexCoord) * count, uvs);
+	if (count < 3)
+		return;
 
-	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kColorBuffer]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(u32) * count, colours);
+	u32 num_triangles = count - 2;
+	GLVertex * out = AllocBatchVertices(num_triangles * 3);
 
-	glDrawArrays(prim, 0, count);
+	for (u32 t = 0; t < num_triangles; ++t)
+	{
+		u32 idx[3];
+		if (prim == GL_TRIANGLE_FAN)
+		{
+			idx[0] = 0;		idx[1] = t + 1;		idx[2] = t + 2;
+		}
+		else
+		{
+			idx[0] = t;		idx[1] = t + 1;		idx[2] = t + 2;
+		}
+
+		for (u32 v = 0; v < 3; ++v)
+		{
+			u32 i = idx[v];
+			out->Position[0] = positions[i*3+0];
+			out->Position[1] = positions[i*3+1];
+			out->Position[2] = positions[i*3+2];
+			out->UV          = uvs[i];
+			out->Colour      = colours[i];
+			++out;
+		}
+	}
 }
 
 /*
@@ -741,7 +1320,7 @@ static inline void DebugBlender(u32 cycle_type, u32 blender, u32 alpha_cvg_sel,
 }
 #endif
 
-static void InitBlenderMode()
+static BlendType GetBlendMode()
 {
 	u32 cycle_type    = gRDPOtherMode.cycle_type;
 	u32 cvg_x_alpha   = gRDPOtherMode.cvg_x_alpha;
@@ -751,12 +1330,6 @@ static void InitBlenderMode()
 	// NB: If we're running in 1cycle mode, ignore the 2nd cycle.
 	u32 active_mode = (cycle_type == CYCLE_2CYCLE) ? blendmode : (blendmode & 0xcccc);
 
-	enum BlendType
-	{
-		kBlendModeOpaque,
-		kBlendModeAlphaTrans,
-		kBlendModeFade,
-	};
 	BlendType type = kBlendModeOpaque;
 
 	// FIXME(strmnnrmn): lots of these need fog!
@@ -849,24 +1422,7 @@ static void InitBlenderMode()
 	if (type == kBlendModeAlphaTrans && !have_alpha)
 		type = kBlendModeOpaque;
 
-	switch (type)
-	{
-	case kBlendModeOpaque:
-		glDisable(GL_BLEND);
-		break;
-	case kBlendModeAlphaTrans:
-		glBlendColor(0.f, 0.f, 0.f, 0.f);
-		glBlendEquation(GL_FUNC_ADD);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable(GL_BLEND);
-		break;
-	case kBlendModeFade:
-		glBlendColor(0.f, 0.f, 0.f, 0.f);
-		glBlendEquation(GL_FUNC_ADD);
-		glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable(GL_BLEND);
-		break;
-	}
+	return type;
 }
 
 
@@ -880,51 +1436,32 @@ inline u32 MakeMirror(u32 mirror, u32 m)
 	return (mirror && m) ? (1<<m) : 0;
 }
 
-void RendererGL::PrepareRenderState(const float (&mat_project)[16], bool disable_zbuffer)
+bool RendererGL::MakeRenderState(GLRenderState * state, const float (&mat_project)[16], bool disable_zbuffer) const
 {
-	DAEDALUS_PROFILE( "RendererGL::PrepareRenderState" );
+	DAEDALUS_PROFILE( "RendererGL::MakeRenderState" );
 
-	if ( disable_zbuffer )
-	{
-		glDisable(GL_DEPTH_TEST);
-		glDepthMask(GL_FALSE);
-	}
-	else
+	memset(state, 0, sizeof(GLRenderState));
+
+	if ( !disable_zbuffer )
 	{
 		// Decal mode
-		if( gRDPOtherMode.zmode == 3 )
-		{
-			glPolygonOffset(-1.0, -1.0);
-		}
-		else
-		{
-			glPolygonOffset(0.0, 0.0);
-		}
+		state->DecalOffset = gRDPOtherMode.zmode == 3;
 
 		// Enable or Disable ZBuffer test
-		if ( (mTnL.Flags.Zbuffer & gRDPOtherMode.z_cmp) | gRDPOtherMode.z_upd )
-		{
-			glEnable(GL_DEPTH_TEST);
-		}
-		else
-		{
-			glDisable(GL_DEPTH_TEST);
-		}
-
-		glDepthMask(gRDPOtherMode.z_upd ? GL_TRUE : GL_FALSE);
+		state->DepthTest  = ((mTnL.Flags.Zbuffer & gRDPOtherMode.z_cmp) | gRDPOtherMode.z_upd) != 0;
+		state->DepthWrite = gRDPOtherMode.z_upd != 0;
 	}
 
-
 	u32 cycle_mode = gRDPOtherMode.cycle_type;
 
 	// Initiate Blender
 	if(cycle_mode < CYCLE_COPY && gRDPOtherMode.force_bl)
 	{
-		InitBlenderMode();
+		state->Blend = GetBlendMode();
 	}
 	else
 	{
-		glDisable(GL_BLEND);
+		state->Blend = kBlendModeOpaque;
 	}
 
 	ShaderConfiguration config;
@@ -935,16 +1472,21 @@ void RendererGL::PrepareRenderState(const float (&mat_project)[16], bool disable
 	{
 		// There must have been some failure to compile the shader. Abort!
 		DBGConsole_Msg(0, "Couldn't generate a shader for mux %llx, cycle %d, alpha %d\n", config.Mux, config.CycleType, config.AlphaThreshold);
-		return;
+		return false;
 	}
 
-	glUseProgram(program->program);
-
-	glUniformMatrix4fv(program->uloc_project, 1, GL_FALSE, mat_project);
+	state->Program = program;
+	memcpy(state->Projection, mat_project, sizeof(state->Projection));
 
-	glUniform4f(program->uloc_primcol, mPrimitiveColour.GetRf(), mPrimitiveColour.GetGf(), mPrimitiveColour.GetBf(), mPrimitiveColour.GetAf());
-	glUniform4f(program->uloc_envcol,  mEnvColour.GetRf(),       mEnvColour.GetGf(),       mEnvColour.GetBf(),       mEnvColour.GetAf());
-	glUniform1f(program->uloc_primlodfrac, mPrimLODFraction);
+	state->PrimColour[0] = mPrimitiveColour.GetRf();
+	state->PrimColour[1] = mPrimitiveColour.GetGf();
+	state->PrimColour[2] = mPrimitiveColour.GetBf();
+	state->PrimColour[3] = mPrimitiveColour.GetAf();
+	state->EnvColour[0]  = mEnvColour.GetRf();
+	state->EnvColour[1]  = mEnvColour.GetGf();
+	state->EnvColour[2]  = mEnvColour.GetBf();
+	state->EnvColour[3]  = mEnvColour.GetAf();
+	state->PrimLODFrac   = mPrimLODFraction;
 
 	// Second texture is sampled in 2 cycle mode if text_lod is clear (when set,
 	// gRDPOtherMode.text_lod enables mipmapping, but we just set lod_frac to 0.
@@ -953,7 +1495,7 @@ void RendererGL::PrepareRenderState(const float (&mat_project)[16], bool disable
 	bool install_textures[] = { true, use_t1 };
 
 extern u32 gRDPFrame;
-	glUniform1i(program->uloc_foo, gRDPFrame);
+	state->Frame = gRDPFrame;
 
 	for (u32 i = 0; i < kNumTextures; ++i)
 	{
@@ -964,57 +1506,81 @@ extern u32 gRDPFrame;
 
 		if (texture != NULL)
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
-
-			texture->InstallTexture();
+			GLTextureState & tex = state->Textures[i];
 
 			u8 tile_idx = mActiveTile[i];
 			const RDP_Tile &     rdp_tile  = gRDPStateManager.GetTile( tile_idx );
 			const RDP_TileSize & tile_size = gRDPStateManager.GetTileSize( tile_idx );
 
-			// NB: think this can be done just once per program.
-			glUniform1i(program->uloc_texture[i], i);
-
-			bool clamp_s = rdp_tile.clamp_s || (rdp_tile.mask_s == 0);
-			bool clamp_t = rdp_tile.clamp_t || (rdp_tile.mask_t == 0);
+			tex.Texture = texture;
 
-			u32 mirror_bits_s = MakeMirror(rdp_tile.mirror_s, rdp_tile.mask_s);
-			u32 mirror_bits_t = MakeMirror(rdp_tile.mirror_t, rdp_tile.mask_t);
+			tex.ClampS = rdp_tile.clamp_s || (rdp_tile.mask_s == 0);
+			tex.ClampT = rdp_tile.clamp_t || (rdp_tile.mask_t == 0);
 
-			u32 mask_bits_s = MakeMask(rdp_tile.mask_s);
-			u32 mask_bits_t = MakeMask(rdp_tile.mask_t);
+			tex.ShiftS = kShiftScales[rdp_tile.shift_s];
+			tex.ShiftT = kShiftScales[rdp_tile.shift_t];
 
-			glUniform2i(program->uloc_tileclamp[i], clamp_s, clamp_t);
+			tex.MaskS = MakeMask(rdp_tile.mask_s);
+			tex.MaskT = MakeMask(rdp_tile.mask_t);
 
-			glUniform2f(program->uloc_tileshift[i],  kShiftScales[rdp_tile.shift_s],  kShiftScales[rdp_tile.shift_t]);
-			glUniform2i(program->uloc_tilemask[i],   mask_bits_s,   mask_bits_t);
-			glUniform2i(program->uloc_tilemirror[i], mirror_bits_s, mirror_bits_t);
+			tex.MirrorS = MakeMirror(rdp_tile.mirror_s, rdp_tile.mask_s);
+			tex.MirrorT = MakeMirror(rdp_tile.mirror_t, rdp_tile.mask_t);
 
-			glUniform2i(program->uloc_tiletl[i], mTileTopLeft[i].s, mTileTopLeft[i].t);
-			glUniform2i(program->uloc_tilebr[i], tile_size.right,   tile_size.bottom);
+			tex.TopLeftS     = mTileTopLeft[i].s;
+			tex.TopLeftT     = mTileTopLeft[i].t;
+			tex.BottomRightS = tile_size.right;
+			tex.BottomRightT = tile_size.bottom;
 
-			glUniform2f(program->uloc_texscale[i], 1.f / texture->GetCorrectedWidth(), 1.f / texture->GetCorrectedHeight());
+			tex.ScaleS = 1.f / texture->GetCorrectedWidth();
+			tex.ScaleT = 1.f / texture->GetCorrectedHeight();
 
 			if( (gRDPOtherMode.text_filt != G_TF_POINT) | (gGlobalPreferences.ForceLinearFilter) )
 			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				tex.Filter = GL_LINEAR;
 			}
 			else
 			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+				tex.Filter = GL_NEAREST;
 			}
 
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mTexWrap[i].u);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mTexWrap[i].v);
+			tex.WrapS = mTexWrap[i].u;
+			tex.WrapT = mTexWrap[i].v;
 		}
 	}
+
+	return true;
+}
+
+void RendererGL::PrepareRenderState(const float (&mat_project)[16], bool disable_zbuffer)
+{
+	DAEDALUS_PROFILE( "RendererGL::PrepareRenderState" );
+
+	GLRenderState state;
+	if (MakeRenderState(&state, mat_project, disable_zbuffer))
+	{
+		SetRenderState(state);
+	}
 }
 
 // FIXME(strmnnrmn): for fill/copy modes this does more work than needed.
 // It ends up copying colour/uv coords when not needed, and can use a shader uniform for the fill colour.
 void RendererGL::RenderTriangles( DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer )
+{
+	ApplyTexGenScale( p_vertices, num_vertices );
+
+	PrepareRenderState(gProjection.m, disable_zbuffer);
+	RenderDaedalusVtx(GL_TRIANGLES, p_vertices, num_vertices);
+}
+
+void RendererGL::RenderTrianglesIndexed( DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer )
+{
+	ApplyTexGenScale( p_vertices, num_vertices );
+
+	PrepareRenderState(gProjection.m, disable_zbuffer);
+	RenderDaedalusVtxIndexed(p_vertices, num_vertices, indices, num_indices);
+}
+
+void RendererGL::ApplyTexGenScale( DaedalusVtx * p_vertices, u32 num_vertices )
 {
 	if (mTnL.Flags.Texture)
 	{
@@ -1041,9 +1607,6 @@ void RendererGL::RenderTriangles( DaedalusVtx * p_vertices, u32 num_vertices, bo
 			}
 		}
 	}
-
-	PrepareRenderState(gProjection.m, disable_zbuffer);
-	RenderDaedalusVtx(GL_TRIANGLES, p_vertices, num_vertices);
 }
 
 void RendererGL::TexRect( u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1 )
@@ -1195,13 +1758,19 @@ void RendererGL::Draw2DTexture(f32 x0, f32 y0, f32 x1, f32 y1,
 	// FIXME(strmnnrmn): is this right? Gross anyway.
 	gRDPOtherMode.cycle_type = CYCLE_COPY;
 
-	PrepareRenderState(mScreenToDevice.mRaw, false /* disable_depth */);
+	// NB: the overrides go into the state rather than straight to GL, so batching still sees them.
+	GLRenderState state;
+	if (MakeRenderState(&state, mScreenToDevice.mRaw, false /* disable_depth */))
+	{
+		state.Blend = kBlendModeAlphaTrans;
+
+		GLTextureState & tex = state.Textures[0];
+		tex.Filter = GL_LINEAR;
+		tex.WrapS  = GL_CLAMP_TO_EDGE;
+		tex.WrapT  = GL_CLAMP_TO_EDGE;
 
-	glEnable(GL_BLEND);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		SetRenderState(state);
+	}
 
 	float sx0 = N64ToScreenX(x0);
 	float sy0 = N64ToScreenY(y0);
@@ -1246,13 +1815,19 @@ void RendererGL::Draw2DTextureR(f32 x0, f32 y0,
 	// FIXME(strmnnrmn): is this right? Gross anyway.
 	gRDPOtherMode.cycle_type = CYCLE_COPY;
 
-	PrepareRenderState(mScreenToDevice.mRaw, false /* disable_depth */);
+	// NB: the overrides go into the state rather than straight to GL, so batching still sees them.
+	GLRenderState state;
+	if (MakeRenderState(&state, mScreenToDevice.mRaw, false /* disable_depth */))
+	{
+		state.Blend = kBlendModeAlphaTrans;
 
-	glEnable(GL_BLEND);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GLTextureState & tex = state.Textures[0];
+		tex.Filter = GL_LINEAR;
+		tex.WrapS  = GL_CLAMP_TO_EDGE;
+		tex.WrapT  = GL_CLAMP_TO_EDGE;
+
+		SetRenderState(state);
+	}
 
 	const f32 depth = 0.0f;
 
@@ -1283,13 +1858,25 @@ void RendererGL::Draw2DTextureR(f32 x0, f32 y0,
 bool CreateRenderer()
 {
 	DAEDALUS_ASSERT_Q(gRenderer == NULL);
+#ifdef DAEDALUS_LINUX
+	if (gVideoOutput == VO_NULL)
+	{
+		gRenderer = new RendererNull();
+		return true;
+	}
+#endif
 	gRendererGL = new RendererGL();
 	gRenderer   = gRendererGL;
+
+	WarmShaderCache();
 	return true;
 }
 void DestroyRenderer()
 {
-	delete gRendererGL;
+	FlushShaderCache();
+	DestroyShaders();
+
+	delete gRenderer;
 	gRendererGL = NULL;
 	gRenderer   = NULL;
 }
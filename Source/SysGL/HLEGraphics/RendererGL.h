@@ -6,9 +6,12 @@
 class RendererGL : public BaseRenderer
 {
 public:
+	RendererGL();
+
 	virtual void		RestoreRenderStates();
 
 	virtual void		RenderTriangles(DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer);
+	virtual void		RenderTrianglesIndexed(DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer);
 
 	virtual void		TexRect(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
 	virtual void		TexRectFlip(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
@@ -23,9 +26,13 @@ public:
 private:
 	void 				MakeShaderConfigFromCurrentState(struct ShaderConfiguration * config) const;
 
+	bool 				MakeRenderState(struct GLRenderState * state, const float (&mat_project)[16], bool disable_zbuffer) const;
 	void 				PrepareRenderState(const float (&mat_project)[16], bool disable_zbuffer);
 
+	void				ApplyTexGenScale(DaedalusVtx * p_vertices, u32 num_vertices);
+
 	void 				RenderDaedalusVtx(int prim, const DaedalusVtx * vertices, int count);
+	void 				RenderDaedalusVtxIndexed(const DaedalusVtx * vertices, u32 num_vertices, const u16 * indices, u32 num_indices);
 	void 				RenderDaedalusVtxStreams(int prim, const float * positions, const TexCoord * uvs, const u32 * colours, int count);
 };
 
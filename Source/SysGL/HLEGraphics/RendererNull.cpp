@@ -0,0 +1,36 @@
+#include "stdafx.h"
+
+#include "SysGL/HLEGraphics/RendererNull.h"
+
+RendererNull::RendererNull()
+{
+	// Do the same CPU work as RendererGL, which leaves clipping to the hardware.
+	mHardwareClipping = true;
+}
+
+// Textures are still decoded and uploaded, as that's part of the cost we want to measure.
+void RendererNull::RenderTriangles(DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer)
+{
+	if (mTnL.Flags.Texture)
+	{
+		UpdateTileSnapshots( mTextureTile );
+	}
+}
+
+void RendererNull::RenderTrianglesIndexed(DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer)
+{
+	if (mTnL.Flags.Texture)
+	{
+		UpdateTileSnapshots( mTextureTile );
+	}
+}
+
+void RendererNull::TexRect(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1)
+{
+	UpdateTileSnapshots( tile_idx );
+}
+
+void RendererNull::TexRectFlip(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1)
+{
+	UpdateTileSnapshots( tile_idx );
+}
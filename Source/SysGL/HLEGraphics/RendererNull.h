@@ -0,0 +1,29 @@
+#ifndef SYSGL_HLEGRAPHICS_RENDERERNULL_H_
+#define SYSGL_HLEGRAPHICS_RENDERERNULL_H_
+
+#include "HLEGraphics/BaseRenderer.h"
+
+// Runs display lists through the parser, transform and texture cache as usual,
+// but never submits anything to the GPU. Used to benchmark the CPU side of emulation.
+class RendererNull : public BaseRenderer
+{
+public:
+	RendererNull();
+
+	virtual void		RestoreRenderStates()		{}
+
+	virtual void		RenderTriangles(DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer);
+	virtual void		RenderTrianglesIndexed(DaedalusVtx * p_vertices, u32 num_vertices, const u16 * indices, u32 num_indices, bool disable_zbuffer);
+
+	virtual void		TexRect(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
+	virtual void		TexRectFlip(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
+	virtual void		FillRect(const v2 & xy0, const v2 & xy1, u32 color)		{}
+
+	virtual void		Draw2DTexture(f32 x0, f32 y0, f32 x1, f32 y1,
+									  f32 u0, f32 v0, f32 u1, f32 v1, const CNativeTexture * texture)	{}
+	virtual void		Draw2DTextureR(f32 x0, f32 y0, f32 x1, f32 y1,
+									   f32 x2, f32 y2, f32 x3, f32 y3,
+									   f32 s, f32 t)		{}
+};
+
+#endif // SYSGL_HLEGRAPHICS_RENDERERNULL_H_
@@ -1038,7 +1038,7 @@ CJumpLocation CCodeGeneratorPSP::GenerateExitCode( u32 exit_address, u32 jump_ad
 
 		// Check if we're ok to continue, without flushing any registers
 		GetVar( PspReg_V0, &gCPUState.CPUControl[C0_COUNT]._u32 );
-		GetVar( PspReg_A0, (const u32*)&gCPUState.Events[0].mCount );
+		GetVar( PspReg_A0, (const u32*)&gCPUState.NextEvent.mCount );
 
 		//
 		//	Pull in any registers which may have been flushed for whatever reason.
@@ -1071,7 +1071,7 @@ CJumpLocation CCodeGeneratorPSP::GenerateExitCode( u32 exit_address, u32 jump_ad
 		//
 		ADDIU( PspReg_A0, PspReg_A0, -s16(num_instructions) );
 		BGTZ( PspReg_A0, mLoopTop, false );
-		SetVar( (u32*)&gCPUState.Events[0].mCount, PspReg_A0 );	// ASSUMES store is done in just a single op.
+		SetVar( (u32*)&gCPUState.NextEvent.mCount, PspReg_A0 );	// ASSUMES store is done in just a single op.
 
 		FlushAllRegisters( mRegisterCache, true );
 
@@ -126,7 +126,9 @@ class CGraphicsPluginImpl : public CGraphicsPlugin
 		virtual bool		StartEmulation()		{ return true; }
 		virtual void		ViStatusChanged()		{}
 		virtual void		ViWidthChanged()		{}
-		virtual void		ProcessDList();
+		virtual EProcessResult	ProcessDList();
+		virtual void		WaitForDisplayLists()	{}
+		virtual void		RenderFrameBuffer( u32 origin )	{}
 
 		virtual void		UpdateScreen();
 
@@ -157,7 +159,7 @@ bool CGraphicsPluginImpl::Initialise()
 	return true;
 }
 
-void CGraphicsPluginImpl::ProcessDList()
+EProcessResult CGraphicsPluginImpl::ProcessDList()
 {
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	if (!DLDebugger_Process())
@@ -167,6 +169,7 @@ void CGraphicsPluginImpl::ProcessDList()
 #else
 	DLParser_Process();
 #endif
+	return PR_COMPLETED;
 }
 
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
@@ -65,6 +65,19 @@ namespace IO
 		{
 			return sceIoGetstat ( p_file, stat );
 		}
+
+		bool	GetSizeAndTime( const char * p_file, u64 * p_size, u64 * p_time )
+		{
+			SceIoStat s;
+			if ( sceIoGetstat( p_file, &s ) < 0 )
+				return false;
+
+			const ScePspDateTime & t( s.st_mtime );
+			*p_size = s.st_size;
+			*p_time = (u64(t.year) << 48) | (u64(t.month) << 40) | (u64(t.day) << 32) |
+					  (u64(t.hour) << 24) | (u64(t.minute) << 16) | (u64(t.second) << 8);
+			return true;
+		}
 	}
 	namespace Directory
 	{
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SYSPSP_UTILITY_JOBMANAGER_H_
 
 #include "Utility/DaedalusTypes.h"
+#include "Utility/Job.h"
 
 
 enum ETaskMode
@@ -32,17 +33,6 @@ enum ETaskMode
 	TM_ASYNC_ME,	// Asynchronous on ME
 };
 
-class SJob;
-typedef int (*JobFunction)( SJob * job );
-
-class SJob
-{
-public:
-	JobFunction			InitJob;
-	JobFunction			DoJob;
-	JobFunction			FiniJob;
-};
-
 class CJobManager
 {
 public:
@@ -283,6 +283,8 @@ static void	DumpDynarecStats( float elapsed_time )
 	extern u32 gTotalRegistersUncached;
 	extern u32 gFragmentLookupSuccess;
 	extern u32 gFragmentLookupFailure;
+	extern u32 gTLBLookupHit;
+	extern u32 gTLBLookupMiss;
 
 	u32		dynarec_ratio( 0 );
 
@@ -312,13 +314,15 @@ static void	DumpDynarecStats( float elapsed_time )
 	printf( TERMINAL_SAVE_CURSOR );
 	printf( TERMINAL_TOP_LEFT );
 
-	printf( "Frame: %dms, DynaRec %d%%, Regs cached %d%%, Lookup success %d/%d", u32(elapsed_time * 1000.0f), dynarec_ratio, cached_regs_ratio, gFragmentLookupSuccess, gFragmentLookupFailure );
+	printf( "Frame: %dms, DynaRec %d%%, Regs cached %d%%, Lookup success %d/%d, TLB hit %d/%d", u32(elapsed_time * 1000.0f), dynarec_ratio, cached_regs_ratio, gFragmentLookupSuccess, gFragmentLookupFailure, gTLBLookupHit, gTLBLookupMiss );
 
 	printf( TERMINAL_RESTORE_CURSOR );
 	fflush( stdout );
 
 	gFragmentLookupSuccess = 0;
 	gFragmentLookupFailure = 0;
+	gTLBLookupHit = 0;
+	gTLBLookupMiss = 0;
 }
 #endif
 
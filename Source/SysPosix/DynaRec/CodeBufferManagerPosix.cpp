@@ -22,10 +22,28 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stdlib.h>
 
-class CCodeBufferManagerOSX : public CCodeBufferManager
+#ifdef DAEDALUS_ENABLE_DYNAREC
+
+#include <sys/mman.h>
+
+#include "Debug/DBGConsole.h"
+#include "SysPosix/DynaRec/x64/CodeGeneratorX64.h"
+
+// We reserve a large range of address space up front, as we can't move code
+// once it's been generated (this would mess up all the existing jumps).
+// MAP_NORESERVE means pages are only backed by memory once they're touched.
+static const u32		CODE_BUFFER_SIZE = 512 * 1024 * 1024;
+
+// We assume that no single fragment will generate more than this amount of code.
+// Traces are capped in length, so this is generous.
+static const u32		MAX_BLOCK_SIZE = 512 * 1024;
+
+class CCodeBufferManagerPosix : public CCodeBufferManager
 {
 public:
-	CCodeBufferManagerOSX()
+	CCodeBufferManagerPosix()
+		:	mpBuffer( nullptr )
+		,	mBufferPtr( 0 )
 	{
 	}
 
@@ -35,37 +53,147 @@ public:
 
 	virtual CCodeGenerator *StartNewBlock();
 	virtual u32				FinaliseCurrentBlock();
+
+private:
+	u8 *					mpBuffer;
+	u32						mBufferPtr;
+
+	CAssemblyBuffer			mPrimaryBuffer;
 };
 
+//*****************************************************************************
+//
+//*****************************************************************************
 CCodeBufferManager * CCodeBufferManager::Create()
 {
-	return new CCodeBufferManagerOSX;
+	return new CCodeBufferManagerPosix;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool CCodeBufferManagerPosix::Initialise()
+{
+	void * p_buffer = mmap( nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+	if( p_buffer == MAP_FAILED )
+	{
+		#ifdef DAEDALUS_DEBUG_CONSOLE
+		DBGConsole_Msg( 0, "Unable to allocate dynarec buffer" );
+		#endif
+		return false;
+	}
+
+	mpBuffer = static_cast< u8 * >( p_buffer );
+	mBufferPtr = 0;
+
+	return true;
 }
 
-bool CCodeBufferManagerOSX::Initialise()
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeBufferManagerPosix::Reset()
+{
+	mBufferPtr = 0;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeBufferManagerPosix::Finalise()
+{
+	if( mpBuffer != nullptr )
+	{
+		munmap( mpBuffer, CODE_BUFFER_SIZE );
+		mpBuffer = nullptr;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeGenerator * CCodeBufferManagerPosix::StartNewBlock()
+{
+	// Round up to 16 byte boundry
+	u32 aligned_ptr( (mBufferPtr + 15) & (~15) );
+
+	u32	padding( aligned_ptr - mBufferPtr );
+	if( padding > 0 )
+	{
+		memset( mpBuffer + mBufferPtr, 0xcc, padding );		// 0xcc is 'int 3'
+	}
+
+	mBufferPtr = aligned_ptr;
+
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( mBufferPtr + MAX_BLOCK_SIZE <= CODE_BUFFER_SIZE, "Out of space in the dynarec buffer" );
+	#endif
+
+	mPrimaryBuffer.SetBuffer( mpBuffer + mBufferPtr );
+
+	return new CCodeGeneratorX64( &mPrimaryBuffer );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 CCodeBufferManagerPosix::FinaliseCurrentBlock()
+{
+	u32		main_block_size( mPrimaryBuffer.GetSize() );
+
+	mBufferPtr += main_block_size;
+
+	return main_block_size;
+}
+
+#else
+
+class CCodeBufferManagerPosix : public CCodeBufferManager
+{
+public:
+	CCodeBufferManagerPosix()
+	{
+	}
+
+	virtual bool			Initialise();
+	virtual void			Reset();
+	virtual void			Finalise();
+
+	virtual CCodeGenerator *StartNewBlock();
+	virtual u32				FinaliseCurrentBlock();
+};
+
+CCodeBufferManager * CCodeBufferManager::Create()
+{
+	return new CCodeBufferManagerPosix;
+}
+
+bool CCodeBufferManagerPosix::Initialise()
 {
 	DAEDALUS_ASSERT(false, "Unimplemented");
 	return true;
 }
 
-void CCodeBufferManagerOSX::Reset()
+void CCodeBufferManagerPosix::Reset()
 {
 	DAEDALUS_ASSERT(false, "Unimplemented");
 }
 
-void CCodeBufferManagerOSX::Finalise()
+void CCodeBufferManagerPosix::Finalise()
 {
 	DAEDALUS_ASSERT(false, "Unimplemented");
 }
 
-CCodeGenerator * CCodeBufferManagerOSX::StartNewBlock()
+CCodeGenerator * CCodeBufferManagerPosix::StartNewBlock()
 {
 	DAEDALUS_ASSERT(false, "Unimplemented");
 	return NULL;
 }
 
-u32 CCodeBufferManagerOSX::FinaliseCurrentBlock()
+u32 CCodeBufferManagerPosix::FinaliseCurrentBlock()
 {
 	DAEDALUS_ASSERT(false, "Unimplemented");
 	return 0;
 }
+
+#endif // DAEDALUS_ENABLE_DYNAREC
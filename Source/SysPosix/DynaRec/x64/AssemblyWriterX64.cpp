@@ -0,0 +1,541 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "SysPosix/DynaRec/x64/AssemblyWriterX64.h"
+
+//*****************************************************************************
+//	Emit a REX prefix if one is needed. force is used for byte accesses to
+//	spl/bpl/sil/dil, which otherwise encode as ah/ch/dh/bh
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitREX( bool is64, u32 reg, u32 index, u32 base, bool force )
+{
+	u8 rex = 0x40;
+
+	if( is64 )			rex |= 0x08;
+	if( reg & 8 )		rex |= 0x04;
+	if( index & 8 )		rex |= 0x02;
+	if( base & 8 )		rex |= 0x01;
+
+	if( rex != 0x40 || force )
+	{
+		EmitBYTE( rex );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_Reg( u32 reg, u32 rm )
+{
+	EmitBYTE( 0xc0 | ((reg & 7) << 3) | (rm & 7) );
+}
+
+//*****************************************************************************
+//	[r15 + disp]. The low bits of r15 don't clash with the SIB escape, so
+//	no SIB byte is needed
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_Var( u32 reg, const void * p_var )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( mpStateBase != nullptr, "No state base has been set" );
+	#endif
+
+	s64		offset( reinterpret_cast< const u8 * >( p_var ) - mpStateBase );
+
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( offset == s32( offset ), "Variable is too far from the state base" );
+	#endif
+
+	if( offset >= -128 && offset <= 127 )
+	{
+		EmitBYTE( 0x40 | ((reg & 7) << 3) | (R15_CODE & 7) );
+		EmitBYTE( u8( offset ) );
+	}
+	else
+	{
+		EmitBYTE( 0x80 | ((reg & 7) << 3) | (R15_CODE & 7) );
+		EmitDWORD( u32( offset ) );
+	}
+}
+
+//*****************************************************************************
+//	[base + idx]
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_BaseIdx( u32 reg, EIntelReg base, EIntelReg idx )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( idx != RSP_CODE, "rsp can't be used as an index" );
+	#endif
+
+	// rbp/r13 as a base with mod 00 means disp32 with no base, so use a zero disp8
+	bool	needs_disp( (base & 7) == RBP_CODE );
+
+	EmitBYTE( (needs_disp ? 0x44 : 0x04) | ((reg & 7) << 3) );
+	EmitBYTE( ((idx & 7) << 3) | (base & 7) );
+	if( needs_disp )
+	{
+		EmitBYTE( 0x00 );
+	}
+}
+
+//*****************************************************************************
+//	op	reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::ALU_RR( u8 opcode, EIntelReg reg1, EIntelReg reg2, bool is64 )
+{
+	EmitREX( is64, reg2, 0, reg1 );
+	EmitBYTE( opcode );
+	EmitModRM_Reg( reg2, reg1 );
+}
+
+//*****************************************************************************
+//	op	reg, imm (using the short form where possible)
+//*****************************************************************************
+void	CAssemblyWriterX64::ALU_RI( u8 ext, EIntelReg reg, s32 data, bool is64 )
+{
+	EmitREX( is64, 0, 0, reg );
+	if( data >= -128 && data <= 127 )
+	{
+		EmitBYTE( 0x83 );
+		EmitModRM_Reg( ext, reg );
+		EmitBYTE( u8( data ) );
+	}
+	else
+	{
+		EmitBYTE( 0x81 );
+		EmitModRM_Reg( ext, reg );
+		EmitDWORD( u32( data ) );
+	}
+}
+
+//*****************************************************************************
+//	op	reg, [r15 + var]
+//*****************************************************************************
+void	CAssemblyWriterX64::ALU_RV( u8 opcode, EIntelReg reg, const void * p_var, bool is64 )
+{
+	EmitREX( is64, reg, 0, R15_CODE );
+	EmitBYTE( opcode );
+	EmitModRM_Var( reg, p_var );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SHIFT_I( u8 ext, EIntelReg reg, u8 sa, bool is64 )
+{
+	EmitREX( is64, 0, 0, reg );
+	EmitBYTE( 0xc1 );
+	EmitModRM_Reg( ext, reg );
+	EmitBYTE( sa );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SHIFT_CL( u8 ext, EIntelReg reg, bool is64 )
+{
+	EmitREX( is64, 0, 0, reg );
+	EmitBYTE( 0xd3 );
+	EmitModRM_Reg( ext, reg );
+}
+
+//*****************************************************************************
+//	movsx/movzx	reg32, [base + idx]
+//*****************************************************************************
+void	CAssemblyWriterX64::LOAD_EXT_BASE_IDX( u8 opcode, EIntelReg reg, EIntelReg base, EIntelReg idx )
+{
+	EmitREX( false, reg, idx, base );
+	EmitBYTE( 0x0f );
+	EmitBYTE( opcode );
+	EmitModRM_BaseIdx( reg, base, idx );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV( EIntelReg reg1, EIntelReg reg2, bool is64 )
+{
+	if( reg1 != reg2 || !is64 )
+	{
+		ALU_RR( 0x89, reg1, reg2, is64 );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI( EIntelReg reg, u32 data )
+{
+	if( data == 0 )
+	{
+		XOR( reg, reg, false );
+	}
+	else
+	{
+		EmitREX( false, 0, 0, reg );
+		EmitBYTE( 0xb8 | (reg & 7) );
+		EmitDWORD( data );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI64( EIntelReg reg, u64 data )
+{
+	if( data == u64( u32( data ) ) )
+	{
+		MOVI( reg, u32( data ) );
+	}
+	else
+	{
+		EmitREX( true, 0, 0, reg );
+		EmitBYTE( 0xb8 | (reg & 7) );
+		EmitDWORD( u32( data ) );
+		EmitDWORD( u32( data >> 32 ) );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVSXD( EIntelReg reg1, EIntelReg reg2 )
+{
+	EmitREX( true, reg1, 0, reg2 );
+	EmitBYTE( 0x63 );
+	EmitModRM_Reg( reg1, reg2 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVSX8( EIntelReg reg1, EIntelReg reg2 )
+{
+	EmitREX( false, reg1, 0, reg2, reg2 >= RSP_CODE );
+	EmitBYTE( 0x0f );
+	EmitBYTE( 0xbe );
+	EmitModRM_Reg( reg1, reg2 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVZX8( EIntelReg reg1, EIntelReg reg2 )
+{
+	EmitREX( false, reg1, 0, reg2, reg2 >= RSP_CODE );
+	EmitBYTE( 0x0f );
+	EmitBYTE( 0xb6 );
+	EmitModRM_Reg( reg1, reg2 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )
+{
+	ALU_RV( 0x8b, reg, p_var, is64 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_VAR_REG( const void * p_var, EIntelReg reg, bool is64 )
+{
+	ALU_RV( 0x89, reg, p_var, is64 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI_VAR( const void * p_var, u32 data )
+{
+	EmitREX( false, 0, 0, R15_CODE );
+	EmitBYTE( 0xc7 );
+	EmitModRM_Var( 0, p_var );
+	EmitDWORD( data );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI_VAR64( const void * p_var, s32 data )
+{
+	EmitREX( true, 0, 0, R15_CODE );
+	EmitBYTE( 0xc7 );
+	EmitModRM_Var( 0, p_var );
+	EmitDWORD( u32( data ) );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ADD_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x03, reg, p_var, is64 ); }
+void	CAssemblyWriterX64::SUB_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x2b, reg, p_var, is64 ); }
+void	CAssemblyWriterX64::AND_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x23, reg, p_var, is64 ); }
+void	CAssemblyWriterX64::OR_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x0b, reg, p_var, is64 ); }
+void	CAssemblyWriterX64::XOR_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x33, reg, p_var, is64 ); }
+void	CAssemblyWriterX64::CMP_REG_VAR( EIntelReg reg, const void * p_var, bool is64 )	{ ALU_RV( 0x3b, reg, p_var, is64 ); }
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::CMPI_VAR( const void * p_var, u32 data )
+{
+	s32		sdata = s32( data );
+
+	EmitREX( false, 0, 0, R15_CODE );
+	if( sdata >= -128 && sdata <= 127 )
+	{
+		EmitBYTE( 0x83 );
+		EmitModRM_Var( 7, p_var );
+		EmitBYTE( u8( data ) );
+	}
+	else
+	{
+		EmitBYTE( 0x81 );
+		EmitModRM_Var( 7, p_var );
+		EmitDWORD( data );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_REG_MEM_BASE_IDX( EIntelReg reg, EIntelReg base, EIntelReg idx, bool is64 )
+{
+	EmitREX( is64, reg, idx, base );
+	EmitBYTE( 0x8b );
+	EmitModRM_BaseIdx( reg, base, idx );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_MEM_BASE_IDX_REG( EIntelReg base, EIntelReg idx, EIntelReg reg, bool is64 )
+{
+	EmitREX( is64, reg, idx, base );
+	EmitBYTE( 0x89 );
+	EmitModRM_BaseIdx( reg, base, idx );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVSX8_REG_MEM_BASE_IDX( EIntelReg reg, EIntelReg base, EIntelReg idx )		{ LOAD_EXT_BASE_IDX( 0xbe, reg, base, idx ); }
+void	CAssemblyWriterX64::MOVZX8_REG_MEM_BASE_IDX( EIntelReg reg, EIntelReg base, EIntelReg idx )		{ LOAD_EXT_BASE_IDX( 0xb6, reg, base, idx ); }
+void	CAssemblyWriterX64::MOVSX16_REG_MEM_BASE_IDX( EIntelReg reg, EIntelReg base, EIntelReg idx )	{ LOAD_EXT_BASE_IDX( 0xbf, reg, base, idx ); }
+void	CAssemblyWriterX64::MOVZX16_REG_MEM_BASE_IDX( EIntelReg reg, EIntelReg base, EIntelReg idx )	{ LOAD_EXT_BASE_IDX( 0xb7, reg, base, idx ); }
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV8_MEM_BASE_IDX_REG( EIntelReg base, EIntelReg idx, EIntelReg reg )
+{
+	EmitREX( false, reg, idx, base, reg >= RSP_CODE );
+	EmitBYTE( 0x88 );
+	EmitModRM_BaseIdx( reg, base, idx );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV16_MEM_BASE_IDX_REG( EIntelReg base, EIntelReg idx, EIntelReg reg )
+{
+	EmitBYTE( 0x66 );
+	EmitREX( false, reg, idx, base );
+	EmitBYTE( 0x89 );
+	EmitModRM_BaseIdx( reg, base, idx );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ADD( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x01, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::SUB( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x29, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::AND( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x21, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::OR( EIntelReg reg1, EIntelReg reg2, bool is64 )		{ ALU_RR( 0x09, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::XOR( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x31, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::CMP( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x39, reg1, reg2, is64 ); }
+void	CAssemblyWriterX64::TEST( EIntelReg reg1, EIntelReg reg2, bool is64 )	{ ALU_RR( 0x85, reg1, reg2, is64 ); }
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::NOT( EIntelReg reg, bool is64 )
+{
+	EmitREX( is64, 0, 0, reg );
+	EmitBYTE( 0xf7 );
+	EmitModRM_Reg( 2, reg );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::INC_MEM32( EIntelReg reg )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( (reg & 7) != RSP_CODE && (reg & 7) != RBP_CODE, "Unsupported base register" );
+	#endif
+
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE( 0xff );
+	EmitBYTE( reg & 7 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ADDI( EIntelReg reg, s32 data, bool is64 )
+{
+	if( data != 0 )
+	{
+		ALU_RI( 0, reg, data, is64 );
+	}
+	else if( !is64 )
+	{
+		MOV( reg, reg, false );		// Still need to clear the upper half
+	}
+}
+
+void	CAssemblyWriterX64::ORI( EIntelReg reg, s32 data, bool is64 )	{ ALU_RI( 1, reg, data, is64 ); }
+void	CAssemblyWriterX64::ANDI( EIntelReg reg, s32 data, bool is64 )	{ ALU_RI( 4, reg, data, is64 ); }
+void	CAssemblyWriterX64::XORI( EIntelReg reg, s32 data, bool is64 )	{ ALU_RI( 6, reg, data, is64 ); }
+void	CAssemblyWriterX64::CMPI( EIntelReg reg, s32 data, bool is64 )	{ ALU_RI( 7, reg, data, is64 ); }
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ROLI( EIntelReg reg, u8 sa, bool is64 )		{ SHIFT_I( 0, reg, sa, is64 ); }
+void	CAssemblyWriterX64::SHLI( EIntelReg reg, u8 sa, bool is64 )		{ SHIFT_I( 4, reg, sa, is64 ); }
+void	CAssemblyWriterX64::SHRI( EIntelReg reg, u8 sa, bool is64 )		{ SHIFT_I( 5, reg, sa, is64 ); }
+void	CAssemblyWriterX64::SARI( EIntelReg reg, u8 sa, bool is64 )		{ SHIFT_I( 7, reg, sa, is64 ); }
+void	CAssemblyWriterX64::SHL_CL( EIntelReg reg, bool is64 )			{ SHIFT_CL( 4, reg, is64 ); }
+void	CAssemblyWriterX64::SHR_CL( EIntelReg reg, bool is64 )			{ SHIFT_CL( 5, reg, is64 ); }
+void	CAssemblyWriterX64::SAR_CL( EIntelReg reg, bool is64 )			{ SHIFT_CL( 7, reg, is64 ); }
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SETCC( EIntelCond cond, EIntelReg reg )
+{
+	EmitREX( false, 0, 0, reg, reg >= RSP_CODE );
+	EmitBYTE( 0x0f );
+	EmitBYTE( 0x90 | cond );
+	EmitModRM_Reg( 0, reg );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CAssemblyWriterX64::JCCLong( EIntelCond cond, CCodeLabel target )
+{
+	const u32	JUMP_LONG_LENGTH = 6;
+
+	CJumpLocation	jump_location( mpAssemblyBuffer->GetJumpLocation() );
+	s32				offset( jump_location.GetOffset( target ) - JUMP_LONG_LENGTH );
+
+	EmitBYTE( 0x0f );
+	EmitBYTE( 0x80 | cond );
+	EmitDWORD( offset );
+
+	return jump_location;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CAssemblyWriterX64::JMPLong( CCodeLabel target )
+{
+	const u32	JUMP_DIRECT_LONG_LENGTH = 5;
+
+	CJumpLocation	jump_location( mpAssemblyBuffer->GetJumpLocation() );
+	s32				offset( jump_location.GetOffset( target ) - JUMP_DIRECT_LONG_LENGTH );
+
+	EmitBYTE( 0xe9 );
+	EmitDWORD( static_cast< u32 >( offset ) );
+
+	return jump_location;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::JMP_REG( EIntelReg reg )
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE( 0xff );
+	EmitModRM_Reg( 4, reg );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::CALL_REG( EIntelReg reg )
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE( 0xff );
+	EmitModRM_Reg( 2, reg );
+}
+
+//*****************************************************************************
+//	call qword ptr [reg]
+//*****************************************************************************
+void	CAssemblyWriterX64::CALL_MEM_REG( EIntelReg reg )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( (reg & 7) != RSP_CODE && (reg & 7) != RBP_CODE, "Unsupported base register" );
+	#endif
+
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE( 0xff );
+	EmitBYTE( 0x10 | (reg & 7) );
+}
+
+//*****************************************************************************
+//	Calls are rip relative if the target is within 2GB of the code buffer,
+//	otherwise we go via rax (which is never used to pass arguments)
+//*****************************************************************************
+void	CAssemblyWriterX64::CALL( CCodeLabel target )
+{
+	const u32	CALL_LONG_LENGTH = 5;
+
+	const u8 *	p_next( mpAssemblyBuffer->GetLabel().GetTargetU8P() + CALL_LONG_LENGTH );
+	s64			offset( target.GetTargetU8P() - p_next );
+
+	if( offset == s32( offset ) )
+	{
+		EmitBYTE( 0xe8 );
+		EmitDWORD( u32( offset ) );
+	}
+	else
+	{
+		MOVI64( RAX_CODE, reinterpret_cast< uintptr_t >( target.GetTarget() ) );
+		CALL_REG( RAX_CODE );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::RET()
+{
+	EmitBYTE( 0xc3 );
+}
@@ -0,0 +1,172 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSPOSIX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
+#define SYSPOSIX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
+
+#include "DynaRec/AssemblyBuffer.h"
+#include "SysPosix/DynaRec/x64/DynarecTargetX64.h"
+
+// Condition codes, as used in the low nibble of Jcc/SETcc
+enum EIntelCond
+{
+	COND_B	= 0x2,		// unsigned <
+	COND_AE	= 0x3,		// unsigned >=
+	COND_E	= 0x4,
+	COND_NE	= 0x5,
+	COND_L	= 0xc,		// signed <
+	COND_GE	= 0xd,		// signed >=
+};
+
+//
+//	Most instructions come in a 32 bit and a 64 bit (REX.W) flavour. Memory
+//	operands are either relative to the state base register (r15), which is
+//	pointed at gCPUState by _EnterDynaRec, or are [base + index] pairs used
+//	to address emulated RAM.
+//
+class CAssemblyWriterX64
+{
+	public:
+		CAssemblyWriterX64( CAssemblyBuffer * p_buffer )
+			:	mpAssemblyBuffer( p_buffer )
+			,	mpStateBase( nullptr )
+		{
+		}
+
+	public:
+		CAssemblyBuffer *	GetAssemblyBuffer() const									{ return mpAssemblyBuffer; }
+		void				SetAssemblyBuffer( CAssemblyBuffer * p_buffer )				{ mpAssemblyBuffer = p_buffer; }
+
+		void				SetStateBase( const void * p_base )							{ mpStateBase = reinterpret_cast< const u8 * >( p_base ); }
+
+	public:
+				inline void NOP()
+				{
+					EmitBYTE(0x90);
+				}
+
+				inline void INT3()
+				{
+					EmitBYTE(0xcc);
+				}
+
+				void				MOV(EIntelReg reg1, EIntelReg reg2, bool is64);				// mov		reg1, reg2
+				void				MOVI(EIntelReg reg, u32 data);								// mov		reg32, data (zero extends)
+				void				MOVI64(EIntelReg reg, u64 data);							// mov		reg64, data
+				void				MOVSXD(EIntelReg reg1, EIntelReg reg2);						// movsxd	reg64, reg32
+				void				MOVSX8(EIntelReg reg1, EIntelReg reg2);						// movsx	reg32, reg8
+				void				MOVZX8(EIntelReg reg1, EIntelReg reg2);						// movzx	reg32, reg8
+
+				// Accesses to gCPUState (or anything else close to the state base)
+				void				MOV_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// mov		reg, [r15 + var]
+				void				MOV_VAR_REG(const void * p_var, EIntelReg reg, bool is64);	// mov		[r15 + var], reg
+				void				MOVI_VAR(const void * p_var, u32 data);						// mov		dword ptr [r15 + var], data
+				void				MOVI_VAR64(const void * p_var, s32 data);					// mov		qword ptr [r15 + var], sign extended data
+				void				ADD_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// add		reg, [r15 + var]
+				void				SUB_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// sub		reg, [r15 + var]
+				void				AND_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// and		reg, [r15 + var]
+				void				OR_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// or		reg, [r15 + var]
+				void				XOR_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// xor		reg, [r15 + var]
+				void				CMP_REG_VAR(EIntelReg reg, const void * p_var, bool is64);	// cmp		reg, [r15 + var]
+				void				CMPI_VAR(const void * p_var, u32 data);						// cmp		dword ptr [r15 + var], data
+
+				// Accesses to emulated memory
+				void				MOV_REG_MEM_BASE_IDX(EIntelReg reg, EIntelReg base, EIntelReg idx, bool is64);	// mov		reg, [base + idx]
+				void				MOV_MEM_BASE_IDX_REG(EIntelReg base, EIntelReg idx, EIntelReg reg, bool is64);	// mov		[base + idx], reg
+				void				MOVSX8_REG_MEM_BASE_IDX(EIntelReg reg, EIntelReg base, EIntelReg idx);			// movsx	reg32, byte ptr [base + idx]
+				void				MOVZX8_REG_MEM_BASE_IDX(EIntelReg reg, EIntelReg base, EIntelReg idx);			// movzx	reg32, byte ptr [base + idx]
+				void				MOVSX16_REG_MEM_BASE_IDX(EIntelReg reg, EIntelReg base, EIntelReg idx);			// movsx	reg32, word ptr [base + idx]
+				void				MOVZX16_REG_MEM_BASE_IDX(EIntelReg reg, EIntelReg base, EIntelReg idx);			// movzx	reg32, word ptr [base + idx]
+				void				MOV8_MEM_BASE_IDX_REG(EIntelReg base, EIntelReg idx, EIntelReg reg);			// mov		byte ptr [base + idx], reg8
+				void				MOV16_MEM_BASE_IDX_REG(EIntelReg base, EIntelReg idx, EIntelReg reg);			// mov		word ptr [base + idx], reg16
+
+				void				ADD(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				SUB(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				AND(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				OR(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				XOR(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				CMP(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				TEST(EIntelReg reg1, EIntelReg reg2, bool is64);
+				void				NOT(EIntelReg reg, bool is64);
+				void				INC_MEM32(EIntelReg reg);									// inc		dword ptr [reg]
+
+				void				ADDI(EIntelReg reg, s32 data, bool is64);
+				void				ANDI(EIntelReg reg, s32 data, bool is64);
+				void				ORI(EIntelReg reg, s32 data, bool is64);
+				void				XORI(EIntelReg reg, s32 data, bool is64);
+				void				CMPI(EIntelReg reg, s32 data, bool is64);
+
+				void				SHLI(EIntelReg reg, u8 sa, bool is64);
+				void				SHRI(EIntelReg reg, u8 sa, bool is64);
+				void				SARI(EIntelReg reg, u8 sa, bool is64);
+				void				ROLI(EIntelReg reg, u8 sa, bool is64);
+				void				SHL_CL(EIntelReg reg, bool is64);
+				void				SHR_CL(EIntelReg reg, bool is64);
+				void				SAR_CL(EIntelReg reg, bool is64);
+
+				void				SETCC(EIntelCond cond, EIntelReg reg);						// setcc	reg8
+
+				CJumpLocation		JMPLong( CCodeLabel target );
+				CJumpLocation		JCCLong( EIntelCond cond, CCodeLabel target );
+				CJumpLocation		JELong( CCodeLabel target )		{ return JCCLong( COND_E, target ); }
+				CJumpLocation		JNELong( CCodeLabel target )	{ return JCCLong( COND_NE, target ); }
+
+				void				JMP_REG( EIntelReg reg );
+				void				CALL_REG( EIntelReg reg );
+				void				CALL_MEM_REG( EIntelReg reg );								// call		qword ptr [reg]
+				void				CALL( CCodeLabel target );
+				void				RET();
+
+	private:
+				void				EmitREX( bool is64, u32 reg, u32 index, u32 base, bool force = false );
+				void				EmitModRM_Reg( u32 reg, u32 rm );
+				void				EmitModRM_Var( u32 reg, const void * p_var );
+				void				EmitModRM_BaseIdx( u32 reg, EIntelReg base, EIntelReg idx );
+
+				void				ALU_RR( u8 opcode, EIntelReg reg1, EIntelReg reg2, bool is64 );
+				void				ALU_RI( u8 ext, EIntelReg reg, s32 data, bool is64 );
+				void				ALU_RV( u8 opcode, EIntelReg reg, const void * p_var, bool is64 );
+				void				SHIFT_I( u8 ext, EIntelReg reg, u8 sa, bool is64 );
+				void				SHIFT_CL( u8 ext, EIntelReg reg, bool is64 );
+				void				LOAD_EXT_BASE_IDX( u8 opcode, EIntelReg reg, EIntelReg base, EIntelReg idx );
+
+		inline void EmitBYTE(u8 byte)
+		{
+			mpAssemblyBuffer->EmitBYTE( byte );
+		}
+
+		inline void EmitWORD(u16 word)
+		{
+			mpAssemblyBuffer->EmitWORD( word );
+		}
+
+		inline void EmitDWORD(u32 dword)
+		{
+			mpAssemblyBuffer->EmitDWORD( dword );
+		}
+
+	private:
+		CAssemblyBuffer *				mpAssemblyBuffer;
+		const u8 *						mpStateBase;
+};
+
+#endif // SYSPOSIX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
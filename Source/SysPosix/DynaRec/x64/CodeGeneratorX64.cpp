@@ -0,0 +1,1016 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+
+#include "Core/CPU.h"
+#include "Core/Memory.h"
+#include "Core/R4300.h"
+#include "Core/Registers.h"
+#include "Debug/DBGConsole.h"
+#include "DynaRec/AssemblyUtils.h"
+#include "DynaRec/IndirectExitMap.h"
+#include "DynaRec/StaticAnalysis.h"
+#include "DynaRec/Trace.h"
+
+#include "SysPosix/DynaRec/x64/CodeGeneratorX64.h"
+
+#include <algorithm>
+
+using namespace AssemblyUtils;
+
+// Callee saved, so these survive calls into the interpreter. _EnterDynaRec saves them for us.
+static const EIntelReg	gRegistersToUseForCaching[] =
+{
+	RBX_CODE,
+	RBP_CODE,
+	R12_CODE,
+};
+
+static const u32		NUM_CACHE_REGS( sizeof(gRegistersToUseForCaching) / sizeof(gRegistersToUseForCaching[0]) );
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeGeneratorX64::CCodeGeneratorX64( CAssemblyBuffer * p_buffer )
+:	CCodeGenerator( )
+,	CAssemblyWriterX64( p_buffer )
+,	mpPrimary( p_buffer )
+,	mDirtyRegisters( 0 )
+{
+	std::fill( mCachedRegisters, mCachedRegisters + NUM_N64_REGS, INVALID_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::Finalise( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps )
+{
+	if( !exception_handler_jumps.empty() )
+	{
+		GenerateExceptionHander( p_exception_handler_fn, exception_handler_jumps );
+	}
+
+	SetAssemblyBuffer( nullptr );
+	mpPrimary = nullptr;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::Initialise( u32 entry_address, u32 exit_address, u32 * hit_counter, const void * p_base, const SRegisterUsageInfo & register_usage )
+{
+	// All state accesses are made relative to p_base, which _EnterDynaRec loads into r15
+	SetStateBase( p_base );
+
+	if( hit_counter != nullptr )
+	{
+		MOVI64( RAX_CODE, reinterpret_cast< uintptr_t >( hit_counter ) );
+		INC_MEM32( RAX_CODE );
+	}
+
+	SetRegisterCaching( register_usage );
+	LoadCachedRegisters();
+}
+
+//*****************************************************************************
+//	Registers are allocated once for the whole fragment, so the cache looks
+//	the same at every instruction and there's nothing to do here.
+//*****************************************************************************
+void	CCodeGeneratorX64::UpdateRegisterCaching( u32 instruction_idx )
+{
+}
+
+//*****************************************************************************
+//	As above, every branch handler sees the same allocation.
+//*****************************************************************************
+RegisterSnapshotHandle	CCodeGeneratorX64::GetRegisterSnapshot()
+{
+	return RegisterSnapshotHandle( 0 );
+}
+
+//*****************************************************************************
+//	Pick the registers which are live for longest, favouring those used as
+//	load/store bases. Registers only touched by a single instruction don't
+//	gain anything from being cached.
+//*****************************************************************************
+struct SCacheCandidateSort
+{
+	explicit SCacheCandidateSort( const SRegisterUsageInfo & usage ) : Usage( usage ) {}
+
+	bool operator()( const SRegisterSpan & a, const SRegisterSpan & b ) const
+	{
+		bool	a_base( Usage.IsBase( a.Register ) );
+		bool	b_base( Usage.IsBase( b.Register ) );
+		if( a_base != b_base )
+		{
+			return a_base;
+		}
+		return (a.SpanEnd - a.SpanStart) > (b.SpanEnd - b.SpanStart);
+	}
+
+	const SRegisterUsageInfo &	Usage;
+};
+
+void	CCodeGeneratorX64::SetRegisterCaching( const SRegisterUsageInfo & register_usage )
+{
+	RegisterSpanList	candidates;
+	for( RegisterSpanList::const_iterator span_it = register_usage.SpanList.begin(); span_it < register_usage.SpanList.end(); ++span_it )
+	{
+		if( span_it->Register != N64Reg_R0 && span_it->SpanEnd > span_it->SpanStart )
+		{
+			candidates.push_back( *span_it );
+		}
+	}
+
+	std::stable_sort( candidates.begin(), candidates.end(), SCacheCandidateSort( register_usage ) );
+
+	for( u32 i = 0; i < candidates.size() && i < NUM_CACHE_REGS; ++i )
+	{
+		mCachedRegisters[ candidates[ i ].Register ] = gRegistersToUseForCaching[ i ];
+	}
+}
+
+//*****************************************************************************
+//	Pull the cached registers in from gCPUState. This is done on entry to the
+//	fragment and after anything which might have written to gGPR directly.
+//*****************************************************************************
+void	CCodeGeneratorX64::LoadCachedRegisters()
+{
+	for( u32 i = 1; i < NUM_N64_REGS; ++i )
+	{
+		if( mCachedRegisters[ i ] != INVALID_CODE )
+		{
+			MOV_REG_VAR( mCachedRegisters[ i ], &gGPR[ i ]._u64, true );
+		}
+	}
+}
+
+//*****************************************************************************
+//	Write back any cached registers which may have changed. Code is only ever
+//	entered from the top of the fragment and all the jumps within it go
+//	forwards, so anything written before this point in the buffer is covered
+//	by mDirtyRegisters.
+//*****************************************************************************
+void	CCodeGeneratorX64::FlushCachedRegisters()
+{
+	for( u32 i = 1; i < NUM_N64_REGS; ++i )
+	{
+		if( mDirtyRegisters & (1 << i) )
+		{
+			MOV_VAR_REG( &gGPR[ i ]._u64, mCachedRegisters[ i ], true );
+		}
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeLabel	CCodeGeneratorX64::GetEntryPoint() const
+{
+	return mpPrimary->GetStartAddress();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeLabel	CCodeGeneratorX64::GetCurrentLocation() const
+{
+	return mpPrimary->GetLabel();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32	CCodeGeneratorX64::GetCompiledCodeSize() const
+{
+	return mpPrimary->GetSize();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CCodeGeneratorX64::GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( !next_fragment.IsSet() || jump_address == 0, "Shouldn't be specifying a jump address if we have a next fragment?" );
+	#endif
+
+#ifdef _DEBUG
+	if(exit_address == u32(~0))
+	{
+		INT3();
+	}
+#endif
+
+	FlushCachedRegisters();
+
+	MOVI( RDI_CODE, num_instructions );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	// This jump may be NULL, in which case we patch it below
+	// This gets patched with a jump to the next fragment if the target is later found
+	CJumpLocation jump_to_next_fragment( GenerateBranchIfNotSet( const_cast< u32 * >( &gCPUState.StuffToDo ), next_fragment ) );
+
+	// If the flag was set, we need in initialise the pc/delay to exit with
+	CCodeLabel interpret_next_fragment( GetAssemblyBuffer()->GetLabel() );
+
+	u32		exit_delay;
+
+	if( jump_address != 0 )
+	{
+		SetVar( &gCPUState.TargetPC, jump_address );
+		exit_delay = EXEC_DELAY;
+	}
+	else
+	{
+		exit_delay = NO_DELAY;
+	}
+
+	SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), exit_delay );
+	SetVar( &gCPUState.CurrentPC, exit_address );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+	RET();
+
+	// Patch up the exit jump
+	if( !next_fragment.IsSet() )
+	{
+		PatchJumpLong( jump_to_next_fragment, interpret_next_fragment );
+	}
+
+	// If we're exiting with a delay slot pending, chaining straight into the
+	// fragment at exit_address would lose the jump to jump_address
+	if( jump_address != 0 )
+	{
+		return CJumpLocation();
+	}
+
+	return jump_to_next_fragment;
+}
+
+//*****************************************************************************
+// Handle branching back to the interpreter after an ERET
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map )
+{
+	FlushCachedRegisters();
+
+	MOVI( RDI_CODE, num_instructions );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	// We always exit to the interpreter, regardless of the state of gCPUState.StuffToDo
+
+	// Eret is a bit bodged so we exit at PC + 4
+	MOV_REG_VAR( RAX_CODE, &gCPUState.CurrentPC, false );
+	ADDI( RAX_CODE, 4, false );
+	MOV_VAR_REG( &gCPUState.CurrentPC, RAX_CODE, false );
+	SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), NO_DELAY );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+
+	RET();
+}
+
+//*****************************************************************************
+// Handle branching back to the interpreter after an indirect jump
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map )
+{
+	FlushCachedRegisters();
+
+	MOVI( RDI_CODE, num_instructions );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	CCodeLabel		no_target( nullptr );
+	CJumpLocation	jump_to_next_fragment( GenerateBranchIfNotSet( const_cast< u32 * >( &gCPUState.StuffToDo ), no_target ) );
+
+	CCodeLabel		exit_dynarec( GetAssemblyBuffer()->GetLabel() );
+	// New return address is in gCPUState.TargetPC
+	MOV_REG_VAR( RAX_CODE, &gCPUState.TargetPC, false );
+	MOV_VAR_REG( &gCPUState.CurrentPC, RAX_CODE, false );
+	SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), NO_DELAY );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+
+	RET();
+
+	// gCPUState.StuffToDo == 0, try to jump to the indirect target
+	PatchJumpLong( jump_to_next_fragment, GetAssemblyBuffer()->GetLabel() );
+
+	MOVI64( RDI_CODE, reinterpret_cast< uintptr_t >( p_map ) );
+	MOV_REG_VAR( RSI_CODE, &gCPUState.TargetPC, false );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( IndirectExitMap_Lookup ) ) );
+
+	// If the target was not found, exit
+	TEST( RAX_CODE, RAX_CODE, true );
+	JELong( exit_dynarec );
+
+	JMP_REG( RAX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateExceptionHander( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps )
+{
+	CCodeLabel exception_handler( GetAssemblyBuffer()->GetLabel() );
+
+	CALL( CCodeLabel( reinterpret_cast< const void * >( p_exception_handler_fn ) ) );
+	RET();
+
+	for( std::vector< CJumpLocation >::const_iterator it = exception_handler_jumps.begin(); it != exception_handler_jumps.end(); ++it )
+	{
+		CJumpLocation	jump( *it );
+		PatchJumpLong( jump, exception_handler );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::SetVar( u32 * p_var, u32 value )
+{
+	MOVI_VAR( p_var, value );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot )
+{
+	PatchJumpLong( branch_handler_jump, GetAssemblyBuffer()->GetLabel() );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchAlways( CCodeLabel target )
+{
+	return JMPLong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfSet( const u32 * p_var, CCodeLabel target )
+{
+	CMPI_VAR( p_var, 0 );
+	return JNELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfNotSet( const u32 * p_var, CCodeLabel target )
+{
+	CMPI_VAR( p_var, 0 );
+	return JELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfEqual32( const u32 * p_var, u32 value, CCodeLabel target )
+{
+	CMPI_VAR( p_var, value );
+	return JELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfNotEqual32( const u32 * p_var, u32 value, CCodeLabel target )
+{
+	CMPI_VAR( p_var, value );
+	return JNELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::LoadRegister32( EIntelReg reg, EN64Reg n64_reg )
+{
+	if( n64_reg == N64Reg_R0 )
+	{
+		MOVI( reg, 0 );
+	}
+	else if( mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		MOV( reg, mCachedRegisters[ n64_reg ], false );
+	}
+	else
+	{
+		MOV_REG_VAR( reg, &gGPR[ n64_reg ]._u32_0, false );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::LoadRegister64( EIntelReg reg, EN64Reg n64_reg )
+{
+	if( n64_reg == N64Reg_R0 )
+	{
+		MOVI( reg, 0 );
+	}
+	else if( mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		MOV( reg, mCachedRegisters[ n64_reg ], true );
+	}
+	else
+	{
+		MOV_REG_VAR( reg, &gGPR[ n64_reg ]._u64, true );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::StoreRegister32( EN64Reg n64_reg, EIntelReg reg )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( n64_reg != N64Reg_R0, "Shouldn't be writing to r0" );
+	#endif
+
+	if( mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		MOVSXD( mCachedRegisters[ n64_reg ], reg );
+		mDirtyRegisters |= 1 << n64_reg;
+	}
+	else
+	{
+		MOVSXD( reg, reg );
+		MOV_VAR_REG( &gGPR[ n64_reg ]._u64, reg, true );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::StoreRegister64( EN64Reg n64_reg, EIntelReg reg )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( n64_reg != N64Reg_R0, "Shouldn't be writing to r0" );
+	#endif
+
+	if( mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		MOV( mCachedRegisters[ n64_reg ], reg, true );
+		mDirtyRegisters |= 1 << n64_reg;
+	}
+	else
+	{
+		MOV_VAR_REG( &gGPR[ n64_reg ]._u64, reg, true );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::SetRegister64( EN64Reg n64_reg, s32 value )
+{
+	#ifdef DAEDALUS_ENABLE_ASSERTS
+	DAEDALUS_ASSERT( n64_reg != N64Reg_R0, "Shouldn't be writing to r0" );
+	#endif
+
+	if( mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		MOVI64( mCachedRegisters[ n64_reg ], u64( s64( value ) ) );
+		mDirtyRegisters |= 1 << n64_reg;
+	}
+	else
+	{
+		MOVI_VAR64( &gGPR[ n64_reg ]._u64, value );
+	}
+}
+
+//*****************************************************************************
+//	Returns the host register holding n64_reg, loading it into scratch if
+//	it isn't cached
+//*****************************************************************************
+EIntelReg	CCodeGeneratorX64::GetRegisterOperand( EIntelReg scratch, EN64Reg n64_reg, bool is64 )
+{
+	if( n64_reg != N64Reg_R0 && mCachedRegisters[ n64_reg ] != INVALID_CODE )
+	{
+		return mCachedRegisters[ n64_reg ];
+	}
+
+	if( is64 )
+	{
+		LoadRegister64( scratch, n64_reg );
+	}
+	else
+	{
+		LoadRegister32( scratch, n64_reg );
+	}
+	return scratch;
+}
+
+//*****************************************************************************
+//	Generates instruction handler for the specified op code.
+//	Returns a jump location if an exception handler is required
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump)
+{
+	u32 address = ti.Address;
+	bool exception = false;
+	OpCode op_code = ti.OpCode;
+
+	if (op_code._u32 == 0)
+	{
+		if( branch_delay_slot )
+		{
+			SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), NO_DELAY );
+		}
+		return CJumpLocation();
+	}
+
+	if( branch_delay_slot )
+	{
+		SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), EXEC_DELAY );
+	}
+
+	const EN64Reg	rs = EN64Reg( op_code.rs );
+	const EN64Reg	rt = EN64Reg( op_code.rt );
+	const EN64Reg	base = EN64Reg( op_code.base );
+
+	CJumpLocation	exception_handler;
+	bool			handled = false;
+	bool			is_direct_jump = false;
+
+	switch(op_code.op)
+	{
+		case OP_J:			GenerateJ( address, op_code ); handled = true; is_direct_jump = true; break;
+		case OP_JAL:		GenerateJAL( address, op_code ); handled = true; is_direct_jump = true; break;
+		case OP_CACHE:		GenerateCACHE( base, op_code.immediate, rt ); handled = true; break;
+
+		case OP_ADDI:
+		case OP_ADDIU:
+			if( rt != N64Reg_R0 )	{ GenerateADDIU( rt, rs, s16(op_code.immediate) ); handled = true; }
+			break;
+		case OP_DADDIU:
+			if( rt != N64Reg_R0 )	{ GenerateDADDIU( rt, rs, s16(op_code.immediate) ); handled = true; }
+			break;
+		case OP_SLTI:
+		case OP_SLTIU:
+			if( rt != N64Reg_R0 )	{ GenerateSLTI( rt, rs, s16(op_code.immediate), op_code.op == OP_SLTIU ); handled = true; }
+			break;
+		case OP_ANDI:
+		case OP_ORI:
+		case OP_XORI:
+			if( rt != N64Reg_R0 )	{ GenerateLogicalImmediate( rt, rs, op_code.immediate, op_code.op ); handled = true; }
+			break;
+		case OP_LUI:
+			if( rt != N64Reg_R0 )	{ GenerateLUI( rt, s16(op_code.immediate) ); handled = true; }
+			break;
+
+		case OP_SPECOP:
+			handled = GenerateSpecial( op_code );
+			break;
+
+		// Loads and stores which hit rdram are done inline, everything else falls back to the interpreter
+		case OP_LB:
+		case OP_LBU:
+		case OP_LH:
+		case OP_LHU:
+		case OP_LW:
+		case OP_LWU:
+		case OP_LD:
+			if( rt != N64Reg_R0 )
+			{
+				exception_handler = GenerateMemoryAccess( address, op_code );
+				handled = true;
+			}
+			break;
+		case OP_SB:
+		case OP_SH:
+		case OP_SW:
+		case OP_SD:
+			exception_handler = GenerateMemoryAccess( address, op_code );
+			handled = true;
+			break;
+
+		// The handlers for these are swapped out when cop1 is disabled, so call through the table
+		case OP_COPRO1:
+		case OP_LWC1:
+		case OP_LDC1:
+		case OP_SWC1:
+		case OP_SDC1:
+			SetVar( &gCPUState.CurrentPC, address );
+			GenerateGenericR4300Indirect( op_code );
+			exception = true;
+			handled = true;
+			break;
+	}
+
+	if (!handled)
+	{
+		if( R4300_InstructionHandlerNeedsPC( op_code ) )
+		{
+			SetVar( &gCPUState.CurrentPC, address );
+			exception = true;
+		}
+		GenerateGenericR4300( op_code, R4300_GetInstructionHandler( op_code ) );
+
+		// The interpreter handlers don't bother checking for writes to r0
+		if( (ti.Usage.RegWrites & 1) || op_code.rt == 0 || op_code.rd == 0 )
+		{
+			MOVI_VAR64( &gGPR[ N64Reg_R0 ]._u64, 0 );
+		}
+	}
+
+	CCodeLabel		no_target( nullptr );
+
+	if( exception )
+	{
+		exception_handler = GenerateBranchIfSet( const_cast< u32 * >( &gCPUState.StuffToDo ), no_target );
+	}
+
+	// Check whether we want to invert the status of this branch
+	if( p_branch != nullptr )
+	{
+		//
+		// Check if the branch has been taken
+		//
+		if( is_direct_jump )
+		{
+			// J/JAL are always taken, and the trace always follows them, so there's nothing to check
+		}
+		else if( p_branch->Direct )
+		{
+			if( p_branch->ConditionalBranchTaken )
+			{
+				*p_branch_jump = GenerateBranchIfNotEqual32( reinterpret_cast< u32 * >( &gCPUState.Delay ), DO_DELAY, no_target );
+			}
+			else
+			{
+				*p_branch_jump = GenerateBranchIfEqual32( reinterpret_cast< u32 * >( &gCPUState.Delay ), DO_DELAY, no_target );
+			}
+		}
+		else
+		{
+			// XXXX eventually just exit here, and skip default exit code below
+			if( p_branch->Eret )
+			{
+				*p_branch_jump = GenerateBranchAlways( no_target );
+			}
+			else
+			{
+				*p_branch_jump = GenerateBranchIfNotEqual32( &gCPUState.TargetPC, p_branch->TargetAddress, no_target );
+			}
+		}
+	}
+	else
+	{
+		if( branch_delay_slot )
+		{
+			SetVar( reinterpret_cast< u32 * >( &gCPUState.Delay ), NO_DELAY );
+		}
+	}
+
+	return exception_handler;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateGenericR4300( OpCode op_code, CPU_Instruction p_instruction )
+{
+	// The handler works on gGPR directly
+	FlushCachedRegisters();
+
+	// Call function - the op code is passed as the first argument
+	MOVI( RDI_CODE, op_code._u32 );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( p_instruction ) ) );
+
+	LoadCachedRegisters();
+}
+
+//*****************************************************************************
+//	As above, but look the handler up in R4300Instruction when the fragment is
+//	executed rather than when it's compiled
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateGenericR4300Indirect( OpCode op_code )
+{
+	FlushCachedRegisters();
+
+	MOVI( RDI_CODE, op_code._u32 );
+	MOVI64( RAX_CODE, reinterpret_cast< uintptr_t >( &R4300Instruction[ op_code.op ] ) );
+	CALL_MEM_REG( RAX_CODE );
+
+	LoadCachedRegisters();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CCodeGeneratorX64::ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return )
+{
+	FlushCachedRegisters();
+	CALL( speed_hack );
+	LoadCachedRegisters();
+
+	if( check_return )
+	{
+		TEST( RAX_CODE, RAX_CODE, false );
+		return JELong( CCodeLabel(nullptr) );
+	}
+	else
+	{
+		return CJumpLocation(nullptr);
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateJ( u32 address, OpCode op_code )
+{
+	u32		target( (address & 0xF0000000) | (op_code.target << 2) );
+
+	// The trace follows the jump, but TargetPC is needed if the delay slot throws
+	SetVar( &gCPUState.TargetPC, target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateJAL( u32 address, OpCode op_code )
+{
+	GenerateJ( address, op_code );
+	SetRegister64( N64Reg_RA, s32( address + 8 ) );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op )
+{
+	u32 dwCache = cache_op & 0x3;
+	u32 dwAction = (cache_op >> 2) & 0x7;
+
+	// For instruction cache invalidation, make sure we let the CPU know so the whole
+	// dynarec system can be invalidated
+	if(dwCache == 0 && (dwAction == 0 || dwAction == 4))
+	{
+		LoadRegister32( RDI_CODE, base );
+		ADDI( RDI_CODE, offset, false );
+		MOVI( RSI_CODE, 0x20 );
+		CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_InvalidateICacheRange ) ) );
+	}
+	else
+	{
+		// We don't care about data cache etc
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateADDIU( EN64Reg rt, EN64Reg rs, s16 immediate )
+{
+	LoadRegister32( RAX_CODE, rs );
+	ADDI( RAX_CODE, immediate, false );
+	StoreRegister32( rt, RAX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateDADDIU( EN64Reg rt, EN64Reg rs, s16 immediate )
+{
+	LoadRegister64( RAX_CODE, rs );
+	ADDI( RAX_CODE, immediate, true );
+	StoreRegister64( rt, RAX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateSLTI( EN64Reg rt, EN64Reg rs, s16 immediate, bool is_unsigned )
+{
+	LoadRegister64( RCX_CODE, rs );
+	CMPI( RCX_CODE, immediate, true );
+	SETCC( is_unsigned ? COND_B : COND_L, RAX_CODE );
+	MOVZX8( RAX_CODE, RAX_CODE );
+	StoreRegister64( rt, RAX_CODE );
+}
+
+//*****************************************************************************
+//	The immediate is zero extended, so we can operate on the whole register
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateLogicalImmediate( EN64Reg rt, EN64Reg rs, u16 immediate, u32 op )
+{
+	LoadRegister64( RAX_CODE, rs );
+	switch( op )
+	{
+	case OP_ANDI:	ANDI( RAX_CODE, immediate, true ); break;
+	case OP_ORI:	ORI( RAX_CODE, immediate, true ); break;
+	case OP_XORI:	XORI( RAX_CODE, immediate, true ); break;
+	default:		NODEFAULT;
+	}
+	StoreRegister64( rt, RAX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateLUI( EN64Reg rt, s16 immediate )
+{
+	SetRegister64( rt, s32( u32( s32( immediate ) ) << 16 ) );
+}
+
+//*****************************************************************************
+//	Returns true if the op was handled natively
+//*****************************************************************************
+bool	CCodeGeneratorX64::GenerateSpecial( OpCode op_code )
+{
+	const EN64Reg	rs = EN64Reg( op_code.rs );
+	const EN64Reg	rt = EN64Reg( op_code.rt );
+	const EN64Reg	rd = EN64Reg( op_code.rd );
+	const u8		sa = u8( op_code.sa );
+
+	// These don't write to rd
+	switch( op_code.spec_op )
+	{
+	case SpecOp_MTHI:
+		LoadRegister64( RAX_CODE, rs );
+		MOV_VAR_REG( &gCPUState.MultHi._u64, RAX_CODE, true );
+		return true;
+	case SpecOp_MTLO:
+		LoadRegister64( RAX_CODE, rs );
+		MOV_VAR_REG( &gCPUState.MultLo._u64, RAX_CODE, true );
+		return true;
+	}
+
+	if( rd == N64Reg_R0 )
+	{
+		return false;
+	}
+
+	switch( op_code.spec_op )
+	{
+	// 32 bit shifts, the result is sign extended
+	case SpecOp_SLL:	LoadRegister32( RAX_CODE, rt ); SHLI( RAX_CODE, sa, false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_SRL:	LoadRegister32( RAX_CODE, rt ); SHRI( RAX_CODE, sa, false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_SRA:	LoadRegister32( RAX_CODE, rt ); SARI( RAX_CODE, sa, false ); StoreRegister32( rd, RAX_CODE ); return true;
+
+	// Variable shifts - x86 masks the shift amount in cl the same way as the r4300
+	case SpecOp_SLLV:	LoadRegister32( RCX_CODE, rs ); LoadRegister32( RAX_CODE, rt ); SHL_CL( RAX_CODE, false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_SRLV:	LoadRegister32( RCX_CODE, rs ); LoadRegister32( RAX_CODE, rt ); SHR_CL( RAX_CODE, false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_SRAV:	LoadRegister32( RCX_CODE, rs ); LoadRegister32( RAX_CODE, rt ); SAR_CL( RAX_CODE, false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_DSLLV:	LoadRegister32( RCX_CODE, rs ); LoadRegister64( RAX_CODE, rt ); SHL_CL( RAX_CODE, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRLV:	LoadRegister32( RCX_CODE, rs ); LoadRegister64( RAX_CODE, rt ); SHR_CL( RAX_CODE, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRAV:	LoadRegister32( RCX_CODE, rs ); LoadRegister64( RAX_CODE, rt ); SAR_CL( RAX_CODE, true ); StoreRegister64( rd, RAX_CODE ); return true;
+
+	case SpecOp_DSLL:	LoadRegister64( RAX_CODE, rt ); SHLI( RAX_CODE, sa, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRL:	LoadRegister64( RAX_CODE, rt ); SHRI( RAX_CODE, sa, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRA:	LoadRegister64( RAX_CODE, rt ); SARI( RAX_CODE, sa, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSLL32:	LoadRegister64( RAX_CODE, rt ); SHLI( RAX_CODE, sa + 32, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRL32:	LoadRegister64( RAX_CODE, rt ); SHRI( RAX_CODE, sa + 32, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSRA32:	LoadRegister64( RAX_CODE, rt ); SARI( RAX_CODE, sa + 32, true ); StoreRegister64( rd, RAX_CODE ); return true;
+
+	// The interpreter doesn't raise overflow exceptions for ADD/SUB either
+	case SpecOp_ADD:
+	case SpecOp_ADDU:	LoadRegister32( RAX_CODE, rs ); ADD( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, false ), false ); StoreRegister32( rd, RAX_CODE ); return true;
+	case SpecOp_SUB:
+	case SpecOp_SUBU:	LoadRegister32( RAX_CODE, rs ); SUB( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, false ), false ); StoreRegister32( rd, RAX_CODE ); return true;
+
+	case SpecOp_DADDU:	LoadRegister64( RAX_CODE, rs ); ADD( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_DSUBU:	LoadRegister64( RAX_CODE, rs ); SUB( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_AND:	LoadRegister64( RAX_CODE, rs ); AND( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_OR:		LoadRegister64( RAX_CODE, rs ); OR( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_XOR:	LoadRegister64( RAX_CODE, rs ); XOR( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_NOR:	LoadRegister64( RAX_CODE, rs ); OR( RAX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true ); NOT( RAX_CODE, true ); StoreRegister64( rd, RAX_CODE ); return true;
+
+	case SpecOp_SLT:
+	case SpecOp_SLTU:
+		LoadRegister64( RCX_CODE, rs );
+		CMP( RCX_CODE, GetRegisterOperand( RDX_CODE, rt, true ), true );
+		SETCC( op_code.spec_op == SpecOp_SLTU ? COND_B : COND_L, RAX_CODE );
+		MOVZX8( RAX_CODE, RAX_CODE );
+		StoreRegister64( rd, RAX_CODE );
+		return true;
+
+	case SpecOp_MFHI:	MOV_REG_VAR( RAX_CODE, &gCPUState.MultHi._u64, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	case SpecOp_MFLO:	MOV_REG_VAR( RAX_CODE, &gCPUState.MultLo._u64, true ); StoreRegister64( rd, RAX_CODE ); return true;
+	}
+
+	return false;
+}
+
+//*****************************************************************************
+//	Loads and stores. If the address is in rdram we access it directly
+//	through r14, otherwise we call the interpreter handler which deals with
+//	tlb mapping, hardware registers and exceptions.
+//	Returns the exception handler jump for the slow path.
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateMemoryAccess( u32 address, OpCode op_code )
+{
+	const EN64Reg	rt = EN64Reg( op_code.rt );
+	const EN64Reg	base = EN64Reg( op_code.base );
+	const s16		offset = s16( op_code.immediate );
+
+	// eax = virtual address, ecx = offset into rdram
+	LoadRegister32( RAX_CODE, base );
+	if( offset != 0 )
+	{
+		ADDI( RAX_CODE, offset, false );
+	}
+	MOV( RCX_CODE, RAX_CODE, false );
+	XORI( RCX_CODE, s32( 0x80000000 ), false );
+	CMP( RCX_CODE, REG_MEM_LIMIT, false );
+	CJumpLocation	slow_path( JCCLong( COND_AE, CCodeLabel( nullptr ) ) );
+
+	switch( op_code.op )
+	{
+	case OP_LB:
+		XORI( RAX_CODE, U8_TWIDDLE, false );
+		MOVSX8_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE );
+		StoreRegister32( rt, RAX_CODE );
+		break;
+	case OP_LBU:
+		XORI( RAX_CODE, U8_TWIDDLE, false );
+		MOVZX8_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE );
+		StoreRegister64( rt, RAX_CODE );
+		break;
+	case OP_LH:
+		XORI( RAX_CODE, U16_TWIDDLE, false );
+		MOVSX16_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE );
+		StoreRegister32( rt, RAX_CODE );
+		break;
+	case OP_LHU:
+		XORI( RAX_CODE, U16_TWIDDLE, false );
+		MOVZX16_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE );
+		StoreRegister64( rt, RAX_CODE );
+		break;
+	case OP_LW:
+		MOV_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE, false );
+		StoreRegister32( rt, RAX_CODE );
+		break;
+	case OP_LWU:
+		MOV_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE, false );
+		StoreRegister64( rt, RAX_CODE );
+		break;
+	case OP_LD:
+		// Doublewords are stored with their words swapped
+		MOV_REG_MEM_BASE_IDX( RAX_CODE, REG_RAM_BASE, RAX_CODE, true );
+		ROLI( RAX_CODE, 32, true );
+		StoreRegister64( rt, RAX_CODE );
+		break;
+
+	case OP_SB:
+		XORI( RAX_CODE, U8_TWIDDLE, false );
+		LoadRegister32( RDX_CODE, rt );
+		MOV8_MEM_BASE_IDX_REG( REG_RAM_BASE, RAX_CODE, RDX_CODE );
+		break;
+	case OP_SH:
+		XORI( RAX_CODE, U16_TWIDDLE, false );
+		LoadRegister32( RDX_CODE, rt );
+		MOV16_MEM_BASE_IDX_REG( REG_RAM_BASE, RAX_CODE, RDX_CODE );
+		break;
+	case OP_SW:
+		LoadRegister32( RDX_CODE, rt );
+		MOV_MEM_BASE_IDX_REG( REG_RAM_BASE, RAX_CODE, RDX_CODE, false );
+		break;
+	case OP_SD:
+		LoadRegister64( RDX_CODE, rt );
+		ROLI( RDX_CODE, 32, true );
+		MOV_MEM_BASE_IDX_REG( REG_RAM_BASE, RAX_CODE, RDX_CODE, true );
+		break;
+
+	default:
+		NODEFAULT;
+	}
+
+	CJumpLocation	done( JMPLong( CCodeLabel( nullptr ) ) );
+
+	// Not rdram - let the interpreter deal with it
+	PatchJumpLong( slow_path, GetAssemblyBuffer()->GetLabel() );
+
+	SetVar( &gCPUState.CurrentPC, address );
+	GenerateGenericR4300( op_code, R4300_GetInstructionHandler( op_code ) );
+	CJumpLocation	exception_handler( GenerateBranchIfSet( const_cast< u32 * >( &gCPUState.StuffToDo ), CCodeLabel( nullptr ) ) );
+
+	PatchJumpLong( done, GetAssemblyBuffer()->GetLabel() );
+
+	return exception_handler;
+}
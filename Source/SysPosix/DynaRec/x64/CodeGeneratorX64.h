@@ -0,0 +1,106 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSPOSIX_DYNAREC_X64_CODEGENERATORX64_H_
+#define SYSPOSIX_DYNAREC_X64_CODEGENERATORX64_H_
+
+#include "DynaRec/CodeGenerator.h"
+#include "DynaRec/TraceRecorder.h"
+#include "SysPosix/DynaRec/x64/AssemblyWriterX64.h"
+#include "SysPosix/DynaRec/x64/DynarecTargetX64.h"
+
+class CCodeGeneratorX64 : public CCodeGenerator, public CAssemblyWriterX64
+{
+	public:
+		CCodeGeneratorX64( CAssemblyBuffer * p_buffer );
+
+		virtual void				Initialise( u32 entry_address, u32 exit_address, u32 * hit_counter, const void * p_base, const SRegisterUsageInfo & register_usage );
+		virtual void				Finalise( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps );
+
+		virtual void				UpdateRegisterCaching( u32 instruction_idx );
+
+		virtual RegisterSnapshotHandle	GetRegisterSnapshot();
+
+		virtual CCodeLabel			GetEntryPoint() const;
+		virtual CCodeLabel			GetCurrentLocation() const;
+		virtual u32					GetCompiledCodeSize() const;
+
+		virtual	CJumpLocation		GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment );
+		virtual void				GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map );
+		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map );
+
+		virtual void				GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot );
+
+		virtual CJumpLocation		GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump);
+
+		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return );
+
+	private:
+				void				SetVar( u32 * p_var, u32 value );
+
+				CJumpLocation		GenerateBranchAlways( CCodeLabel target );
+				CJumpLocation		GenerateBranchIfSet( const u32 * p_var, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfNotSet( const u32 * p_var, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfEqual32( const u32 * p_var, u32 value, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfNotEqual32( const u32 * p_var, u32 value, CCodeLabel target );
+
+				void				GenerateGenericR4300( OpCode op_code, CPU_Instruction p_instruction );
+				void				GenerateGenericR4300Indirect( OpCode op_code );
+
+				void				GenerateExceptionHander( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps );
+
+	private:
+				void				LoadRegister32( EIntelReg reg, EN64Reg n64_reg );
+				void				LoadRegister64( EIntelReg reg, EN64Reg n64_reg );
+				void				StoreRegister32( EN64Reg n64_reg, EIntelReg reg );		// Sign extends reg
+				void				StoreRegister64( EN64Reg n64_reg, EIntelReg reg );
+				void				SetRegister64( EN64Reg n64_reg, s32 value );			// Sign extends value
+				EIntelReg			GetRegisterOperand( EIntelReg scratch, EN64Reg n64_reg, bool is64 );
+
+				void				SetRegisterCaching( const SRegisterUsageInfo & register_usage );
+				void				LoadCachedRegisters();
+				void				FlushCachedRegisters();
+
+				bool				GenerateSpecial( OpCode op_code );
+
+				void				GenerateJ( u32 address, OpCode op_code );
+				void				GenerateJAL( u32 address, OpCode op_code );
+				void				GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op );
+
+				void				GenerateADDIU( EN64Reg rt, EN64Reg rs, s16 immediate );
+				void				GenerateDADDIU( EN64Reg rt, EN64Reg rs, s16 immediate );
+				void				GenerateSLTI( EN64Reg rt, EN64Reg rs, s16 immediate, bool is_unsigned );
+				void				GenerateLogicalImmediate( EN64Reg rt, EN64Reg rs, u16 immediate, u32 op );
+				void				GenerateLUI( EN64Reg rt, s16 immediate );
+
+				CJumpLocation		GenerateMemoryAccess( u32 address, OpCode op_code );
+
+	private:
+				CAssemblyBuffer *	mpPrimary;
+
+				// The host register caching each n64 register, or INVALID_CODE.
+				// This is fixed for the whole fragment.
+				EIntelReg			mCachedRegisters[ NUM_N64_REGS ];
+				u32					mDirtyRegisters;		// Cached registers written by the code emitted so far
+};
+
+#endif // SYSPOSIX_DYNAREC_X64_CODEGENERATORX64_H_
@@ -0,0 +1,257 @@
+#include "stdafx.h"
+
+#ifdef DAEDALUS_ENABLE_DYNAREC
+
+#include "Core/CPU.h"
+#include "Core/Memory.h"
+#include "Core/R4300.h"
+#include "Core/Registers.h"
+#include "DynaRec/CodeBufferManager.h"
+#include "DynaRec/CodeGenerator.h"
+#include "DynaRec/RegisterSpan.h"
+#include "DynaRec/Trace.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Compiles random straight-line fragments with CCodeGeneratorX64, runs them,
+// and compares the registers and memory they leave behind with the interpreter.
+
+// These normally live in SysPosix/main.cpp, which the tests don't link.
+void Dynarec_ClearedCPUStuffToDo()	{}
+void Dynarec_SetCPUStuffToDo()		{}
+
+namespace
+{
+
+static const u32 kNumFragments		= 20000;
+static const u32 kMaxFragmentOps	= 24;
+static const u32 kFragmentStart		= 0x80000400;
+static const u32 kScratchAddress	= 0x80100000;
+static const u32 kScratchSize		= 512;
+
+static bool		gExceptionRaised = false;
+static void		ExceptionHandler()		{ gExceptionRaised = true; }
+
+struct SMachineState
+{
+	u64		GPR[32];
+	u64		Hi;
+	u64		Lo;
+	u8		Ram[kScratchSize];
+};
+
+static void SaveState( SMachineState & state )
+{
+	for( u32 i = 0; i < 32; ++i )
+		state.GPR[i] = gGPR[i]._u64;
+	state.Hi = gCPUState.MultHi._u64;
+	state.Lo = gCPUState.MultLo._u64;
+	memcpy( state.Ram, g_pu8RamBase_8000 + kScratchAddress, kScratchSize );
+}
+
+static void LoadState( const SMachineState & state )
+{
+	for( u32 i = 0; i < 32; ++i )
+		gGPR[i]._u64 = state.GPR[i];
+	gCPUState.MultHi._u64 = state.Hi;
+	gCPUState.MultLo._u64 = state.Lo;
+	memcpy( g_pu8RamBase_8000 + kScratchAddress, state.Ram, kScratchSize );
+}
+
+class CodeGeneratorX64Test : public ::testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		Memory_Init();
+		Memory_Reset();
+		// Keep the event queue non-empty, it's never reached by these fragments.
+		CPU_AddEvent( 0x7fffffff, CPU_EVENT_VBL );
+	}
+
+	virtual void SetUp()
+	{
+		mRng.seed( 1234 );
+		mCodeBuffers = CCodeBufferManager::Create();
+		mCodeBuffers->Initialise();
+	}
+
+	virtual void TearDown()
+	{
+		mCodeBuffers->Finalise();
+		delete mCodeBuffers;
+	}
+
+	u32		Next()			{ return u32( mRng() ); }
+	u64		Next64()		{ return (u64( Next() ) << 32) | Next(); }
+
+	// Mostly ALU ops on r1-r8, with some loads and stores. r29 points into
+	// rdram, which takes the fast path, and r28 at its uncached mirror.
+	OpCode	RandomOpCode()
+	{
+		static const u32 kImmediateOps[] = { OP_ADDIU, OP_ADDI, OP_DADDIU, OP_SLTI, OP_SLTIU, OP_ANDI, OP_ORI, OP_XORI, OP_LUI };
+		static const u32 kSpecialOps[] =
+		{
+			SpecOp_SLL, SpecOp_SRL, SpecOp_SRA, SpecOp_SLLV, SpecOp_SRLV, SpecOp_SRAV,
+			SpecOp_DSLLV, SpecOp_DSRLV, SpecOp_DSRAV,
+			SpecOp_MFHI, SpecOp_MTHI, SpecOp_MFLO, SpecOp_MTLO, SpecOp_MULT, SpecOp_MULTU, SpecOp_DMULTU,
+			SpecOp_ADDU, SpecOp_ADD, SpecOp_SUBU, SpecOp_SUB, SpecOp_AND, SpecOp_OR, SpecOp_XOR, SpecOp_NOR,
+			SpecOp_SLT, SpecOp_SLTU, SpecOp_DADDU, SpecOp_DSUBU, SpecOp_DADD, SpecOp_DSUB,
+			SpecOp_DSLL, SpecOp_DSRL, SpecOp_DSRA, SpecOp_DSLL32, SpecOp_DSRL32, SpecOp_DSRA32,
+		};
+		static const u32 kMemoryOps[]		= { OP_LB, OP_LBU, OP_LH, OP_LHU, OP_LW, OP_LWU, OP_LD, OP_SB, OP_SH, OP_SW, OP_SD };
+		static const u32 kMemoryAlign[]		= { 1,     1,      2,     2,      4,     4,      8,     1,     2,     4,     8 };
+
+		OpCode	op;
+		op._u32 = 0;
+
+		u32		rs( (Next() % 8) == 0 ? 0 : 1 + Next() % 8 );
+		u32		rt( 1 + Next() % 8 );
+		u32		rd( 1 + Next() % 8 );
+		u32		kind( Next() % 100 );
+
+		if( kind < 30 )
+		{
+			op.op = kImmediateOps[ Next() % ARRAYSIZE( kImmediateOps ) ];
+			op.rs = rs;
+			op.rt = rt;
+			op.immediate = Next();
+		}
+		else if( kind < 75 )
+		{
+			op.op = OP_SPECOP;
+			op.spec_op = kSpecialOps[ Next() % ARRAYSIZE( kSpecialOps ) ];
+			op.rs = rs;
+			op.rt = rt;
+			op.rd = rd;
+			op.sa = Next() & 31;
+		}
+		else
+		{
+			u32		i( Next() % ARRAYSIZE( kMemoryOps ) );
+			bool	is_store( kMemoryOps[i] >= OP_SB );
+
+			op.op = kMemoryOps[i];
+			op.base = (Next() & 3) == 0 ? N64Reg_GP : N64Reg_SP;
+			op.rt = (is_store && (Next() % 8) == 0) ? 0 : rt;
+			op.immediate = (Next() % (kScratchSize / 2)) & ~(kMemoryAlign[i] - 1);
+		}
+		return op;
+	}
+
+	std::mt19937			mRng;
+	CCodeBufferManager *	mCodeBuffers;
+};
+
+}
+
+TEST_F(CodeGeneratorX64Test, MatchesInterpreter)
+{
+	for( u32 run = 0; run < kNumFragments; ++run )
+	{
+		u32							num_ops( 1 + Next() % kMaxFragmentOps );
+		std::vector< STraceEntry >	trace( num_ops );
+		SRegisterUsageInfo			usage;
+		s32							span_start[32];
+		s32							span_end[32];
+
+		std::fill( span_start, span_start + 32, s32( num_ops ) );
+		std::fill( span_end, span_end + 32, -1 );
+
+		for( u32 i = 0; i < num_ops; ++i )
+		{
+			STraceEntry & entry( trace[i] );
+
+			entry.Address = kFragmentStart + i * 4;
+			entry.OpCode = RandomOpCode();
+			entry.BranchIdx = u32(~0);
+			entry.BranchDelaySlot = false;
+			StaticAnalysis::Analyse( entry.OpCode, entry.Usage );
+
+			usage.RegistersRead    |= entry.Usage.RegReads;
+			usage.RegistersWritten |= entry.Usage.RegWrites;
+			usage.RegistersAsBases |= entry.Usage.RegBase;
+
+			u32		regs_used( entry.Usage.RegReads | entry.Usage.RegWrites | entry.Usage.RegBase );
+			for( u32 r = 1; r < 32; ++r )
+			{
+				if( regs_used & (1 << r) )
+				{
+					span_start[r] = std::min( span_start[r], s32( i ) );
+					span_end[r]   = std::max( span_end[r], s32( i ) );
+				}
+			}
+		}
+		for( u32 r = 1; r < 32; ++r )
+		{
+			if( span_start[r] <= span_end[r] )
+				usage.SpanList.push_back( SRegisterSpan( EN64Reg( r ), span_start[r], span_end[r] ) );
+		}
+
+		CCodeGenerator *	generator( mCodeBuffers->StartNewBlock() );
+		CCodeLabel			entry_point( generator->GetEntryPoint() );
+		std::vector< CJumpLocation >	exception_jumps;
+
+		generator->Initialise( kFragmentStart, kFragmentStart + num_ops * 4, nullptr, &gCPUState, usage );
+		for( u32 i = 0; i < num_ops; ++i )
+		{
+			generator->UpdateRegisterCaching( i );
+
+			CJumpLocation	branch_jump( nullptr );
+			CJumpLocation	exception_jump( generator->GenerateOpCode( trace[i], false, nullptr, &branch_jump ) );
+			if( exception_jump.IsSet() )
+				exception_jumps.push_back( exception_jump );
+		}
+		generator->GenerateExitCode( kFragmentStart + num_ops * 4, 0, num_ops, CCodeLabel( nullptr ) );
+		generator->Finalise( ExceptionHandler, exception_jumps );
+		mCodeBuffers->FinaliseCurrentBlock();
+		delete generator;
+
+		SMachineState	initial;
+		for( u32 r = 0; r < 32; ++r )
+			initial.GPR[r] = (Next() & 1) ? Next64() : u64( s64( s32( Next() ) ) );
+		initial.GPR[N64Reg_R0] = 0;
+		initial.GPR[N64Reg_SP] = u64( s64( s32( kScratchAddress ) ) );
+		initial.GPR[N64Reg_GP] = u64( s64( s32( kScratchAddress | 0x20000000 ) ) );
+		initial.Hi = Next64();
+		initial.Lo = Next64();
+		for( u32 i = 0; i < kScratchSize; ++i )
+			initial.Ram[i] = u8( Next() );
+
+		SMachineState	expected;
+		LoadState( initial );
+		for( u32 i = 0; i < num_ops; ++i )
+		{
+			gCPUState.CurrentPC = trace[i].Address;
+			R4300_GetInstructionHandler( trace[i].OpCode )( trace[i].OpCode._u32 );
+			gGPR[N64Reg_R0]._u64 = 0;
+		}
+		SaveState( expected );
+
+		SMachineState	actual;
+		LoadState( initial );
+		gCPUState.StuffToDo = 0;
+		gExceptionRaised = false;
+		_EnterDynaRec( entry_point.GetTarget(), &gCPUState, g_pu8RamBase_8000, 0x80000000 + gRamSize );
+		SaveState( actual );
+
+		ASSERT_FALSE( gExceptionRaised ) << "run " << run;
+		for( u32 r = 0; r < 32; ++r )
+			ASSERT_EQ( expected.GPR[r], actual.GPR[r] ) << "run " << run << " r" << r;
+		ASSERT_EQ( expected.Hi, actual.Hi ) << "run " << run;
+		ASSERT_EQ( expected.Lo, actual.Lo ) << "run " << run;
+		ASSERT_EQ( 0, memcmp( expected.Ram, actual.Ram, kScratchSize ) ) << "run " << run;
+
+		// Start again before the code buffer fills up.
+		if( (run & 1023) == 1023 )
+			mCodeBuffers->Reset();
+	}
+}
+
+#endif // DAEDALUS_ENABLE_DYNAREC
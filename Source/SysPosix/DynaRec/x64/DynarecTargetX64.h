@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSPOSIX_DYNAREC_X64_DYNARECTARGETX64_H_
+#define SYSPOSIX_DYNAREC_X64_DYNARECTARGETX64_H_
+
+// x86-64 register codes. Codes 8-15 need a REX prefix bit to encode
+enum EIntelReg {
+	INVALID_CODE = 0xFFFFFFFF,
+	RAX_CODE = 0,
+	RCX_CODE = 1,
+	RDX_CODE = 2,
+	RBX_CODE = 3,
+	RSP_CODE = 4,
+	RBP_CODE = 5,
+	RSI_CODE = 6,
+	RDI_CODE = 7,
+	R8_CODE = 8,
+	R9_CODE = 9,
+	R10_CODE = 10,
+	R11_CODE = 11,
+	R12_CODE = 12,
+	R13_CODE = 13,
+	R14_CODE = 14,
+	R15_CODE = 15,
+
+	NUM_X64_REGISTERS = 16,
+};
+
+// Registers which hold fixed values for the lifetime of a fragment (set up by _EnterDynaRec)
+static const EIntelReg	REG_MEM_LIMIT	= R13_CODE;		// RDRAM size (compared against physical address)
+static const EIntelReg	REG_RAM_BASE	= R14_CODE;		// g_pu8RamBase_8000
+static const EIntelReg	REG_STATE_BASE	= R15_CODE;		// &gCPUState
+
+// RBX, RBP and R12 cache n64 registers (see CodeGeneratorX64.cpp)
+
+#endif // SYSPOSIX_DYNAREC_X64_DYNARECTARGETX64_H_
@@ -1,10 +1,493 @@
+/*
+Copyright (C) 2003 Azimer
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+//
+//	N.B. This source code is derived from Azimer's Audio plugin (v0.55?)
+//	and modified by StrmnNrmn to work with Daedalus PSP. Thanks Azimer!
+//	Drop me a line if you get chance :)
+//
+
 #include "stdafx.h"
 #include "Plugins/AudioPlugin.h"
+
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
 #include "Config/ConfigOptions.h"
+#include "Core/CPU.h"
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+#include "HLEAudio/AudioBuffer.h"
+#include "HLEAudio/audiohle.h"
+#include "Utility/FramerateLimiter.h"
+#include "Utility/Thread.h"
+#include "Utility/Timing.h"
 
 EAudioPluginMode gAudioPluginEnabled = APM_DISABLED;
+EAudioOutput	 gAudioOutput = AO_DEVICE;
+IO::Filename	 gAudioOutputFilename = "audio.wav";
+EAudioResampleQuality gAudioResampleQuality = ARQ_SINC;
+
+#define DEBUG_AUDIO  0
+
+#if DEBUG_AUDIO
+#define DPF_AUDIO(...)	do { printf(__VA_ARGS__); } while(0)
+#else
+#define DPF_AUDIO(...)	do { (void)sizeof(__VA_ARGS__); } while(0)
+#endif
+
+static const u32 kOutputFrequency = 44100;
+static const u32 kAudioBufferSize = 1024 * 1024;	// Circular buffer length. Converts N64 samples out our output rate.
+static const u32 kNumChannels = 2;
+
+// Roughly how long the RSP spends on an audio list (~2ms), so async lists
+// complete at about the point they would on hardware.
+static const u32 kAudioTaskCycles = 8000;
+
+// How much input we try to keep buffered in the synchronisation code.
+// Setting this too low and we run the risk of skipping.
+// Setting this too high and we run the risk of being very laggy.
+static const u32 kMaxBufferLengthMs = 30;
+
+// Number of samples pulled from the buffer at a time, by SDL or by our own
+// output thread when writing to a file (or nowhere). ~23ms at 44100Hz.
+static const u32 kOutputPeriodSamples = 1024;
+
+class AudioPluginLinux : public CAudioPlugin
+{
+public:
+	AudioPluginLinux();
+	virtual ~AudioPluginLinux();
+
+	virtual bool			StartEmulation();
+	virtual void			StopEmulation();
+
+	virtual void			DacrateChanged(int system_type);
+	virtual void			LenChanged();
+	virtual u32				ReadLength()			{ return 0; }
+	virtual EProcessResult	ProcessAList();
+
+	void					AddBuffer(void * ptr, u32 length);	// Uploads a new buffer and returns status
+
+	void					StopAudio();						// Stops the Audio PlayBack (as if paused)
+	void					StartAudio();						// Starts the Audio PlayBack (as if unpaused)
+
+	static void				AudioSyncFunction(void * arg);
+	static void				AudioCallback(void * arg, Uint8 * stream, int len);
+	static u32				AudioThread(void * arg);
+
+private:
+	bool					OpenDevice();
+	void					CloseDevice();
+	bool					OpenWaveFile();
+	void					CloseWaveFile();
+	void					UpdateBufferLength();
+
+private:
+	CAudioBuffer			mAudioBuffer;
+	u32						mFrequency;
+	SDL_AudioDeviceID		mDevice;
+	FILE *					mWaveFile;
+	u32						mWaveBytes;
+	ThreadHandle			mAudioThread;
+	volatile bool			mKeepRunning;	// Should the audio thread keep running?
+	bool					mAudioStarted;
+
+	volatile u32			mBufferLenMs;
+};
+
+AudioPluginLinux::AudioPluginLinux()
+:	mAudioBuffer( kAudioBufferSize )
+,	mFrequency( 44100 )
+,	mDevice( 0 )
+,	mWaveFile( NULL )
+,	mWaveBytes( 0 )
+,	mAudioThread( kInvalidThreadHandle )
+,	mKeepRunning( false )
+,	mAudioStarted( false )
+,	mBufferLenMs( 0 )
+{
+}
+
+AudioPluginLinux::~AudioPluginLinux()
+{
+	StopAudio();
+}
+
+bool AudioPluginLinux::StartEmulation()
+{
+	return true;
+}
+
+void AudioPluginLinux::StopEmulation()
+{
+	Audio_Reset();
+	StopAudio();
+}
+
+void AudioPluginLinux::DacrateChanged(int system_type)
+{
+	u32 clock      = (system_type == ST_NTSC) ? VI_NTSC_CLOCK : VI_PAL_CLOCK;
+	u32 dacrate   = Memory_AI_GetRegister(AI_DACRATE_REG);
+	u32	frequency = clock / (dacrate + 1);
+
+	DBGConsole_Msg(0, "Audio frequency: %d", frequency);
+	mFrequency = frequency;
+}
+
+void AudioPluginLinux::LenChanged()
+{
+	if (gAudioPluginEnabled > APM_DISABLED)
+	{
+		u32	address = Memory_AI_GetRegister(AI_DRAM_ADDR_REG) & 0xFFFFFF;
+		u32	length  = Memory_AI_GetRegister(AI_LEN_REG);
+
+		AddBuffer( g_pu8RamBase + address, length );
+	}
+	else
+	{
+		StopAudio();
+	}
+}
+
+EProcessResult AudioPluginLinux::ProcessAList()
+{
+	Memory_SP_SetRegisterBits(SP_STATUS_REG, SP_STATUS_HALT);
+
+	EProcessResult result = PR_NOT_STARTED;
+
+	switch (gAudioPluginEnabled)
+	{
+		case APM_DISABLED:
+			result = PR_COMPLETED;
+			break;
+		case APM_ENABLED_ASYNC:
+			if (Audio_UcodeAsync())
+			{
+				// CPU_EVENT_AUDIO waits for the worker and raises the SP interrupt.
+				CPU_AddEvent(kAudioTaskCycles, CPU_EVENT_AUDIO);
+				result = PR_STARTED;
+			}
+			else
+			{
+				Audio_Ucode();
+				result = PR_COMPLETED;
+			}
+			break;
+		case APM_ENABLED_SYNC:
+			Audio_Ucode();
+			result = PR_COMPLETED;
+			break;
+	}
+
+	return result;
+}
+
+void AudioPluginLinux::AddBuffer(void * ptr, u32 length)
+{
+	if (length == 0)
+		return;
+
+	if (!mAudioStarted)
+		StartAudio();
+
+	u32 num_samples = length / sizeof( Sample );
+
+	mAudioBuffer.AddSamples( reinterpret_cast<const Sample *>(ptr), num_samples, mFrequency, kOutputFrequency );
+
+	UpdateBufferLength();
+	float ms = (float)num_samples * 1000.f / (float)mFrequency;
+	DPF_AUDIO("Queuing %d samples @%dHz - %.2fms - bufferlen now %d\n",
+		num_samples, mFrequency, ms, mBufferLenMs);
+}
+
+void AudioPluginLinux::UpdateBufferLength()
+{
+	u32 remaining_samples = mAudioBuffer.GetNumBufferedSamples();
+	mBufferLenMs = (1000 * remaining_samples) / kOutputFrequency;
+}
+
+//*****************************************************************************
+//	Called by SDL on its own thread whenever the device wants more data.
+//*****************************************************************************
+void AudioPluginLinux::AudioCallback(void * arg, Uint8 * stream, int len)
+{
+	AudioPluginLinux * plugin = static_cast<AudioPluginLinux *>(arg);
+
+	u32 num_samples     = len / sizeof(Sample);
+	u32 samples_written = plugin->mAudioBuffer.Drain(reinterpret_cast<Sample *>(stream), num_samples);
+
+	plugin->UpdateBufferLength();
+
+	if (samples_written == 0)
+	{
+		// Drain has already filled the stream with silence.
+		DPF_AUDIO("********************* Audio buffer is empty ***********************\n");
+	}
+}
+
+//*****************************************************************************
+//	Drains the buffer in real time when there's no device to do it for us,
+//	optionally writing what it plays to a wave file.
+//*****************************************************************************
+u32 AudioPluginLinux::AudioThread(void * arg)
+{
+	AudioPluginLinux * plugin = static_cast<AudioPluginLinux *>(arg);
+
+	Sample	period[kOutputPeriodSamples];
+
+	u64 freq;
+	u64 start_time;
+	NTiming::GetPreciseFrequency(&freq);
+	NTiming::GetPreciseTime(&start_time);
+
+	u64 samples_played = 0;
+
+	while (plugin->mKeepRunning)
+	{
+		plugin->mAudioBuffer.Drain(period, kOutputPeriodSamples);
+		plugin->UpdateBufferLength();
+
+		if (plugin->mWaveFile != NULL)
+		{
+			fwrite(period, sizeof(Sample), kOutputPeriodSamples, plugin->mWaveFile);
+			plugin->mWaveBytes += kOutputPeriodSamples * sizeof(Sample);
+		}
+
+		samples_played += kOutputPeriodSamples;
+
+		// Sleep until this period would have finished playing.
+		u64 now;
+		NTiming::GetPreciseTime(&now);
+
+		u64 due = start_time + (samples_played * freq) / kOutputFrequency;
+		if (due > now)
+		{
+			ThreadSleepMs(u32(NTiming::ToMilliseconds(due - now)));
+		}
+	}
+
+	return 0;
+}
+
+void AudioPluginLinux::AudioSyncFunction(void * arg)
+{
+	AudioPluginLinux * plugin = static_cast<AudioPluginLinux *>(arg);
+#if DEBUG_AUDIO
+	static u64 last_time = 0;
+	u64 now;
+	NTiming::GetPreciseTime(&now);
+	if (last_time == 0) last_time = now;
+	DPF_AUDIO("VBL: %dms elapsed. Audio buffer len %dms\n", (s32)NTiming::ToMilliseconds(now-last_time), plugin->mBufferLenMs);
+	last_time = now;
+#endif
+
+	u32 buffer_len = plugin->mBufferLenMs;	// NB: copy this volatile to a local var so that we have a consistent view for the remainder of this function.
+	if (buffer_len > kMaxBufferLengthMs)
+	{
+		ThreadSleepMs(buffer_len - kMaxBufferLengthMs);
+	}
+}
+
+bool AudioPluginLinux::OpenDevice()
+{
+	// SDL picks PulseAudio or ALSA (or whatever SDL_AUDIODRIVER asks for).
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+	{
+		DBGConsole_Msg(0, "Couldn't initialise SDL audio: %s", SDL_GetError());
+		return false;
+	}
+
+	SDL_AudioSpec desired;
+	SDL_AudioSpec obtained;
+	memset(&desired, 0, sizeof(desired));
+
+	desired.freq     = kOutputFrequency;
+	desired.format   = AUDIO_S16SYS;
+	desired.channels = kNumChannels;
+	desired.samples  = kOutputPeriodSamples;
+	desired.callback = &AudioCallback;
+	desired.userdata = this;
+
+	// Let SDL convert if the device wants something else.
+	mDevice = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+	if (mDevice == 0)
+	{
+		DBGConsole_Msg(0, "Couldn't open audio device: %s", SDL_GetError());
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+
+	DBGConsole_Msg(0, "Audio output: %s", SDL_GetCurrentAudioDriver());
+	SDL_PauseAudioDevice(mDevice, 0);
+	return true;
+}
+
+void AudioPluginLinux::CloseDevice()
+{
+	if (mDevice == 0)
+		return;
+
+	SDL_CloseAudioDevice(mDevice);
+	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	mDevice = 0;
+}
+
+//*****************************************************************************
+//	Canonical 44 byte RIFF header. The sizes are patched in CloseWaveFile.
+//*****************************************************************************
+static void WriteWaveHeader(FILE * fh, u32 data_bytes)
+{
+	const u32 bytes_per_frame = kNumChannels * sizeof(s16);
+
+	struct
+	{
+		char	riff[4];
+		u32		riff_size;
+		char	wave[4];
+		char	fmt[4];
+		u32		fmt_size;
+		u16		format;
+		u16		channels;
+		u32		sample_rate;
+		u32		byte_rate;
+		u16		block_align;
+		u16		bits_per_sample;
+		char	data[4];
+		u32		data_size;
+	} header;
+
+	DAEDALUS_STATIC_ASSERT( sizeof(header) == 44 );
+
+	memcpy(header.riff, "RIFF", 4);
+	header.riff_size       = 36 + data_bytes;
+	memcpy(header.wave, "WAVE", 4);
+	memcpy(header.fmt,  "fmt ", 4);
+	header.fmt_size        = 16;
+	header.format          = 1;		// PCM
+	header.channels        = kNumChannels;
+	header.sample_rate     = kOutputFrequency;
+	header.byte_rate       = kOutputFrequency * bytes_per_frame;
+	header.block_align     = bytes_per_frame;
+	header.bits_per_sample = 16;
+	memcpy(header.data, "data", 4);
+	header.data_size       = data_bytes;
+
+	fwrite(&header, sizeof(header), 1, fh);
+}
+
+bool AudioPluginLinux::OpenWaveFile()
+{
+	mWaveFile = fopen(gAudioOutputFilename, "wb");
+	if (mWaveFile == NULL)
+	{
+		DBGConsole_Msg(0, "Couldn't open %s for audio output", gAudioOutputFilename);
+		return false;
+	}
+
+	mWaveBytes = 0;
+	WriteWaveHeader(mWaveFile, 0);
+
+	DBGConsole_Msg(0, "Audio output: %s", gAudioOutputFilename);
+	return true;
+}
+
+void AudioPluginLinux::CloseWaveFile()
+{
+	if (mWaveFile == NULL)
+		return;
+
+	fseek(mWaveFile, 0, SEEK_SET);
+	WriteWaveHeader(mWaveFile, mWaveBytes);
+	fclose(mWaveFile);
+	mWaveFile = NULL;
+}
+
+void AudioPluginLinux::StartAudio()
+{
+	if (mAudioStarted)
+		return;
+
+	// We're on the thread which adds samples, so it's safe to configure the buffer here.
+	// Rate control aims for the level the sync function holds the buffer at, so it only
+	// kicks in when the emulator can't keep up or the host clocks disagree.
+	mAudioBuffer.SetResampleQuality(gAudioResampleQuality);
+	mAudioBuffer.SetRateControl((kOutputFrequency * kMaxBufferLengthMs) / 1000);
+
+	bool use_thread = true;
+	switch (gAudioOutput)
+	{
+		case AO_DEVICE:
+			// Fall back to the null output if there's no device (e.g. headless)
+			use_thread = !OpenDevice();
+			break;
+		case AO_WAVE_FILE:
+			OpenWaveFile();
+			break;
+		case AO_NULL:
+			break;
+	}
+
+	if (use_thread)
+	{
+		mKeepRunning = true;
+
+		mAudioThread = CreateThread("Audio", &AudioThread, this);
+		if (mAudioThread == kInvalidThreadHandle)
+		{
+			DBGConsole_Msg(0, "Failed to start the audio thread!");
+			mKeepRunning = false;
+			CloseWaveFile();
+			return;
+		}
+	}
+
+	// Install the sync function.
+	FramerateLimiter_SetAuxillarySyncFunction(&AudioSyncFunction, this);
+	mAudioStarted = true;
+}
+
+void AudioPluginLinux::StopAudio()
+{
+	if (!mAudioStarted)
+		return;
+
+	// Tell the thread to stop running.
+	mKeepRunning = false;
+
+	if (mAudioThread != kInvalidThreadHandle)
+	{
+		JoinThread(mAudioThread, -1);
+		mAudioThread = kInvalidThreadHandle;
+	}
+
+	CloseDevice();
+	CloseWaveFile();
+
+	// Remove the sync function.
+	FramerateLimiter_SetAuxillarySyncFunction(NULL, NULL);
+	mAudioStarted = false;
+}
 
 CAudioPlugin * CreateAudioPlugin()
 {
-	return NULL;
+	return new AudioPluginLinux();
 }
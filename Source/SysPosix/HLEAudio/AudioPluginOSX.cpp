@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <CoreFoundation/CFRunLoop.h>
 
 #include "Config/ConfigOptions.h"
+#include "Core/CPU.h"
 #include "Core/Memory.h"
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/AudioBuffer.h"
@@ -56,6 +57,10 @@ static const u32 kOutputFrequency = 44100;
 static const u32 kAudioBufferSize = 1024 * 1024;	// Circular buffer length. Converts N64 samples out our output rate.
 static const u32 kNumChannels = 2;
 
+// Roughly how long the RSP spends on an audio list (~2ms), so async lists
+// complete at about the point they would on hardware.
+static const u32 kAudioTaskCycles = 8000;
+
 // How much input we try to keep buffered in the synchronisation code.
 // Setting this too low and we run the risk of skipping.
 // Setting this too high and we run the risk of being very laggy.
@@ -161,9 +166,17 @@ EProcessResult AudioPluginOSX::ProcessAList()
 			result = PR_COMPLETED;
 			break;
 		case APM_ENABLED_ASYNC:
-			DAEDALUS_ERROR("Async audio is unimplemented");
-			Audio_Ucode();
-			result = PR_COMPLETED;
+			if (Audio_UcodeAsync())
+			{
+				// CPU_EVENT_AUDIO waits for the worker and raises the SP interrupt.
+				CPU_AddEvent(kAudioTaskCycles, CPU_EVENT_AUDIO);
+				result = PR_STARTED;
+			}
+			else
+			{
+				Audio_Ucode();
+				result = PR_COMPLETED;
+			}
 			break;
 		case APM_ENABLED_SYNC:
 			Audio_Ucode();
@@ -268,6 +268,7 @@ void DLDebugger_ProcessDebugTask()
 				// Make the BYTE array, factor of 3 because it's RBG.
 				void * pixels = malloc( 4 * width * height );
 
+				FlushBatchedDraws();
 				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
 				// NB, pass a negative pitch, to render the screenshot the right way up.
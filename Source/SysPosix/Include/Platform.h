@@ -32,6 +32,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define DAEDALUS_COMPRESSED_ROM_SUPPORT
 //#define DAEDALUS_ENABLE_OS_HOOKS
 
+// The dynarec is currently only implemented for x86-64 Linux
+#if defined(DAEDALUS_LINUX) && defined(__x86_64__)
+#define DAEDALUS_ENABLE_DYNAREC
+#endif
+
 #define DAEDALUS_ENDIAN_MODE DAEDALUS_ENDIAN_LITTLE
 
 #ifdef __GNUC__
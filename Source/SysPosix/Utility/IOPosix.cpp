@@ -20,10 +20,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "Utility/IO.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 namespace IO
 {
@@ -54,6 +57,35 @@ namespace IO
 				return false;
 			}
 		}
+
+		bool	GetSizeAndTime( const char * p_file, u64 * p_size, u64 * p_time )
+		{
+			struct stat s;
+			if ( stat( p_file, &s ) != 0 )
+				return false;
+
+			*p_size = s.st_size;
+			*p_time = s.st_mtime;
+			return true;
+		}
+
+		void *	Map( const char * p_file, u32 size )
+		{
+			int fd = open( p_file, O_RDONLY );
+			if ( fd < 0 )
+				return nullptr;
+
+			void * p_mem = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+
+			// The mapping keeps its own reference to the file
+			close( fd );
+			return p_mem != MAP_FAILED ? p_mem : nullptr;
+		}
+
+		void	Unmap( void * p_mem, u32 size )
+		{
+			munmap( p_mem, size );
+		}
 	}
 	namespace Directory
 	{
@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Utility/IO.h"
 #include "Utility/PathsPosix.h"
 #include "Config/ConfigOptions.h"
+#include "SysGL/Graphics/FrameCaptureGL.h"
 
 #include <SDL2/SDL.h>
 #ifdef DAEDALUS_LINUX
@@ -60,6 +61,35 @@ int main(int argc, char **argv)
 
 	//ReadConfiguration();
 
+#ifdef DAEDALUS_LINUX
+	// The graphics context is created by System_Init(), so this has to be known up front.
+	for (int i = 1; i+1 < argc; ++i)
+	{
+		if (strcmp( argv[i], "--video" ) == 0)
+		{
+			// --video window|headless|null
+			const char * output = argv[i+1];
+
+			if (strcmp( output, "window" ) == 0)
+			{
+				gVideoOutput = VO_WINDOW;
+			}
+			else if (strcmp( output, "headless" ) == 0)
+			{
+				gVideoOutput = VO_HEADLESS;
+			}
+			else if (strcmp( output, "null" ) == 0)
+			{
+				gVideoOutput = VO_NULL;
+			}
+			else
+			{
+				fprintf(stderr, "Unknown video output '%s'\n", output);
+			}
+		}
+	}
+#endif
+
 	if (!System_Init())
 	{
 		return 1;
@@ -95,6 +125,76 @@ int main(int argc, char **argv)
 						CRomDB::Get()->AddRomDirectory(dir);
 					}
 				}
+#ifdef DAEDALUS_LINUX
+				else if (strcmp( arg, "-audio" ) == 0 )
+				{
+					// --audio device|null|<filename.wav>
+					if (i+1 < argc)
+					{
+						const char * output = argv[i+1];
+						++i;
+
+						if (strcmp( output, "device" ) == 0)
+						{
+							gAudioOutput = AO_DEVICE;
+						}
+						else if (strcmp( output, "null" ) == 0)
+						{
+							gAudioOutput = AO_NULL;
+						}
+						else
+						{
+							gAudioOutput = AO_WAVE_FILE;
+							strncpy( gAudioOutputFilename, output, sizeof(gAudioOutputFilename) - 1 );
+						}
+					}
+				}
+				else if (strcmp( arg, "-video" ) == 0 )
+				{
+					// Handled before System_Init(), just skip the argument
+					++i;
+				}
+				else if (strcmp( arg, "-dump-frames" ) == 0 )
+				{
+					// --dump-frames <filename.y4m|filename.rgb>
+					if (i+1 < argc)
+					{
+						const char * output = argv[i+1];
+						++i;
+
+						if (!FrameCapture_StartVideo( output ))
+						{
+							fprintf(stderr, "Couldn't open '%s' for frame dumping\n", output);
+						}
+					}
+				}
+				else if (strcmp( arg, "-resampler" ) == 0 )
+				{
+					// --resampler linear|cubic|sinc
+					if (i+1 < argc)
+					{
+						const char * quality = argv[i+1];
+						++i;
+
+						if (strcmp( quality, "linear" ) == 0)
+						{
+							gAudioResampleQuality = ARQ_LINEAR;
+						}
+						else if (strcmp( quality, "cubic" ) == 0)
+						{
+							gAudioResampleQuality = ARQ_CUBIC;
+						}
+						else if (strcmp( quality, "sinc" ) == 0)
+						{
+							gAudioResampleQuality = ARQ_SINC;
+						}
+						else
+						{
+							fprintf(stderr, "Unknown resampler '%s'\n", quality);
+						}
+					}
+				}
+#endif
 			}
 			else
 			{
@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <Shlwapi.h>
 #include <io.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 
 namespace IO
@@ -42,6 +44,17 @@ namespace IO
 		{
 			return ::PathFileExists( p_path ) ? true : false;
 		}
+
+		bool	GetSizeAndTime( const char * p_file, u64 * p_size, u64 * p_time )
+		{
+			struct _stat64 s;
+			if ( _stat64( p_file, &s ) != 0 )
+				return false;
+
+			*p_size = s.st_size;
+			*p_time = s.st_mtime;
+			return true;
+		}
 	}
 	namespace Directory
 	{
@@ -44,6 +44,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 
 #include "Utility/FramerateLimiter.h"
+#ifndef DAEDALUS_PSP
+#include "Utility/JobSystem.h"
+#endif
 #include "Utility/Synchroniser.h"
 #include "Utility/Macros.h"
 #include "Utility/Profiler.h"
@@ -163,6 +166,9 @@ static const SysEntityEntry gSysInitTable[] =
 #endif
 #ifdef DAEDALUS_ENABLE_PROFILING
 	{"Profiler",			Profiler_Init,				Profiler_Fini},
+#endif
+#ifndef DAEDALUS_PSP
+	{"JobSystem",			JobSystem_Init,				JobSystem_Fini},
 #endif
 	{"ROM Database",		CRomDB::Create,				CRomDB::Destroy},
 	{"ROM Settings",		CRomSettingsDB::Create,		CRomSettingsDB::Destroy},
@@ -47,6 +47,20 @@ inline u32 AtomicBitSet( volatile u32 * ptr, u32 and_bits, u32 or_bits )
 	return _AtomicBitSet( ptr, and_bits, or_bits );
 }
 
+// Single core, so it's enough to stop the compiler reordering around these
+inline u32 AtomicLoadAcquire( const volatile u32 * ptr )
+{
+	u32 value = *ptr;
+	asm volatile( "" ::: "memory" );
+	return value;
+}
+
+inline void AtomicStoreRelease( volatile u32 * ptr, u32 value )
+{
+	asm volatile( "" ::: "memory" );
+	*ptr = value;
+}
+
 #elif defined( DAEDALUS_W32 )
 
 #include <intrin.h>
@@ -80,27 +94,64 @@ inline u32 AtomicBitSet( volatile u32 * ptr, u32 and_bits, u32 or_bits )
 	return new_value;
 }
 
+inline bool AtomicCompareAndSwap( volatile u32 * ptr, u32 expected, u32 desired )
+{
+	return _InterlockedCompareExchange( reinterpret_cast< volatile LONG * >( ptr ), desired, expected ) == (LONG)expected;
+}
+
+// x86 doesn't reorder loads with loads or stores with stores, so only the compiler needs fencing
+inline u32 AtomicLoadAcquire( const volatile u32 * ptr )
+{
+	u32 value = *ptr;
+	_ReadWriteBarrier();
+	return value;
+}
+
+inline void AtomicStoreRelease( volatile u32 * ptr, u32 value )
+{
+	_ReadWriteBarrier();
+	*ptr = value;
+}
+
 #elif defined( DAEDALUS_POSIX)
 
 inline u32 AtomicIncrement( volatile u32 * ptr )
 {
-	DAEDALUS_ASSERT(false, "FIXME");
-	return *ptr++;
+	return __sync_add_and_fetch( ptr, 1 );
 }
 
 inline u32 AtomicDecrement( volatile u32 * ptr )
 {
-	DAEDALUS_ASSERT(false, "FIXME");
-	return *ptr--;
+	return __sync_sub_and_fetch( ptr, 1 );
 }
 
 inline u32 AtomicBitSet( volatile u32 * ptr, u32 and_bits, u32 or_bits )
 {
-	u32 r = *ptr;
-	r &= and_bits;
-	r |= or_bits;
-	*ptr = r;
-	return r;
+	u32 new_value;
+	u32 orig_value;
+	do
+	{
+		orig_value = *ptr;
+		new_value = (orig_value & and_bits) | or_bits;
+	}
+	while ( !__sync_bool_compare_and_swap( ptr, orig_value, new_value ) );
+
+	return new_value;
+}
+
+inline bool AtomicCompareAndSwap( volatile u32 * ptr, u32 expected, u32 desired )
+{
+	return __sync_bool_compare_and_swap( ptr, expected, desired );
+}
+
+inline u32 AtomicLoadAcquire( const volatile u32 * ptr )
+{
+	return __atomic_load_n( ptr, __ATOMIC_ACQUIRE );
+}
+
+inline void AtomicStoreRelease( volatile u32 * ptr, u32 value )
+{
+	__atomic_store_n( ptr, value, __ATOMIC_RELEASE );
 }
 
 
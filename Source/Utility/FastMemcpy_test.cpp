@@ -2,6 +2,7 @@
 #include "Utility/FastMemcpy.h"
 #include "Utility/Endian.h"
 #include "Utility/Alignment.h"
+#include "Utility/Timing.h"
 
 #include <gtest/gtest.h>
 
@@ -56,4 +57,78 @@ TEST_P(MemcpyByteSwapTest, WorksWithSmallCopies)
 
 INSTANTIATE_TEST_CASE_P(X, MemcpyByteSwapTest, ::testing::Combine(::testing::Values(0,1,2,3),
 																  ::testing::Values(0,1,2,3), 
-																  ::testing::Values(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16)));
\ No newline at end of file
+																  ::testing::Values(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16)));
+
+// Big enough for the vectorised loops to run, with a scalar head and tail either side.
+class MemcpyByteSwapLargeTest : public ::testing::TestWithParam< ::std::tr1::tuple<u32, u32, u32> >
+{
+protected:
+	virtual void SetUp()
+	{
+		for (u32 i = 0; i < 512; ++i)
+			mSrc[i] = u8(i * 7 + 3);
+		memset(mDst, 0, sizeof(mDst));
+		memset(mExpected, 0, sizeof(mExpected));
+	}
+
+	ALIGNED_MEMBER(u8, mSrc[512], 64);
+	ALIGNED_MEMBER(u8, mDst[512], 64);
+	ALIGNED_MEMBER(u8, mExpected[512], 64);
+};
+
+TEST_P(MemcpyByteSwapLargeTest, WorksWithLargeCopies)
+{
+	u32 src_off = ::std::tr1::get<0>(GetParam());
+	u32 dst_off = ::std::tr1::get<1>(GetParam());
+	u32 len = ::std::tr1::get<2>(GetParam());
+
+	memcpy_byteswap(&mDst[dst_off], &mSrc[src_off], len);
+	memcpy_byteswap_reference(mExpected, dst_off, mSrc, src_off, len);
+	for (u32 i = 0; i < 512; ++i)
+		EXPECT_EQ(mExpected[i], mDst[i]);
+}
+
+INSTANTIATE_TEST_CASE_P(X, MemcpyByteSwapLargeTest, ::testing::Combine(::testing::Values(0,1,2,3,5,18),
+																	   ::testing::Values(0,1,2,3,6,17),
+																	   ::testing::Values(17,31,32,33,63,64,65,127,128,129,255,256,257,400)));
+
+
+// Throughput from 8 bytes to 64MB, for each relative alignment of src and dst.
+// Run with --gtest_also_run_disabled_tests.
+TEST(memcpy_byteswap, DISABLED_Benchmark)
+{
+	const size_t kMaxSize = 64 * 1024 * 1024;
+	u8 * src = (u8 *)malloc(kMaxSize + 16);
+	u8 * dst = (u8 *)malloc(kMaxSize + 16);
+	for (size_t i = 0; i < kMaxSize + 16; ++i)
+		src[i] = u8(i);
+	memset(dst, 0, kMaxSize + 16);
+
+	u64 freq;
+	NTiming::GetPreciseFrequency(&freq);
+
+	for (size_t size = 8; size <= kMaxSize; size *= 4)
+	{
+		// Copy about 256MB for each size, but at least once
+		u32 iterations = u32((256 * 1024 * 1024) / size);
+		if (iterations == 0)
+			iterations = 1;
+
+		printf("%9zu bytes |", size);
+		for (u32 src_off = 0; src_off < 4; ++src_off)
+		{
+			u64 start, end;
+			NTiming::GetPreciseTime(&start);
+			for (u32 j = 0; j < iterations; ++j)
+				memcpy_byteswap(dst, src + src_off, size);
+			NTiming::GetPreciseTime(&end);
+
+			double seconds = double(end - start) / double(freq);
+			printf(" src+%u %8.1f MB/s |", src_off, (double(size) * iterations) / (seconds * 1024.0 * 1024.0));
+		}
+		printf("\n");
+	}
+
+	free(src);
+	free(dst);
+}
@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "Utility/Hash.h"
 
+#include <string.h>
+
 //-----------------------------------------------------------------------------
 // MurmurHash2, by Austin Appleby
 // Note - This code makes a few assumptions about how your machine behaves -
@@ -132,3 +134,104 @@ unsigned int murmur2_neutral_hash ( const void * key, int len, unsigned int seed
 
 	return h;
 }
+
+//-----------------------------------------------------------------------------
+// xxHash64, by Yann Collet
+// Reads native-endian words, so like murmur2_hash the result differs between
+// little- and big-endian machines. The four independent lanes keep the main
+// loop friendly to wide/superscalar cores; it's used to detect changes to
+// texture data, so only needs to be fast and well distributed.
+//-----------------------------------------------------------------------------
+
+static const u64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const u64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const u64 XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const u64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const u64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline u64 xxh_rotl64( u64 x, u32 r )	{ return (x << r) | (x >> (64 - r)); }
+static inline u64 xxh_read64( const u8 * p )	{ u64 v; memcpy( &v, p, sizeof( v ) ); return v; }
+static inline u32 xxh_read32( const u8 * p )	{ u32 v; memcpy( &v, p, sizeof( v ) ); return v; }
+
+static inline u64 xxh_round( u64 acc, u64 input )
+{
+	acc += input * XXH_PRIME64_2;
+	acc  = xxh_rotl64( acc, 31 );
+	acc *= XXH_PRIME64_1;
+	return acc;
+}
+
+static inline u64 xxh_merge_round( u64 acc, u64 val )
+{
+	acc ^= xxh_round( 0, val );
+	acc  = acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+	return acc;
+}
+
+u64 xxhash64( const void * key, u32 len, u64 seed )
+{
+	const u8 * data = (const u8 *)key;
+	const u8 * end  = data + len;
+	u64 h;
+
+	if( len >= 32 )
+	{
+		const u8 * limit = end - 32;
+
+		u64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		u64 v2 = seed + XXH_PRIME64_2;
+		u64 v3 = seed;
+		u64 v4 = seed - XXH_PRIME64_1;
+
+		do
+		{
+			v1 = xxh_round( v1, xxh_read64( data +  0 ) );
+			v2 = xxh_round( v2, xxh_read64( data +  8 ) );
+			v3 = xxh_round( v3, xxh_read64( data + 16 ) );
+			v4 = xxh_round( v4, xxh_read64( data + 24 ) );
+			data += 32;
+		}
+		while( data <= limit );
+
+		h = xxh_rotl64( v1, 1 ) + xxh_rotl64( v2, 7 ) + xxh_rotl64( v3, 12 ) + xxh_rotl64( v4, 18 );
+		h = xxh_merge_round( h, v1 );
+		h = xxh_merge_round( h, v2 );
+		h = xxh_merge_round( h, v3 );
+		h = xxh_merge_round( h, v4 );
+	}
+	else
+	{
+		h = seed + XXH_PRIME64_5;
+	}
+
+	h += len;
+
+	while( data + 8 <= end )
+	{
+		h ^= xxh_round( 0, xxh_read64( data ) );
+		h  = xxh_rotl64( h, 27 ) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		data += 8;
+	}
+
+	if( data + 4 <= end )
+	{
+		h ^= (u64)xxh_read32( data ) * XXH_PRIME64_1;
+		h  = xxh_rotl64( h, 23 ) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		data += 4;
+	}
+
+	while( data < end )
+	{
+		h ^= (*data) * XXH_PRIME64_5;
+		h  = xxh_rotl64( h, 11 ) * XXH_PRIME64_1;
+		data++;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
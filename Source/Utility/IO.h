@@ -35,9 +35,16 @@ namespace IO
 		bool		Move( const char * p_existing, const char * p_new );
 		bool		Delete( const char * p_file );
 		bool		Exists( const char * p_path );
+		bool		GetSizeAndTime( const char * p_file, u64 * p_size, u64 * p_time );	// Time is only good for spotting changes
 #ifdef DAEDALUS_PSP
 		int			Stat( const char *p_file, SceIoStat *stat );
 #endif
+#ifdef DAEDALUS_POSIX
+		// Maps the first size bytes of a file copy-on-write. Writes through the
+		// mapping are private to this process and never reach the file.
+		void *		Map( const char * p_file, u32 size );
+		void		Unmap( void * p_mem, u32 size );
+#endif
 
 	}
 	namespace Directory
@@ -0,0 +1,39 @@
+/*
+Copyright (C) 2007 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef UTILITY_JOB_H_
+#define UTILITY_JOB_H_
+
+class SJob;
+typedef int (*JobFunction)( SJob * job );
+
+// Jobs are copied when they're queued, so derived classes should hold their
+// data by value (or by pointers which outlive the job) and have no destructor
+// work to do.
+class SJob
+{
+public:
+	JobFunction			InitJob;		// Called when the job is queued, on the queueing thread
+	JobFunction			DoJob;			// Called on whichever thread runs the job
+	JobFunction			FiniJob;		// Called after DoJob
+};
+
+#endif // UTILITY_JOB_H_
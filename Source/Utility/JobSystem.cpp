@@ -0,0 +1,447 @@
+/*
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "Utility/JobSystem.h"
+
+#include <string.h>
+
+#include <thread>
+
+#include "Debug/DBGConsole.h"
+#include "Utility/AtomicPrimitives.h"
+#include "Utility/Cond.h"
+
+CJobSystem gJobSystem;
+
+// Which worker (if any) the current thread is, so jobs it queues stay local
+static thread_local s32	tWorkerIndex = -1;
+
+static const u32 kSlotIndexBits = 8;
+static const u32 kSlotIndexMask = (1 << kSlotIndexBits) - 1;
+static const u32 kGenerationMask = 0xffffffff >> kSlotIndexBits;
+
+// Enough for the fan-in we use - anything beyond this is waited for when queued
+static const u32 kMaxContinuations = 8;
+
+DAEDALUS_STATIC_ASSERT( CJobSystem::kMaxJobs == (1 << kSlotIndexBits) );
+
+struct SJobSlot
+{
+	u64				Data[ CJobSystem::kMaxJobSize / sizeof( u64 ) ];
+
+	volatile u32	Generation;			// Bumped when the job finishes. Handles carry the generation they were issued with.
+	volatile u32	PendingCount;		// Unfinished dependencies, plus one until AddJob has registered them all
+	u32				NumContinuations;	// Jobs waiting on this one
+	u32				Continuations[ kMaxContinuations ];
+};
+
+//*****************************************************************************
+//	Bounded multi-producer/multi-consumer queue of slot indices (after Dmitry
+//	Vyukov's). Each cell's sequence number says whether it's ready to be
+//	written (== pos) or read (== pos + 1) for a given position, so producers
+//	and consumers only contend on their own position counter.
+//	Every queue is as big as the slot pool, so a push can never fail.
+//*****************************************************************************
+class CJobQueue
+{
+public:
+	CJobQueue()
+	{
+		for( u32 i = 0; i < kCapacity; ++i )
+		{
+			mCells[ i ].Sequence = i;
+			mCells[ i ].Value = 0;
+		}
+		mEnqueuePos = 0;
+		mDequeuePos = 0;
+	}
+
+	bool Push( u32 value )
+	{
+		Cell *	cell;
+		u32		pos( mEnqueuePos );
+		for( ;; )
+		{
+			cell = &mCells[ pos & kMask ];
+			s32 diff( s32( AtomicLoadAcquire( &cell->Sequence ) - pos ) );
+			if( diff == 0 )
+			{
+				if( AtomicCompareAndSwap( &mEnqueuePos, pos, pos + 1 ) )
+					break;
+			}
+			else if( diff < 0 )
+			{
+				return false;		// Full
+			}
+			pos = mEnqueuePos;
+		}
+
+		cell->Value = value;
+		AtomicStoreRelease( &cell->Sequence, pos + 1 );
+		return true;
+	}
+
+	bool Pop( u32 * value )
+	{
+		Cell *	cell;
+		u32		pos( mDequeuePos );
+		for( ;; )
+		{
+			cell = &mCells[ pos & kMask ];
+			s32 diff( s32( AtomicLoadAcquire( &cell->Sequence ) - (pos + 1) ) );
+			if( diff == 0 )
+			{
+				if( AtomicCompareAndSwap( &mDequeuePos, pos, pos + 1 ) )
+					break;
+			}
+			else if( diff < 0 )
+			{
+				return false;		// Empty
+			}
+			pos = mDequeuePos;
+		}
+
+		*value = cell->Value;
+		AtomicStoreRelease( &cell->Sequence, pos + kCapacity );
+		return true;
+	}
+
+private:
+	static const u32 kCapacity = CJobSystem::kMaxJobs;
+	static const u32 kMask = kCapacity - 1;
+
+	struct Cell
+	{
+		volatile u32	Sequence;
+		u32				Value;
+	};
+
+	Cell			mCells[ kCapacity ];
+	u8				mPad0[ 64 ];			// Keep producers and consumers off each other's cache lines
+	volatile u32	mEnqueuePos;
+	u8				mPad1[ 64 ];
+	volatile u32	mDequeuePos;
+};
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJobSystem::CJobSystem()
+:	mSlots( nullptr )
+,	mFreeSlots( nullptr )
+,	mQueues( nullptr )
+,	mNumWorkers( 0 )
+,	mNextQueue( 0 )
+,	mQueuedJobs( 0 )
+,	mWorkAvailable( nullptr )
+,	mQuit( false )
+{
+}
+
+CJobSystem::~CJobSystem()
+{
+	Stop();
+}
+
+bool CJobSystem::Start( u32 num_workers )
+{
+	if( mNumWorkers > 0 )
+		return true;
+
+	if( num_workers == 0 )
+	{
+		u32 num_cores( std::thread::hardware_concurrency() );
+		num_workers = num_cores > 1 ? num_cores - 1 : 1;
+	}
+	if( num_workers > kMaxWorkers )
+		num_workers = kMaxWorkers;
+
+	mSlots = new SJobSlot[ kMaxJobs ];
+	mFreeSlots = new CJobQueue;
+	mQueues = new CJobQueue[ num_workers ];
+	mWorkAvailable = CondCreate();
+	mQuit = false;
+	mQueuedJobs = 0;
+
+	for( u32 i = 0; i < kMaxJobs; ++i )
+	{
+		mSlots[ i ].Generation = 1;
+		mSlots[ i ].PendingCount = 0;
+		mSlots[ i ].NumContinuations = 0;
+		mFreeSlots->Push( i );
+	}
+
+	static const char * const kWorkerNames[ kMaxWorkers ] =
+	{
+		"Job0", "Job1", "Job2", "Job3", "Job4", "Job5", "Job6", "Job7",
+		"Job8", "Job9", "Job10", "Job11", "Job12", "Job13", "Job14", "Job15",
+	};
+
+	for( u32 i = 0; i < num_workers; ++i )
+	{
+		SWorker & worker( mWorkers[ i ] );
+		worker.System = this;
+		worker.Index = i;
+		worker.Thread = CreateThread( kWorkerNames[ i ], &WorkerMain, &worker );
+		if( worker.Thread == kInvalidThreadHandle )
+		{
+			DBGConsole_Msg( 0, "Failed to start job worker %d", i );
+			break;
+		}
+		mNumWorkers++;
+	}
+
+	DBGConsole_Msg( 0, "Job system running %d workers", mNumWorkers );
+	return true;
+}
+
+void CJobSystem::Stop()
+{
+	if( mSlots == nullptr )
+		return;
+
+	mSleepMutex.Lock();
+	mQuit = true;
+	mSleepMutex.Unlock();
+
+	for( u32 i = 0; i < mNumWorkers; ++i )
+	{
+		CondSignal( mWorkAvailable );
+	}
+	for( u32 i = 0; i < mNumWorkers; ++i )
+	{
+		JoinThread( mWorkers[ i ].Thread, -1 );
+		mWorkers[ i ].Thread = kInvalidThreadHandle;
+	}
+	mNumWorkers = 0;
+
+	CondDestroy( mWorkAvailable );
+	mWorkAvailable = nullptr;
+	delete [] mQueues;
+	mQueues = nullptr;
+	delete mFreeSlots;
+	mFreeSlots = nullptr;
+	delete [] mSlots;
+	mSlots = nullptr;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+JobHandle CJobSystem::AddJob( const SJob * job, u32 job_size, const JobHandle * dependencies, u32 num_dependencies )
+{
+	u32 index;
+	if( mNumWorkers == 0 || job_size > kMaxJobSize || !mFreeSlots->Pop( &index ) )
+	{
+		#ifdef DAEDALUS_ENABLE_ASSERTS
+		DAEDALUS_ASSERT( job_size <= kMaxJobSize, "Job is too large: %d bytes", job_size );
+		#endif
+		RunJobInline( job, job_size, dependencies, num_dependencies );
+		return kInvalidJob;
+	}
+
+	SJobSlot &	slot( mSlots[ index ] );
+	SJob *		run( reinterpret_cast< SJob * >( slot.Data ) );
+
+	memcpy( slot.Data, job, job_size );
+	if( run->InitJob )
+		run->InitJob( run );
+
+	JobHandle	handle( (slot.Generation << kSlotIndexBits) | index );
+
+	// Hold the job back until we've finished registering with its dependencies
+	slot.PendingCount = 1;
+
+	for( u32 i = 0; i < num_dependencies; ++i )
+	{
+		{
+			MutexLock lock( &mDependencyMutex );
+			if( IsJobFinished( dependencies[ i ] ) )
+				continue;
+
+			SJobSlot & parent( mSlots[ dependencies[ i ] & kSlotIndexMask ] );
+			if( parent.NumContinuations < kMaxContinuations )
+			{
+				parent.Continuations[ parent.NumContinuations++ ] = index;
+				AtomicIncrement( &slot.PendingCount );
+				continue;
+			}
+		}
+
+		// Nowhere to record it, so just wait (outside the lock, which finishing jobs need)
+		WaitForJob( dependencies[ i ] );
+	}
+
+	ReleaseDependency( index );
+	return handle;
+}
+
+void CJobSystem::RunJobInline( const SJob * job, u32 job_size, const JobHandle * dependencies, u32 num_dependencies )
+{
+	for( u32 i = 0; i < num_dependencies; ++i )
+	{
+		WaitForJob( dependencies[ i ] );
+	}
+
+	// Run from a copy, as if it had been queued
+	u64 data[ kMaxJobSize / sizeof( u64 ) ];
+	SJob * run( job_size <= sizeof( data ) ? reinterpret_cast< SJob * >( data ) : const_cast< SJob * >( job ) );
+	if( run != job )
+		memcpy( data, job, job_size );
+
+	if( run->InitJob )	run->InitJob( run );
+	if( run->DoJob )	run->DoJob( run );
+	if( run->FiniJob )	run->FiniJob( run );
+}
+
+bool CJobSystem::IsJobFinished( JobHandle handle ) const
+{
+	if( handle == kInvalidJob )
+		return true;
+
+	const SJobSlot & slot( mSlots[ handle & kSlotIndexMask ] );
+	return AtomicLoadAcquire( &slot.Generation ) != (handle >> kSlotIndexBits);
+}
+
+void CJobSystem::WaitForJob( JobHandle handle )
+{
+	while( !IsJobFinished( handle ) )
+	{
+		if( !TryRunJob( tWorkerIndex ) )
+		{
+			ThreadYield();
+		}
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CJobSystem::ReleaseDependency( u32 slot_index )
+{
+	if( AtomicDecrement( &mSlots[ slot_index ].PendingCount ) == 0 )
+	{
+		Enqueue( slot_index );
+	}
+}
+
+void CJobSystem::Enqueue( u32 slot_index )
+{
+	u32 queue( tWorkerIndex >= 0 ? u32( tWorkerIndex ) : AtomicIncrement( &mNextQueue ) % mNumWorkers );
+
+	mQueues[ queue ].Push( slot_index );
+	AtomicIncrement( &mQueuedJobs );
+
+	// Taking the lock means a worker can't miss this between checking mQueuedJobs and sleeping
+	mSleepMutex.Lock();
+	mSleepMutex.Unlock();
+	CondSignal( mWorkAvailable );
+}
+
+bool CJobSystem::TryRunJob( s32 worker_index )
+{
+	// Start with our own queue, then try to steal from the others
+	u32 first( worker_index >= 0 ? u32( worker_index ) : 0 );
+	for( u32 i = 0; i < mNumWorkers; ++i )
+	{
+		u32 slot_index;
+		if( mQueues[ (first + i) % mNumWorkers ].Pop( &slot_index ) )
+		{
+			AtomicDecrement( &mQueuedJobs );
+			RunJob( slot_index );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CJobSystem::RunJob( u32 slot_index )
+{
+	SJobSlot &	slot( mSlots[ slot_index ] );
+	SJob *		run( reinterpret_cast< SJob * >( slot.Data ) );
+
+	if( run->DoJob )	run->DoJob( run );
+	if( run->FiniJob )	run->FiniJob( run );
+
+	u32 num_continuations;
+	u32 continuations[ kMaxContinuations ];
+	{
+		MutexLock lock( &mDependencyMutex );
+
+		u32 generation( (slot.Generation + 1) & kGenerationMask );
+		AtomicStoreRelease( &slot.Generation, generation != 0 ? generation : 1 );
+
+		num_continuations = slot.NumContinuations;
+		memcpy( continuations, slot.Continuations, num_continuations * sizeof( u32 ) );
+		slot.NumContinuations = 0;
+	}
+
+	mFreeSlots->Push( slot_index );
+
+	for( u32 i = 0; i < num_continuations; ++i )
+	{
+		ReleaseDependency( continuations[ i ] );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 DAEDALUS_THREAD_CALL_TYPE CJobSystem::WorkerMain( void * arg )
+{
+	SWorker * worker( static_cast< SWorker * >( arg ) );
+
+	tWorkerIndex = worker->Index;
+	worker->System->WorkerLoop( worker->Index );
+	return 0;
+}
+
+void CJobSystem::WorkerLoop( u32 worker_index )
+{
+	for( ;; )
+	{
+		if( TryRunJob( worker_index ) )
+			continue;
+
+		MutexLock lock( &mSleepMutex );
+		while( s32( mQueuedJobs ) <= 0 && !mQuit )
+		{
+			CondWait( mWorkAvailable, &mSleepMutex, kTimeoutInfinity );
+		}
+
+		// Drain everything that's queued before quitting
+		if( mQuit && s32( mQueuedJobs ) <= 0 )
+			break;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool JobSystem_Init()
+{
+	return gJobSystem.Start( 0 );
+}
+
+void JobSystem_Fini()
+{
+	gJobSystem.Stop();
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2026 DaedalusX64 Team
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef UTILITY_JOBSYSTEM_H_
+#define UTILITY_JOBSYSTEM_H_
+
+#include "Utility/DaedalusTypes.h"
+#include "Utility/Job.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+struct Cond;
+class CJobQueue;
+struct SJobSlot;
+
+typedef u32 JobHandle;
+static const JobHandle kInvalidJob = 0;
+
+// A fixed pool of worker threads which run SJobs. Each worker has its own
+// lock-free queue: jobs queued by a worker go on its own queue, others are
+// spread across all of them, and a worker with nothing to do steals from the
+// others. A job can be held back until the jobs it depends on have finished.
+class CJobSystem
+{
+public:
+	CJobSystem();
+	~CJobSystem();
+
+	static const u32	kMaxJobSize = 256;
+	static const u32	kMaxJobs = 256;			// Queued or running at once
+	static const u32	kMaxWorkers = 16;
+
+	bool			Start( u32 num_workers );	// 0 for one per core, leaving one for the emulation thread
+	void			Stop();						// Finishes any outstanding jobs first
+
+	u32				GetNumWorkers() const		{ return mNumWorkers; }
+
+	// Copies the job and queues it to run once all of its dependencies have finished.
+	// If there are no workers, or no free slots, the job is run before returning and
+	// kInvalidJob is returned (which counts as finished).
+	JobHandle		AddJob( const SJob * job, u32 job_size, const JobHandle * dependencies = nullptr, u32 num_dependencies = 0 );
+
+	bool			IsJobFinished( JobHandle handle ) const;
+	void			WaitForJob( JobHandle handle );	// Runs other jobs while it waits
+
+private:
+	static u32 DAEDALUS_THREAD_CALL_TYPE	WorkerMain( void * arg );
+
+	void			WorkerLoop( u32 worker_index );
+	bool			TryRunJob( s32 worker_index );
+	void			RunJob( u32 slot_index );
+	void			RunJobInline( const SJob * job, u32 job_size, const JobHandle * dependencies, u32 num_dependencies );
+	void			ReleaseDependency( u32 slot_index );
+	void			Enqueue( u32 slot_index );
+
+private:
+	struct SWorker
+	{
+		CJobSystem *	System;
+		u32				Index;
+		ThreadHandle	Thread;
+	};
+
+	SJobSlot *		mSlots;
+	CJobQueue *		mFreeSlots;
+	CJobQueue *		mQueues;				// One per worker
+	SWorker			mWorkers[ kMaxWorkers ];
+	u32				mNumWorkers;
+
+	volatile u32	mNextQueue;				// Round robin for jobs queued from outside the pool
+	volatile u32	mQueuedJobs;			// Jobs sitting in a queue (may briefly dip below zero)
+
+	Mutex			mDependencyMutex;		// Guards slot generations and continuations
+
+	Mutex			mSleepMutex;
+	Cond *			mWorkAvailable;
+	bool			mQuit;
+};
+
+extern CJobSystem	gJobSystem;
+
+bool JobSystem_Init();
+void JobSystem_Fini();
+
+#endif // UTILITY_JOBSYSTEM_H_
@@ -276,6 +276,10 @@ bool IPreferences::OpenPreferencesFile( const char * filename )
 			preferences.ControllerIndex = CInputManager::Get()->GetConfigurationFromName( property->GetValue() );
 		}
 #endif
+		if( section->FindProperty( "ThreadedDisplayLists", &property ) )
+		{
+			preferences.ThreadedDisplayLists = property->GetBooleanValue( false );
+		}
 		if( section->FindProperty( "MemoryAccessOptimisation", &property ) )
 		{
 			preferences.MemoryAccessOptimisation = property->GetBooleanValue( false );
@@ -308,6 +312,7 @@ void IPreferences::OutputSectionDetails( const RomID & id, const SRomPreferences
 	fprintf(fh, "DoubleDisplayEnabled=%d\n",       preferences.DoubleDisplayEnabled);
 	fprintf(fh, "CleanSceneEnabled=%d\n",          preferences.CleanSceneEnabled);
 	fprintf(fh, "ClearDepthFrameBuffer=%d\n",	   preferences.ClearDepthFrameBuffer);
+	fprintf(fh, "ThreadedDisplayLists=%d\n",       preferences.ThreadedDisplayLists);
 	fprintf(fh, "AudioRateMatch=%d\n",             preferences.AudioRateMatch);
 	fprintf(fh, "VideoRateMatch=%d\n",             preferences.VideoRateMatch);
 	fprintf(fh, "FogEnabled=%d\n",                 preferences.FogEnabled);
@@ -434,6 +439,7 @@ SRomPreferences::SRomPreferences()
 	,	DoubleDisplayEnabled( true )
 	,	CleanSceneEnabled( false )
 	,	ClearDepthFrameBuffer( false )
+	,	ThreadedDisplayLists( false )
 	,	AudioRateMatch( false )
 	,	VideoRateMatch( false )
 	,	FogEnabled( false )
@@ -459,6 +465,7 @@ void SRomPreferences::Reset()
 	DoubleDisplayEnabled       = true;
 	CleanSceneEnabled          = false;
 	ClearDepthFrameBuffer	   = false;
+	ThreadedDisplayLists       = false;
 	AudioRateMatch             = false;
 	VideoRateMatch             = false;
 	FogEnabled                 = false;
@@ -482,6 +489,7 @@ void SRomPreferences::Apply() const
 	gDoubleDisplayEnabled       = g_ROM.settings.DoubleDisplayEnabled && DoubleDisplayEnabled; // I don't know why DD won't disabled if we set ||
 	gCleanSceneEnabled          = g_ROM.settings.CleanSceneEnabled || CleanSceneEnabled;
 	gClearDepthFrameBuffer      = g_ROM.settings.ClearDepthFrameBuffer || ClearDepthFrameBuffer;
+	gThreadedDisplayLists       = !g_ROM.settings.SyncDisplayLists && ThreadedDisplayLists;
 	gAudioRateMatch             = g_ROM.settings.AudioRateMatch || AudioRateMatch;
 	gVideoRateMatch             = g_ROM.settings.VideoRateMatch || VideoRateMatch;
 	gFogEnabled                 = g_ROM.settings.FogEnabled || FogEnabled;
@@ -141,6 +141,7 @@ struct SRomPreferences
 	bool						DoubleDisplayEnabled;
 	bool						CleanSceneEnabled;
 	bool						ClearDepthFrameBuffer;
+	bool						ThreadedDisplayLists;		// Can be overridden by SyncDisplayLists in RomSettings
 	bool						AudioRateMatch;
 	bool						VideoRateMatch;
 	bool						FogEnabled;
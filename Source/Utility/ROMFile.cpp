@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 #include "Debug/DBGConsole.h"
+#include "Math/SIMD.h"
 
 #include "Utility/ROMFile.h"
 #include "Utility/ROMFileCompressed.h"
@@ -146,6 +147,14 @@ void ROMFile::ByteSwap_2301( void * p_bytes, u32 length )
 {
 	u32* p = (u32*)p_bytes;
 	u32* maxp = (u32*)((u8*)p_bytes + length);
+#ifdef DAEDALUS_SIMD_SSE
+	for(; p + 4 <= maxp; p += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+		_mm_storeu_si128((__m128i *)p, v);
+	}
+#endif
 	for(; p < maxp; p++)
 	{
 		std::swap(((u16*)p)[0], ((u16*)p)[1]);
@@ -159,6 +168,16 @@ void ROMFile::ByteSwap_3210( void * p_bytes, u32 length )
 {
 	u8* p = (u8*)p_bytes;
 	u8* maxp = (u8*)(p + length);
+#ifdef DAEDALUS_SIMD_SSE
+	// Swap the bytes in each half, then the halves
+	for(; p + 16 <= maxp; p += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+		_mm_storeu_si128((__m128i *)p, v);
+	}
+#endif
 	for(; p < maxp; p+=4)
 	{
 		std::swap(p[0], p[3]);
@@ -52,9 +52,11 @@ public:
 	static	void		ByteSwap_2301( void * p_bytes, u32 length );
 	static	void		ByteSwap_3210( void * p_bytes, u32 length );
 
+			// Swap raw bytes from the file into the order the rest of the emulator expects
+			void		CorrectSwap( u8 * p_bytes, u32 length );
+
 protected:
 			bool		SetHeaderMagic( u32 magic );
-			void		CorrectSwap( u8 * p_bytes, u32 length );
 
 private:
 	virtual bool		LoadRawData( u32 bytes_to_read, u8 *p_bytes, COutputStream & messages ) = 0;
@@ -29,12 +29,23 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 #define toGzipFile(fh) ((gzFile)fh)
+
+static gzFile OpenForWriting( const char * filename, s32 compression_level )
+{
+	char mode[ 4 ] = "wb";
+	if( compression_level >= 1 && compression_level <= 9 )
+	{
+		mode[ 2 ] = char( '0' + compression_level );
+	}
+	return gzopen( filename, mode );
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
-COutStream::COutStream( const char * filename )
+COutStream::COutStream( const char * filename, s32 compression_level )
 :	mBufferCount( 0 )
-,	mFile( gzopen( filename, "wb" ) )
+,	mFile( OpenForWriting( filename, compression_level ) )
 {
 }
 
@@ -80,6 +91,14 @@ bool	COutStream::WriteData( const void * data, u32 length )
 {
 	if ( mFile != NULL )
 	{
+		//
+		// Big blocks (e.g. RDRAM) gain nothing from being copied through the buffer
+		//
+		if( length >= BUFFER_SIZE )
+		{
+			return Flush() && gzwrite( toGzipFile(mFile), data, length ) == s32( length );
+		}
+
 		const u8 *	current_ptr( reinterpret_cast< const u8 * >( data ) );
 		u32			bytes_remaining( length );
 		while( bytes_remaining > 0 )
@@ -26,7 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 class COutStream
 {
 	public:
-		COutStream( const char * filename );
+		COutStream( const char * filename, s32 compression_level = -1 );	// 1 (fastest) to 9, -1 for zlib's default
 		~COutStream();
 
 		bool					IsOpen() const;